@@ -0,0 +1,1663 @@
+/*
+ * bench_ftcs.cpp
+ * libftcs の Google Benchmark スイート
+ *
+ * 入力は bench_gen で生成した一時ファイルを使い、種類×行数ごとに
+ * ftcs_parse_file のスループット、検索のレイテンシ、共有メモリへの公開時間・読み出し側の走査・更新通知の遅延、
+ * 検索サーバーの同時接続時の応答レイテンシ（p50 / p99）を計る。
+ * 結果は make bench で JSON に書き出され、コミット間の比較に使う。
+ *
+ * 環境変数:
+ *   FTCS_BENCH_MAX_LINES  パースする最大行数（既定 10^6、10^8 まで指定可）
+ *   FTCS_BENCH_DIR        一時ファイルの置き場所（既定 /tmp）
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include "ftcs.h"
+#include "bench_gen.h"
+}
+
+/* ── 設定 ────────────────────────────────────────────────── */
+
+/* パースする最大行数の既定値。1 ケース数秒以内に収まる規模。 */
+static const size_t DEFAULT_MAX_LINES = 1000000;
+
+/* パースする最小行数 */
+static const size_t MIN_LINES = 1000;
+
+/* 検索ベンチマークのレコード数の上限（線形探索が 1 回数 ms に収まる規模） */
+static const size_t FIND_MAX_RECORDS = 100000;
+
+/* 検索で順に使うキーの個数（分岐予測やキャッシュに偏らないよう散らす） */
+static const size_t FIND_KEY_COUNT = 1024;
+
+/* 共有メモリ公開ベンチマークで使う shm 名 */
+static const char *SHM_NAME = "/ftcs_bench";
+
+/* 検索サーバーベンチマークで各接続が1反復あたりに送る要求バッチ数 */
+static const int SERVER_ROUNDS = 200;
+
+/* ── 入力ファイル ─────────────────────────────────────────── */
+
+/* 生成済みファイル（種類, 行数）→ パス。プロセス終了時に削除する */
+static std::map<std::pair<int, size_t>, std::string> g_files;
+
+/**
+ * @brief 種類と行数に対応する入力ファイルを用意する（初回のみ生成）
+ * @return ファイルパス、生成失敗時は空文字列
+ */
+static std::string input_file(bench_gen_kind_t kind, size_t lines)
+{
+    auto key = std::make_pair((int)kind, lines);
+    auto it  = g_files.find(key);
+    if (it != g_files.end()) {
+        return it->second;
+    }
+    const char *dir = getenv("FTCS_BENCH_DIR");
+    std::string path = std::string(dir ? dir : "/tmp") + "/ftcs_bench_"
+                     + bench_schema(kind)->name + "_" + std::to_string(lines) + ".txt";
+    if (bench_gen_file(path.c_str(), kind, lines) != 0) {
+        return std::string();
+    }
+    g_files[key] = path;
+    return path;
+}
+
+/**
+ * @brief ファイルサイズを返す
+ */
+static size_t file_size(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+/**
+ * @brief 生成した入力ファイルをすべて削除する
+ */
+static void remove_input_files()
+{
+    for (auto &f : g_files) {
+        unlink(f.second.c_str());
+    }
+    g_files.clear();
+}
+
+/* ── ベンチマーク本体 ─────────────────────────────────────── */
+
+/**
+ * @brief ftcs_parse_file のスループット（bytes_per_second / items_per_second）
+ *
+ * キーを直前の行と同じ順で予測できた割合を key_hit_rate に出す。
+ */
+static void BM_ParseFile(benchmark::State &state, bench_gen_kind_t kind,
+                         ftcs_io_backend_t backend, const ftcs_allocator_t *allocator)
+{
+    const bench_schema_t *schema = bench_schema(kind);
+    size_t lines = (size_t)state.range(0);
+    std::string path = input_file(kind, lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+    ftcs_parser_config_t cfg = *schema->parser_config;
+    cfg.io_backend = backend;
+    cfg.allocator  = allocator;
+
+    size_t records = 0;
+    for (auto _ : state) {
+        ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, schema->mapping,
+                                                schema->struct_size);
+        if (!rs) {
+            state.SkipWithError("ftcs_parse_file failed");
+            return;
+        }
+        records = rs->count;
+        benchmark::DoNotOptimize(rs->records);
+        ftcs_record_set_free(rs);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size(path)));
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+    state.counters["records"] = (double)records;
+
+    /* キー順の予測が当たった割合は、統計つきで計測外にもう一度パースして求める */
+    ftcs_parse_stats_t st = {};
+    cfg.stats = &st;
+    ftcs_record_set_free(ftcs_parse_file(path.c_str(), &cfg, schema->mapping, schema->struct_size));
+    if (st.key_hits + st.key_misses > 0) {
+        state.counters["key_hit_rate"] = (double)st.key_hits / (double)(st.key_hits + st.key_misses);
+    }
+}
+
+/**
+ * @brief フィルタ式つきのパース（sample 形式、行数 range(0)、選択率 range(1) %）
+ *
+ * ID は行の先頭フィールドなので、棄却行は NAME / VALUE を変換せずに読み飛ばされる。
+ */
+static void BM_ParseFilter(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    size_t lines   = (size_t)state.range(0);
+    size_t percent = (size_t)state.range(1);
+    std::string path = input_file(BENCH_GEN_SAMPLE, lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+    std::string expr = "ID<=" + std::to_string(lines * percent / 100);
+    ftcs_parser_config_t cfg = *schema->parser_config;
+    cfg.filter = expr.c_str();
+
+    size_t records = 0;
+    size_t bytes   = 0;
+    for (auto _ : state) {
+        ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, schema->mapping,
+                                                schema->struct_size);
+        if (!rs) {
+            state.SkipWithError("ftcs_parse_file failed");
+            return;
+        }
+        records = rs->count;
+        bytes   = rs->capacity * rs->struct_size;
+        benchmark::DoNotOptimize(rs->records);
+        ftcs_record_set_free(rs);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size(path)));
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+    state.counters["records"]      = (double)records;
+    state.counters["record_bytes"] = (double)bytes;
+}
+
+/**
+ * @brief 32 フィールドの wide 形式から 2 フィールドだけ使う場合の読み込み方式の比較
+ *
+ * range(0) は行数、range(1) は方式（0: 全フィールド変換、1: projection、
+ * 2: ftcs_parse_lazy で位置だけ記録し、全レコードの 2 フィールドを参照する）。
+ */
+static void BM_ParseProjection(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_WIDE);
+    size_t lines = (size_t)state.range(0);
+    int    mode  = (int)state.range(1);
+    std::string path = input_file(BENCH_GEN_WIDE, lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+    static const char *const fields[] = { "ID", "D03", nullptr };
+    ftcs_parser_config_t cfg = *schema->parser_config;
+    if (mode == 1) {
+        cfg.projection = fields;
+    }
+
+    for (auto _ : state) {
+        if (mode == 2) {
+            ftcs_lazy_set_t *ls = ftcs_parse_lazy(path.c_str(), &cfg, schema->mapping,
+                                                  schema->struct_size);
+            if (!ls) {
+                state.SkipWithError("ftcs_parse_lazy failed");
+                return;
+            }
+            int id  = ftcs_lazy_field_index(ls, fields[0]);
+            int d03 = ftcs_lazy_field_index(ls, fields[1]);
+            for (size_t i = 0; i < ftcs_lazy_count(ls); i++) {
+                benchmark::DoNotOptimize(ftcs_lazy_field(ls, i, id));
+                benchmark::DoNotOptimize(ftcs_lazy_field(ls, i, d03));
+            }
+            ftcs_lazy_free(ls);
+            continue;
+        }
+        ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, schema->mapping,
+                                                schema->struct_size);
+        if (!rs) {
+            state.SkipWithError("ftcs_parse_file failed");
+            return;
+        }
+        benchmark::DoNotOptimize(rs->records);
+        ftcs_record_set_free(rs);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size(path)));
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+}
+
+/**
+ * @brief sparse 形式（ID が 8 おき）を疎なレコード集合に読み込む（range(0) は行数）
+ *
+ * BM_ParseFile/sparse の密な配置と比べ、確保バイト数（record_bytes）とスループットを見る。
+ */
+static void BM_ParseSparse(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SPARSE_ID);
+    size_t lines = (size_t)state.range(0);
+    std::string path = input_file(BENCH_GEN_SPARSE_ID, lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+
+    size_t bytes = 0;
+    for (auto _ : state) {
+        ftcs_sparse_set_t *ss = ftcs_parse_sparse(path.c_str(), schema->parser_config,
+                                                  schema->mapping, schema->struct_size);
+        if (!ss) {
+            state.SkipWithError("ftcs_parse_sparse failed");
+            return;
+        }
+        bytes = ftcs_sparse_bytes(ss);
+        benchmark::DoNotOptimize(ss);
+        ftcs_sparse_free(ss);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size(path)));
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+    state.counters["record_bytes"] = (double)bytes;
+}
+
+/* BM_Compact の反復回数。1回ごとに計測外で全体をパースし直すため、自動で決まる回数
+ * （計測区間の合計が最小時間に届くまで）では切り詰め自体が速すぎて終わらない */
+static const int COMPACT_ITERATIONS = 5;
+
+/**
+ * @brief パース直後のレコード集合を ftcs_record_set_compact で容量に合わせる時間（range(0) は行数）
+ *
+ * range(1) はアロケーター（0: malloc、1: ftcs_hugepage_allocator）。
+ * 切り詰め前後の確保バイト数（reserved_before / reserved_after）と、切り詰め後に
+ * 物理メモリに載っているバイト数（resident_after）を報告する。
+ */
+static void BM_Compact(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    size_t lines = (size_t)state.range(0);
+    std::string path = input_file(BENCH_GEN_SAMPLE, lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+    ftcs_allocator_t     huge = ftcs_hugepage_allocator();
+    ftcs_parser_config_t cfg  = *schema->parser_config;
+    if (state.range(1) == 1) {
+        cfg.allocator = &huge;
+    }
+
+    ftcs_memory_info_t before = {};
+    ftcs_memory_info_t after  = {};
+    for (auto _ : state) {
+        state.PauseTiming();
+        ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, schema->mapping,
+                                                schema->struct_size);
+        if (!rs) {
+            state.SkipWithError("ftcs_parse_file failed");
+            return;
+        }
+        ftcs_record_set_memory_info(rs, &before);
+        state.ResumeTiming();
+        if (ftcs_record_set_compact(rs, 0) != 0) {
+            state.SkipWithError("ftcs_record_set_compact failed");
+            return;
+        }
+        state.PauseTiming();
+        ftcs_record_set_memory_info(rs, &after);
+        ftcs_record_set_free(rs);
+        state.ResumeTiming();
+    }
+    state.counters["reserved_before"] = (double)before.reserved_bytes;
+    state.counters["reserved_after"]  = (double)after.reserved_bytes;
+    state.counters["resident_after"]  = (double)after.resident_bytes;
+}
+
+/**
+ * @brief 分割実行パーサーで1回の呼び出しにかかる時間の分布（sample 形式、行数 range(0)）
+ *
+ * range(1) はステップ1回の時間予算（マイクロ秒）。0 は ftcs_parse_file を1回で呼ぶ場合で、
+ * その所要時間がそのまま1回の停止時間になる。p99_ns / max_ns がイベントループを止める時間。
+ */
+static void BM_ParserStep(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    size_t   lines     = (size_t)state.range(0);
+    uint64_t budget_ns = (uint64_t)state.range(1) * 1000;
+    std::string path = input_file(BENCH_GEN_SAMPLE, lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+
+    std::vector<double> pauses;
+    for (auto _ : state) {
+        ftcs_record_set_t *rs;
+        if (budget_ns == 0) {
+            auto t0 = std::chrono::steady_clock::now();
+            rs = ftcs_parse_file(path.c_str(), schema->parser_config, schema->mapping,
+                                 schema->struct_size);
+            pauses.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count());
+        } else {
+            ftcs_parser_t *p = ftcs_parser_open(path.c_str(), schema->parser_config,
+                                                schema->mapping, schema->struct_size);
+            int more = p ? 1 : -1;
+            while (more == 1) {
+                auto t0 = std::chrono::steady_clock::now();
+                more = ftcs_parser_step(p, 0, budget_ns);
+                pauses.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - t0).count());
+            }
+            rs = ftcs_parser_finish(p);
+        }
+        if (!rs) {
+            state.SkipWithError("parse failed");
+            return;
+        }
+        benchmark::DoNotOptimize(rs->records);
+        ftcs_record_set_free(rs);
+    }
+    std::sort(pauses.begin(), pauses.end());
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size(path)));
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+    state.counters["steps"]  = (double)pauses.size() / (double)state.iterations();
+    state.counters["p99_ns"] = pauses[pauses.size() * 99 / 100];
+    state.counters["max_ns"] = pauses.back();
+}
+
+/* ftcs_parse_resume で取り込む、追記されたとみなす末尾の行数 */
+static const size_t RESUME_TAIL_LINES = 10;
+
+/**
+ * @brief 末尾 RESUME_TAIL_LINES 行の追記を取り込む時間（sample 形式、行数 range(0)）
+ *
+ * mode 0: ファイル全体を ftcs_parse_file で読み直す、
+ * mode 1: 末尾の行の直前まで解析済みの記録から ftcs_parse_resume で続きだけ読む
+ * （毎回レコード数と記録を末尾の行の直前に戻す）。
+ */
+static void BM_ParseResume(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    size_t lines = (size_t)state.range(0);
+    int    mode  = (int)state.range(1);
+    std::string path = input_file(BENCH_GEN_SAMPLE, lines);
+    ftcs_checkpoint_t  cp = {};
+    ftcs_record_set_t *rs = nullptr;
+    if (path.empty()
+        || ftcs_parse_resume(&cp, path.c_str(), schema->parser_config, schema->mapping,
+                             schema->struct_size, &rs) < 0) {
+        state.SkipWithError("input generation or parse failed");
+        ftcs_record_set_free(rs);
+        return;
+    }
+    /* 末尾 RESUME_TAIL_LINES 行の先頭のバイト位置を求め、そこまで解析済みの記録を作る */
+    FILE *fp = fopen(path.c_str(), "r");
+    std::vector<uint64_t> starts;
+    uint64_t off = 0;
+    int c;
+    starts.push_back(0);
+    while (fp && (c = fgetc(fp)) != EOF) {
+        off++;
+        if (c == '\n') {
+            starts.push_back(off);
+        }
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    ftcs_checkpoint_t base = cp;
+    base.offset  = starts[starts.size() - 1 - RESUME_TAIL_LINES];
+    base.records = cp.records - RESUME_TAIL_LINES;
+    size_t base_count = rs->count - RESUME_TAIL_LINES;
+
+    for (auto _ : state) {
+        if (mode == 0) {
+            ftcs_record_set_t *full = ftcs_parse_file(path.c_str(), schema->parser_config,
+                                                      schema->mapping, schema->struct_size);
+            benchmark::DoNotOptimize(full);
+            ftcs_record_set_free(full);
+        } else {
+            cp        = base;
+            rs->count = base_count;
+            long added = ftcs_parse_resume(&cp, path.c_str(), schema->parser_config,
+                                           schema->mapping, schema->struct_size, &rs);
+            benchmark::DoNotOptimize(added);
+        }
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * RESUME_TAIL_LINES));
+    ftcs_record_set_free(rs);
+}
+
+/* 種類混在ファイルに含めるレコードの種類数 */
+static const int MULTI_TAGS = 4;
+
+/* 種類混在ファイルの1レコード（sample 形式に判別キー TYPE を加えたもの） */
+typedef struct {
+    char   type[16];
+    int    id;
+    char   name[64];
+    double value;
+} bench_tagged_t;
+
+/**
+ * @brief sample 形式の各レコード行の先頭に TYPE=t<レコード番号 % MULTI_TAGS> を付けた入力ファイルを用意する
+ * @return ファイルパス、生成失敗時は空文字列
+ */
+static std::string multi_input_file(size_t lines)
+{
+    auto key = std::make_pair((int)BENCH_GEN_KIND_COUNT, lines);
+    auto it  = g_files.find(key);
+    if (it != g_files.end()) {
+        return it->second;
+    }
+    std::string src = input_file(BENCH_GEN_SAMPLE, lines);
+    if (src.empty()) {
+        return std::string();
+    }
+    std::string path = src.substr(0, src.size() - 4) + "_tagged.txt";
+    FILE *in  = fopen(src.c_str(), "r");
+    FILE *out = fopen(path.c_str(), "w");
+    char  line[256];
+    size_t i = 0;
+    while (in && out && fgets(line, sizeof(line), in)) {
+        if (line[0] == '#') {
+            fputs(line, out);
+        } else {
+            fprintf(out, "TYPE=t%zu %s", i++ % MULTI_TAGS, line);
+        }
+    }
+    int ok = in && out;
+    if (in) {
+        fclose(in);
+    }
+    if (out && fclose(out) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        unlink(path.c_str());
+        return std::string();
+    }
+    g_files[key] = path;
+    return path;
+}
+
+/**
+ * @brief MULTI_TAGS 種類が混在するファイルを種類ごとのレコード集合にする時間（行数 range(0)）
+ *
+ * mode 0: 種類ごとに filter "TYPE=t<k>" を付けて ftcs_parse_file を MULTI_TAGS 回、
+ * mode 1: ftcs_parse_multi で1回読み、判別キーの値で振り分ける。
+ */
+static void BM_ParseMulti(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    size_t lines = (size_t)state.range(0);
+    int    mode  = (int)state.range(1);
+    std::string path = multi_input_file(lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+    /* C++ では _Generic が使えないため手動定義 */
+    static const ftcs_field_mapping_t tagged_mapping[] = {
+        { "TYPE",  offsetof(bench_tagged_t, type),  sizeof(char[16]), FTCS_TYPE_STRING, FTCS_TYPE_STRING },
+        { "ID",    offsetof(bench_tagged_t, id),    sizeof(int),      FTCS_TYPE_INT,    FTCS_TYPE_INT    },
+        { "NAME",  offsetof(bench_tagged_t, name),  sizeof(char[64]), FTCS_TYPE_STRING, FTCS_TYPE_STRING },
+        { "VALUE", offsetof(bench_tagged_t, value), sizeof(double),   FTCS_TYPE_DOUBLE, FTCS_TYPE_DOUBLE },
+        { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
+    };
+    static const char *const tags[MULTI_TAGS]    = { "t0", "t1", "t2", "t3" };
+    static const char *const filters[MULTI_TAGS] = { "TYPE=t0", "TYPE=t1", "TYPE=t2", "TYPE=t3" };
+    ftcs_schema_t schemas[MULTI_TAGS];
+    for (int k = 0; k < MULTI_TAGS; k++) {
+        schemas[k] = { tags[k], schema->mapping, schema->struct_size };
+    }
+
+    for (auto _ : state) {
+        ftcs_record_set_t *out[MULTI_TAGS] = {};
+        if (mode == 0) {
+            ftcs_parser_config_t cfg = *schema->parser_config;
+            for (int k = 0; k < MULTI_TAGS; k++) {
+                cfg.filter = filters[k];
+                out[k] = ftcs_parse_file(path.c_str(), &cfg, tagged_mapping, sizeof(bench_tagged_t));
+            }
+        } else if (ftcs_parse_multi(path.c_str(), schema->parser_config, "TYPE",
+                                    schemas, MULTI_TAGS, out) != 0) {
+            state.SkipWithError("ftcs_parse_multi failed");
+            return;
+        }
+        for (int k = 0; k < MULTI_TAGS; k++) {
+            benchmark::DoNotOptimize(out[k]);
+            ftcs_record_set_free(out[k]);
+        }
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size(path)));
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+}
+
+/* 幅の広いレコードの数値列の要素数（センサー1件分のサンプル数） */
+static const int WIDE_SAMPLES = 64;
+
+/* 幅の広いレコードの入力ファイルの行数の上限（1行が 600 バイト前後になるため） */
+static const size_t WIDE_MAX_LINES = 100000;
+
+/* 数値列を持つ幅の広いレコード */
+typedef struct {
+    int   id;
+    float samples[WIDE_SAMPLES];
+} bench_wide_t;
+
+/**
+ * @brief WIDE_SAMPLES 個の数値を持つ行の入力ファイルを用意する
+ *
+ * as_array が 0 なら要素ごとのキー（S0=... S63=...）、非ゼロなら1個の配列キー（SAMPLES=...,...）で書く。
+ * @return ファイルパス、生成失敗時は空文字列
+ */
+static std::string wide_input_file(size_t lines, int as_array)
+{
+    auto key = std::make_pair((int)BENCH_GEN_KIND_COUNT + 1 + as_array, lines);
+    auto it  = g_files.find(key);
+    if (it != g_files.end()) {
+        return it->second;
+    }
+    const char *dir = getenv("FTCS_BENCH_DIR");
+    std::string path = std::string(dir ? dir : "/tmp") + "/ftcs_bench_wide_"
+                     + (as_array ? "array_" : "keys_") + std::to_string(lines) + ".txt";
+    FILE *out = fopen(path.c_str(), "w");
+    if (!out) {
+        return std::string();
+    }
+    for (size_t i = 0; i < lines; i++) {
+        fprintf(out, "ID=%zu %s", i, as_array ? "SAMPLES=" : "");
+        for (int k = 0; k < WIDE_SAMPLES; k++) {
+            double v = (double)((i * 31 + (size_t)k * 7) % 4000) / 8.0;
+            if (as_array) {
+                fprintf(out, k ? ",%.3f" : "%.3f", v);
+            } else {
+                fprintf(out, k ? " S%d=%.3f" : "S%d=%.3f", k, v);
+            }
+        }
+        fputc('\n', out);
+    }
+    if (fclose(out) != 0) {
+        unlink(path.c_str());
+        return std::string();
+    }
+    g_files[key] = path;
+    return path;
+}
+
+/**
+ * @brief WIDE_SAMPLES 個の float を持つ行のパース時間（行数 range(0)）
+ *
+ * mode 0: 要素ごとに S<k> キーを書き、マッピングも 64 個のスカラー float にする、
+ * mode 1: SAMPLES キー1個にカンマ区切りで書き、FTCS_TYPE_ARRAY の1エントリで変換する。
+ */
+static void BM_ParseArrayField(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    size_t lines = (size_t)state.range(0);
+    int    mode  = (int)state.range(1);
+    std::string path = wide_input_file(lines, mode);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+    /* C++ では _Generic が使えないため手動定義（キー名の文字列はマッピングより長く生存させる） */
+    static std::vector<std::string>          names;
+    static std::vector<ftcs_field_mapping_t> keys_mapping;
+    if (keys_mapping.empty()) {
+        keys_mapping.push_back({ "ID", offsetof(bench_wide_t, id), sizeof(int), FTCS_TYPE_INT, FTCS_TYPE_INT });
+        for (int k = 0; k < WIDE_SAMPLES; k++) {
+            names.push_back("S" + std::to_string(k));
+        }
+        for (int k = 0; k < WIDE_SAMPLES; k++) {
+            keys_mapping.push_back({ names[k].c_str(), offsetof(bench_wide_t, samples) + k * sizeof(float),
+                                     sizeof(float), FTCS_TYPE_FLOAT, FTCS_TYPE_FLOAT });
+        }
+        keys_mapping.push_back({ nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT });
+    }
+    static const ftcs_field_mapping_t array_mapping[] = {
+        { "ID",      offsetof(bench_wide_t, id),      sizeof(int),                 FTCS_TYPE_INT,   FTCS_TYPE_INT   },
+        { "SAMPLES", offsetof(bench_wide_t, samples), sizeof(float[WIDE_SAMPLES]), FTCS_TYPE_ARRAY, FTCS_TYPE_FLOAT },
+        { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
+    };
+    const ftcs_field_mapping_t *mapping = mode ? array_mapping : keys_mapping.data();
+
+    for (auto _ : state) {
+        ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), schema->parser_config, mapping,
+                                                sizeof(bench_wide_t));
+        if (!rs) {
+            state.SkipWithError("ftcs_parse_file failed");
+            return;
+        }
+        benchmark::DoNotOptimize(rs->records);
+        ftcs_record_set_free(rs);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size(path)));
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+}
+
+/**
+ * @brief 検索用に sample 形式をパースしておくフィクスチャ相当のヘルパー
+ */
+static ftcs_record_set_t *parse_sample(size_t records)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    std::string path = input_file(BENCH_GEN_SAMPLE, records);
+    if (path.empty()) {
+        return nullptr;
+    }
+    return ftcs_parse_file(path.c_str(), schema->parser_config, schema->mapping,
+                           schema->struct_size);
+}
+
+/**
+ * @brief 0..n-1 に散らばったキーの列を作る（乱数は固定シード）
+ */
+static std::vector<size_t> scattered_keys(size_t n)
+{
+    std::vector<size_t> keys(FIND_KEY_COUNT);
+    unsigned long long x = 88172645463325252ULL;
+    for (auto &k : keys) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        k = (size_t)(x % n);
+    }
+    return keys;
+}
+
+/**
+ * @brief ftcs_find_by_key の1回あたりのレイテンシ（線形探索）
+ */
+static void BM_FindByKey(benchmark::State &state)
+{
+    size_t n = (size_t)state.range(0);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    std::vector<std::string> keys;
+    for (size_t k : scattered_keys(n)) {
+        keys.push_back(std::to_string(k + 1)); /* ID は 1-based */
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const void *rec = ftcs_find_by_key(rs, schema->mapping, "ID",
+                                           keys[i++ % keys.size()].c_str(),
+                                           schema->struct_size);
+        benchmark::DoNotOptimize(rec);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief ftcs_key_index_find の1回あたりのレイテンシ（索引構築は計測外）
+ */
+static void BM_KeyIndexFind(benchmark::State &state)
+{
+    size_t n = (size_t)state.range(0);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    ftcs_key_index_t *idx = ftcs_key_index_build(rs, bench_schema(BENCH_GEN_SAMPLE)->mapping, "ID");
+    std::vector<std::string> keys;
+    for (size_t k : scattered_keys(n)) {
+        keys.push_back(std::to_string(k + 1)); /* ID は 1-based */
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const void *rec = ftcs_key_index_find(idx, keys[i++ % keys.size()].c_str());
+        benchmark::DoNotOptimize(rec);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    ftcs_key_index_free(idx);
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief 並べ替え済みの集合での ftcs_find_by_key の1回あたりのレイテンシ（二分探索、並べ替えは計測外）
+ */
+static void BM_SortedFindByKey(benchmark::State &state)
+{
+    size_t n = (size_t)state.range(0);
+    ftcs_record_set_t *rs = parse_sample(n);
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    if (!rs || ftcs_record_set_sort(rs, schema->mapping, "ID") != 0) {
+        state.SkipWithError("parse or sort failed");
+        ftcs_record_set_free(rs);
+        return;
+    }
+    std::vector<std::string> keys;
+    for (size_t k : scattered_keys(n)) {
+        keys.push_back(std::to_string(k + 1)); /* ID は 1-based */
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const void *rec = ftcs_find_by_key(rs, schema->mapping, "ID",
+                                           keys[i++ % keys.size()].c_str(),
+                                           schema->struct_size);
+        benchmark::DoNotOptimize(rec);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief FIND_KEY_COUNT 個のキーをまとめて引く時間（キー1個あたりの件数で報告）
+ *
+ * mode 0/1: 未整列の集合でキーごとの ftcs_find_by_key（線形探索）/ ftcs_find_many（1回の走査）、
+ * mode 2/3: ID で並べ替えた集合でキーごとの ftcs_find_by_key / ftcs_find_many（交互の二分探索）、
+ * mode 4/5: ハッシュ索引でキーごとの ftcs_key_index_find / ftcs_key_index_find_many
+ * （並べ替えと索引構築は計測外）。
+ */
+static void BM_FindMany(benchmark::State &state)
+{
+    size_t n    = (size_t)state.range(0);
+    int    mode = (int)state.range(1);
+    ftcs_record_set_t *rs = parse_sample(n);
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    if (!rs || (mode >= 2 && mode <= 3 && ftcs_record_set_sort(rs, schema->mapping, "ID") != 0)) {
+        state.SkipWithError("parse or sort failed");
+        ftcs_record_set_free(rs);
+        return;
+    }
+    ftcs_key_index_t *idx = (mode >= 4) ? ftcs_key_index_build(rs, schema->mapping, "ID") : nullptr;
+    std::vector<std::string> keys;
+    for (size_t k : scattered_keys(n)) {
+        keys.push_back(std::to_string(k + 1)); /* ID は 1-based */
+    }
+    std::vector<const char *> ptrs;
+    for (const std::string &k : keys) {
+        ptrs.push_back(k.c_str());
+    }
+    std::vector<const void *> out(ptrs.size());
+
+    for (auto _ : state) {
+        switch (mode) {
+        case 1:
+        case 3:
+            ftcs_find_many(rs, schema->mapping, "ID", ptrs.data(), ptrs.size(), out.data());
+            break;
+        case 5:
+            ftcs_key_index_find_many(idx, ptrs.data(), ptrs.size(), out.data());
+            break;
+        default:
+            for (size_t i = 0; i < ptrs.size(); i++) {
+                out[i] = idx ? ftcs_key_index_find(idx, ptrs[i])
+                             : ftcs_find_by_key(rs, schema->mapping, "ID", ptrs[i],
+                                                schema->struct_size);
+            }
+            break;
+        }
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * ptrs.size()));
+    ftcs_key_index_free(idx);
+    ftcs_record_set_free(rs);
+}
+
+/** @brief BM_Sort の比較関数が読むフィールド（qsort は比較関数に文脈を渡せないため） */
+static const ftcs_field_mapping_t *sort_field;
+
+/**
+ * @brief BM_Sort の qsort 用比較関数（sort_field の double の昇順）
+ */
+static int compare_by_field(const void *a, const void *b)
+{
+    double x = *(const double *)((const char *)a + sort_field->offset);
+    double y = *(const double *)((const char *)b + sort_field->offset);
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief VALUE（double）での並べ替え（range(0) は件数、range(1) は方式）
+ *
+ * 方式 0 は qsort と比較関数、方式 1 は ftcs_record_set_sort（LSD 基数ソート）。
+ * どちらも毎回パース直後の並びを書き戻してから並べ替える（書き戻しも計測に含む）。
+ */
+static void BM_Sort(benchmark::State &state)
+{
+    size_t n    = (size_t)state.range(0);
+    int    mode = (int)state.range(1);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    const ftcs_field_mapping_t *mapping = bench_schema(BENCH_GEN_SAMPLE)->mapping;
+    sort_field = mapping;
+    while (strcmp(sort_field->field_name, "VALUE") != 0) {
+        sort_field++;
+    }
+    std::vector<char> orig((const char *)rs->records,
+                           (const char *)rs->records + rs->count * rs->struct_size);
+
+    for (auto _ : state) {
+        memcpy(rs->records, orig.data(), orig.size());
+        if (mode == 0) {
+            qsort(rs->records, rs->count, rs->struct_size, compare_by_field);
+        } else if (ftcs_record_set_sort(rs, mapping, "VALUE") != 0) {
+            state.SkipWithError("ftcs_record_set_sort failed");
+            break;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * n));
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief ftcs_trie_find の1回あたりのレイテンシ（NAME の完全一致、構築は計測外）
+ *
+ * NAME は "Item<0〜99999>" で重複があるため、散らばったレコードの NAME をキーにする。
+ * 索引のバイト数を index_bytes に出す。
+ */
+static void BM_TrieFind(benchmark::State &state)
+{
+    size_t n = (size_t)state.range(0);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    const ftcs_field_mapping_t *mapping = bench_schema(BENCH_GEN_SAMPLE)->mapping;
+    const ftcs_field_mapping_t *m = mapping;
+    while (strcmp(m->field_name, "NAME") != 0) {
+        m++;
+    }
+    ftcs_trie_t *t = ftcs_trie_build(rs, mapping, "NAME", 0, nullptr);
+    std::vector<std::string> keys;
+    for (size_t k : scattered_keys(n)) {
+        keys.push_back((const char *)rs->records + k * rs->struct_size + m->offset);
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const void *rec = ftcs_trie_find(t, keys[i++ % keys.size()].c_str());
+        benchmark::DoNotOptimize(rec);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    state.counters["index_bytes"] = (double)ftcs_trie_bytes(t);
+    ftcs_trie_free(t);
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief ftcs_trie_prefix_count の1回あたりのレイテンシ（"Item1" 〜 "Item9" で始まる NAME の件数）
+ */
+static void BM_TriePrefixCount(benchmark::State &state)
+{
+    size_t n = (size_t)state.range(0);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    ftcs_trie_t *t = ftcs_trie_build(rs, bench_schema(BENCH_GEN_SAMPLE)->mapping, "NAME", 0, nullptr);
+    const char *prefixes[] = { "Item1", "Item23", "Item456", "Item7890", "Item9" };
+
+    size_t i = 0;
+    for (auto _ : state) {
+        size_t cnt = ftcs_trie_prefix_count(t, prefixes[i++ % 5]);
+        benchmark::DoNotOptimize(cnt);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    ftcs_trie_free(t);
+    ftcs_record_set_free(rs);
+}
+
+/** @brief BM_RangeQuery のコールバックに渡す合計先 */
+struct range_sum {
+    size_t offset; /* VALUE のオフセット */
+    double sum;
+};
+
+/** @brief BM_RangeQuery のコールバック: VALUE を合計する */
+static int sum_value(const void *record, void *arg)
+{
+    range_sum *rsum = (range_sum *)arg;
+    rsum->sum += *(const double *)((const char *)record + rsum->offset);
+    return 0;
+}
+
+/**
+ * @brief VALUE が幅 10 の範囲（約 1%）に入るレコードの件数と VALUE の合計（range(0) は件数、range(1) は方式）
+ *
+ * 方式 0 は全件を走査する素朴なループ、方式 1 は ftcs_range_count（件数だけ）、
+ * 方式 2 は ftcs_range_query で範囲内のレコードを辿る。索引の構築は計測外。
+ */
+static void BM_RangeQuery(benchmark::State &state)
+{
+    size_t n    = (size_t)state.range(0);
+    int    mode = (int)state.range(1);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    const ftcs_field_mapping_t *mapping = bench_schema(BENCH_GEN_SAMPLE)->mapping;
+    const ftcs_field_mapping_t *m = mapping;
+    while (strcmp(m->field_name, "VALUE") != 0) {
+        m++;
+    }
+    ftcs_range_index_t *idx = ftcs_range_index_build(rs, mapping, "VALUE");
+
+    size_t i = 0;
+    for (auto _ : state) {
+        double    lo   = (double)(i++ * 37 % 990); // VALUE は 0〜999.99
+        double    hi   = lo + 10;
+        size_t    cnt  = 0;
+        range_sum rsum = { m->offset, 0 };
+        if (mode == 0) {
+            const char *p = (const char *)rs->records + m->offset;
+            for (size_t r = 0; r < rs->count; r++, p += rs->struct_size) {
+                double v = *(const double *)p;
+                if (v >= lo && v <= hi) {
+                    cnt++;
+                    rsum.sum += v;
+                }
+            }
+        } else if (mode == 1) {
+            cnt = ftcs_range_count(idx, lo, hi);
+        } else {
+            cnt = ftcs_range_query(idx, lo, hi, sum_value, &rsum);
+        }
+        benchmark::DoNotOptimize(cnt);
+        benchmark::DoNotOptimize(rsum);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    ftcs_range_index_free(idx);
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief VALUE（double）の件数・合計・最小・最大（range(0) は件数、range(1) は方式）
+ *
+ * 方式 0 は利用側が書く素朴なループ（struct_size おきに1件ずつ読む。-O2 でコンパイル）、
+ * 方式 1 は ftcs_aggregate（AVX2 gather と複数スレッド）。
+ */
+static void BM_Aggregate(benchmark::State &state)
+{
+    size_t n    = (size_t)state.range(0);
+    int    mode = (int)state.range(1);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    const ftcs_field_mapping_t *mapping = bench_schema(BENCH_GEN_SAMPLE)->mapping;
+    const ftcs_field_mapping_t *m = mapping;
+    while (strcmp(m->field_name, "VALUE") != 0) {
+        m++;
+    }
+
+    for (auto _ : state) {
+        ftcs_agg_result_t r = {};
+        if (mode == 0) {
+            const char *p = (const char *)rs->records + m->offset;
+            for (size_t i = 0; i < rs->count; i++, p += rs->struct_size) {
+                double v = *(const double *)p;
+                r.min = (i == 0 || v < r.min) ? v : r.min;
+                r.max = (i == 0 || v > r.max) ? v : r.max;
+                r.sum += v;
+            }
+            r.count = rs->count;
+        } else if (ftcs_aggregate(rs, mapping, "VALUE", FTCS_AGG_ALL, &r) != 0) {
+            state.SkipWithError("ftcs_aggregate failed");
+            break;
+        }
+        benchmark::DoNotOptimize(r);
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * n));
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief ftcs_find_by_index の1回あたりのレイテンシ（文字列→添字変換込み）
+ */
+static void BM_FindByIndex(benchmark::State &state)
+{
+    size_t n = (size_t)state.range(0);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    std::vector<std::string> keys;
+    for (size_t k : scattered_keys(n)) {
+        keys.push_back(std::to_string(k));
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const void *rec = ftcs_find_by_index(rs, keys[i++ % keys.size()].c_str(),
+                                             schema->struct_size);
+        benchmark::DoNotOptimize(rec);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations());
+    ftcs_record_set_free(rs);
+}
+
+/**
+ * @brief パース結果を POSIX 共有メモリへ公開する時間（ftcs_main と同じ memcpy）
+ */
+static void BM_ShmPublish(benchmark::State &state)
+{
+    size_t n = (size_t)state.range(0);
+    ftcs_record_set_t *rs = parse_sample(n);
+    if (!rs) {
+        state.SkipWithError("parse failed");
+        return;
+    }
+    size_t bytes = rs->count * bench_schema(BENCH_GEN_SAMPLE)->struct_size;
+    int fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0600);
+    if (fd == -1 || ftruncate(fd, (off_t)bytes) == -1) {
+        state.SkipWithError("shm_open/ftruncate failed");
+        if (fd != -1) {
+            close(fd);
+        }
+        shm_unlink(SHM_NAME);
+        ftcs_record_set_free(rs);
+        return;
+    }
+    void *shm_addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm_addr == MAP_FAILED) {
+        state.SkipWithError("mmap failed");
+        shm_unlink(SHM_NAME);
+        ftcs_record_set_free(rs);
+        return;
+    }
+
+    for (auto _ : state) {
+        memcpy(shm_addr, rs->records, bytes);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * bytes));
+
+    munmap(shm_addr, bytes);
+    shm_unlink(SHM_NAME);
+    ftcs_record_set_free(rs);
+}
+
+/* BM_ShmScan の読み出し側でのマップ指定（range(1) の添字に対応） */
+static const unsigned SCAN_PAGE_FLAGS[] = { 0, FTCS_SHM_THP, FTCS_SHM_HUGETLB };
+
+/**
+ * @brief 読み出し側が共有メモリのレコード配列を一巡する時間（sample 形式、件数 range(0)）
+ *
+ * range(1) はページの種類（0: 4KiB、1: THP、2: hugetlbfs）、range(2) は順序
+ * （0: 先頭から順、1: 黄金比の歩幅で飛び飛び＝TLB ミスが出やすい）。大きなページを確保できない
+ * 環境では 4KiB ページで計るので、実際に効いたかを huge カウンタ（1 = 効いた）で示す。
+ */
+static void BM_ShmScan(benchmark::State &state)
+{
+    size_t   n      = (size_t)state.range(0);
+    unsigned pages  = SCAN_PAGE_FLAGS[state.range(1)];
+    bool     random = state.range(2) == 1;
+    size_t   ss     = bench_schema(BENCH_GEN_SAMPLE)->struct_size;
+    ftcs_shm_t w, r;
+    if (ftcs_shm_create(&w, SHM_NAME, ss, n, pages | FTCS_SHM_POPULATE) != 0) {
+        state.SkipWithError("ftcs_shm_create failed");
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        memcpy((char *)w.records + i * ss, &i, sizeof(i));
+    }
+    if (ftcs_shm_open(&r, SHM_NAME, ss, pages | FTCS_SHM_POPULATE) != 0) {
+        state.SkipWithError("ftcs_shm_open failed");
+        ftcs_shm_close(&w);
+        return;
+    }
+    /* n（10 のべき乗）と互いに素な歩幅にして全件を1回ずつ訪れる */
+    size_t step = random ? ((size_t)((double)n * 0.6180339887) | 1) : 1;
+    while (random && step % 5 == 0) {
+        step += 2;
+    }
+    const char *recs = (const char *)r.records;
+
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        size_t   idx = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t v;
+            memcpy(&v, recs + idx * ss, sizeof(v));
+            sum += v;
+            idx += step;
+            if (idx >= n) {
+                idx -= n;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * n));
+    state.counters["huge"] = (r.flags & (FTCS_SHM_THP | FTCS_SHM_HUGETLB)) ? 1 : 0;
+    ftcs_shm_close(&r);
+    ftcs_shm_close(&w);
+}
+
+/* BM_ShmRingStream のリングのスロット数と、消費者が1回に取り出す最大件数 */
+static const size_t RING_SLOTS = 4096;
+static const size_t RING_BATCH = 256;
+
+/**
+ * @brief パースしながら共有メモリの消費者へレコードを渡す時間（sample 形式、行数 range(0)）
+ *
+ * range(1) は渡し方（0: パース後に ftcs_main と同じ memcpy で公開、1: ftcs_shm_ring で
+ * パース中に1件ずつ公開）。消費者が最初のレコードを受け取るまでの時間（first_record_us）と、
+ * 全件を受け取り終えるまでの時間（計測値）を比べる。
+ */
+static void BM_ShmRingStream(benchmark::State &state)
+{
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    size_t lines = (size_t)state.range(0);
+    std::string path = input_file(BENCH_GEN_SAMPLE, lines);
+    if (path.empty()) {
+        state.SkipWithError("input generation failed");
+        return;
+    }
+    size_t ss    = schema->struct_size;
+    int    ring  = state.range(1) == 1;
+    size_t bytes = ring ? ftcs_shm_ring_bytes(ss, RING_SLOTS) : lines * ss;
+    void *shm = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        state.SkipWithError("mmap failed");
+        return;
+    }
+    ftcs_parser_config_t cfg = *schema->parser_config;
+    std::vector<char>    buf(RING_BATCH * ss);
+    double               first_us = 0;
+    size_t               received = 0;
+
+    for (auto _ : state) {
+        auto t0 = std::chrono::steady_clock::now();
+        received = 0;
+        if (!ring) {
+            ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, schema->mapping, ss);
+            if (!rs) {
+                state.SkipWithError("ftcs_parse_file failed");
+                break;
+            }
+            memcpy(shm, rs->records, rs->count * ss);
+            received = rs->count;
+            ftcs_record_set_free(rs);
+            first_us += std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - t0).count();
+            continue;
+        }
+        ftcs_shm_ring_t *prod = ftcs_shm_ring_init(shm, bytes, ss, 1);
+        ftcs_shm_ring_t *cons = ftcs_shm_ring_attach(shm, bytes, ss, 0);
+        cfg.ring = prod;
+        std::thread producer([&]() {
+            ftcs_record_set_free(ftcs_parse_file(path.c_str(), &cfg, schema->mapping, ss));
+            ftcs_shm_ring_close(prod);
+        });
+        long got;
+        while ((got = ftcs_shm_ring_pop(cons, buf.data(), RING_BATCH, -1)) > 0) {
+            if (received == 0) {
+                first_us += std::chrono::duration<double, std::micro>(
+                                std::chrono::steady_clock::now() - t0).count();
+            }
+            received += (size_t)got;
+            benchmark::DoNotOptimize(buf.data());
+        }
+        producer.join();
+        ftcs_shm_ring_detach(cons);
+        ftcs_shm_ring_detach(prod);
+    }
+    if (received != lines) {
+        state.SkipWithError("consumer did not receive every record");
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * lines));
+    state.counters["first_record_us"] = first_us / (double)state.iterations();
+    munmap(shm, bytes);
+}
+
+/* BM_ShmNotify の公開間隔と、ポーリング方式の確認間隔（ミリ秒） */
+static const int NOTIFY_PUBLISH_MS = 2;
+static const int NOTIFY_POLL_MS    = 1;
+
+/** CLOCK_MONOTONIC（ftcs_shm_notify_t::publish_ns と同じ時計）の現在値をナノ秒で返す */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 共有メモリの更新に読み出し側が気づくまでの時間（1 反復 = 1 回の公開）
+ *
+ * 別スレッドが NOTIFY_PUBLISH_MS ごとに公開する。range(0) は待ち方
+ * （0: NOTIFY_POLL_MS ごとに世代を確かめるポーリング、1: ftcs_shm_wait_update で futex 待ち）。
+ * 公開から気づくまでの平均（latency_us）を出し、読み出し側の消費 CPU は CPU 列で比べる。
+ */
+static void BM_ShmNotify(benchmark::State &state)
+{
+    bool              futex = state.range(0) == 1;
+    ftcs_shm_notify_t n     = {};
+    std::atomic<bool> stop{ false };
+    std::thread publisher([&]() {
+        for (size_t i = 1; !stop; i++) {
+            struct timespec interval = { 0, NOTIFY_PUBLISH_MS * 1000000L };
+            nanosleep(&interval, nullptr);
+            ftcs_shm_publish_begin(&n);
+            ftcs_shm_publish_end(&n, i);
+        }
+    });
+    uint32_t seen       = 0;
+    double   latency_ns = 0;
+    for (auto _ : state) {
+        if (futex) {
+            ftcs_shm_wait_update(&n, &seen, -1);
+        } else {
+            while (ftcs_shm_wait_update(&n, &seen, 0) == 0) {
+                struct timespec interval = { 0, NOTIFY_POLL_MS * 1000000L };
+                nanosleep(&interval, nullptr);
+            }
+        }
+        latency_ns += (double)(monotonic_ns() - n.publish_ns);
+    }
+    stop = true;
+    publisher.join();
+    state.counters["latency_us"] = latency_ns / 1000.0 / (double)state.iterations();
+}
+
+/* ── 検索サーバー ─────────────────────────────────────────── */
+
+/* 全ケースで共有する常駐サーバー（初回使用時に起動し、プロセス終了前に停止する） */
+static struct {
+    ftcs_record_set_t *rs = nullptr;
+    ftcs_server_t     *srv = nullptr;
+    std::thread        loop;
+    std::string        path;
+} g_server;
+
+/**
+ * @brief sample 形式 FIND_MAX_RECORDS 件を公開する検索サーバーを用意する（初回のみ起動）
+ * @return ソケットパス、起動失敗時は空文字列
+ */
+static std::string server_socket()
+{
+    if (g_server.srv) {
+        return g_server.path;
+    }
+    const bench_schema_t *schema = bench_schema(BENCH_GEN_SAMPLE);
+    g_server.rs = parse_sample(FIND_MAX_RECORDS);
+    if (!g_server.rs) {
+        return std::string();
+    }
+    const char *dir = getenv("FTCS_BENCH_DIR");
+    g_server.path = std::string(dir ? dir : "/tmp") + "/ftcs_bench_"
+                  + std::to_string(getpid()) + ".sock";
+    g_server.srv = ftcs_server_create(g_server.path.c_str(), g_server.rs,
+                                      schema->mapping, schema->parser_config);
+    if (!g_server.srv) {
+        ftcs_record_set_free(g_server.rs);
+        g_server.rs = nullptr;
+        return std::string();
+    }
+    ftcs_server_t *srv = g_server.srv;
+    g_server.loop = std::thread([srv]() { ftcs_server_run(srv); });
+    return g_server.path;
+}
+
+/**
+ * @brief 検索サーバーを停止して破棄する
+ */
+static void stop_server()
+{
+    if (!g_server.srv) {
+        return;
+    }
+    ftcs_server_stop(g_server.srv);
+    g_server.loop.join();
+    ftcs_server_destroy(g_server.srv);
+    ftcs_record_set_free(g_server.rs);
+    g_server.srv = nullptr;
+    g_server.rs  = nullptr;
+}
+
+/**
+ * @brief 検索サーバーの応答レイテンシ（接続数 range(0) × パイプライン深さ range(1)）
+ *
+ * 各接続は別スレッドで depth 件の要求をまとめて送り、応答を順に受け取る。
+ * 要求1件のレイテンシはバッチ送信開始からその応答を受け取るまでの時間とし、
+ * 全接続分の分布から p50 / p99 をカウンタに出す。
+ */
+static void BM_ServerLookup(benchmark::State &state)
+{
+    int conns = (int)state.range(0);
+    int depth = (int)state.range(1);
+    std::string path = server_socket();
+    if (path.empty()) {
+        state.SkipWithError("server start failed");
+        return;
+    }
+    std::vector<ftcs_client_t *> clients;
+    for (int c = 0; c < conns; c++) {
+        ftcs_client_t *client = ftcs_client_connect(path.c_str());
+        if (!client) {
+            state.SkipWithError("connect failed");
+            for (ftcs_client_t *opened : clients) {
+                ftcs_client_close(opened);
+            }
+            return;
+        }
+        clients.push_back(client);
+    }
+    std::vector<std::string> keys;
+    for (size_t k : scattered_keys(FIND_MAX_RECORDS)) {
+        keys.push_back(std::to_string(k + 1)); /* ID は 1-based */
+    }
+
+    std::vector<std::vector<double>> lat(conns); /* 接続ごとの要求レイテンシ [ns] */
+    std::atomic<bool> failed{false}; /* 複数のワーカーから書き込まれる */
+    for (auto _ : state) {
+        std::vector<std::thread> workers;
+        for (int c = 0; c < conns; c++) {
+            workers.emplace_back([&, c]() {
+                ftcs_client_t *client = clients[c];
+                size_t i = (size_t)c * 7;
+                for (int r = 0; r < SERVER_ROUNDS; r++) {
+                    auto t0 = std::chrono::steady_clock::now();
+                    for (int d = 0; d < depth; d++) {
+                        ftcs_client_send(client, keys[i++ % keys.size()].c_str());
+                    }
+                    for (int d = 0; d < depth; d++) {
+                        if (ftcs_client_recv(client, nullptr, 0) != FTCS_LOOKUP_FOUND) {
+                            failed.store(true, std::memory_order_relaxed);
+                        }
+                        lat[c].push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - t0).count());
+                    }
+                }
+            });
+        }
+        for (std::thread &t : workers) {
+            t.join();
+        }
+    }
+    for (ftcs_client_t *client : clients) {
+        ftcs_client_close(client);
+    }
+    if (failed.load()) {
+        state.SkipWithError("lookup failed");
+        return;
+    }
+
+    std::vector<double> all;
+    for (const auto &v : lat) {
+        all.insert(all.end(), v.begin(), v.end());
+    }
+    std::sort(all.begin(), all.end());
+    state.SetItemsProcessed((int64_t)all.size());
+    state.counters["p50_ns"] = all[all.size() / 2];
+    state.counters["p99_ns"] = all[all.size() * 99 / 100];
+}
+
+/* ── 登録 ────────────────────────────────────────────────── */
+
+/**
+ * @brief FTCS_BENCH_MAX_LINES（未設定なら既定値）を返す
+ */
+static size_t max_lines()
+{
+    const char *env = getenv("FTCS_BENCH_MAX_LINES");
+    if (!env) {
+        return DEFAULT_MAX_LINES;
+    }
+    char *end;
+    unsigned long long v = strtoull(env, &end, 10);
+    if (*end != '\0' || v < MIN_LINES) {
+        fprintf(stderr, "bench_ftcs: invalid FTCS_BENCH_MAX_LINES: %s\n", env);
+        return DEFAULT_MAX_LINES;
+    }
+    return (size_t)v;
+}
+
+/**
+ * @brief 行数 MIN_LINES..limit を 10 倍刻みで列挙する
+ */
+static std::vector<int64_t> decades(size_t limit)
+{
+    std::vector<int64_t> v;
+    for (size_t n = MIN_LINES; n <= limit; n *= 10) {
+        v.push_back((int64_t)n);
+    }
+    return v;
+}
+
+static void register_benchmarks()
+{
+    size_t limit = max_lines();
+
+    /* 種類ごとのパーススループット（1 行が長い種類は行数を減らす） */
+    for (int k = 0; k < BENCH_GEN_KIND_COUNT; k++) {
+        const bench_schema_t *schema = bench_schema((bench_gen_kind_t)k);
+        std::string name = std::string("BM_ParseFile/") + schema->name;
+        auto *b = benchmark::RegisterBenchmark(name.c_str(), BM_ParseFile,
+                                               (bench_gen_kind_t)k, FTCS_IO_STDIO,
+                                               nullptr);
+        for (int64_t n : decades(limit / schema->line_divisor)) {
+            b->Arg(n);
+        }
+        b->Unit(benchmark::kMillisecond);
+    }
+
+    /* 読み込みバックエンドの比較（sample 形式、最大行数のみ） */
+    const struct { const char *name; ftcs_io_backend_t backend; } backends[] = {
+        { "stdio", FTCS_IO_STDIO },
+        { "uring", FTCS_IO_URING },
+        { "pread", FTCS_IO_PREAD },
+    };
+    for (const auto &be : backends) {
+        std::string name = std::string("BM_ParseBackend/") + be.name;
+        benchmark::RegisterBenchmark(name.c_str(), BM_ParseFile,
+                                     BENCH_GEN_SAMPLE, be.backend, nullptr)
+            ->Arg((int64_t)decades(limit).back())
+            ->Unit(benchmark::kMillisecond);
+    }
+
+    /* レコード配列のアロケーター比較（sample 形式、最大行数のみ） */
+    static ftcs_arena_t     arena;
+    static ftcs_allocator_t arena_alloc;
+    static ftcs_allocator_t huge_alloc = ftcs_hugepage_allocator();
+    size_t top = (size_t)decades(limit).back();
+    /* 倍々拡張の最終容量は行数の 2 倍未満なので、その分を確保しておく */
+    if (ftcs_arena_init(&arena, nullptr, 2 * top * bench_schema(BENCH_GEN_SAMPLE)->struct_size) == 0) {
+        arena_alloc = ftcs_arena_allocator(&arena);
+        benchmark::RegisterBenchmark("BM_ParseAllocator/arena", BM_ParseFile,
+                                     BENCH_GEN_SAMPLE, FTCS_IO_STDIO, &arena_alloc)
+            ->Arg((int64_t)top)
+            ->Unit(benchmark::kMillisecond);
+    }
+    benchmark::RegisterBenchmark("BM_ParseAllocator/malloc", BM_ParseFile,
+                                 BENCH_GEN_SAMPLE, FTCS_IO_STDIO, nullptr)
+        ->Arg((int64_t)top)
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_ParseAllocator/hugepage", BM_ParseFile,
+                                 BENCH_GEN_SAMPLE, FTCS_IO_STDIO, &huge_alloc)
+        ->Arg((int64_t)top)
+        ->Unit(benchmark::kMillisecond);
+    /* 出力ファイルは反復ごとに切り詰めて使い直し、終了時に入力ファイルと一緒に削除する */
+    static ftcs_mapfile_t   mapfile;
+    static ftcs_allocator_t mapfile_alloc;
+    const char *dir = getenv("FTCS_BENCH_DIR");
+    std::string mapfile_path = std::string(dir ? dir : "/tmp") + "/ftcs_bench_mapfile.snap";
+    if (ftcs_mapfile_create(&mapfile, mapfile_path.c_str()) == 0) {
+        g_files[std::make_pair(-1, (size_t)0)] = mapfile_path;
+        mapfile_alloc = ftcs_mapfile_allocator(&mapfile);
+        benchmark::RegisterBenchmark("BM_ParseAllocator/mapfile", BM_ParseFile,
+                                     BENCH_GEN_SAMPLE, FTCS_IO_STDIO, &mapfile_alloc)
+            ->Arg((int64_t)top)
+            ->Unit(benchmark::kMillisecond);
+    }
+
+    /* フィルタ式の選択率ごとのスループットとレコード配列のサイズ（sample 形式、最大行数のみ） */
+    benchmark::RegisterBenchmark("BM_ParseFilter", BM_ParseFilter)
+        ->ArgNames({ "lines", "pct" })
+        ->ArgsProduct({ { (int64_t)top }, { 1, 10, 50, 100 } })
+        ->Unit(benchmark::kMillisecond);
+
+    /* 疎なレコード集合（sparse 形式）。密な配置は BM_ParseFile/sparse */
+    for (int64_t n : decades(limit / bench_schema(BENCH_GEN_SPARSE_ID)->line_divisor)) {
+        benchmark::RegisterBenchmark("BM_ParseSparse", BM_ParseSparse)
+            ->Arg(n)
+            ->Unit(benchmark::kMillisecond);
+    }
+
+    /* パース直後の集合の容量合わせ（malloc / huge page） */
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_Compact", BM_Compact)
+            ->ArgNames({ "lines", "alloc" })
+            ->ArgsProduct({ { n }, { 0, 1 } })
+            ->Iterations(COMPACT_ITERATIONS)
+            ->Unit(benchmark::kMicrosecond);
+    }
+
+    /* 2 フィールドだけ使う場合の全変換 / projection / 遅延変換（wide 形式、最大行数のみ） */
+    benchmark::RegisterBenchmark("BM_ParseProjection", BM_ParseProjection)
+        ->ArgNames({ "lines", "mode" })
+        ->ArgsProduct({ { (int64_t)(top / bench_schema(BENCH_GEN_WIDE)->line_divisor) }, { 0, 1, 2 } })
+        ->Unit(benchmark::kMillisecond);
+
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_ParseResume", BM_ParseResume)
+            ->ArgNames({ "lines", "mode" })
+            ->ArgsProduct({ { n }, { 0, 1 } })
+            ->Unit(benchmark::kMicrosecond);
+    }
+
+    /* 1回で読む場合と、ステップ1回あたり 250us / 1ms の予算で分割する場合（最大行数のみ） */
+    benchmark::RegisterBenchmark("BM_ParserStep", BM_ParserStep)
+        ->ArgNames({ "lines", "budget_us" })
+        ->ArgsProduct({ { (int64_t)top }, { 0, 250, 1000 } })
+        ->Unit(benchmark::kMillisecond);
+
+    /* 種類混在ファイルの種類ごとの filter 付き再読み込み / ftcs_parse_multi（最大行数のみ） */
+    benchmark::RegisterBenchmark("BM_ParseMulti", BM_ParseMulti)
+        ->ArgNames({ "lines", "mode" })
+        ->ArgsProduct({ { (int64_t)top }, { 0, 1 } })
+        ->Unit(benchmark::kMillisecond);
+
+    /* 64 個の数値: 要素ごとのキー / 配列フィールド1個 */
+    benchmark::RegisterBenchmark("BM_ParseArrayField", BM_ParseArrayField)
+        ->ArgNames({ "lines", "mode" })
+        ->ArgsProduct({ { (int64_t)(top < WIDE_MAX_LINES ? top : WIDE_MAX_LINES) }, { 0, 1 } })
+        ->Unit(benchmark::kMillisecond);
+
+    size_t find_limit = limit < FIND_MAX_RECORDS ? limit : FIND_MAX_RECORDS;
+    for (int64_t n : decades(find_limit)) {
+        benchmark::RegisterBenchmark("BM_FindByKey", BM_FindByKey)->Arg(n);
+        benchmark::RegisterBenchmark("BM_FindByIndex", BM_FindByIndex)->Arg(n);
+    }
+    for (int64_t n : decades(find_limit)) {
+        benchmark::RegisterBenchmark("BM_FindMany", BM_FindMany)
+            ->ArgNames({ "n", "mode" })
+            ->ArgsProduct({ { n }, { 0, 1 } })
+            ->Unit(benchmark::kMicrosecond);
+    }
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_FindMany", BM_FindMany)
+            ->ArgNames({ "n", "mode" })
+            ->ArgsProduct({ { n }, { 2, 3, 4, 5 } })
+            ->Unit(benchmark::kMicrosecond);
+    }
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_KeyIndexFind", BM_KeyIndexFind)->Arg(n);
+        benchmark::RegisterBenchmark("BM_SortedFindByKey", BM_SortedFindByKey)->Arg(n);
+    }
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_TrieFind", BM_TrieFind)->Arg(n);
+        benchmark::RegisterBenchmark("BM_TriePrefixCount", BM_TriePrefixCount)->Arg(n);
+    }
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_RangeQuery", BM_RangeQuery)
+            ->ArgNames({ "n", "mode" })
+            ->ArgsProduct({ { n }, { 0, 1, 2 } });
+    }
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_Sort", BM_Sort)
+            ->ArgNames({ "n", "mode" })
+            ->ArgsProduct({ { n }, { 0, 1 } })
+            ->Unit(benchmark::kMicrosecond);
+    }
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_Aggregate", BM_Aggregate)
+            ->ArgNames({ "n", "mode" })
+            ->ArgsProduct({ { n }, { 0, 1 } })
+            ->Unit(benchmark::kMicrosecond);
+    }
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_ShmPublish", BM_ShmPublish)
+            ->Arg(n)
+            ->Unit(benchmark::kMicrosecond);
+    }
+    /* 読み出し側の走査: ページの種類 × 順序（小さい表は TLB に収まるので 10^4 件から） */
+    for (int64_t n : decades(limit)) {
+        if (n < 10000) {
+            continue;
+        }
+        benchmark::RegisterBenchmark("BM_ShmScan", BM_ShmScan)
+            ->ArgNames({ "n", "pages", "random" })
+            ->ArgsProduct({ { n }, { 0, 1, 2 }, { 0, 1 } })
+            ->Unit(benchmark::kMicrosecond);
+    }
+
+    for (int64_t n : decades(limit)) {
+        benchmark::RegisterBenchmark("BM_ShmRingStream", BM_ShmRingStream)
+            ->ArgNames({ "lines", "ring" })
+            ->ArgsProduct({ { n }, { 0, 1 } })
+            ->UseRealTime()
+            ->Unit(benchmark::kMillisecond);
+    }
+    benchmark::RegisterBenchmark("BM_ShmNotify", BM_ShmNotify)
+        ->ArgName("futex")
+        ->DenseRange(0, 1)
+        ->Iterations(500)
+        ->UseRealTime()
+        ->Unit(benchmark::kMicrosecond);
+
+    /* 検索サーバー: 同時接続数 × パイプライン深さ */
+    benchmark::RegisterBenchmark("BM_ServerLookup", BM_ServerLookup)
+        ->ArgNames({ "conns", "depth" })
+        ->ArgsProduct({ { 1, 16, 64 }, { 1, 16 } })
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+}
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    register_benchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    stop_server();
+    remove_input_files();
+    return 0;
+}
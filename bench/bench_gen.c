@@ -0,0 +1,260 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include "bench_gen.h"
+
+// 長い文字列フィールドの容量。1行が数 KB 級になる入力を想定した値。
+#define LONG_STRING_CAPACITY 1024
+
+// 長い文字列フィールドに書き出す文字数（容量に収まり、ブロック境界をまたぎやすい長さ）
+#define LONG_STRING_LENGTH 900
+
+// 飛び飛びの ID の間隔。配列の 7/8 が空きスロットになる。
+#define SPARSE_ID_STRIDE 8
+
+// コメントの多い入力で、レコード1行あたりに挟むコメント行数
+#define COMMENT_LINES_PER_RECORD 3
+
+// 1行が長い種類（横に広い・長い文字列）の最大行数を既定値から減らす割合
+#define LONG_LINE_DIVISOR 10
+
+// 横に広いスキーマの型別フィールド数（ID と合わせて 32 フィールド）
+#define WIDE_INT_FIELDS    16
+#define WIDE_DOUBLE_FIELDS 8
+#define WIDE_STRING_FIELDS 7
+
+// 生成データの疑似乱数の初期値（生成結果を実行ごとに固定するため定数にする）
+#define RANDOM_SEED 0x9e3779b97f4a7c15ULL
+
+// --- 生成データの構造体 ---
+
+typedef struct {
+    int    id;
+    char   name[64];
+    double value;
+} bench_sample_t;
+
+typedef struct {
+    char  location[32];
+    float temperature;
+    float humidity;
+} bench_sensor_t;
+
+typedef struct {
+    int    id;
+    int    i00, i01, i02, i03, i04, i05, i06, i07;
+    int    i08, i09, i10, i11, i12, i13, i14, i15;
+    double d00, d01, d02, d03, d04, d05, d06, d07;
+    char   s00[16], s01[16], s02[16], s03[16], s04[16], s05[16], s06[16];
+} bench_wide_t;
+
+typedef struct {
+    int  id;
+    char text[LONG_STRING_CAPACITY];
+} bench_long_t;
+
+// --- パーサー設定 ---
+
+static const ftcs_parser_config_t field_config = {
+    .comment_char = '#',
+    .kv_separator = "=",
+    .primary_key  = "ID",
+};
+
+static const ftcs_parser_config_t index_config = {
+    .comment_char     = '#',
+    .kv_separator     = "=",
+    .primary_key_mode = FTCS_KEY_INDEX,
+    .index_field_name = "ID",
+};
+
+// bench_gen_kind_t の並びと一致させること。mapping は bench_schema() で設定する。
+static bench_schema_t schemas[BENCH_GEN_KIND_COUNT] = {
+    { "sample",  NULL, &field_config, sizeof(bench_sample_t), 1 },
+    { "sensor",  NULL, &index_config, sizeof(bench_sensor_t), 1 },
+    { "wide",    NULL, &field_config, sizeof(bench_wide_t),   LONG_LINE_DIVISOR },
+    { "long",    NULL, &field_config, sizeof(bench_long_t),   LONG_LINE_DIVISOR },
+    { "sparse",  NULL, &index_config, sizeof(bench_sensor_t), SPARSE_ID_STRIDE },
+    { "comment", NULL, &field_config, sizeof(bench_sample_t), 1 },
+};
+
+// --- 関数宣言（目次） ---
+
+static const ftcs_field_mapping_t *schema_mapping(bench_gen_kind_t kind); // 種類に対応するマッピングを返す
+static int      write_record(FILE *fp, bench_gen_kind_t kind, size_t i,
+                             unsigned long long *rng); // 1レコード分の行を書き出す
+static unsigned next_random(unsigned long long *rng); // 疑似乱数を1つ進める
+
+// --- 関数定義（概要→詳細の順） ---
+
+const bench_schema_t *bench_schema(bench_gen_kind_t kind)
+{
+    if ((int)kind < 0 || kind >= BENCH_GEN_KIND_COUNT) {
+        return NULL;
+    }
+    schemas[kind].mapping = schema_mapping(kind);
+    return &schemas[kind];
+}
+
+int bench_gen_kind_from_name(const char *name)
+{
+    for (int k = 0; k < BENCH_GEN_KIND_COUNT; k++) {
+        if (strcmp(schemas[k].name, name) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+int bench_gen_write(FILE *fp, bench_gen_kind_t kind, size_t records)
+{
+    if (!bench_schema(kind)) {
+        return -1;
+    }
+    unsigned long long rng = RANDOM_SEED; // 疑似乱数の状態
+    fprintf(fp, "# ftcs benchmark data: %s, %zu records\n", schemas[kind].name, records);
+    for (size_t i = 0; i < records; i++) {
+        if (write_record(fp, kind, i, &rng) < 0) {
+            return -1;
+        }
+    }
+    return ferror(fp) ? -1 : 0;
+}
+
+int bench_gen_file(const char *path, bench_gen_kind_t kind, size_t records)
+{
+    FILE *fp = fopen(path, "w"); // 出力先ファイル
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    int ret = bench_gen_write(fp, kind, records); // 生成結果
+    // fclose の失敗（書き出し時のディスクフル等）も生成失敗として扱う
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * @brief 種類に対応するマッピングテーブルを返す
+ *
+ * FTCS_MAPPING_BEGIN は構造体型ごとに typedef を置くため、
+ * 1つの翻訳単位で複数の型を扱えるよう各テーブルをブロックスコープで定義する。
+ *
+ * @param kind データの種類
+ * @return マッピングテーブル
+ */
+static const ftcs_field_mapping_t *schema_mapping(bench_gen_kind_t kind)
+{
+    switch (kind) {
+    case BENCH_GEN_SENSOR:
+    case BENCH_GEN_SPARSE_ID: {
+        FTCS_MAPPING_BEGIN(sensor_mapping, bench_sensor_t)
+            FTCS_FIELD(location,    "LOCATION")
+            FTCS_FIELD(temperature, "TEMP")
+            FTCS_FIELD(humidity,    "HUMIDITY")
+        FTCS_MAPPING_END()
+        return sensor_mapping;
+    }
+    case BENCH_GEN_WIDE: {
+        FTCS_MAPPING_BEGIN(wide_mapping, bench_wide_t)
+            FTCS_FIELD(id,  "ID")
+            FTCS_FIELD(i00, "I00") FTCS_FIELD(i01, "I01") FTCS_FIELD(i02, "I02") FTCS_FIELD(i03, "I03")
+            FTCS_FIELD(i04, "I04") FTCS_FIELD(i05, "I05") FTCS_FIELD(i06, "I06") FTCS_FIELD(i07, "I07")
+            FTCS_FIELD(i08, "I08") FTCS_FIELD(i09, "I09") FTCS_FIELD(i10, "I10") FTCS_FIELD(i11, "I11")
+            FTCS_FIELD(i12, "I12") FTCS_FIELD(i13, "I13") FTCS_FIELD(i14, "I14") FTCS_FIELD(i15, "I15")
+            FTCS_FIELD(d00, "D00") FTCS_FIELD(d01, "D01") FTCS_FIELD(d02, "D02") FTCS_FIELD(d03, "D03")
+            FTCS_FIELD(d04, "D04") FTCS_FIELD(d05, "D05") FTCS_FIELD(d06, "D06") FTCS_FIELD(d07, "D07")
+            FTCS_FIELD(s00, "S00") FTCS_FIELD(s01, "S01") FTCS_FIELD(s02, "S02") FTCS_FIELD(s03, "S03")
+            FTCS_FIELD(s04, "S04") FTCS_FIELD(s05, "S05") FTCS_FIELD(s06, "S06")
+        FTCS_MAPPING_END()
+        return wide_mapping;
+    }
+    case BENCH_GEN_LONG_STRING: {
+        FTCS_MAPPING_BEGIN(long_mapping, bench_long_t)
+            FTCS_FIELD(id,   "ID")
+            FTCS_FIELD(text, "TEXT")
+        FTCS_MAPPING_END()
+        return long_mapping;
+    }
+    default: {
+        FTCS_MAPPING_BEGIN(sample_mapping, bench_sample_t)
+            FTCS_FIELD(id,    "ID")
+            FTCS_FIELD(name,  "NAME")
+            FTCS_FIELD(value, "VALUE")
+        FTCS_MAPPING_END()
+        return sample_mapping;
+    }
+    }
+}
+
+/**
+ * @brief i 番目のレコードを種類に応じた形式で1行書き出す
+ *
+ * @param fp   出力先
+ * @param kind データの種類
+ * @param i    0-based のレコード番号
+ * @param rng  疑似乱数の状態
+ * @return 成功時 0 以上、書き込み失敗時 -1
+ */
+static int write_record(FILE *fp, bench_gen_kind_t kind, size_t i,
+                        unsigned long long *rng)
+{
+    unsigned r = next_random(rng); // 値のばらつきに使う乱数
+
+    switch (kind) {
+    case BENCH_GEN_SAMPLE:
+        return fprintf(fp, "ID=%zu NAME=Item%u VALUE=%u.%02u\n",
+                       i + 1, r % 100000u, r % 1000u, r % 100u);
+    case BENCH_GEN_SENSOR:
+        return fprintf(fp, "ID=%zu LOCATION=Room%u TEMP=%u.%u HUMIDITY=%u.%u\n",
+                       i + 1, r % 1000u, 15u + r % 20u, r % 10u, 30u + r % 50u, (r >> 8) % 10u);
+    case BENCH_GEN_WIDE:
+        if (fprintf(fp, "ID=%zu", i + 1) < 0) {
+            return -1;
+        }
+        for (int f = 0; f < WIDE_INT_FIELDS; f++) {
+            fprintf(fp, " I%02d=%u", f, next_random(rng) % 1000000u);
+        }
+        for (int f = 0; f < WIDE_DOUBLE_FIELDS; f++) {
+            fprintf(fp, " D%02d=%u.%03u", f, next_random(rng) % 10000u, r % 1000u);
+        }
+        for (int f = 0; f < WIDE_STRING_FIELDS; f++) {
+            fprintf(fp, " S%02d=str%u", f, next_random(rng) % 100000u);
+        }
+        return fputc('\n', fp) == EOF ? -1 : 0;
+    case BENCH_GEN_LONG_STRING: {
+        char text[LONG_STRING_LENGTH + 1]; // 空白を含まない長い値
+        for (size_t c = 0; c < LONG_STRING_LENGTH; c++) {
+            text[c] = (char)('a' + (r + c) % 26u);
+        }
+        text[LONG_STRING_LENGTH] = '\0';
+        return fprintf(fp, "ID=%zu TEXT=%s\n", i + 1, text);
+    }
+    case BENCH_GEN_SPARSE_ID:
+        return fprintf(fp, "ID=%zu LOCATION=Room%u TEMP=20.0 HUMIDITY=50.0\n",
+                       i * SPARSE_ID_STRIDE + 1, r % 1000u);
+    case BENCH_GEN_COMMENT_HEAVY:
+        for (int c = 0; c < COMMENT_LINES_PER_RECORD; c++) {
+            fprintf(fp, "# record %zu note %d: generated comment line\n", i + 1, c);
+        }
+        return fprintf(fp, "\nID=%zu NAME=Item%u VALUE=%u.5\n", i + 1, r % 100000u, r % 1000u);
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief xorshift64 で疑似乱数を1つ進める
+ *
+ * @param rng 疑似乱数の状態（更新される）
+ * @return 32 ビットの乱数
+ */
+static unsigned next_random(unsigned long long *rng)
+{
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 7;
+    *rng ^= *rng << 17;
+    return (unsigned)(*rng >> 32);
+}
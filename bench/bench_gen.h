@@ -0,0 +1,60 @@
+#ifndef BENCH_GEN_H
+#define BENCH_GEN_H
+
+// ベンチマーク用の合成データ生成。生成するファイルの種類ごとに、
+// パースに必要な構造体・マッピング・パーサー設定を bench_schema_t としてまとめる。
+
+#include <stdio.h>
+#include "ftcs.h"
+
+/**
+ * @brief 生成するデータの種類
+ */
+typedef enum {
+    BENCH_GEN_SAMPLE,        /**< sample_t 形式（ID / NAME / VALUE） */
+    BENCH_GEN_SENSOR,        /**< sensor_t 形式（index_field_name=ID による位置指定） */
+    BENCH_GEN_WIDE,          /**< 32 フィールドの横に広いスキーマ */
+    BENCH_GEN_LONG_STRING,   /**< 約 900 文字の長い文字列フィールド */
+    BENCH_GEN_SPARSE_ID,     /**< ID が飛び飛びの位置指定（配列の大半が空きスロット） */
+    BENCH_GEN_COMMENT_HEAVY, /**< レコード1行ごとにコメント3行と空行1行 */
+    BENCH_GEN_KIND_COUNT     /**< 種類の数（番兵） */
+} bench_gen_kind_t;
+
+/**
+ * @brief 生成データをパースするための情報
+ */
+typedef struct {
+    const char                 *name;          /**< 種類名（CLI とベンチマーク名に使用） */
+    const ftcs_field_mapping_t *mapping;       /**< フィールドマッピングテーブル */
+    const ftcs_parser_config_t *parser_config; /**< パーサー設定 */
+    size_t                      struct_size;   /**< 1レコードのバイトサイズ */
+    size_t                      line_divisor;  /**< 既定の最大行数をこの値で割って使う（1行が長い種類用） */
+} bench_schema_t;
+
+/**
+ * @brief 種類に対応するスキーマを返す
+ * @return スキーマ、範囲外の kind なら NULL
+ */
+const bench_schema_t *bench_schema(bench_gen_kind_t kind);
+
+/**
+ * @brief 種類名から種類を引く
+ * @return 種類、該当なしなら -1
+ */
+int bench_gen_kind_from_name(const char *name);
+
+/**
+ * @brief 指定した種類のデータを records 件分書き出す
+ *
+ * 同じ引数なら常に同じ内容を生成する。
+ * @return 成功時 0、書き込み失敗時 -1
+ */
+int bench_gen_write(FILE *fp, bench_gen_kind_t kind, size_t records);
+
+/**
+ * @brief bench_gen_write() の結果をファイルに書き出す
+ * @return 成功時 0、失敗時 -1
+ */
+int bench_gen_file(const char *path, bench_gen_kind_t kind, size_t records);
+
+#endif /* BENCH_GEN_H */
@@ -2,6 +2,7 @@
 #define FTCS_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 // --- フィールド型定義 ---
 
@@ -16,6 +17,7 @@ typedef enum {
     FTCS_TYPE_CHAR,   /**< char 型（1文字） */
     FTCS_TYPE_LONG,   /**< long 型 */
     FTCS_TYPE_SHORT,  /**< short 型 */
+    FTCS_TYPE_ARRAY,  /**< 数値・char の固定長配列（要素型は elem_type） */
 } ftcs_field_type_t;
 
 /**
@@ -28,6 +30,7 @@ typedef struct {
     size_t            offset;     /**< 対象構造体内のバイトオフセット */
     size_t            size;       /**< フィールドのバイトサイズ */
     ftcs_field_type_t type;       /**< フィールドのデータ型 */
+    ftcs_field_type_t elem_type;  /**< 要素1個の型（配列なら要素型で要素数は size から求める。それ以外は type と同じ） */
 } ftcs_field_mapping_t;
 
 // --- マッピングテーブル定義マクロ ---
@@ -65,9 +68,27 @@ typedef struct {
  */
 #define FTCS_FIELD(member, fname) \
     { .field_name = (fname), \
-      .offset = offsetof(_ftcs_current_t, member), \
-      .size   = sizeof(((_ftcs_current_t *)0)->member), \
-      .type   = FTCS_INFER_TYPE(member) },
+      .offset    = offsetof(_ftcs_current_t, member), \
+      .size      = sizeof(((_ftcs_current_t *)0)->member), \
+      .type      = FTCS_INFER_TYPE(member), \
+      .elem_type = FTCS_INFER_TYPE(member) },
+
+/**
+ * @brief 固定長配列メンバのマッピングエントリを1件追加するマクロ
+ *
+ * 値はカンマ区切りで書き（例: SAMPLES=0.5,1.25,2）、先頭要素から順に格納する。
+ * 要素型は member[0] から推定し、要素数は sizeof(member) から求める。
+ * 値が要素数より少なければ残りの要素を 0 にし、多ければ解析エラーにする。
+ * 配列フィールドはキー・フィルタ・集計・範囲索引には使えない。
+ * @param member 構造体メンバ名（int / long / short / float / double / char の配列）
+ * @param fname  ファイル内のキー名（文字列）
+ */
+#define FTCS_FIELD_ARRAY(member, fname) \
+    { .field_name = (fname), \
+      .offset    = offsetof(_ftcs_current_t, member), \
+      .size      = sizeof(((_ftcs_current_t *)0)->member), \
+      .type      = FTCS_TYPE_ARRAY, \
+      .elem_type = FTCS_INFER_TYPE(member[0]) },
 
 /**
  * @brief マッピングテーブル定義の終端マクロ
@@ -77,6 +98,83 @@ typedef struct {
 #define FTCS_MAPPING_END() \
     { .field_name = NULL } };
 
+// --- アロケーター ---
+
+/**
+ * @brief レコード配列の確保に使うアロケーター
+ *
+ * 関数ポインタがすべて NULL のときは malloc 系を使う。サイズは常にバイト単位で、
+ * free_fn / realloc_fn には確保時（または直前の再確保時）のサイズが渡される。
+ * alloc_fn が返す領域をゼロ初期化する必要はない（ライブラリ側で初期化する）。
+ */
+typedef struct {
+    void *(*alloc_fn)(void *ctx, size_t size);   /**< 確保。失敗時 NULL */
+    void *(*realloc_fn)(void *ctx, void *ptr,
+                        size_t old_size, size_t new_size); /**< 内容を保ったまま拡張。失敗時 NULL（ptr は有効なまま） */
+    void  (*free_fn)(void *ctx, void *ptr, size_t size);   /**< 解放 */
+    void   *ctx;                                           /**< 各関数に渡す利用者データ */
+} ftcs_allocator_t;
+
+/**
+ * @brief 連続領域から先頭側へ順に切り出すバンプアリーナ
+ *
+ * 最後に確保したブロックは領域内で伸縮・解放できる（それ以外の解放は何もしない）。
+ * メンバは ftcs_arena_init() で設定し、直接変更しないこと。
+ */
+typedef struct {
+    char   *base;  /**< 領域の先頭 */
+    size_t  size;  /**< 領域のバイトサイズ */
+    size_t  used;  /**< 使用済みバイト数 */
+    size_t  last;  /**< 最後に確保したブロックの先頭オフセット */
+    int     owned; /**< 非ゼロなら base はアリーナが確保したもの（destroy で解放する） */
+} ftcs_arena_t;
+
+/**
+ * @brief アリーナを初期化する
+ * @param arena 初期化対象
+ * @param buf   使用する領域（NULL なら size バイトを malloc する）
+ * @param size  領域のバイトサイズ
+ * @return 成功時 0、確保失敗時 -1
+ */
+int ftcs_arena_init(ftcs_arena_t *arena, void *buf, size_t size);
+
+/**
+ * @brief アリーナ上のすべての確保を破棄して先頭から使い直す
+ */
+void ftcs_arena_reset(ftcs_arena_t *arena);
+
+/**
+ * @brief アリーナが確保した領域を解放する（呼び出し元が渡した領域は解放しない）
+ */
+void ftcs_arena_destroy(ftcs_arena_t *arena);
+
+/**
+ * @brief アリーナから確保するアロケーターを返す
+ * @note アリーナはアロケーターで確保したレコード集合より長く生存させること
+ */
+ftcs_allocator_t ftcs_arena_allocator(ftcs_arena_t *arena);
+
+/**
+ * @brief mmap + MADV_HUGEPAGE で確保し、拡張は mremap で行うアロケーター
+ *
+ * 再確保でデータをコピーせず、ページテーブルの付け替えだけで領域を広げる。
+ * 大きなレコード集合で TLB ミスと realloc のコピーを減らす。
+ */
+ftcs_allocator_t ftcs_hugepage_allocator(void);
+
+/**
+ * @brief 呼び出し元が用意した共有メモリ領域に直接レコード配列を置くアロケーター
+ *
+ * arena を shm 領域で初期化して返す。レコード配列は shm_addr から始まり、
+ * 領域を超える拡張は失敗する（パースは NULL を返す）。
+ * ftcs_main() はレコード配列がすでに shm 領域にある場合コピーを省略する。
+ *
+ * @param arena    状態を保持するアリーナ（レコード集合より長く生存させること）
+ * @param shm_addr 共有メモリ領域の先頭
+ * @param shm_size 共有メモリ領域のバイトサイズ
+ */
+ftcs_allocator_t ftcs_shm_allocator(ftcs_arena_t *arena, void *shm_addr, size_t shm_size);
+
 // --- パーサー ---
 
 /**
@@ -87,6 +185,53 @@ typedef enum {
     FTCS_KEY_INDEX = 1, /**< 配列添字（整数）で検索 */
 } ftcs_primary_key_mode_t;
 
+/**
+ * @brief 入力ファイルの読み込みバックエンド
+ *
+ * FTCS_IO_STDIO 以外はファイルを大きなブロック単位で読み込み、
+ * 読み込みとパースを重ねることでストレージの待ち時間を隠蔽する。
+ */
+typedef enum {
+    FTCS_IO_STDIO = 0, /**< fgets による1行ずつの読み込み（デフォルト） */
+    FTCS_IO_URING = 1, /**< io_uring で複数ブロックを先読み。利用不可なら FTCS_IO_PREAD にフォールバック */
+    FTCS_IO_PREAD = 2, /**< pread + posix_fadvise による先読み */
+} ftcs_io_backend_t;
+
+/**
+ * @brief 共有メモリ上のレコードリングへの書き込み・読み出しハンドル（不透明型）
+ *
+ * API は「共有メモリリング」の節を参照。
+ */
+typedef struct ftcs_shm_ring ftcs_shm_ring_t;
+
+/**
+ * @brief パース統計（ftcs_parser_config_t.stats に渡すと書き込まれる）
+ *
+ * 件数は全行について正確に数える。フェーズ別の時間は計測自体の負荷を抑えるため
+ * 一定間隔の行だけで計り、全レコード行分に換算した推定値である。
+ */
+typedef struct {
+    size_t   bytes;         /**< 読み込んだ入力バイト数 */
+    size_t   lines;         /**< 読み込んだ行数（コメント・空行を含む） */
+    size_t   records;       /**< 格納したレコード数（INDEX モードの空きスロットは含まない） */
+    size_t   comments;      /**< コメント行数 */
+    size_t   empty_lines;   /**< 空行数 */
+    size_t   unknown_keys;  /**< マッピングに存在しないキーの出現数 */
+    size_t   reallocs;      /**< レコード配列の再確保回数 */
+    size_t   peak_bytes;    /**< レコード配列の最大確保バイト数 */
+    size_t   sampled_lines; /**< フェーズ時間を計測したレコード行数 */
+    uint64_t total_ns;      /**< パース全体の所要時間 */
+    uint64_t io_ns;         /**< 入力の読み込み（fgets / ブロック待ち） */
+    uint64_t tokenize_ns;   /**< トークン分割と区切り文字の検索（推定値） */
+    uint64_t lookup_ns;     /**< キー名からマッピングエントリの検索（推定値） */
+    uint64_t convert_ns;    /**< 値の型変換と書き込み（推定値） */
+    uint64_t alloc_ns;      /**< レコード配列の再確保 */
+    size_t   filtered;      /**< フィルタ式で棄却したレコード行数 */
+    size_t   unrouted;      /**< ftcs_parse_multi() で判別キーがないか値がどのスキーマにも一致せず読み飛ばした行数 */
+    size_t   key_hits;      /**< 直前の行の同じ位置のキーと一致し、検索せずにエントリが決まったキーの数 */
+    size_t   key_misses;    /**< 予測が外れてマッピングを検索したキーの数（最初の行・未知のキーを含む） */
+} ftcs_parse_stats_t;
+
 /**
  * @brief パーサー設定
  */
@@ -100,16 +245,34 @@ typedef struct {
                                        値は 1-based の整数で、array[値-1] に格納される。
                                        NULL のときは出現順（sequential）に格納する。
                                        このフィールド自体は構造体メンバには書き込まれない。 */
+    ftcs_io_backend_t io_backend; /**< 入力の読み込み方式（デフォルト: FTCS_IO_STDIO） */
+    unsigned    stream_threads; /**< ftcs_parse_fd() のパーサースレッド数（0 のときは 1） */
+    ftcs_parse_stats_t *stats;  /**< 非 NULL ならパース統計を書き込む（NULL のとき計測コストなし） */
+    const ftcs_allocator_t *allocator; /**< レコード配列のアロケーター（NULL なら malloc 系） */
+    const char *filter;         /**< 格納するレコードを絞り込む式（NULL なら全件）。
+                                     "FIELD OP VALUE" を "&&" で結ぶ（例: "TEMP>30 && LOCATION=ServerRoom"）。
+                                     OP は = (==), !=, <, <=, >, >=。文字列は辞書順で比較する。
+                                     判定は各フィールドの値を変換した直後に行い、棄却した行の残りは解析しない。
+                                     行に現れないフィールドはゼロ値として判定する */
+    const char *const *projection; /**< 変換するフィールド名の配列（NULL 終端）。NULL なら全フィールド。
+                                        含まれないフィールドは変換せずゼロのまま残す
+                                        （filter が参照するフィールドは判定のため常に変換する） */
+    ftcs_shm_ring_t *ring;      /**< 非 NULL なら格納したレコードを格納順にこのリングへも書き込む（生産者側）。
+                                     リングが満杯の間はパースが止まる。配置位置指定モードでも出現順に書く */
 } ftcs_parser_config_t;
 
 /**
  * @brief パース結果のレコード集合（動的配列）
  */
 typedef struct {
-    void   *records;     /**< 構造体の連続配列（calloc で確保） */
+    void   *records;     /**< 構造体の連続配列（allocator で確保） */
     size_t  count;       /**< 格納済みレコード数 */
     size_t  capacity;    /**< 確保済みスロット数 */
     size_t  struct_size; /**< 1レコードのバイトサイズ */
+    ftcs_allocator_t allocator; /**< records の確保に使ったアロケーター（解放時にも使う） */
+    int     sorted;      /**< 非ゼロなら ftcs_record_set_sort() で sorted_key の昇順に並べ替え済み
+                              （records を書き換えた場合は呼び出し元が 0 に戻すこと） */
+    ftcs_field_mapping_t sorted_key; /**< 並べ替えに使ったキーフィールドのマッピングエントリ（写し） */
 } ftcs_record_set_t;
 
 /**
@@ -130,15 +293,121 @@ ftcs_record_set_t *ftcs_parse_file(const char *filepath,
                                    const ftcs_field_mapping_t *mapping,
                                    size_t struct_size);
 
+/**
+ * @brief ファイルディスクリプタ（パイプ・ソケット等のシーク不能な入力）をパースする
+ *
+ * 読み込みスレッドが入力を行境界で区切った大きなブロックにし、
+ * config->stream_threads 本のパーサースレッドがそれを構造体のバッチに変換し、
+ * 呼び出しスレッドがバッチを入力順にレコード集合へ結合する3段パイプラインで処理する。
+ * 段間はロックフリーの有界 SPSC キューで接続する。
+ * 結果は同じ内容のファイルを ftcs_parse_file() でパースした場合と同一になる。
+ *
+ * @param fd          入力 fd（EOF まで読む。close は呼び出し元の責務）
+ * @param config      パーサー設定
+ * @param mapping     フィールドマッピングテーブル
+ * @param struct_size 1レコードのバイトサイズ
+ * @return 成功時は新たに確保した ftcs_record_set_t へのポインタ、失敗時は NULL
+ * @note 戻り値は必ず ftcs_record_set_free() で解放すること
+ */
+ftcs_record_set_t *ftcs_parse_fd(int fd,
+                                 const ftcs_parser_config_t *config,
+                                 const ftcs_field_mapping_t *mapping,
+                                 size_t struct_size);
+
+/**
+ * @brief 1つのファイルに混在する複数種類のレコードを振り分けて格納するためのスキーマ
+ */
+typedef struct {
+    const char                 *tag;         /**< このスキーマに振り分ける判別キーの値（例: "sensor"） */
+    const ftcs_field_mapping_t *mapping;     /**< フィールドマッピングテーブル */
+    size_t                      struct_size; /**< 1レコードのバイトサイズ */
+} ftcs_schema_t;
+
+/**
+ * @brief 判別キーの値で各行をスキーマに振り分け、1回の読み込みで全スキーマのレコード集合を作る
+ *
+ * 各行の discriminator キー（例: "TYPE=sensor" の TYPE）の値と一致する tag のスキーマの
+ * マッピングで、その行を ftcs_parse_file() と同じ規則で格納する。ファイルは1回だけ読み、
+ * 行は振り分け先のスキーマでだけ解析するので、スキーマごとに ftcs_parse_file() を
+ * 繰り返すより読み込みとトークン分割がスキーマ数分の1で済む。
+ * 判別キーがない行・値がどの tag とも一致しない行は読み飛ばす（統計の unrouted に数える）。
+ * 判別キー自体はマッピングになくてよい（未知のキーとしては数えない）。
+ * config の filter・projection・キー検索モードは全スキーマに適用する（filter と projection の
+ * フィールドは全スキーマのマッピングに存在すること）。
+ *
+ * @param filepath      入力ファイルのパス
+ * @param config        パーサー設定
+ * @param discriminator 判別キーの名前
+ * @param schemas       スキーマの配列（tag が重複した場合は先のものに振り分ける）
+ * @param nschemas      スキーマの数（1 以上）
+ * @param out           schemas[i] のレコード集合を out[i] に書き込む nschemas 要素の配列
+ * @return 成功時 0、失敗時 -1（out は全て NULL）
+ * @note out の各要素は必ず ftcs_record_set_free() で解放すること
+ */
+int ftcs_parse_multi(const char *filepath,
+                     const ftcs_parser_config_t *config,
+                     const char *discriminator,
+                     const ftcs_schema_t *schemas, size_t nschemas,
+                     ftcs_record_set_t *out[]);
+
 /**
  * @brief ftcs_parse_file() が返したレコード集合を解放する
  * @param rs 解放対象（NULL でも安全に無視される）
  */
 void ftcs_record_set_free(ftcs_record_set_t *rs);
 
+/**
+ * @brief レコード集合のメモリ使用量
+ */
+typedef struct {
+    size_t used_bytes;     /**< 格納済みレコードのバイト数（count × struct_size） */
+    size_t reserved_bytes; /**< 確保済みのバイト数（capacity × struct_size）。倍々の拡張で used の2倍近くになる */
+    size_t empty_bytes;    /**< count 内の空きスロット（全バイト 0 のレコード）のバイト数。配置位置指定モードの飛び番など */
+    size_t trailing_empty; /**< 末尾に連続する空きスロットの数（FTCS_COMPACT_TRIM_EMPTY で切り落とせる） */
+    size_t resident_bytes; /**< records を含むページのうち物理メモリに載っているバイト数（mincore によるページ単位の概算） */
+} ftcs_memory_info_t;
+
+/**
+ * @brief レコード集合のメモリ使用量を調べる
+ *
+ * 空きスロットを数えるため全レコードを走査する（頻繁に呼ぶ用途には向かない）。
+ * 索引のメモリ使用量は ftcs_key_index_bytes() / ftcs_range_index_bytes() / ftcs_trie_bytes() で得る。
+ *
+ * @param rs  対象のレコード集合
+ * @param out 結果の格納先
+ * @return 成功時 0、NULL 引数なら -1
+ */
+int ftcs_record_set_memory_info(const ftcs_record_set_t *rs, ftcs_memory_info_t *out);
+
+/**
+ * @brief ftcs_record_set_compact() の動作を指定するフラグ
+ */
+enum {
+    FTCS_COMPACT_TRIM_EMPTY = 1u << 0, /**< 末尾に連続する空きスロット（全バイト 0 のレコード）を count から除く。
+                                            配置位置指定モードで末尾の ID を消した場合など。手前のレコードの位置は変えない */
+};
+
+/**
+ * @brief レコード配列の未使用スロットを解放し、容量を count に合わせる
+ *
+ * 再確保はアロケーターの realloc_fn（既定は realloc）で行う。既定のアロケーターでは
+ * 縮めたあと malloc_trim() でヒープの空きを OS に返す。ftcs_hugepage_allocator() と
+ * ftcs_mapfile_allocator() は mremap / ftruncate で末尾のページを外す。
+ * 以後に追記すると容量は再び倍々に増える。
+ * 再確保で records の位置が変わることがあるため、索引は作り直すこと。
+ *
+ * @param rs    対象のレコード集合
+ * @param flags FTCS_COMPACT_* の論理和
+ * @return 成功時 0、NULL 引数・再確保失敗時 -1（失敗時 rs は変わらない）
+ */
+int ftcs_record_set_compact(ftcs_record_set_t *rs, unsigned flags);
+
 /**
  * @brief プライマリキー値でレコードを線形検索する（FTCS_KEY_FIELD 用）
  *
+ * rs が ftcs_record_set_sort() で同じキーフィールドの昇順に並べ替え済みなら、
+ * 線形探索の代わりに二分探索する（結果は並べ替え前に線形探索した場合と同じレコード）。
+ *
  * @param rs               検索対象のレコード集合
  * @param mapping          フィールドマッピングテーブル
  * @param primary_key_name プライマリキーのフィールド名
@@ -164,6 +433,1051 @@ const void *ftcs_find_by_index(const ftcs_record_set_t *rs,
                                const char *key_value,
                                size_t struct_size);
 
+// --- 分割実行パーサー ---
+
+/**
+ * @brief 呼び出しごとに決まった量だけ進めるパーサー（不透明型）
+ */
+typedef struct ftcs_parser ftcs_parser_t;
+
+/**
+ * @brief 分割実行パーサーの進捗
+ */
+typedef struct {
+    uint64_t bytes;       /**< 読み込んだバイト数 */
+    uint64_t total_bytes; /**< ftcs_parser_open() 時点のファイルサイズ（進捗率の分母） */
+    size_t   records;     /**< 格納したレコード数 */
+    uint64_t busy_ns;     /**< ftcs_parser_step() で費やした時間の累計 */
+    int      done;        /**< 1 なら EOF まで読み終えた、-1 ならエラーで停止した */
+} ftcs_parser_progress_t;
+
+/**
+ * @brief ファイルを開き、ftcs_parser_step() で少しずつパースするパーサーを作る
+ *
+ * イベントループなどで1回の呼び出しの処理量を抑えたい場合に使う。ftcs_parser_step() を
+ * 繰り返して ftcs_parser_finish() で取り出したレコード集合は、同じ設定の ftcs_parse_file() の
+ * 結果と同一になる（読み込みは io_backend によらず pread で行い、行長の上限はない）。
+ *
+ * @param filepath    入力ファイルのパス
+ * @param config      パーサー設定（パーサー内に写すが、filter・projection・stats・allocator の
+ *                    指す先は ftcs_parser_finish() / ftcs_parser_free() まで生存させること）
+ * @param mapping     フィールドマッピングテーブル（同上）
+ * @param struct_size 1レコードのバイトサイズ
+ * @return パーサー、ファイルが開けない・設定が不正な場合は NULL
+ */
+ftcs_parser_t *ftcs_parser_open(const char *filepath,
+                                const ftcs_parser_config_t *config,
+                                const ftcs_field_mapping_t *mapping,
+                                size_t struct_size);
+
+/**
+ * @brief 予算の範囲でパースを進める
+ *
+ * 最大 budget_bytes バイトを読み、または budget_ns ナノ秒を使い切った時点で戻る（0 は制限なし）。
+ * 時間は小さなブロック（16KiB）を処理するごとに確認するので、超過は1ブロック分の処理時間に収まる。
+ * 予算によらず1回の呼び出しで少なくとも1バイトは進む。
+ *
+ * @param p            パーサー
+ * @param budget_bytes 今回読むバイト数の上限（0 は制限なし）
+ * @param budget_ns    今回使う時間の上限（0 は制限なし）
+ * @return 続きがあれば 1、EOF まで読み終えたら 0、読み込み・解析エラー時 -1（以後も -1）
+ */
+int ftcs_parser_step(ftcs_parser_t *p, size_t budget_bytes, uint64_t budget_ns);
+
+/**
+ * @brief 進捗を取得する
+ * @param p   パーサー
+ * @param out 進捗の書き込み先
+ */
+void ftcs_parser_progress(const ftcs_parser_t *p, ftcs_parser_progress_t *out);
+
+/**
+ * @brief 残りを最後までパースしてレコード集合を取り出し、パーサーを解放する
+ *
+ * config->stats を指定した場合は、ステップ実行で費やした時間を total_ns として統計を書き込む。
+ *
+ * @param p パーサー（呼び出し後は使えない）
+ * @return レコード集合、エラーで停止していた場合は NULL
+ * @note 戻り値は必ず ftcs_record_set_free() で解放すること
+ */
+ftcs_record_set_t *ftcs_parser_finish(ftcs_parser_t *p);
+
+/**
+ * @brief パースを中断してパーサーと構築途中のレコード集合を解放する
+ * @param p 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_parser_free(ftcs_parser_t *p);
+
+// --- 追記ファイルの差分パース ---
+
+/**
+ * @brief 追記されていくファイルをどこまで解析したかの記録（ftcs_parse_resume() 用）
+ *
+ * ゼロ初期化した状態がファイル先頭からの解析を表す。ポインタを含まないので、
+ * そのまま保存して別のプロセスで再開できる（再開時は保存時と同じ件数のレコード集合を渡すこと）。
+ * 改行の来ていない末尾の行は offset 以降に残し、次回改行が追記されてから読み直す。
+ */
+typedef struct {
+    uint64_t dev;      /**< 解析中のファイルのデバイス番号 */
+    uint64_t ino;      /**< 解析中のファイルの inode 番号（0 は未解析。置き換えの検出に使う） */
+    uint64_t offset;   /**< 解析済みのバイト位置（改行で終わる最後の行の直後） */
+    size_t   pending;  /**< offset 以降に読んだ、改行待ちの行のバイト数 */
+    size_t   records;  /**< これまでに格納したレコード数の累計 */
+    size_t   restarts; /**< 切り詰め・置き換えを検出してファイル先頭から読み直した回数 */
+} ftcs_checkpoint_t;
+
+/**
+ * @brief 前回の解析以降に追記された行だけを解析し、レコード集合の末尾に追加する
+ *
+ * cp->offset から EOF までを読み、改行で終わる行を ftcs_parse_file() と同じ規則で格納する。
+ * ファイルの inode が変わった（ローテーション）、offset より短くなった、または offset の直前が
+ * 改行でなくなった（切り詰め後の上書き）場合は、新しいファイルの先頭から読み直す
+ * （既に格納したレコードは残し、cp->restarts を増やす）。切り詰めたあと前回と同じ長さまで
+ * 書き戻され、offset の直前も改行だった場合は区別できない（tail -F と同じ制約）。
+ * レコード配列は (*rs)->allocator で拡張するので、ftcs_shm_allocator() で確保した集合なら
+ * 共有メモリ上で追記される。レコードを追加すると (*rs)->sorted は 0 に戻る。
+ *
+ * @param cp          解析位置の記録（呼び出しごとに更新される）
+ * @param filepath    入力ファイルのパス
+ * @param config      パーサー設定（io_backend は無視する）
+ * @param mapping     フィールドマッピングテーブル
+ * @param struct_size 1レコードのバイトサイズ
+ * @param rs          追加先のレコード集合（*rs が NULL なら config->allocator で新たに作る）
+ * @return 今回格納したレコード数、失敗時 -1（ファイルが開けない・解析エラー・確保失敗。
+ *         cp と (*rs)->count は呼び出し前のまま）
+ * @note config->stats を指定した場合は今回の呼び出し分の統計を書き込む
+ */
+long ftcs_parse_resume(ftcs_checkpoint_t *cp,
+                       const char *filepath,
+                       const ftcs_parser_config_t *config,
+                       const ftcs_field_mapping_t *mapping,
+                       size_t struct_size,
+                       ftcs_record_set_t **rs);
+
+// --- ファイルに置くレコード集合（スナップショット） ---
+
+/**
+ * @brief レコード配列をファイルの共有マップに置くための出力ファイル（ftcs_mapfile_allocator() 用）
+ *
+ * メンバは ftcs_mapfile_create() で設定し、直接変更しないこと。
+ */
+typedef struct {
+    int     fd;      /**< 出力ファイル（-1 なら閉じている） */
+    char   *base;    /**< マップの先頭（スナップショットのヘッダー）。未確保なら NULL */
+    size_t  len;     /**< マップしているバイト数（= ファイルサイズ） */
+    size_t  flushed; /**< 書き戻しを開始した範囲の終端（ファイル先頭からのバイト数） */
+    size_t  dropped; /**< 書き戻しを終えてマップから外した範囲の終端（ファイル先頭からのバイト数） */
+} ftcs_mapfile_t;
+
+/**
+ * @brief レコード配列を置く出力ファイルを作る（既存のファイルは切り詰める）
+ * @param mf   初期化対象
+ * @param path 出力ファイルのパス
+ * @return 成功時 0、失敗時 -1
+ */
+int ftcs_mapfile_create(ftcs_mapfile_t *mf, const char *path);
+
+/**
+ * @brief 出力ファイルの共有マップにレコード配列を置くアロケーターを返す
+ *
+ * 確保・拡張は ftruncate + mremap で行い、データはコピーしない。拡張のたびに、それまでに
+ * 埋まった範囲の書き戻しを開始し、前回書き戻しを始めた範囲は完了を待ってマップから外す。
+ * レコード配列はヒープではなくページキャッシュに載り、書き戻したページはカーネルが回収できるので、
+ * 物理メモリより大きなレコード集合でもパースできる。
+ * 確保できるのは1つのレコード配列だけ（ftcs_parse_sparse() のページには使えない）。
+ *
+ * @param mf ftcs_mapfile_create() で作った出力ファイル（レコード集合より長く生存させること）
+ */
+ftcs_allocator_t ftcs_mapfile_allocator(ftcs_mapfile_t *mf);
+
+/**
+ * @brief レコード集合を出力ファイルに確定し、スナップショットとして読み直せるようにする
+ *
+ * ファイルを rs->count 件分に切り詰め（rs->capacity も count になる）、全体を書き戻してから
+ * ヘッダー（レコード数・構造体サイズ）を書く。確定後もレコード集合はそのまま使え、
+ * さらにレコードを追加した場合はもう一度呼ぶ。
+ *
+ * @param mf 出力ファイル
+ * @param rs ftcs_mapfile_allocator(mf) で確保したレコード集合
+ * @return 成功時 0、失敗時 -1
+ */
+int ftcs_mapfile_commit(ftcs_mapfile_t *mf, ftcs_record_set_t *rs);
+
+/**
+ * @brief 出力ファイルを閉じる（レコード集合の解放の前後どちらでもよい）
+ */
+void ftcs_mapfile_close(ftcs_mapfile_t *mf);
+
+/**
+ * @brief ftcs_mapfile_commit() で確定したファイルをマップし、レコード集合として返す
+ *
+ * レコード配列はファイルの私的マップ（コピーオンライト）で、読み込み・変換は行わない。
+ * 並べ替え・追加などの変更はファイルに反映されない。スナップショットを作ったのと
+ * 同じ構造体定義・ABI で読むこと。
+ *
+ * @param path        スナップショットのパス
+ * @param struct_size 1レコードのバイトサイズ（ヘッダーと一致しなければエラー）
+ * @return レコード集合、ファイルが開けない・形式が違う場合は NULL
+ * @note 戻り値は必ず ftcs_record_set_free() で解放すること
+ */
+ftcs_record_set_t *ftcs_snapshot_open(const char *path, size_t struct_size);
+
+// --- 遅延変換 ---
+
+/**
+ * @brief 値の変換をアクセス時まで遅らせるレコード集合（不透明型）
+ *
+ * ファイルを mmap し、パース時は各フィールドの値の位置（バイト範囲）だけを記録する。
+ * 値は ftcs_lazy_field() で初めて参照されたときに変換され、以後はその結果を返す。
+ * 読み込み時間は実際に参照するフィールド数に比例する。
+ * アクセサは内部状態を更新するため、複数スレッドから同時に呼ばないこと。
+ */
+typedef struct ftcs_lazy_set ftcs_lazy_set_t;
+
+/**
+ * @brief ファイルを mmap し、フィールド値の位置だけを記録する
+ *
+ * comment_char / kv_separator / projection / stats（件数と total_ns）を参照する。
+ * index_field_name による配置位置指定と filter には対応しない（指定時はエラー）。
+ *
+ * @param filepath    入力ファイルのパス
+ * @param config      パーサー設定
+ * @param mapping     フィールドマッピングテーブル
+ * @param struct_size 1レコードのバイトサイズ
+ * @return 成功時は遅延レコード集合、失敗時は NULL
+ * @note 戻り値は必ず ftcs_lazy_free() で解放すること
+ */
+ftcs_lazy_set_t *ftcs_parse_lazy(const char *filepath,
+                                 const ftcs_parser_config_t *config,
+                                 const ftcs_field_mapping_t *mapping,
+                                 size_t struct_size);
+
+/**
+ * @brief レコード数を返す
+ */
+size_t ftcs_lazy_count(const ftcs_lazy_set_t *ls);
+
+/**
+ * @brief フィールド名に対応するフィールド番号（マッピングテーブル上の位置）を返す
+ * @return フィールド番号、存在しなければ -1
+ */
+int ftcs_lazy_field_index(const ftcs_lazy_set_t *ls, const char *field_name);
+
+/**
+ * @brief i 番目のレコードのフィールドを（未変換なら変換して）返す
+ *
+ * 行に現れなかったフィールドと projection 外のフィールドはゼロ値を返す。
+ *
+ * @param ls    遅延レコード集合
+ * @param i     0-based のレコード位置
+ * @param field ftcs_lazy_field_index() で得たフィールド番号
+ * @return レコード内のフィールドへのポインタ、範囲外・変換失敗時は NULL
+ */
+const void *ftcs_lazy_field(ftcs_lazy_set_t *ls, size_t i, int field);
+
+/**
+ * @brief i 番目のレコードの全フィールドを変換して返す
+ * @return レコード先頭へのポインタ、範囲外・変換失敗時は NULL
+ */
+const void *ftcs_lazy_record(ftcs_lazy_set_t *ls, size_t i);
+
+/**
+ * @brief 遅延レコード集合を解放し、ファイルの mmap を解除する
+ * @param ls 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_lazy_free(ftcs_lazy_set_t *ls);
+
+// --- 疎な配置位置指定 ---
+
+/**
+ * @brief 配置位置指定モードのレコードをページ単位で持つ疎なレコード集合（不透明型）
+ *
+ * 2段のページテーブルで位置を引き、64 件分のレコードページは最初に書き込まれたときに確保する。
+ * 使用メモリは最大 ID ではなく、実際に現れたレコードの数（と分布）に比例する。
+ */
+typedef struct ftcs_sparse_set ftcs_sparse_set_t;
+
+/**
+ * @brief 疎なレコード集合の走査位置（ゼロ初期化して使う）
+ */
+typedef struct {
+    size_t index; /**< 直前に返したレコードの 0-based 配置位置 */
+    size_t next;  /**< 次に調べる配置位置 */
+} ftcs_sparse_iter_t;
+
+/**
+ * @brief 配置位置指定モード（FTCS_KEY_INDEX + index_field_name）のファイルを疎な集合に読み込む
+ *
+ * ftcs_parse_file() と同じ設定（読み込みバックエンド・filter・projection・allocator・stats）を使う。
+ * allocator はレコードページの確保に使う。同じ ID が複数回現れた場合は後の行で上書きする。
+ *
+ * @param filepath    入力ファイルのパス
+ * @param config      パーサー設定（primary_key_mode は FTCS_KEY_INDEX、index_field_name が必須）
+ * @param mapping     フィールドマッピングテーブル
+ * @param struct_size 1レコードのバイトサイズ
+ * @return 成功時は疎なレコード集合、失敗時は NULL
+ * @note 戻り値は必ず ftcs_sparse_free() で解放すること
+ */
+ftcs_sparse_set_t *ftcs_parse_sparse(const char *filepath,
+                                     const ftcs_parser_config_t *config,
+                                     const ftcs_field_mapping_t *mapping,
+                                     size_t struct_size);
+
+/**
+ * @brief 存在するレコードの数を返す（最大 ID ではない）
+ */
+size_t ftcs_sparse_count(const ftcs_sparse_set_t *ss);
+
+/**
+ * @brief レコードページとページテーブルの確保バイト数を返す
+ */
+size_t ftcs_sparse_bytes(const ftcs_sparse_set_t *ss);
+
+/**
+ * @brief 0-based 配置位置のレコードを返す（ftcs_find_by_index() の疎な版）
+ * @return レコードへのポインタ、その位置にレコードがなければ NULL
+ */
+const void *ftcs_sparse_find(const ftcs_sparse_set_t *ss, size_t index);
+
+/**
+ * @brief 存在するレコードを配置位置の昇順に1件ずつ返す
+ *
+ * @code
+ * ftcs_sparse_iter_t it = { 0 };
+ * const sensor_t *rec;
+ * while ((rec = ftcs_sparse_next(ss, &it)) != NULL) {
+ *     // it.index がレコードの 0-based 配置位置
+ * }
+ * @endcode
+ *
+ * @param ss 疎なレコード集合
+ * @param it 走査位置（呼び出しごとに進む）
+ * @return 次のレコードへのポインタ、終端に達したら NULL
+ */
+const void *ftcs_sparse_next(const ftcs_sparse_set_t *ss, ftcs_sparse_iter_t *it);
+
+/**
+ * @brief 疎なレコード集合を解放する
+ * @param ss 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_sparse_free(ftcs_sparse_set_t *ss);
+
+// --- キー索引 ---
+
+/**
+ * @brief プライマリキーのハッシュ索引（不透明型）
+ *
+ * ftcs_find_by_key() の線形探索を1回のハッシュ探査に置き換える。
+ * 多数のキーを同じレコード集合に問い合わせる場合に使う。
+ */
+typedef struct ftcs_key_index ftcs_key_index_t;
+
+/**
+ * @brief レコード集合のプライマリキーフィールドからハッシュ索引を構築する
+ *
+ * 同じキーのレコードが複数ある場合は ftcs_find_by_key() と同じく先頭のものを返す。
+ *
+ * @param rs               索引対象のレコード集合（索引より長く生存させ、変更しないこと）
+ * @param mapping          フィールドマッピングテーブル
+ * @param primary_key_name プライマリキーのフィールド名
+ * @return 成功時は索引、失敗時は NULL
+ * @note 戻り値は必ず ftcs_key_index_free() で解放すること
+ */
+ftcs_key_index_t *ftcs_key_index_build(const ftcs_record_set_t *rs,
+                                       const ftcs_field_mapping_t *mapping,
+                                       const char *primary_key_name);
+
+/**
+ * @brief 索引からキー値に一致するレコードを検索する
+ *
+ * キー文字列の解釈（数値変換など）は ftcs_find_by_key() と同じ。
+ *
+ * @param idx       ftcs_key_index_build() が返した索引
+ * @param key_value 検索するキー値（文字列）
+ * @return 一致レコードへのポインタ（rs->records 内）、見つからなければ NULL
+ */
+const void *ftcs_key_index_find(const ftcs_key_index_t *idx, const char *key_value);
+
+/**
+ * @brief 索引で複数のキー値をまとめて検索する
+ *
+ * 一定数のキーごとにハッシュ値を求めて探査先のスロットを先読みしてから探査するので、
+ * ftcs_key_index_find() を繰り返すよりキャッシュミスの待ち時間が重なる。
+ *
+ * @param idx  ftcs_key_index_build() が返した索引
+ * @param keys 検索するキー値の配列（NULL の要素は見つからないキーとして扱う）
+ * @param n    キーの数
+ * @param out  keys[i] の一致レコード（見つからなければ NULL）を out[i] に書き込む n 要素の配列
+ * @return 見つかったキーの数（引数不正時は 0）
+ */
+size_t ftcs_key_index_find_many(const ftcs_key_index_t *idx, const char *const keys[], size_t n,
+                                const void *out[]);
+
+/**
+ * @brief 索引を解放する
+ * @param idx 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_key_index_free(ftcs_key_index_t *idx);
+
+/**
+ * @brief 索引が確保しているバイト数（メモリ使用量）を返す
+ * @param idx 索引
+ * @return バイト数（NULL なら 0）
+ */
+size_t ftcs_key_index_bytes(const ftcs_key_index_t *idx);
+
+/**
+ * @brief 複数のキー値でまとめて ftcs_find_by_key() と同じ検索をする
+ *
+ * キー文字列の変換とフィールドの探索は最初に1回だけ行う。
+ * rs が ftcs_record_set_sort() で同じフィールドの順に並べ替え済みなら、一定数のキーの
+ * 二分探索を1段ずつ交互に進め、各キーが次に読むレコードを先読みする。
+ * そうでなければキーのハッシュ表を作り、レコード集合を1回だけ走査して突き合わせる
+ * （全てのキーが見つかった時点で打ち切る）。
+ * 結果はキーごとに ftcs_find_by_key() を呼んだ場合と同じレコードになる。
+ *
+ * @param rs         検索対象のレコード集合（レコード間隔は rs->struct_size）
+ * @param mapping    フィールドマッピングテーブル
+ * @param field_name キーのフィールド名
+ * @param keys       検索するキー値の配列（NULL の要素は見つからないキーとして扱う）
+ * @param n          キーの数
+ * @param out        keys[i] の一致レコード（見つからなければ NULL）を out[i] に書き込む n 要素の配列
+ * @return 見つかったキーの数（引数不正・フィールドが存在しない場合は 0 で、out は全て NULL）
+ * @note 作業領域としてキー1個あたり数十バイトを確保する
+ */
+size_t ftcs_find_many(const ftcs_record_set_t *rs,
+                      const ftcs_field_mapping_t *mapping,
+                      const char *field_name,
+                      const char *const keys[], size_t n,
+                      const void *out[]);
+
+// --- 整列 ---
+
+/**
+ * @brief レコード集合をキーフィールドの昇順に並べ替える
+ *
+ * キーを順序を保つ 64 ビット整数に変換し、8 ビットずつの LSD 基数ソートで並べ替える
+ * （比較関数は使わない）。全レコードで値が同じ桁のパスは省く。大きな集合では
+ * スレッドごとに範囲を受け持ってヒストグラムと振り分けを並列に行う。
+ * 文字列キーは先頭 8 バイトで並べ替えたあと、先頭 8 バイトが同じ範囲だけを
+ * 9 バイト目以降の MSD 基数ソートで並べ替える。
+ *
+ * 並べ替えは安定で、同じキーのレコードは元の順序を保つ。
+ * 浮動小数点数は 0.0 と -0.0 を等しく扱い、NaN は正負に応じて両端に置く。
+ * 文字列は strcmp と同じ順（unsigned char の辞書順）に並ぶ。
+ *
+ * 成功すると rs->sorted を立てて rs->sorted_key にキーを記録し、以後の
+ * ftcs_find_by_key() はこのキーでの検索を二分探索で行う。
+ *
+ * @param rs         並べ替えるレコード集合（records をその場で並べ替える）
+ * @param mapping    フィールドマッピングテーブル
+ * @param field_name キーのフィールド名（配列以外の全ての型を指定できる）
+ * @return 成功時 0、引数不正・フィールドが存在しない・確保失敗時 -1（失敗時 records は変更しない）
+ * @note 作業領域としてレコード配列と同じ大きさの一時領域と、1件あたり 32 バイトを確保する
+ */
+int ftcs_record_set_sort(ftcs_record_set_t *rs,
+                         const ftcs_field_mapping_t *mapping,
+                         const char *field_name);
+
+// --- 範囲索引 ---
+
+/**
+ * @brief 数値フィールドの順序索引（不透明型）
+ *
+ * キーを昇順に並べ、Eytzinger 配置（幅優先順に並べた暗黙の二分探索木）で持つ。
+ * 範囲の端の探索は O(log n) で、木の上段は数キャッシュラインに収まって常駐し、
+ * 下段は数段先の子孫を先読みするためキャッシュミスが少ない。
+ */
+typedef struct ftcs_range_index ftcs_range_index_t;
+
+/**
+ * @brief ftcs_range_query() が範囲内のレコードごとに呼ぶコールバック
+ *
+ * @param record 範囲内のレコード（rs->records 内）
+ * @param arg    ftcs_range_query() に渡した arg
+ * @return 0 なら続行、非ゼロなら走査を打ち切る
+ */
+typedef int (*ftcs_range_cb_t)(const void *record, void *arg);
+
+/**
+ * @brief レコード集合の数値フィールドから順序索引を構築する
+ *
+ * @param rs         索引対象のレコード集合（索引より長く生存させ、変更しないこと）
+ * @param mapping    フィールドマッピングテーブル
+ * @param field_name 索引を作る数値フィールド名（INT / LONG / SHORT / FLOAT / DOUBLE / CHAR）
+ * @return 成功時は索引、失敗時（文字列フィールド・存在しないフィールド・確保失敗）は NULL
+ * @note 戻り値は必ず ftcs_range_index_free() で解放すること
+ */
+ftcs_range_index_t *ftcs_range_index_build(const ftcs_record_set_t *rs,
+                                           const ftcs_field_mapping_t *mapping,
+                                           const char *field_name);
+
+/**
+ * @brief lo 以上 hi 以下の値を持つレコード数を返す（範囲の両端の探索だけで求める）
+ *
+ * 整数フィールドでは lo を切り上げ、hi を切り捨てた整数範囲として扱う。
+ * lo > hi または NaN を含む範囲は空とする。値が NaN のレコードはどの範囲にも入らない。
+ *
+ * @param idx ftcs_range_index_build() が返した索引
+ * @param lo  範囲の下端（含む。-INFINITY で下限なし）
+ * @param hi  範囲の上端（含む。INFINITY で上限なし）
+ * @return 範囲内のレコード数（idx が NULL なら 0）
+ */
+size_t ftcs_range_count(const ftcs_range_index_t *idx, double lo, double hi);
+
+/**
+ * @brief lo 以上 hi 以下の値を持つレコードを値の昇順に cb へ渡す
+ *
+ * 同じ値のレコードはレコード集合での順に渡す。範囲の解釈は ftcs_range_count() と同じ。
+ *
+ * @param idx ftcs_range_index_build() が返した索引
+ * @param lo  範囲の下端（含む）
+ * @param hi  範囲の上端（含む）
+ * @param cb  レコードごとに呼ぶコールバック
+ * @param arg cb にそのまま渡す値
+ * @return cb に渡したレコード数（idx か cb が NULL なら 0）
+ */
+size_t ftcs_range_query(const ftcs_range_index_t *idx, double lo, double hi,
+                        ftcs_range_cb_t cb, void *arg);
+
+/**
+ * @brief 順序索引を解放する
+ * @param idx 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_range_index_free(ftcs_range_index_t *idx);
+
+/**
+ * @brief 順序索引が確保しているバイト数（メモリ使用量）を返す
+ * @param idx 順序索引
+ * @return バイト数（NULL なら 0）
+ */
+size_t ftcs_range_index_bytes(const ftcs_range_index_t *idx);
+
+// --- 文字列索引 ---
+
+/** @brief ftcs_trie_build() の flags: ASCII の大文字・小文字を区別せずに検索する */
+#define FTCS_TRIE_CASE_INSENSITIVE 0x1u
+
+/**
+ * @brief 文字列フィールドのパス圧縮トライ（不透明型）
+ *
+ * 完全一致検索と前方一致の列挙を、キー長に比例する時間で行う。
+ * 分岐のない区間は1ノードにまとめ、子ノードは先頭バイトの順に連続して並べる。
+ * 索引の本体（イメージ）はポインタを含まない1つの連続領域で、共有メモリ等に
+ * コピーして別プロセスから ftcs_trie_attach() で使える。
+ */
+typedef struct ftcs_trie ftcs_trie_t;
+
+/**
+ * @brief レコード集合の文字列フィールドからトライを構築する
+ *
+ * @param rs         索引対象のレコード集合（索引より長く生存させ、変更しないこと。2^32 件未満）
+ * @param mapping    フィールドマッピングテーブル
+ * @param field_name 索引を作る文字列フィールド名
+ * @param flags      0 または FTCS_TRIE_CASE_INSENSITIVE
+ * @param allocator  イメージの確保に使うアロケーター（NULL なら malloc 系）
+ * @return 成功時はトライ、失敗時（文字列以外のフィールド・存在しないフィールド・確保失敗）は NULL
+ * @note 戻り値は必ず ftcs_trie_free() で解放すること
+ */
+ftcs_trie_t *ftcs_trie_build(const ftcs_record_set_t *rs,
+                             const ftcs_field_mapping_t *mapping,
+                             const char *field_name,
+                             unsigned flags,
+                             const ftcs_allocator_t *allocator);
+
+/**
+ * @brief 他のプロセス等が作ったイメージをコピーせずにトライとして使う
+ *
+ * @param image ftcs_trie_image() が返した内容と同じバイト列（トライより長く生存させること）
+ * @param size  image のバイトサイズ
+ * @param rs    イメージを構築したときと同じ内容のレコード集合
+ * @return 成功時はトライ、イメージが不正・件数が合わない場合は NULL
+ * @note 戻り値は ftcs_trie_free() で解放する（image 自体は解放しない）
+ */
+ftcs_trie_t *ftcs_trie_attach(const void *image, size_t size, const ftcs_record_set_t *rs);
+
+/**
+ * @brief キーに完全一致するレコードを検索する
+ *
+ * 同じキーのレコードが複数ある場合は ftcs_find_by_key() と同じく先頭のものを返す。
+ *
+ * @param t   トライ
+ * @param key 検索するキー
+ * @return 一致レコードへのポインタ（rs->records 内）、見つからなければ NULL
+ */
+const void *ftcs_trie_find(const ftcs_trie_t *t, const char *key);
+
+/**
+ * @brief prefix で始まるキーのレコードをキーの辞書順に cb へ渡す
+ *
+ * 同じキーのレコードはレコード集合での順に渡す。空文字列は全件に一致する。
+ *
+ * @param t      トライ
+ * @param prefix 前方一致させる文字列
+ * @param cb     レコードごとに呼ぶコールバック（非ゼロを返すと打ち切る）
+ * @param arg    cb にそのまま渡す値
+ * @return cb に渡したレコード数（t・prefix・cb のいずれかが NULL なら 0）
+ */
+size_t ftcs_trie_prefix(const ftcs_trie_t *t, const char *prefix, ftcs_range_cb_t cb, void *arg);
+
+/**
+ * @brief prefix で始まるキーのレコード数を返す（レコードは辿らない）
+ * @param t      トライ
+ * @param prefix 前方一致させる文字列
+ * @return レコード数（t か prefix が NULL なら 0）
+ */
+size_t ftcs_trie_prefix_count(const ftcs_trie_t *t, const char *prefix);
+
+/**
+ * @brief トライのイメージ（連続領域）の先頭を返す
+ * @param t トライ
+ * @return イメージの先頭（サイズは ftcs_trie_bytes()）
+ */
+const void *ftcs_trie_image(const ftcs_trie_t *t);
+
+/**
+ * @brief トライのイメージのバイト数（索引のメモリ使用量）を返す
+ * @param t トライ
+ * @return バイト数（NULL なら 0）
+ */
+size_t ftcs_trie_bytes(const ftcs_trie_t *t);
+
+/**
+ * @brief トライを解放する
+ * @param t 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_trie_free(ftcs_trie_t *t);
+
+// --- 集計 ---
+
+/**
+ * @brief 集計の種類（ビットの OR で複数指定する）
+ */
+typedef enum {
+    FTCS_AGG_COUNT = 1u << 0, /**< 件数 */
+    FTCS_AGG_SUM   = 1u << 1, /**< 合計 */
+    FTCS_AGG_MIN   = 1u << 2, /**< 最小値 */
+    FTCS_AGG_MAX   = 1u << 3, /**< 最大値 */
+    FTCS_AGG_MEAN  = 1u << 4, /**< 平均 */
+    FTCS_AGG_ALL   = 0x1fu    /**< すべて */
+} ftcs_agg_op_t;
+
+/**
+ * @brief 集計結果（指定しなかった項目と、count が 0 のときの他の項目は 0）
+ */
+typedef struct {
+    size_t count; /**< 件数 */
+    double sum;   /**< 合計 */
+    double min;   /**< 最小値 */
+    double max;   /**< 最大値 */
+    double mean;  /**< 平均（sum / count） */
+} ftcs_agg_result_t;
+
+/**
+ * @brief グループごとの集計結果
+ */
+typedef struct {
+    const void        *record; /**< グループで最初に現れたレコード（group_by フィールドがグループのキー） */
+    ftcs_agg_result_t  result; /**< このグループの集計結果 */
+} ftcs_agg_group_t;
+
+/**
+ * @brief レコード集合の数値フィールドを集計する
+ *
+ * AVX2 が使える CPU では構造体の並び（struct_size おき）を gather 命令でまとめて読み、
+ * 大きな集合は複数スレッドで分割して集計する。合計は型によらず double で累積する（AVX2 の有無で結果が変わらない）。
+ * 最小値・最大値は NaN の値を無視する（全件 NaN のときだけ NaN）。合計・平均は NaN を含めば NaN になる。
+ * 配置位置指定モードの空きスロットもゼロ値のレコードとして数える。
+ *
+ * @param rs         集計対象のレコード集合
+ * @param mapping    フィールドマッピングテーブル
+ * @param field_name 集計するフィールド名（INT / LONG / SHORT / FLOAT / DOUBLE / CHAR）
+ * @param ops        ftcs_agg_op_t の OR
+ * @param out        集計結果の書き込み先
+ * @return 成功時 0、引数不正・数値でないフィールド・スレッド資源の確保失敗時 -1
+ */
+int ftcs_aggregate(const ftcs_record_set_t *rs,
+                   const ftcs_field_mapping_t *mapping,
+                   const char *field_name,
+                   unsigned ops,
+                   ftcs_agg_result_t *out);
+
+/**
+ * @brief group_by フィールドの値ごとに数値フィールドを集計する
+ *
+ * グループは最初に現れた順に並ぶ。group_by は STRING / INT / LONG / SHORT / CHAR のフィールド。
+ *
+ * @param rs         集計対象のレコード集合（結果の record が指すため、結果より長く生存させること）
+ * @param mapping    フィールドマッピングテーブル
+ * @param field_name 集計するフィールド名
+ * @param group_by   グループ分けに使うフィールド名
+ * @param ops        ftcs_agg_op_t の OR
+ * @param groups     グループごとの結果の配列（free() で解放する）
+ * @param ngroups    グループ数
+ * @return 成功時 0、失敗時 -1
+ */
+int ftcs_aggregate_by(const ftcs_record_set_t *rs,
+                      const ftcs_field_mapping_t *mapping,
+                      const char *field_name,
+                      const char *group_by,
+                      unsigned ops,
+                      ftcs_agg_group_t **groups,
+                      size_t *ngroups);
+
+// --- 共有メモリリング ---
+
+/**
+ * @brief 共有メモリリングを読む消費者の上限
+ */
+enum { FTCS_SHM_RING_MAX_CONSUMERS = 8 };
+
+/**
+ * @brief レコード slots 件を格納できるリングに必要な共有メモリのバイト数を返す
+ *
+ * @param struct_size 1レコードのバイトサイズ
+ * @param slots       格納できるレコード数（2 のべき乗に切り上げる）
+ * @return 必要なバイト数、引数が 0 なら 0
+ */
+size_t ftcs_shm_ring_bytes(size_t struct_size, size_t slots);
+
+/**
+ * @brief 共有メモリ領域にリングを作り、生産者として書き込むハンドルを返す
+ *
+ * 領域は全プロセスで MAP_SHARED にマップしておくこと。リングの状態はすべて領域内にあり
+ * ポインタを含まないため、プロセスごとにマップ先のアドレスが違ってよい。
+ * 容量は領域に収まる最大の 2 のべき乗件になる。
+ * 生産者1つと消費者 consumers 個の間で、ロックを使わずにレコードを渡す。
+ * 各消費者はすべてのレコードを受け取る（consumers が 2 以上なら同報）。
+ * 生産者は最も遅い消費者が読み終えたスロットにだけ書き込む。
+ * 待つ側は短くスピンしたあと futex で眠り、相手の更新で起こされる。
+ *
+ * @param addr        共有メモリ領域の先頭（64 バイト境界）
+ * @param size        領域のバイトサイズ
+ * @param struct_size 1レコードのバイトサイズ
+ * @param consumers   消費者の数（1〜FTCS_SHM_RING_MAX_CONSUMERS）
+ * @return 成功時はハンドル、領域が小さい・引数不正・確保失敗時は NULL
+ */
+ftcs_shm_ring_t *ftcs_shm_ring_init(void *addr, size_t size, size_t struct_size,
+                                    unsigned consumers);
+
+/**
+ * @brief ftcs_shm_ring_init() 済みの領域に消費者として接続する
+ *
+ * @param addr        共有メモリ領域の先頭
+ * @param size        領域のバイトサイズ
+ * @param struct_size 1レコードのバイトサイズ（リング作成時と一致すること）
+ * @param consumer    消費者番号（0〜consumers-1。番号ごとに接続は1つまで）
+ * @return 成功時はハンドル、未初期化・サイズ不一致・番号不正なら NULL
+ */
+ftcs_shm_ring_t *ftcs_shm_ring_attach(void *addr, size_t size, size_t struct_size,
+                                      unsigned consumer);
+
+/**
+ * @brief レコード n 件を書き込む（生産者用）
+ *
+ * 空きがある分をまとめて書き、1回の公開で消費者に見せる。
+ * 空きがなければ最も遅い消費者が読み進めるまで待つ。
+ *
+ * @param ring       生産者ハンドル
+ * @param recs       書き込むレコードの連続配列
+ * @param n          レコード数
+ * @param timeout_ms 空きを待つ上限（ミリ秒。負なら無期限、0 なら待たない）
+ * @return 書き込んだ件数（時間切れなら n 未満）、引数不正・クローズ済みなら -1
+ */
+long ftcs_shm_ring_push(ftcs_shm_ring_t *ring, const void *recs, size_t n, int timeout_ms);
+
+/**
+ * @brief 最大 max 件のレコードを取り出す（消費者用）
+ *
+ * 1件もなければ生産者が書き込むまで待つ。
+ *
+ * @param ring       消費者ハンドル
+ * @param out        レコードのコピー先（max 件分）
+ * @param max        取り出す最大件数
+ * @param timeout_ms 待つ上限（ミリ秒。負なら無期限、0 なら待たない）
+ * @return 取り出した件数、生産者がクローズして読み切った場合 0、
+ *         時間切れ（errno = ETIMEDOUT）・引数不正なら -1
+ */
+long ftcs_shm_ring_pop(ftcs_shm_ring_t *ring, void *out, size_t max, int timeout_ms);
+
+/**
+ * @brief 書き込みの終わりを消費者に知らせる（生産者用）
+ *
+ * 待っている消費者を起こす。消費者は残りを読み切ると ftcs_shm_ring_pop() で 0 を受け取る。
+ */
+void ftcs_shm_ring_close(ftcs_shm_ring_t *ring);
+
+/**
+ * @brief ハンドルを解放する（共有メモリ領域とリングの状態は変えない）
+ * @param ring 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_shm_ring_detach(ftcs_shm_ring_t *ring);
+
+// --- 共有メモリの更新通知 ---
+
+/**
+ * @brief 共有メモリに置くスナップショットの更新通知（ゼロ初期化で「未公開」）
+ *
+ * 書き込み側は公開のたびに ftcs_shm_publish_begin() / ftcs_shm_publish_end() で挟み、
+ * 読み出し側は ftcs_shm_wait_update() で次の公開まで眠る。generation は seqlock を兼ね、
+ * 奇数の間は書き込み中である。メンバは必ずこの節の関数で読み書きすること（アトミックに扱う）。
+ */
+typedef struct {
+    uint32_t generation; /**< 公開ごとに 2 増える世代（奇数なら書き込み中）。futex 語 */
+    uint32_t waiters;    /**< ftcs_shm_wait_update() で眠っている読み出し側の数 */
+    uint64_t count;      /**< 直近に公開したレコード数 */
+    uint64_t publish_ns; /**< 直近の公開を終えた時刻（CLOCK_MONOTONIC のナノ秒） */
+} ftcs_shm_notify_t;
+
+/**
+ * @brief 公開を始める（generation を奇数にする）。このあと共有メモリのレコードを書き換える
+ * @param n 更新通知（NULL なら何もしない）
+ */
+void ftcs_shm_publish_begin(ftcs_shm_notify_t *n);
+
+/**
+ * @brief 公開を終え（generation を偶数にする）、待っている読み出し側を起こす
+ *
+ * 眠っている読み出し側がいるときだけ FUTEX_WAKE を呼ぶ。
+ *
+ * @param n     更新通知（NULL なら何もしない）
+ * @param count 公開したレコード数
+ */
+void ftcs_shm_publish_end(ftcs_shm_notify_t *n, size_t count);
+
+/**
+ * @brief *seen と異なる世代が公開されるまで待つ
+ *
+ * タイマーで共有メモリを見に行く代わりに futex で眠り、公開と同時に起こされる。
+ * 初回は *seen を 0 にして呼ぶと、最初の公開（すでに公開済みならすぐ）で戻る。
+ *
+ * @param n          更新通知
+ * @param seen       前回受け取った世代（新しい世代を受け取ったら書き換える）
+ * @param timeout_ms 待つ上限（ミリ秒。負なら無期限、0 なら待たない）
+ * @return 新しい世代を受け取ったら 1、時間切れなら 0、引数不正なら -1
+ */
+int ftcs_shm_wait_update(const ftcs_shm_notify_t *n, uint32_t *seen, int timeout_ms);
+
+/**
+ * @brief スナップショットの読み出しを始める（書き込み中なら終わるまで待つ）
+ *
+ * 読み出したあと ftcs_shm_read_retry() が非ゼロなら、途中で書き換えられたので読み直す:
+ * @code
+ * uint32_t gen;
+ * do {
+ *     gen = ftcs_shm_read_begin(n);
+ *     memcpy(copy, shm_records, ftcs_shm_count(n) * sizeof(rec_t));
+ * } while (ftcs_shm_read_retry(n, gen));
+ * @endcode
+ * @return 読み出し開始時の世代（偶数）
+ */
+uint32_t ftcs_shm_read_begin(const ftcs_shm_notify_t *n);
+
+/**
+ * @brief ftcs_shm_read_begin() 以降に公開が始まったかを返す
+ * @param gen ftcs_shm_read_begin() の戻り値
+ * @return 読み直すべきなら非ゼロ
+ */
+int ftcs_shm_read_retry(const ftcs_shm_notify_t *n, uint32_t gen);
+
+/**
+ * @brief 直近に公開したレコード数を返す
+ */
+size_t ftcs_shm_count(const ftcs_shm_notify_t *n);
+
+// --- 共有メモリのセグメント ---
+
+/**
+ * @brief ftcs_shm_create() / ftcs_shm_open() に渡すマップの指定（ビットの論理和）
+ *
+ * 大きなページが使えない環境では 4KiB ページで続け、実際に効いた指定だけを ftcs_shm_t.flags に残す。
+ */
+enum {
+    FTCS_SHM_HUGETLB  = 1u << 0, /**< hugetlbfs（/dev/hugepages）上のファイルに置き、事前確保した大きなページを使う */
+    FTCS_SHM_THP      = 1u << 1, /**< POSIX 共有メモリに MADV_HUGEPAGE を指定する（shmem_enabled が advise 以上のとき有効） */
+    FTCS_SHM_POPULATE = 1u << 2, /**< MAP_POPULATE でマップ時に全ページを割り当て、初回アクセスのページフォールトをなくす */
+    FTCS_SHM_MLOCK    = 1u << 3, /**< mlock でスワップアウトさせない（RLIMIT_MEMLOCK を超えると外れる） */
+};
+
+/**
+ * @brief ヘッダー・更新通知・レコード配列をまとめて置く名前付き共有メモリ
+ *
+ * 先頭のヘッダーに構造体サイズ・容量・ftcs_shm_notify_t を持ち、レコード配列が続く。
+ * メンバは ftcs_shm_create() / ftcs_shm_open() で設定し、直接変更しないこと。
+ */
+typedef struct {
+    void              *base;     /**< マップの先頭（ヘッダー）。閉じていれば NULL */
+    size_t             len;      /**< マップしているバイト数（ページサイズの倍数） */
+    ftcs_shm_notify_t *notify;   /**< ヘッダー内の更新通知 */
+    void              *records;  /**< レコード配列の先頭（64 バイト境界） */
+    size_t             capacity; /**< 格納できるレコード数（ページの端数まで使う） */
+    unsigned           flags;    /**< 実際に効いた FTCS_SHM_* の論理和 */
+    char              *name;     /**< 作成者が閉じるときに消す名前（ftcs_shm_open() では NULL） */
+} ftcs_shm_t;
+
+/**
+ * @brief struct_size バイトのレコードを capacity 件置けるセグメントを作る
+ *
+ * 同名のセグメントがあれば名前を外してから作り直す（マップ中の読み出し側は古い内容を読み続ける）。
+ * 大きさはページサイズ（大きなページを使うなら 2MiB など）に切り上げ、端数も容量に含める。
+ *
+ * @param shm         初期化対象
+ * @param name        shm_open(3) の名前（"/" で始める）
+ * @param struct_size 1レコードのバイトサイズ
+ * @param capacity    格納するレコード数（パースしたレコード数など。0 なら 1 ページ分）
+ * @param flags       FTCS_SHM_* の論理和
+ * @return 成功時 0、失敗時 -1
+ */
+int ftcs_shm_create(ftcs_shm_t *shm, const char *name, size_t struct_size, size_t capacity,
+                    unsigned flags);
+
+/**
+ * @brief ftcs_shm_create() で作ったセグメントを読み出し側としてマップする
+ *
+ * POSIX 共有メモリになければ hugetlbfs を探す。更新通知を待つため読み書き可能でマップする。
+ *
+ * @param shm         初期化対象
+ * @param name        作成時の名前
+ * @param struct_size 1レコードのバイトサイズ（作成時と違えばエラー）
+ * @param flags       FTCS_SHM_POPULATE / FTCS_SHM_MLOCK / FTCS_SHM_THP の論理和
+ * @return 成功時 0、見つからない・未初期化・サイズ違いなら -1
+ */
+int ftcs_shm_open(ftcs_shm_t *shm, const char *name, size_t struct_size, unsigned flags);
+
+/**
+ * @brief 作成側のセグメントを capacity 件以上置ける大きさで作り直す
+ *
+ * 同じ名前・構造体サイズ・フラグで新しいセグメントを作り、直近に公開したレコードと世代を引き継ぐ。
+ * 古いセグメントには「置き換え済み」を記して世代を進め、ftcs_shm_wait_update() で待っている
+ * 読み出し側を起こす。読み出し側は ftcs_shm_replaced() を見て開き直す。
+ *
+ * @param shm      ftcs_shm_create() で作ったセグメント（成功時は新しいセグメントを指す）
+ * @param capacity 新しい容量（現在の容量以下なら何もしない）
+ * @return 成功時 0、作成側でない・作れなければ -1（shm は古いセグメントのまま）
+ */
+int ftcs_shm_grow(ftcs_shm_t *shm, size_t capacity);
+
+/**
+ * @brief セグメントが ftcs_shm_grow() で置き換えられたかを返す（読み出し側用）
+ *
+ * 非ゼロなら、以降の公開は新しいセグメントにしか現れない。ftcs_shm_close() してから
+ * ftcs_shm_open() で開き直す。
+ * @return 置き換えられていれば非ゼロ
+ */
+int ftcs_shm_replaced(const ftcs_shm_t *shm);
+
+/**
+ * @brief マップを外す。ftcs_shm_create() で作った側なら名前も消す
+ * @param shm 対象（NULL や閉じたものでも安全に無視される）
+ */
+void ftcs_shm_close(ftcs_shm_t *shm);
+
+// --- 検索サーバー ---
+
+/**
+ * @brief 検索サーバーの応答ステータス
+ *
+ * プロトコル（AF_UNIX ストリーム、整数はホストのバイト順）:
+ *   要求: uint32_t key_len, char key[key_len]
+ *   応答: uint32_t status, uint32_t len, uint8_t record[len]（FOUND のときのみ len > 0）
+ * 要求は応答を待たずに続けて送ってよく（パイプライン）、応答は要求順に返る。
+ * キーは FTCS_KEY_FIELD ではプライマリキー値、FTCS_KEY_INDEX では 0-based 添字の文字列。
+ */
+typedef enum {
+    FTCS_LOOKUP_FOUND       = 0, /**< レコードが見つかった（record にレコード本体） */
+    FTCS_LOOKUP_NOT_FOUND   = 1, /**< 該当レコードなし（添字の範囲外・不正を含む） */
+    FTCS_LOOKUP_BAD_REQUEST = 2, /**< キー長が上限（FTCS_LOOKUP_MAX_KEY）を超えた */
+} ftcs_lookup_status_t;
+
+/**
+ * @brief 検索キーの最大バイト数（超えた要求には BAD_REQUEST を返して切断する）
+ */
+#define FTCS_LOOKUP_MAX_KEY 4096
+
+/**
+ * @brief 常駐検索サーバー（不透明型）
+ */
+typedef struct ftcs_server ftcs_server_t;
+
+/**
+ * @brief レコード集合を AF_UNIX ソケットで公開する検索サーバーを作成する
+ *
+ * ソケットを bind / listen し、FTCS_KEY_FIELD ではキー索引を構築する。
+ * socket_path に古いソケットファイルが残っていれば削除してから bind する。
+ *
+ * @param socket_path ソケットファイルのパス
+ * @param rs          公開するレコード集合（サーバーより長く生存させ、変更しないこと）
+ * @param mapping     フィールドマッピングテーブル
+ * @param config      パーサー設定（primary_key_mode / primary_key を参照する）
+ * @return 成功時はサーバー、失敗時は NULL
+ * @note 戻り値は必ず ftcs_server_destroy() で破棄すること
+ */
+ftcs_server_t *ftcs_server_create(const char *socket_path,
+                                  const ftcs_record_set_t *rs,
+                                  const ftcs_field_mapping_t *mapping,
+                                  const ftcs_parser_config_t *config);
+
+/**
+ * @brief epoll のイベントループで要求を処理する（ftcs_server_stop() まで戻らない）
+ * @return 停止要求で終了した場合 0、エラー時 -1
+ */
+int ftcs_server_run(ftcs_server_t *srv);
+
+/**
+ * @brief イベントループに停止を要求する
+ *
+ * 別スレッドやシグナルハンドラから呼んでよい（eventfd への write のみを行う）。
+ */
+void ftcs_server_stop(ftcs_server_t *srv);
+
+/**
+ * @brief サーバーを破棄し、接続を閉じてソケットファイルを削除する
+ * @param srv 破棄対象（NULL でも安全に無視される）
+ */
+void ftcs_server_destroy(ftcs_server_t *srv);
+
+/**
+ * @brief 検索サーバーのクライアント（不透明型）
+ */
+typedef struct ftcs_client ftcs_client_t;
+
+/**
+ * @brief 検索サーバーに接続する
+ * @return 成功時はクライアント、失敗時は NULL
+ */
+ftcs_client_t *ftcs_client_connect(const char *socket_path);
+
+/**
+ * @brief キーを1件検索し、応答を待つ
+ *
+ * @param client   接続済みクライアント
+ * @param key      検索キー
+ * @param out      レコードのコピー先（NULL 可）
+ * @param out_size out のバイト数（レコードが大きければ切り詰める）
+ * @return ftcs_lookup_status_t の値、通信エラー時 -1
+ */
+int ftcs_client_lookup(ftcs_client_t *client, const char *key, void *out, size_t out_size);
+
+/**
+ * @brief 応答を待たずに検索要求を送る（パイプライン）
+ *
+ * 送った要求の数だけ ftcs_client_recv() で応答を受け取ること。
+ * @return 成功時 0、通信エラー時 -1
+ */
+int ftcs_client_send(ftcs_client_t *client, const char *key);
+
+/**
+ * @brief 送信済みの要求に対する応答を、送った順に1件受け取る
+ * @return ftcs_lookup_status_t の値、通信エラー時 -1
+ */
+int ftcs_client_recv(ftcs_client_t *client, void *out, size_t out_size);
+
+/**
+ * @brief 接続を閉じてクライアントを解放する
+ * @param client 解放対象（NULL でも安全に無視される）
+ */
+void ftcs_client_close(ftcs_client_t *client);
+
 // --- フレームワーク エントリポイント ---
 
 /**
@@ -177,6 +1491,11 @@ typedef struct {
     void (*dump_fn)(const void *data);         /**< レコード内容をダンプするコールバック（省略可） */
     void                       *shm_addr;      /**< 呼び出し元が用意した共有メモリ先頭アドレス（NULL = 不使用） */
     size_t                      shm_size;      /**< 共有メモリ領域のバイトサイズ */
+    ftcs_shm_notify_t          *shm_notify;    /**< 共有メモリ上の更新通知（NULL = 通知しない）。
+                                                    shm_addr に書き込むたびに世代を進め、待っている読み出し側を起こす */
+    const char                 *shm_name;      /**< パース後にレコード数に合わせて作るセグメントの名前（NULL = 作らない）。
+                                                    shm_addr とは併用しない。--follow で容量を超えたら作り直す。終了時に名前を消す */
+    unsigned                    shm_flags;     /**< shm_name のセグメントに渡す FTCS_SHM_* の論理和 */
 } ftcs_config_t;
 
 /**
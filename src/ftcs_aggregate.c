@@ -0,0 +1,714 @@
+#define _GNU_SOURCE
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftcs_internal.h"
+
+// 1スレッドに割り当てる最小レコード数（ftcs_parallel_threads に渡す）。
+// 集計は1件あたり数 ns で終わるため、振り分けより大きな単位で分ける。
+#define PARALLEL_MIN_RECORDS 131072
+
+// グループ別集計を並列化するグループ数の上限。スレッドごとにグループ数分の集計領域を持つため、
+// グループが多いと結合のコストが並列化の利得を上回る。
+#define PARALLEL_MAX_GROUPS 65536
+
+// グループ表の最大負荷率の逆数（ftcs_index.c と同じく線形探査の探査長を短く保つ）
+#define GROUP_LOAD_INVERSE 2
+
+// グループ表の最小スロット数（2 のべき乗）
+#define GROUP_MIN_SLOTS 16
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 集計途中の値（count が 0 の間 min / max は未定義）
+ */
+typedef struct {
+    size_t count; /**< 件数 */
+    double sum;   /**< 合計 */
+    double min;   /**< 最小値 */
+    double max;   /**< 最大値 */
+} agg_acc_t;
+
+/**
+ * @brief 1スレッド分の集計範囲
+ */
+typedef struct {
+    const char        *base;     /**< 範囲の先頭レコードの集計フィールド */
+    size_t             n;        /**< レコード数 */
+    size_t             stride;   /**< レコード間隔（struct_size） */
+    ftcs_field_type_t  type;     /**< 集計フィールドの型 */
+    const uint32_t    *group_of; /**< 範囲の先頭レコードからのグループ番号（NULL なら全体を1つに集計） */
+    agg_acc_t         *accs;     /**< 集計先（group_of があればグループ数分） */
+} agg_task_t;
+
+/**
+ * @brief グループ表のスロット1個分
+ */
+typedef struct {
+    uint64_t hash;  /**< キーのハッシュ値 */
+    size_t   group; /**< グループ番号 + 1（0 は空きスロット） */
+} group_slot_t;
+
+/**
+ * @brief グループ分けに使う線形探査のハッシュ表と、グループの代表レコードの配列
+ */
+typedef struct {
+    group_slot_t     *slots;  /**< ハッシュ表 */
+    size_t            nslots; /**< スロット数（2 のべき乗） */
+    ftcs_agg_group_t *groups; /**< グループごとの代表レコード */
+    size_t            cap;    /**< groups の確保済み要素数 */
+    size_t            count;  /**< グループ数 */
+} group_table_t;
+
+// --- 関数宣言（目次） ---
+
+static const ftcs_field_mapping_t *find_numeric(const ftcs_field_mapping_t *mapping,
+                                                const char *field_name);      // 集計できるフィールドを探す
+static int    run_tasks(const agg_task_t *whole, size_t naccs, size_t nthreads,
+                        agg_acc_t *out);                                      // 範囲を分割して集計する
+static void   task_run(void *arg);                                            // 1範囲を集計する
+static void   acc_scalar(const char *p, size_t n, size_t stride,
+                         ftcs_field_type_t type, agg_acc_t *acc);             // 1件ずつ集計する
+static size_t acc_avx2(const char *p, size_t n, size_t stride,
+                       ftcs_field_type_t type, agg_acc_t *acc);               // gather でまとめて集計する
+static __m256d epi64_to_pd(__m256i v);                                        // 64 ビット整数 4 件を double にする
+static double field_value(const char *p, ftcs_field_type_t type);            // フィールド値を double で読む
+static void   acc_add(agg_acc_t *acc, double v);                              // 1件を加える
+static void   acc_merge(agg_acc_t *dst, const agg_acc_t *src);                // 集計途中の値を結合する
+static double min_skip_nan(double a, double b);                               // NaN を無視した最小値
+static double max_skip_nan(double a, double b);                               // NaN を無視した最大値
+static void   fill_result(const agg_acc_t *acc, unsigned ops, ftcs_agg_result_t *out); // 結果に書き出す
+static uint32_t *assign_groups(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *g,
+                               ftcs_agg_group_t **groups, size_t *ngroups);   // 各レコードのグループを決める
+static long   group_lookup(group_table_t *tab, const ftcs_field_mapping_t *g,
+                           const char *rec);                                  // レコードのグループ番号を返す
+static int    group_rehash(group_table_t *tab);                               // グループ表を広げる
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+int ftcs_aggregate(const ftcs_record_set_t *rs,
+                   const ftcs_field_mapping_t *mapping,
+                   const char *field_name,
+                   unsigned ops,
+                   ftcs_agg_result_t *out)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs || !mapping || !field_name || !out) {
+        fprintf(stderr, "ftcs: ftcs_aggregate に NULL 引数が渡された\n");
+        return -1;
+    }
+    const ftcs_field_mapping_t *m = find_numeric(mapping, field_name); // 集計するフィールド
+    if (!m) {
+        return -1;
+    }
+
+    agg_task_t whole = {
+        .base   = (const char *)rs->records + m->offset,
+        .n      = rs->count,
+        .stride = rs->struct_size,
+        .type   = m->type,
+    }; // 集合全体の集計範囲
+    agg_acc_t acc; // 集計結果
+    if (run_tasks(&whole, 1, ftcs_parallel_threads(rs->count, PARALLEL_MIN_RECORDS), &acc) != 0) {
+        return -1;
+    }
+    fill_result(&acc, ops, out);
+    return 0;
+}
+
+int ftcs_aggregate_by(const ftcs_record_set_t *rs,
+                      const ftcs_field_mapping_t *mapping,
+                      const char *field_name,
+                      const char *group_by,
+                      unsigned ops,
+                      ftcs_agg_group_t **groups,
+                      size_t *ngroups)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs || !mapping || !field_name || !group_by || !groups || !ngroups) {
+        fprintf(stderr, "ftcs: ftcs_aggregate_by に NULL 引数が渡された\n");
+        return -1;
+    }
+    const ftcs_field_mapping_t *m = find_numeric(mapping, field_name); // 集計するフィールド
+    if (!m) {
+        return -1;
+    }
+    const ftcs_field_mapping_t *g = mapping; // グループ分けに使うフィールド
+    while (g->field_name && strcmp(g->field_name, group_by) != 0) {
+        g++;
+    }
+    if (!g->field_name || g->type == FTCS_TYPE_FLOAT || g->type == FTCS_TYPE_DOUBLE
+        || g->type == FTCS_TYPE_ARRAY) {
+        fprintf(stderr, "ftcs: '%s' はグループ分けに使えるフィールドではない\n", group_by);
+        return -1;
+    }
+
+    ftcs_agg_group_t *grp;       // グループごとの結果
+    size_t            ngrp;      // グループ数
+    uint32_t         *group_of = assign_groups(rs, g, &grp, &ngrp); // 各レコードのグループ番号
+    if (!group_of) {
+        return -1;
+    }
+    agg_acc_t *accs = malloc((ngrp ? ngrp : 1) * sizeof(*accs)); // グループごとの集計結果
+    if (!accs) {
+        perror("ftcs: malloc");
+        free(group_of);
+        free(grp);
+        return -1;
+    }
+    agg_task_t whole = {
+        .base     = (const char *)rs->records + m->offset,
+        .n        = rs->count,
+        .stride   = rs->struct_size,
+        .type     = m->type,
+        .group_of = group_of,
+    }; // 集合全体の集計範囲
+    size_t nthreads = ngrp <= PARALLEL_MAX_GROUPS ? ftcs_parallel_threads(rs->count, PARALLEL_MIN_RECORDS) : 1; // 集計スレッド数
+    int    rc       = run_tasks(&whole, ngrp, nthreads, accs); // 集計結果
+    if (rc == 0) {
+        for (size_t i = 0; i < ngrp; i++) {
+            fill_result(&accs[i], ops, &grp[i].result);
+        }
+        *groups  = grp;
+        *ngroups = ngrp;
+    } else {
+        free(grp);
+    }
+    free(accs);
+    free(group_of);
+    return rc;
+}
+
+/**
+ * @brief マッピングから集計できる数値型のフィールドを探す
+ *
+ * @param mapping    フィールドマッピングテーブル
+ * @param field_name フィールド名
+ * @return マッピングエントリ、存在しないか文字列型・配列型なら NULL
+ */
+static const ftcs_field_mapping_t *find_numeric(const ftcs_field_mapping_t *mapping,
+                                                const char *field_name)
+{
+    const ftcs_field_mapping_t *m = mapping; // 探索中のエントリ
+    while (m->field_name && strcmp(m->field_name, field_name) != 0) {
+        m++;
+    }
+    if (!m->field_name || m->type == FTCS_TYPE_STRING || m->type == FTCS_TYPE_ARRAY) {
+        fprintf(stderr, "ftcs: '%s' は集計できる数値フィールドではない\n", field_name);
+        return NULL;
+    }
+    return m;
+}
+
+/**
+ * @brief 集計範囲を nthreads 個に分け、各スレッドの結果を結合する
+ *
+ * 分けた範囲は ftcs_run_parallel() で並行して集計する。
+ *
+ * @param whole    集合全体の集計範囲（accs は使わない）
+ * @param naccs    集計先の数（全体集計なら 1、グループ別ならグループ数）
+ * @param nthreads 分割数
+ * @param out      結合した集計結果（naccs 個）
+ * @return 成功時 0、確保失敗時 -1
+ */
+static int run_tasks(const agg_task_t *whole, size_t naccs, size_t nthreads, agg_acc_t *out)
+{
+    agg_task_t *tasks = calloc(nthreads, sizeof(*tasks));          // 各スレッドの集計範囲
+    agg_acc_t  *accs  = calloc(nthreads * naccs + 1, sizeof(*accs)); // 各スレッドの集計先
+    if (!tasks || !accs) {
+        perror("ftcs: calloc");
+        free(tasks);
+        free(accs);
+        return -1;
+    }
+
+    size_t per = whole->n / nthreads; // 1スレッドあたりのレコード数（端数は最後のスレッド）
+    for (size_t i = 0; i < nthreads; i++) {
+        size_t first = i * per;                                   // 範囲の先頭位置
+        tasks[i]      = *whole;
+        tasks[i].base = whole->base + first * whole->stride;
+        tasks[i].n    = (i + 1 == nthreads) ? whole->n - first : per;
+        tasks[i].accs = accs + i * naccs;
+        if (whole->group_of) {
+            tasks[i].group_of = whole->group_of + first;
+        }
+    }
+    if (ftcs_run_parallel(tasks, nthreads, sizeof(*tasks), task_run) != 0) {
+        free(tasks);
+        free(accs);
+        return -1;
+    }
+
+    memset(out, 0, naccs * sizeof(*out));
+    for (size_t i = 0; i < nthreads; i++) {
+        for (size_t a = 0; a < naccs; a++) {
+            acc_merge(&out[a], &tasks[i].accs[a]);
+        }
+    }
+    free(tasks);
+    free(accs);
+    return 0;
+}
+
+/**
+ * @brief 1つの集計範囲を集計する
+ *
+ * 全体集計では gather で処理できる型をまとめて読み、残りを1件ずつ処理する。
+ *
+ * @param arg 集計範囲（agg_task_t。accs に書き込む）
+ */
+static void task_run(void *arg)
+{
+    agg_task_t *t = arg; // 集計範囲
+    if (t->group_of) {
+        const char *p = t->base; // 処理中のフィールド
+        for (size_t i = 0; i < t->n; i++, p += t->stride) {
+            acc_add(&t->accs[t->group_of[i]], field_value(p, t->type));
+        }
+        return;
+    }
+    size_t done = 0; // gather で処理したレコード数
+    // gather の添字は 32 ビット符号付きなので、8 レコード分の間隔が収まる場合に限る
+    if (t->stride <= INT32_MAX / 8 && __builtin_cpu_supports("avx2")) {
+        done = acc_avx2(t->base, t->n, t->stride, t->type, t->accs);
+    }
+    agg_acc_t rest = { 0 }; // 端数の集計結果
+    acc_scalar(t->base + done * t->stride, t->n - done, t->stride, t->type, &rest);
+    acc_merge(t->accs, &rest);
+}
+
+/**
+ * @brief 1件ずつフィールド値を読んで集計する
+ *
+ * @param p      先頭レコードの集計フィールド
+ * @param n      レコード数
+ * @param stride レコード間隔
+ * @param type   フィールドの型
+ * @param acc    集計先
+ */
+static void acc_scalar(const char *p, size_t n, size_t stride,
+                       ftcs_field_type_t type, agg_acc_t *acc)
+{
+    for (size_t i = 0; i < n; i++, p += stride) {
+        acc_add(acc, field_value(p, type));
+    }
+}
+
+/**
+ * @brief AVX2 の gather で struct_size おきのフィールドをまとめて読み、集計する
+ *
+ * 1回の gather で INT / FLOAT は 8 件、LONG / DOUBLE は 4 件を読む。
+ * SHORT / CHAR は 4 バイト単位の gather が末尾レコードの外を読むおそれがあるため扱わない。
+ * 末尾の端数（1回の gather に満たない分）は呼び出し元が1件ずつ処理する。
+ *
+ * @param p      先頭レコードの集計フィールド
+ * @param n      レコード数
+ * @param stride レコード間隔
+ * @param type   フィールドの型
+ * @param acc    集計先（count が 0 の状態で渡す）
+ * @return 処理したレコード数
+ */
+__attribute__((target("avx2")))
+static size_t acc_avx2(const char *p, size_t n, size_t stride,
+                       ftcs_field_type_t type, agg_acc_t *acc)
+{
+    int    s     = (int)stride;                                  // 添字計算用の間隔
+    __m256i idx8 = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s); // 8 件分のバイト位置
+    __m128i idx4 = _mm_setr_epi32(0, s, 2 * s, 3 * s);             // 4 件分のバイト位置
+    size_t  lanes = (type == FTCS_TYPE_LONG || type == FTCS_TYPE_DOUBLE) ? 4 : 8; // 1回の gather の件数
+    size_t  n_vec = n / lanes * lanes; // gather で処理するレコード数
+    size_t  step  = lanes * stride;    // 1回の gather で進むバイト数
+    if (n_vec == 0) {
+        return 0;
+    }
+
+    double sum;       // 合計
+    double mn;        // 最小値
+    double mx;        // 最大値
+    switch (type) {
+    case FTCS_TYPE_INT: {
+        // 合計は acc_add と同じく double に広げて累積し、最小・最大は 32 ビットのまま比べる
+        __m256i vmin = _mm256_i32gather_epi32((const int *)p, idx8, 1); // 各レーンの最小値
+        __m256i vmax = vmin;                                            // 各レーンの最大値
+        __m256d vsum = _mm256_setzero_pd();                             // 各レーンの合計
+        for (size_t i = 0; i < n_vec; i += lanes, p += step) {
+            __m256i v = _mm256_i32gather_epi32((const int *)p, idx8, 1); // 8 件分の値
+            vmin = _mm256_min_epi32(vmin, v);
+            vmax = _mm256_max_epi32(vmax, v);
+            vsum = _mm256_add_pd(vsum, _mm256_cvtepi32_pd(_mm256_castsi256_si128(v)));
+            vsum = _mm256_add_pd(vsum, _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)));
+        }
+        int32_t lmin[8], lmax[8]; // レーンごとの最小・最大
+        double  lsum[4];          // レーンごとの合計
+        _mm256_storeu_si256((__m256i *)lmin, vmin);
+        _mm256_storeu_si256((__m256i *)lmax, vmax);
+        _mm256_storeu_pd(lsum, vsum);
+        int32_t imin = lmin[0]; // 最小値
+        int32_t imax = lmax[0]; // 最大値
+        for (int l = 1; l < 8; l++) {
+            imin = lmin[l] < imin ? lmin[l] : imin;
+            imax = lmax[l] > imax ? lmax[l] : imax;
+        }
+        sum = lsum[0] + lsum[1] + lsum[2] + lsum[3];
+        mn  = imin;
+        mx  = imax;
+        break;
+    }
+    case FTCS_TYPE_LONG: {
+        // AVX2 には 64 ビット整数の min / max がないため比較とブレンドで選ぶ。
+        // 合計は 64 ビットのレーンで累積すると大きな値で桁あふれするため、acc_add と同じく double で累積する
+        __m256i vmin = _mm256_i32gather_epi64((const long long *)p, idx4, 1); // 各レーンの最小値
+        __m256i vmax = vmin;                                                  // 各レーンの最大値
+        __m256d vsum = _mm256_setzero_pd();                                   // 各レーンの合計
+        for (size_t i = 0; i < n_vec; i += lanes, p += step) {
+            __m256i v = _mm256_i32gather_epi64((const long long *)p, idx4, 1); // 4 件分の値
+            vmin = _mm256_blendv_epi8(vmin, v, _mm256_cmpgt_epi64(vmin, v));
+            vmax = _mm256_blendv_epi8(vmax, v, _mm256_cmpgt_epi64(v, vmax));
+            vsum = _mm256_add_pd(vsum, epi64_to_pd(v));
+        }
+        long long lmin[4], lmax[4]; // レーンごとの最小・最大
+        double    lsum[4];          // レーンごとの合計
+        _mm256_storeu_si256((__m256i *)lmin, vmin);
+        _mm256_storeu_si256((__m256i *)lmax, vmax);
+        _mm256_storeu_pd(lsum, vsum);
+        long long lo = lmin[0]; // 最小値
+        long long hi = lmax[0]; // 最大値
+        for (int l = 1; l < 4; l++) {
+            lo = lmin[l] < lo ? lmin[l] : lo;
+            hi = lmax[l] > hi ? lmax[l] : hi;
+        }
+        sum = lsum[0] + lsum[1] + lsum[2] + lsum[3];
+        mn  = (double)lo;
+        mx  = (double)hi;
+        break;
+    }
+    case FTCS_TYPE_FLOAT: {
+        // 合計は桁落ちを避けるため double に広げて累積する
+        __m256  vmin = _mm256_i32gather_ps((const float *)p, idx8, 1); // 各レーンの最小値
+        __m256  vmax = vmin;                                           // 各レーンの最大値
+        __m256d vsum = _mm256_setzero_pd();                            // 各レーンの合計
+        for (size_t i = 0; i < n_vec; i += lanes, p += step) {
+            __m256 v = _mm256_i32gather_ps((const float *)p, idx8, 1); // 8 件分の値
+            // min / max は NaN を無視する：v が NaN なら第2オペランドの累積値が残り、
+            // 累積値が NaN のレーン（先頭が NaN だった）は v で置き換える
+            __m256 nan = _mm256_cmp_ps(vmin, vmin, _CMP_UNORD_Q); // 累積値が NaN のレーン
+            vmin = _mm256_blendv_ps(_mm256_min_ps(v, vmin), v, nan);
+            vmax = _mm256_blendv_ps(_mm256_max_ps(v, vmax), v, nan);
+            vsum = _mm256_add_pd(vsum, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+            vsum = _mm256_add_pd(vsum, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+        }
+        float  lmin[8], lmax[8]; // レーンごとの最小・最大
+        double lsum[4];          // レーンごとの合計
+        _mm256_storeu_ps(lmin, vmin);
+        _mm256_storeu_ps(lmax, vmax);
+        _mm256_storeu_pd(lsum, vsum);
+        mn = lmin[0];
+        mx = lmax[0];
+        for (int l = 1; l < 8; l++) {
+            mn = min_skip_nan(mn, lmin[l]);
+            mx = max_skip_nan(mx, lmax[l]);
+        }
+        sum = lsum[0] + lsum[1] + lsum[2] + lsum[3];
+        break;
+    }
+    case FTCS_TYPE_DOUBLE: {
+        __m256d vmin = _mm256_i32gather_pd((const double *)p, idx4, 1); // 各レーンの最小値
+        __m256d vmax = vmin;                                            // 各レーンの最大値
+        __m256d vsum = _mm256_setzero_pd();                             // 各レーンの合計
+        for (size_t i = 0; i < n_vec; i += lanes, p += step) {
+            __m256d v = _mm256_i32gather_pd((const double *)p, idx4, 1); // 4 件分の値
+            __m256d nan = _mm256_cmp_pd(vmin, vmin, _CMP_UNORD_Q); // 累積値が NaN のレーン（FLOAT と同じく NaN を無視）
+            vmin = _mm256_blendv_pd(_mm256_min_pd(v, vmin), v, nan);
+            vmax = _mm256_blendv_pd(_mm256_max_pd(v, vmax), v, nan);
+            vsum = _mm256_add_pd(vsum, v);
+        }
+        double lmin[4], lmax[4], lsum[4]; // レーンごとの最小・最大・合計
+        _mm256_storeu_pd(lmin, vmin);
+        _mm256_storeu_pd(lmax, vmax);
+        _mm256_storeu_pd(lsum, vsum);
+        mn = lmin[0];
+        mx = lmax[0];
+        for (int l = 1; l < 4; l++) {
+            mn = min_skip_nan(mn, lmin[l]);
+            mx = max_skip_nan(mx, lmax[l]);
+        }
+        sum = lsum[0] + lsum[1] + lsum[2] + lsum[3];
+        break;
+    }
+    default:
+        return 0;
+    }
+    acc->count = n_vec;
+    acc->sum   = sum;
+    acc->min   = mn;
+    acc->max   = mx;
+    return n_vec;
+}
+
+/**
+ * @brief 64 ビット符号付き整数 4 件を double に変換する（AVX2 には直接の変換命令がない）
+ *
+ * 上位 32 ビット（符号付き）と下位 32 ビット（符号なし）をそれぞれ正確に double にし、
+ * 上位 × 2^32 + 下位 の1回の加算で丸めるので、スカラーの (double) 変換と同じ値になる。
+ *
+ * @param v 4 件分の値
+ * @return 4 件分の double
+ */
+__attribute__((target("avx2")))
+static __m256d epi64_to_pd(__m256i v)
+{
+    // 各レーンの上位 32 ビットを下側 128 ビットに、下位 32 ビットを上側 128 ビットに集める
+    __m256i split = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(1, 3, 5, 7, 0, 2, 4, 6)); // 上位・下位に分けた値
+    __m256d hi    = _mm256_cvtepi32_pd(_mm256_castsi256_si128(split));                       // 上位（符号付き）
+    // 下位は符号ビットを反転して符号付きで変換し、2^31 を足して符号なしの値に戻す
+    __m128i lo32  = _mm_xor_si128(_mm256_extracti128_si256(split, 1), _mm_set1_epi32(INT32_MIN)); // 下位 - 2^31
+    __m256d lo    = _mm256_add_pd(_mm256_cvtepi32_pd(lo32), _mm256_set1_pd(2147483648.0));       // 下位（符号なし）
+    return _mm256_add_pd(_mm256_mul_pd(hi, _mm256_set1_pd(4294967296.0)), lo);
+}
+
+/**
+ * @brief フィールド値を型に応じて読み、double で返す
+ *
+ * @param p    フィールドの位置
+ * @param type フィールドの型（STRING 以外）
+ * @return フィールド値
+ */
+static double field_value(const char *p, ftcs_field_type_t type)
+{
+    switch (type) {
+    case FTCS_TYPE_INT:
+        return *(const int *)p;
+    case FTCS_TYPE_LONG:
+        return (double)*(const long *)p;
+    case FTCS_TYPE_SHORT:
+        return *(const short *)p;
+    case FTCS_TYPE_FLOAT:
+        return *(const float *)p;
+    case FTCS_TYPE_DOUBLE:
+        return *(const double *)p;
+    case FTCS_TYPE_CHAR:
+        return *(const char *)p;
+    case FTCS_TYPE_STRING:
+    case FTCS_TYPE_ARRAY:
+        break;
+    }
+    return 0.0;
+}
+
+/**
+ * @brief 集計途中の値に1件を加える
+ *
+ * @param acc 集計先
+ * @param v   加える値
+ */
+static void acc_add(agg_acc_t *acc, double v)
+{
+    if (acc->count == 0) {
+        acc->min = v;
+        acc->max = v;
+    } else {
+        acc->min = min_skip_nan(acc->min, v);
+        acc->max = max_skip_nan(acc->max, v);
+    }
+    acc->count++;
+    acc->sum += v;
+}
+
+/**
+ * @brief 集計途中の値 src を dst に結合する
+ *
+ * @param dst 結合先
+ * @param src 結合元
+ */
+static void acc_merge(agg_acc_t *dst, const agg_acc_t *src)
+{
+    if (src->count == 0) {
+        return;
+    }
+    if (dst->count == 0) {
+        *dst = *src;
+        return;
+    }
+    dst->count += src->count;
+    dst->sum   += src->sum;
+    dst->min    = min_skip_nan(dst->min, src->min);
+    dst->max    = max_skip_nan(dst->max, src->max);
+}
+
+/**
+ * @brief NaN を無視して小さい方を返す（AVX2 の経路と同じ規則）
+ *
+ * @param a 累積中の最小値（NaN なら b を返す）
+ * @param b 比べる値（NaN なら a を返す）
+ * @return 小さい方。両方 NaN のときだけ NaN
+ */
+static double min_skip_nan(double a, double b)
+{
+    return (b < a || a != a) ? b : a;
+}
+
+/**
+ * @brief NaN を無視して大きい方を返す（AVX2 の経路と同じ規則）
+ *
+ * @param a 累積中の最大値（NaN なら b を返す）
+ * @param b 比べる値（NaN なら a を返す）
+ * @return 大きい方。両方 NaN のときだけ NaN
+ */
+static double max_skip_nan(double a, double b)
+{
+    return (b > a || a != a) ? b : a;
+}
+
+/**
+ * @brief 集計途中の値から ops で指定した項目を結果に書き出す
+ *
+ * @param acc 集計途中の値
+ * @param ops ftcs_agg_op_t の OR
+ * @param out 書き込み先
+ */
+static void fill_result(const agg_acc_t *acc, unsigned ops, ftcs_agg_result_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (ops & FTCS_AGG_COUNT) {
+        out->count = acc->count;
+    }
+    if (acc->count == 0) {
+        return;
+    }
+    if (ops & FTCS_AGG_SUM) {
+        out->sum = acc->sum;
+    }
+    if (ops & FTCS_AGG_MIN) {
+        out->min = acc->min;
+    }
+    if (ops & FTCS_AGG_MAX) {
+        out->max = acc->max;
+    }
+    if (ops & FTCS_AGG_MEAN) {
+        out->mean = acc->sum / (double)acc->count;
+    }
+}
+
+/**
+ * @brief group_by フィールドの値で各レコードのグループ番号を決める
+ *
+ * グループは最初に現れた順に番号を振り、そのレコードを代表として groups に記録する。
+ *
+ * @param rs      レコード集合
+ * @param g       グループ分けに使うフィールドのマッピングエントリ
+ * @param groups  グループごとの代表レコード（result は未設定。free() で解放する）
+ * @param ngroups グループ数
+ * @return 各レコードのグループ番号の配列（free() で解放する）、確保失敗時 NULL
+ */
+static uint32_t *assign_groups(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *g,
+                               ftcs_agg_group_t **groups, size_t *ngroups)
+{
+    group_table_t tab = { .nslots = GROUP_MIN_SLOTS, .cap = GROUP_MIN_SLOTS }; // グループ表
+    uint32_t *group_of = malloc((rs->count ? rs->count : 1) * sizeof(*group_of)); // 各レコードのグループ番号
+    tab.slots  = calloc(tab.nslots, sizeof(*tab.slots));
+    tab.groups = malloc(tab.cap * sizeof(*tab.groups));
+    if (!group_of || !tab.slots || !tab.groups) {
+        perror("ftcs: malloc");
+        free(group_of);
+        free(tab.slots);
+        free(tab.groups);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < rs->count; i++) {
+        const char *rec = (const char *)rs->records + i * rs->struct_size; // i 番目のレコード
+        long        grp = group_lookup(&tab, g, rec);                      // レコードのグループ番号
+        if (grp < 0) {
+            free(group_of);
+            free(tab.slots);
+            free(tab.groups);
+            return NULL;
+        }
+        group_of[i] = (uint32_t)grp;
+    }
+    free(tab.slots);
+    *groups  = tab.groups;
+    *ngroups = tab.count;
+    return group_of;
+}
+
+/**
+ * @brief レコードのグループ番号を返す（キーが初出なら新しいグループを作る）
+ *
+ * @param tab グループ表
+ * @param g   グループ分けに使うフィールドのマッピングエントリ
+ * @param rec レコード
+ * @return グループ番号、確保失敗・グループ数超過時 -1
+ */
+static long group_lookup(group_table_t *tab, const ftcs_field_mapping_t *g, const char *rec)
+{
+    const void *field = rec + g->offset;            // グループのキー
+    uint64_t    h     = ftcs_field_hash(g, field);  // キーのハッシュ値
+    size_t      s     = h & (tab->nslots - 1);      // 探査中のスロット
+    while (tab->slots[s].group) {
+        size_t grp = tab->slots[s].group - 1; // スロットのグループ番号
+        if (tab->slots[s].hash == h
+            && ftcs_field_equal(g, field, (const char *)tab->groups[grp].record + g->offset)) {
+            return (long)grp;
+        }
+        s = (s + 1) & (tab->nslots - 1);
+    }
+
+    // 新しいグループ: 代表レコードを記録し、必要なら表を広げる
+    if (tab->count == UINT32_MAX) {
+        fprintf(stderr, "ftcs: グループ数が多すぎる\n");
+        return -1;
+    }
+    if (tab->count == tab->cap) {
+        ftcs_agg_group_t *bigger = realloc(tab->groups, tab->cap * 2 * sizeof(*bigger)); // 拡張後の配列
+        if (!bigger) {
+            perror("ftcs: realloc");
+            return -1;
+        }
+        tab->groups = bigger;
+        tab->cap   *= 2;
+    }
+    size_t grp = tab->count++; // 新しいグループ番号
+    tab->groups[grp].record = rec;
+    tab->slots[s].hash      = h;
+    tab->slots[s].group     = grp + 1;
+    if (tab->count * GROUP_LOAD_INVERSE > tab->nslots && group_rehash(tab) != 0) {
+        return -1;
+    }
+    return (long)grp;
+}
+
+/**
+ * @brief グループ表のスロット数を2倍にして登録済みのグループを移す
+ *
+ * @param tab グループ表
+ * @return 成功時 0、calloc 失敗時 -1
+ */
+static int group_rehash(group_table_t *tab)
+{
+    size_t        nbig = tab->nslots * 2;               // 拡張後のスロット数
+    group_slot_t *big  = calloc(nbig, sizeof(*big));    // 拡張後のグループ表
+    if (!big) {
+        perror("ftcs: calloc");
+        return -1;
+    }
+    for (size_t k = 0; k < tab->nslots; k++) {
+        if (!tab->slots[k].group) {
+            continue;
+        }
+        size_t t = tab->slots[k].hash & (nbig - 1); // 移し先のスロット
+        while (big[t].group) {
+            t = (t + 1) & (nbig - 1);
+        }
+        big[t] = tab->slots[k];
+    }
+    free(tab->slots);
+    tab->slots  = big;
+    tab->nslots = nbig;
+    return 0;
+}
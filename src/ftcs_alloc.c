@@ -0,0 +1,374 @@
+#define _GNU_SOURCE
+#include <malloc.h>
+#include <stdio.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "ftcs_internal.h"
+
+// アリーナで切り出すブロックの境界。どの構造体型でも正しく整列できるよう max_align_t に合わせる。
+#define ARENA_ALIGN alignof(max_align_t)
+
+// huge page（x86-64 の PMD）1枚のサイズ。確保・拡張はこの単位に切り上げ、
+// 部分的な huge page が末尾に残って 4KiB ページに分割されるのを避ける。
+#define HUGEPAGE_SIZE (2u * 1024 * 1024)
+
+// --- 関数宣言（目次） ---
+
+static void  *arena_alloc(void *ctx, size_t size);                                // アリーナから切り出す
+static void  *arena_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size); // 末尾ブロックなら領域内で伸ばす
+static void   arena_free(void *ctx, void *ptr, size_t size);                      // 末尾ブロックなら巻き戻す
+static void  *hugepage_alloc(void *ctx, size_t size);                             // huge page 対象の匿名 mmap を確保する
+static void  *hugepage_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size); // mremap で拡張する
+static void   hugepage_free(void *ctx, void *ptr, size_t size);                   // munmap する
+static size_t round_up(size_t n, size_t unit);                                    // n を unit の倍数に切り上げる
+static int    slot_empty(const char *rec, size_t size);                           // 全バイト 0 のレコードか
+static size_t resident_bytes(const void *p, size_t len);                          // 物理メモリに載っているバイト数
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+int ftcs_arena_init(ftcs_arena_t *arena, void *buf, size_t size)
+{
+    memset(arena, 0, sizeof(*arena));
+    // 領域が渡されなければアリーナ自身が確保する
+    if (!buf) {
+        buf = malloc(size);
+        if (!buf) {
+            perror("ftcs: malloc");
+            return -1;
+        }
+        arena->owned = 1;
+    }
+    arena->base = buf;
+    arena->size = size;
+    return 0;
+}
+
+void ftcs_arena_reset(ftcs_arena_t *arena)
+{
+    arena->used = 0;
+    arena->last = 0;
+}
+
+void ftcs_arena_destroy(ftcs_arena_t *arena)
+{
+    if (arena->owned) {
+        free(arena->base);
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+ftcs_allocator_t ftcs_arena_allocator(ftcs_arena_t *arena)
+{
+    ftcs_allocator_t a = { arena_alloc, arena_realloc, arena_free, arena }; // アリーナを ctx に持つアロケーター
+    return a;
+}
+
+ftcs_allocator_t ftcs_hugepage_allocator(void)
+{
+    ftcs_allocator_t a = { hugepage_alloc, hugepage_realloc, hugepage_free, NULL }; // 状態を持たないアロケーター
+    return a;
+}
+
+ftcs_allocator_t ftcs_shm_allocator(ftcs_arena_t *arena, void *shm_addr, size_t shm_size)
+{
+    // 呼び出し元の領域を渡すので確保は発生せず、失敗しない
+    ftcs_arena_init(arena, shm_addr, shm_size);
+    return ftcs_arena_allocator(arena);
+}
+
+int ftcs_record_set_memory_info(const ftcs_record_set_t *rs, ftcs_memory_info_t *out)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs || !out) {
+        fprintf(stderr, "ftcs: ftcs_record_set_memory_info に NULL 引数が渡された\n");
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+    out->used_bytes     = rs->count * rs->struct_size;
+    out->reserved_bytes = rs->capacity * rs->struct_size;
+    out->resident_bytes = resident_bytes(rs->records, out->reserved_bytes);
+
+    const char *rec   = rs->records; // 走査中のレコード
+    size_t      empty = 0;           // 空きスロット数
+    for (size_t i = 0; i < rs->count; i++, rec += rs->struct_size) {
+        // 空きスロットが続いている間だけ末尾の連続数を伸ばし、使用中のスロットで数え直す
+        if (slot_empty(rec, rs->struct_size)) {
+            empty++;
+            out->trailing_empty++;
+        } else {
+            out->trailing_empty = 0;
+        }
+    }
+    out->empty_bytes = empty * rs->struct_size;
+    return 0;
+}
+
+int ftcs_record_set_compact(ftcs_record_set_t *rs, unsigned flags)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs) {
+        fprintf(stderr, "ftcs: ftcs_record_set_compact に NULL 引数が渡された\n");
+        return -1;
+    }
+    size_t count = rs->count; // 縮めたあとのレコード数
+    if (flags & FTCS_COMPACT_TRIM_EMPTY) {
+        while (count > 0
+               && slot_empty((const char *)rs->records + (count - 1) * rs->struct_size, rs->struct_size)) {
+            count--;
+        }
+    }
+    // 0 件でも records は有効な領域を指したままにする（realloc(ptr, 0) は解放になりうる）
+    size_t new_cap = count ? count : 1; // 縮めたあとのスロット数
+    if (new_cap < rs->capacity) {
+        void *p = ftcs_mem_realloc(&rs->allocator, rs->records,
+                                   rs->capacity * rs->struct_size,
+                                   new_cap * rs->struct_size); // 縮めたレコード配列
+        if (!p) {
+            fprintf(stderr, "ftcs: レコード配列を %zu スロットに縮められない\n", new_cap);
+            return -1;
+        }
+        rs->records  = p;
+        rs->capacity = new_cap;
+        // realloc で縮めた末尾はヒープの空きに戻るだけなので、OS に返す
+        if (!rs->allocator.realloc_fn) {
+            malloc_trim(0);
+        }
+    }
+    rs->count = count;
+    return 0;
+}
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+void *ftcs_mem_alloc(const ftcs_allocator_t *a, size_t size)
+{
+    // アロケーター未指定なら calloc でゼロ初期化済みの領域を得る
+    if (!a || !a->alloc_fn) {
+        return calloc(1, size);
+    }
+    void *p = a->alloc_fn(a->ctx, size); // 利用者アロケーターが返した領域
+    if (p) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+void *ftcs_mem_realloc(const ftcs_allocator_t *a, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!a || !a->realloc_fn) {
+        return realloc(ptr, new_size);
+    }
+    return a->realloc_fn(a->ctx, ptr, old_size, new_size);
+}
+
+void ftcs_mem_free(const ftcs_allocator_t *a, void *ptr, size_t size)
+{
+    if (!ptr) {
+        return;
+    }
+    if (!a || !a->free_fn) {
+        free(ptr);
+        return;
+    }
+    a->free_fn(a->ctx, ptr, size);
+}
+
+// --- バンプアリーナ ---
+
+/**
+ * @brief アリーナの使用済み位置から size バイトを切り出す
+ *
+ * @param ctx  ftcs_arena_t へのポインタ
+ * @param size 確保するバイト数
+ * @return 確保した領域、領域不足なら NULL
+ */
+static void *arena_alloc(void *ctx, size_t size)
+{
+    ftcs_arena_t *arena = ctx; // 切り出し元のアリーナ
+    size_t off = round_up(arena->used, ARENA_ALIGN); // 整列後の切り出し位置
+    if (off > arena->size || size > arena->size - off) {
+        fprintf(stderr, "ftcs: アリーナの容量不足（%zu / %zu バイト使用中、%zu バイト要求）\n",
+                arena->used, arena->size, size);
+        return NULL;
+    }
+    arena->last = off;
+    arena->used = off + size;
+    return arena->base + off;
+}
+
+/**
+ * @brief ブロックを new_size バイトに伸縮する
+ *
+ * 最後に確保したブロックなら領域内でそのまま伸縮する（コピーなし）。
+ * それ以外は、縮める場合はそのまま返し、伸ばす場合は新しく切り出してコピーし、古いブロックは放置する。
+ *
+ * @param ctx      ftcs_arena_t へのポインタ
+ * @param ptr      伸縮対象のブロック
+ * @param old_size 現在のバイト数
+ * @param new_size 新しいバイト数
+ * @return 伸縮後のブロック、領域不足なら NULL（ptr は有効なまま）
+ */
+static void *arena_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    ftcs_arena_t *arena = ctx; // 伸縮対象のアリーナ
+    // 末尾ブロックは使用済み位置を動かすだけでよい
+    if ((char *)ptr == arena->base + arena->last) {
+        if (new_size > arena->size - arena->last) {
+            fprintf(stderr, "ftcs: アリーナの容量不足（%zu バイトへの拡張要求、容量 %zu バイト）\n",
+                    new_size, arena->size);
+            return NULL;
+        }
+        arena->used = arena->last + new_size;
+        return ptr;
+    }
+    // 途中のブロックは縮める場合だけその場に残す（後ろのブロックを動かせないため）
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    void *p = arena_alloc(ctx, new_size); // 新しく切り出したブロック
+    if (p) {
+        memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return p;
+}
+
+/**
+ * @brief 最後に確保したブロックなら使用済み位置を巻き戻す（それ以外は何もしない）
+ *
+ * @param ctx  ftcs_arena_t へのポインタ
+ * @param ptr  解放するブロック
+ * @param size ブロックのバイト数（未使用）
+ */
+static void arena_free(void *ctx, void *ptr, size_t size)
+{
+    (void)size;
+    ftcs_arena_t *arena = ctx; // 解放対象のアリーナ
+    if ((char *)ptr == arena->base + arena->last) {
+        arena->used = arena->last;
+    }
+}
+
+// --- huge page ---
+
+/**
+ * @brief huge page 単位に切り上げた匿名 mmap を確保し、THP の対象にする
+ *
+ * @param ctx  未使用
+ * @param size 確保するバイト数
+ * @return 確保した領域、失敗時 NULL
+ */
+static void *hugepage_alloc(void *ctx, size_t size)
+{
+    (void)ctx;
+    size_t len = round_up(size, HUGEPAGE_SIZE); // 実際にマップするバイト数
+    void  *p   = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); // 確保した領域
+    if (p == MAP_FAILED) {
+        perror("ftcs: mmap");
+        return NULL;
+    }
+    // THP が無効（never）な環境では失敗するが、通常ページのまま使えるので無視する
+    madvise(p, len, MADV_HUGEPAGE);
+    return p;
+}
+
+/**
+ * @brief mremap で領域を拡張する（ページテーブルの付け替えのみでデータはコピーしない）
+ *
+ * MADV_HUGEPAGE は VMA の属性なので移動後も引き継がれる。
+ *
+ * @param ctx      未使用
+ * @param ptr      拡張対象の領域
+ * @param old_size 現在のバイト数
+ * @param new_size 新しいバイト数
+ * @return 拡張後の領域、失敗時 NULL（ptr は有効なまま）
+ */
+static void *hugepage_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    (void)ctx;
+    size_t old_len = round_up(old_size, HUGEPAGE_SIZE); // 現在マップしているバイト数
+    size_t new_len = round_up(new_size, HUGEPAGE_SIZE); // 拡張後にマップするバイト数
+    // 切り上げ後のサイズが変わらなければ既存のマップで足りる
+    if (new_len == old_len) {
+        return ptr;
+    }
+    void *p = mremap(ptr, old_len, new_len, MREMAP_MAYMOVE); // 拡張後の領域
+    if (p == MAP_FAILED) {
+        perror("ftcs: mremap");
+        return NULL;
+    }
+    return p;
+}
+
+/**
+ * @brief hugepage_alloc で確保した領域を munmap する
+ *
+ * @param ctx  未使用
+ * @param ptr  解放する領域
+ * @param size 確保時（または直前の拡張時）のバイト数
+ */
+static void hugepage_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx;
+    munmap(ptr, round_up(size, HUGEPAGE_SIZE));
+}
+
+/**
+ * @brief n を unit の倍数に切り上げる
+ *
+ * @param n    切り上げる値
+ * @param unit 単位（0 より大きいこと）
+ * @return 切り上げた値
+ */
+static size_t round_up(size_t n, size_t unit)
+{
+    return (n + unit - 1) / unit * unit;
+}
+
+/**
+ * @brief レコード1件が全バイト 0（未書き込みの空きスロット）かを返す
+ *
+ * @param rec  レコードの先頭
+ * @param size レコードのバイトサイズ（1 以上）
+ * @return 全バイト 0 なら非ゼロ
+ */
+static int slot_empty(const char *rec, size_t size)
+{
+    // 先頭が 0 で、各バイトが1つ前のバイトと等しければ全バイト 0
+    return rec[0] == 0 && memcmp(rec, rec + 1, size - 1) == 0;
+}
+
+/**
+ * @brief [p, p + len) を含むページのうち物理メモリに載っているバイト数を返す
+ *
+ * @param p   領域の先頭
+ * @param len 領域のバイト数
+ * @return 常駐しているページのバイト数、調べられなければ 0
+ */
+static size_t resident_bytes(const void *p, size_t len)
+{
+    if (!p || len == 0) {
+        return 0;
+    }
+    size_t         page  = (size_t)sysconf(_SC_PAGESIZE);             // ページサイズ
+    uintptr_t      start = (uintptr_t)p / page * page;                // 先頭を含むページの開始位置
+    size_t         pages = ((uintptr_t)p + len - start + page - 1) / page; // 対象のページ数
+    unsigned char *vec   = malloc(pages);                             // ページごとの常駐状態
+    if (!vec) {
+        return 0;
+    }
+    size_t resident = 0; // 常駐しているページ数
+    if (mincore((void *)start, pages * page, vec) == 0) {
+        for (size_t i = 0; i < pages; i++) {
+            resident += vec[i] & 1;
+        }
+    }
+    free(vec);
+    return resident * page;
+}
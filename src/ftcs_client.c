@@ -0,0 +1,186 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "ftcs_internal.h"
+
+// 読み捨てに使う一時バッファのサイズ（out に収まらないレコードの残りを捨てる）
+#define DISCARD_CHUNK 4096
+
+// --- 内部型定義 ---
+
+struct ftcs_client {
+    int fd; /**< サーバーへの接続ソケット（ブロッキング） */
+};
+
+// --- 関数宣言（目次） ---
+
+static int write_full(int fd, const void *buf, size_t len); // len バイトをすべて送る
+static int read_full(int fd, void *buf, size_t len);        // len バイトをすべて受け取る
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+ftcs_client_t *ftcs_client_connect(const char *socket_path)
+{
+    if (!socket_path) {
+        fprintf(stderr, "ftcs: ftcs_client_connect に NULL 引数が渡された\n");
+        return NULL;
+    }
+    struct sockaddr_un addr = { .sun_family = AF_UNIX }; // 接続先のアドレス
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "ftcs: ソケットパスが長すぎる: '%s'\n", socket_path);
+        return NULL;
+    }
+    memcpy(addr.sun_path, socket_path, strlen(socket_path) + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0); // 接続ソケット
+    if (fd < 0) {
+        perror("ftcs: socket");
+        return NULL;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "ftcs: '%s' に接続できない: %s\n", socket_path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    ftcs_client_t *client = malloc(sizeof(*client)); // 作成するクライアント
+    if (!client) {
+        perror("ftcs: malloc");
+        close(fd);
+        return NULL;
+    }
+    client->fd = fd;
+    return client;
+}
+
+int ftcs_client_lookup(ftcs_client_t *client, const char *key, void *out, size_t out_size)
+{
+    if (ftcs_client_send(client, key) != 0) {
+        return -1;
+    }
+    return ftcs_client_recv(client, out, out_size);
+}
+
+int ftcs_client_send(ftcs_client_t *client, const char *key)
+{
+    if (!client || !key) {
+        return -1;
+    }
+    size_t len = strlen(key); // キーのバイト数
+    if (len > UINT32_MAX) {
+        return -1;
+    }
+    ftcs_lookup_req_t req = { (uint32_t)len }; // 要求ヘッダ
+    // 通常の長さのキーはヘッダと連結して1回の送信にする
+    char buf[sizeof(req) + FTCS_LOOKUP_MAX_KEY]; // 送信する要求
+    if (len <= FTCS_LOOKUP_MAX_KEY) {
+        memcpy(buf, &req, sizeof(req));
+        memcpy(buf + sizeof(req), key, len);
+        return write_full(client->fd, buf, sizeof(req) + len);
+    }
+    // 上限を超えるキーもそのまま送り、判定はサーバーに任せる（BAD_REQUEST が返る）
+    if (write_full(client->fd, &req, sizeof(req)) != 0) {
+        return -1;
+    }
+    return write_full(client->fd, key, len);
+}
+
+int ftcs_client_recv(ftcs_client_t *client, void *out, size_t out_size)
+{
+    if (!client) {
+        return -1;
+    }
+    ftcs_lookup_resp_t resp; // 応答ヘッダ
+    if (read_full(client->fd, &resp, sizeof(resp)) != 0) {
+        return -1;
+    }
+    size_t copy = 0; // out に書くバイト数
+    if (out) {
+        copy = resp.len < out_size ? resp.len : out_size;
+    }
+    if (copy > 0 && read_full(client->fd, out, copy) != 0) {
+        return -1;
+    }
+    // out に収まらなかった残りを読み捨て、次の応答の境界にそろえる
+    char   discard[DISCARD_CHUNK]; // 読み捨て用
+    size_t rest = resp.len - copy; // 読み捨てるバイト数
+    while (rest > 0) {
+        size_t n = rest < sizeof(discard) ? rest : sizeof(discard); // 今回読むバイト数
+        if (read_full(client->fd, discard, n) != 0) {
+            return -1;
+        }
+        rest -= n;
+    }
+    return (int)resp.status;
+}
+
+void ftcs_client_close(ftcs_client_t *client)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!client) {
+        return;
+    }
+    close(client->fd);
+    free(client);
+}
+
+/**
+ * @brief len バイトをすべて送る（部分送信とシグナル割り込みを再試行する）
+ *
+ * @param fd  送信先ソケット
+ * @param buf 送信データ
+ * @param len 送信バイト数
+ * @return 成功時 0、接続エラー時 -1
+ */
+static int write_full(int fd, const void *buf, size_t len)
+{
+    const char *p = buf; // 未送信部分の先頭
+    while (len > 0) {
+        // サーバーが切断していても SIGPIPE で呼び出し元を落とさない
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL); // 送信バイト数
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief len バイトをすべて受け取る（部分受信とシグナル割り込みを再試行する）
+ *
+ * @param fd  受信元ソケット
+ * @param buf 受信先
+ * @param len 受信バイト数
+ * @return 成功時 0、接続エラーまたは途中で切断された場合 -1
+ */
+static int read_full(int fd, void *buf, size_t len)
+{
+    char *p = buf; // 未受信部分の先頭
+    while (len > 0) {
+        ssize_t n = read(fd, p, len); // 受信バイト数
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
@@ -1,33 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
 #include "ftcs.h"
+#include "ftcs_internal.h"
+
+// 1秒あたりのナノ秒数（時間の単位換算用）
+#define NS_PER_SEC 1000000000.0
+
+// 1ミリ秒あたりのナノ秒数（時間の単位換算用）
+#define NS_PER_MS 1000000.0
+
+// getopt_long の短縮名を持たない長いオプションの識別値（文字と衝突しない範囲）
+#define OPT_STATS     256
+#define OPT_KEYS_FROM 257
+#define OPT_SERVE     258
+#define OPT_FILTER    259
+#define OPT_FOLLOW    260
+#define OPT_SNAPSHOT  261
+
+// --follow で追記を確認する間隔（ミリ秒）。追記の確認は fstat 1回で済むため、
+// 人が見て遅れを感じない程度まで短くしても負荷は無視できる。
+#define FOLLOW_INTERVAL_MS 200
+
+// --follow で共有メモリの容量を超えたときの作り直し倍率。作り直しのたびに読み出し側が
+// 開き直すため、追記が続いても作り直しの回数が件数の対数で済むよう倍にする。
+#define SHM_GROW_FACTOR 2
+
+// 検索キー配列の初期容量
+#define KEYS_INITIAL_CAPACITY 16
+
+// シグナル受信時に停止させる検索サーバー（--serve 実行中のみ非 NULL）
+static ftcs_server_t *serving_server = NULL;
+
+// --follow 実行中に SIGINT/SIGTERM を受けたら非ゼロにする
+static volatile sig_atomic_t follow_stopped = 0;
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 検索キーの並び（-k の繰り返しと --keys-from の内容を指定順に保持する）
+ */
+typedef struct {
+    char  **keys;  /**< 検索キー文字列（各要素は strdup で確保） */
+    size_t  count; /**< キー数 */
+    size_t  cap;   /**< keys の確保済み要素数 */
+} key_list_t;
+
+/**
+ * @brief 検索・ダンプの所要時間（--stats 表示用）
+ */
+typedef struct {
+    double find_ns;    /**< 検索（索引構築を含む）に要した時間の合計 */
+    size_t find_count; /**< 検索回数 */
+    double dump_ns;    /**< ダンプに要した時間の合計 */
+    size_t dump_count; /**< ダンプしたレコード数 */
+} query_timing_t;
 
 // --- 関数宣言（目次） ---
 
 static void print_usage(const ftcs_config_t *config); // 使用方法を stderr に表示する
+static int  run_queries(const ftcs_config_t *config, const ftcs_record_set_t *rs,
+                        const key_list_t *keys, query_timing_t *qt); // 全キーを検索して入力順にダンプする
+static int  key_list_push(key_list_t *list, const char *key);        // キーを末尾に追加する
+static int  key_list_read(key_list_t *list, const char *path);       // ファイルの各行をキーとして追加する
+static void key_list_free(key_list_t *list);                         // キー配列を解放する
+static void print_stats(const ftcs_config_t *config, const ftcs_parse_stats_t *st,
+                        const query_timing_t *qt);                   // パース統計を stderr に表示する
+static int  serve(const ftcs_config_t *config, const ftcs_parser_config_t *pcfg,
+                  const ftcs_record_set_t *rs, const char *socket_path); // 検索サーバーを停止まで動かす
+static void on_stop_signal(int sig);                                 // SIGINT/SIGTERM でサーバーを止める
+static int  follow(const ftcs_config_t *config, const ftcs_parser_config_t *pcfg,
+                   const char *filepath, int do_dump, int do_stats); // 追記を待ち続けて取り込む
+static void on_follow_signal(int sig);                               // SIGINT/SIGTERM で --follow を止める
+static int  publish_shm(const ftcs_config_t *config, ftcs_shm_t *seg,
+                        const ftcs_record_set_t *rs);                // レコードを共有メモリに写す
+static void dump_range(const ftcs_config_t *config, const ftcs_record_set_t *rs,
+                       size_t first, query_timing_t *qt);            // first 番目以降をダンプする
 
 // --- 関数定義（概要→詳細の順） ---
 
 int ftcs_main(int argc, char *argv[], const ftcs_config_t *config)
 {
     const char *filepath  = NULL; // 入力ファイルパス（-f で指定）
-    const char *key_value = NULL; // 検索キー値（-k で指定）
+    const char *keys_from = NULL; // 検索キーを1行1件で読むファイル（--keys-from で指定）
+    key_list_t  keys      = { 0 }; // 検索キー（-k の繰り返しと --keys-from の内容）
     int         do_dump   = 0;    // ダンプ出力フラグ（-d で有効化）
+    long        threads   = 0;    // ストリーム入力のパーサースレッド数（-j で指定、0 = 設定値のまま）
+    int         do_stats  = 0;    // 統計表示フラグ（--stats で有効化）
+    const char *serve_path = NULL; // 検索サーバーのソケットパス（--serve で指定）
+    const char *filter    = NULL; // 格納するレコードの絞り込み式（--filter で指定）
+    int         do_follow = 0;    // 追記を待ち続けるフラグ（--follow で有効化）
+    const char *snapshot  = NULL; // レコード配列を置くスナップショットのパス（--snapshot で指定）
 
     // getopt_long 用オプション定義テーブル
     static struct option long_opts[] = {
         { "file",    required_argument, NULL, 'f' },
         { "dump",    no_argument,       NULL, 'd' },
         { "key",     required_argument, NULL, 'k' },
+        { "keys-from", required_argument, NULL, OPT_KEYS_FROM },
+        { "threads", required_argument, NULL, 'j' },
+        { "stats",   no_argument,       NULL, OPT_STATS },
+        { "serve",   required_argument, NULL, OPT_SERVE },
+        { "filter",  required_argument, NULL, OPT_FILTER },
+        { "follow",  no_argument,       NULL, OPT_FOLLOW },
+        { "snapshot", required_argument, NULL, OPT_SNAPSHOT },
         { "help",    no_argument,       NULL, 'h' },
         { NULL, 0, NULL, 0 }
     };
 
     // --- CLIオプションを解析する ---
     int opt; // getopt_long の戻り値（オプション文字または -1）
-    while ((opt = getopt_long(argc, argv, "f:dk:h", long_opts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "f:dk:j:h", long_opts, NULL)) != -1) {
         // オプション文字に応じて対応する変数を設定する
         switch (opt) {
         case 'f':
@@ -37,13 +125,48 @@ int ftcs_main(int argc, char *argv[], const ftcs_config_t *config)
             do_dump = 1;
             break;
         case 'k':
-            key_value = optarg;
+            if (key_list_push(&keys, optarg) != 0) {
+                key_list_free(&keys);
+                return 1;
+            }
+            break;
+        case OPT_KEYS_FROM:
+            keys_from = optarg;
+            break;
+        case 'j': {
+            char *endptr; // 変換終端ポインタ（変換成否の確認に使用）
+            threads = strtol(optarg, &endptr, 10);
+            // スレッド数は正の整数でなければならない
+            if (*endptr != '\0' || threads < 1) {
+                fprintf(stderr, "%s: --threads には正の整数を指定する: '%s'\n",
+                        config->program_name, optarg);
+                key_list_free(&keys);
+                return 1;
+            }
+            break;
+        }
+        case OPT_STATS:
+            do_stats = 1;
+            break;
+        case OPT_SERVE:
+            serve_path = optarg;
+            break;
+        case OPT_FILTER:
+            filter = optarg;
+            break;
+        case OPT_FOLLOW:
+            do_follow = 1;
+            break;
+        case OPT_SNAPSHOT:
+            snapshot = optarg;
             break;
         case 'h':
             print_usage(config);
+            key_list_free(&keys);
             return 0;
         default:
             print_usage(config);
+            key_list_free(&keys);
             return 1;
         }
     }
@@ -52,29 +175,90 @@ int ftcs_main(int argc, char *argv[], const ftcs_config_t *config)
     if (!filepath) {
         fprintf(stderr, "%s: --file は必須オプション\n", config->program_name);
         print_usage(config);
+        key_list_free(&keys);
+        return 1;
+    }
+    // 標準入力はデータとキーの一方にしか使えない
+    if (keys_from && strcmp(keys_from, "-") == 0 && strcmp(filepath, "-") == 0) {
+        fprintf(stderr, "%s: --file と --keys-from の両方に '-' は指定できない\n",
+                config->program_name);
+        key_list_free(&keys);
+        return 1;
+    }
+    // --follow は追記されるファイルを取り込み続けるモードで、検索やサーバーとは組み合わせない
+    if (do_follow && (strcmp(filepath, "-") == 0 || keys.count > 0 || keys_from || serve_path
+                      || snapshot)) {
+        fprintf(stderr, "%s: --follow は通常ファイルにのみ使え、-k / --keys-from / --serve / --snapshot とは併用できない\n",
+                config->program_name);
+        key_list_free(&keys);
+        return 1;
+    }
+    // 公開先の共有メモリは呼び出し元が用意するか、ftcs_main に作らせるかのどちらか
+    if (config->shm_name && config->shm_addr) {
+        fprintf(stderr, "%s: shm_name と shm_addr は併用できない\n", config->program_name);
+        key_list_free(&keys);
+        return 1;
+    }
+    // キーはパース前に読み切り、ファイル不在などをパースより先に検出する
+    if (keys_from && key_list_read(&keys, keys_from) != 0) {
+        key_list_free(&keys);
         return 1;
     }
 
+    // CLI オプションで上書きするため、利用者の設定はコピーして使う
+    ftcs_parser_config_t pcfg = *config->parser_config; // 実際に使うパーサー設定
+    if (threads > 0) {
+        pcfg.stream_threads = (unsigned)threads;
+    }
+    if (filter) {
+        pcfg.filter = filter;
+    }
+    if (do_follow) {
+        return follow(config, &pcfg, filepath, do_dump, do_stats);
+    }
+    ftcs_parse_stats_t stats = { 0 }; // --stats 指定時のパース統計
+    if (do_stats) {
+        pcfg.stats = &stats;
+    }
+    // --snapshot 指定時はレコード配列をヒープではなく出力ファイルのマップに置く
+    ftcs_mapfile_t   mf;       // スナップショットの出力ファイル
+    ftcs_allocator_t mf_alloc; // 出力ファイルに置くアロケーター
+    if (snapshot) {
+        if (ftcs_mapfile_create(&mf, snapshot) != 0) {
+            key_list_free(&keys);
+            return 1;
+        }
+        mf_alloc       = ftcs_mapfile_allocator(&mf);
+        pcfg.allocator = &mf_alloc;
+    }
+
     // --- ファイルをパースしてレコード集合を構築する ---
-    ftcs_record_set_t *rs = ftcs_parse_file(filepath, config->parser_config,
-                                            config->mapping, config->struct_size);
+    // "-" は標準入力（パイプ）を表し、シークできないためストリームパイプラインで読む
+    ftcs_record_set_t *rs = (strcmp(filepath, "-") == 0)
+        ? ftcs_parse_fd(STDIN_FILENO, &pcfg, config->mapping, config->struct_size)
+        : ftcs_parse_file(filepath, &pcfg, config->mapping, config->struct_size);
     // パース失敗は致命的エラーのため早期リターンする
     if (!rs) {
         fprintf(stderr, "%s: '%s' のパースに失敗した\n",
                 config->program_name, filepath);
+        if (snapshot) {
+            ftcs_mapfile_close(&mf);
+        }
+        key_list_free(&keys);
         return 1;
     }
 
     // --- パース結果を共有メモリに書き込む ---
-    if (config->shm_addr != NULL && config->shm_size > 0) {
-        size_t bytes = rs->count * rs->struct_size; // 書き込みバイト数
-        if (bytes > config->shm_size) {
-            bytes = config->shm_size; // shm 領域を超えないよう切り詰める
-        }
-        memcpy(config->shm_addr, rs->records, bytes);
-    }
+    ftcs_shm_t     seg = { 0 }; // shm_name 指定時に作るセグメント
+    int            ret = publish_shm(config, &seg, rs) == 0 ? 0 : 1; // 戻り値（エラー発生時に非ゼロを設定する）
+    query_timing_t qt  = { 0 }; // 検索・ダンプの所要時間
 
-    int ret = 0; // 戻り値（エラー発生時に非ゼロを設定する）
+    // --- スナップショットを確定する ---
+    if (snapshot && ftcs_mapfile_commit(&mf, rs) != 0) {
+        fprintf(stderr, "%s: スナップショット '%s' を確定できない\n",
+                config->program_name, snapshot);
+        ret = 1;
+    }
 
     // --- --dump が指定された場合にレコードを出力する ---
     if (do_dump) {
@@ -83,52 +267,33 @@ int ftcs_main(int argc, char *argv[], const ftcs_config_t *config)
             fprintf(stderr, "%s: dump 関数が登録されていない\n",
                     config->program_name);
             ret = 1;
-            goto cleanup;
-        }
-
-        // -k が指定された場合は単一レコードを検索してダンプする
-        if (key_value) {
-            const void *rec = NULL; // 検索で見つかったレコードへのポインタ
-            // キーモードに応じて検索関数を切り替える
-            if (config->parser_config->primary_key_mode == FTCS_KEY_INDEX) {
-                rec = ftcs_find_by_index(rs, key_value, config->struct_size);
-                if (!rec) {
-                    // エラーメッセージは ftcs_find_by_index 側で出力済み
-                    ret = 1;
-                    goto cleanup;
-                }
-            } else {
-                // フィールド名で検索するため primary_key の設定が必要
-                const char *pk = config->parser_config->primary_key; // プライマリキーのフィールド名
-                if (!pk) {
-                    fprintf(stderr, "%s: primary_key が設定されていない\n",
-                            config->program_name);
-                    ret = 1;
-                    goto cleanup;
-                }
-                rec = ftcs_find_by_key(rs, config->mapping,
-                                       pk, key_value,
-                                       config->struct_size);
-                // 指定キーのレコードが存在しない場合はエラーを報告する
-                if (!rec) {
-                    fprintf(stderr, "%s: %s=%s のレコードが見つからない\n",
-                            config->program_name, pk, key_value);
-                    ret = 1;
-                    goto cleanup;
-                }
-            }
-            config->dump_fn(rec);
+        } else if (keys.count > 0) {
+            // -k / --keys-from が指定された場合は各キーのレコードを指定順にダンプする
+            ret = run_queries(config, rs, &keys, &qt);
         } else {
-            // -k 未指定の場合は全レコードを順にダンプする
-            for (size_t i = 0; i < rs->count; i++) {
-                const void *rec = (const char *)rs->records + i * config->struct_size; // i 番目のレコード
-                config->dump_fn(rec);
-            }
+            // キー未指定の場合は全レコードを順にダンプする
+            dump_range(config, rs, 0, &qt);
         }
     }
 
-cleanup:
+    // 出力と混ざらないよう、ダンプ済みの標準出力を先に吐き出してから統計を表示する
+    if (do_stats) {
+        fflush(stdout);
+        print_stats(config, &stats, &qt);
+    }
+
+    // --- --serve が指定された場合は常駐して検索要求に応答する ---
+    if (serve_path && ret == 0) {
+        // 常駐中は集合が変わらないので、倍々の拡張で余った容量を先に返しておく（失敗しても公開はできる）
+        ftcs_record_set_compact(rs, 0);
+        ret = serve(config, &pcfg, rs, serve_path);
+    }
+    key_list_free(&keys);
     ftcs_record_set_free(rs);
+    ftcs_shm_close(&seg);
+    if (snapshot) {
+        ftcs_mapfile_close(&mf);
+    }
     return ret;
 }
 
@@ -140,9 +305,426 @@ static void print_usage(const ftcs_config_t *config)
 {
     fprintf(stderr,
         "Usage: %s [options]\n"
-        "  -f, --file <path>       Input file path (required)\n"
+        "  -f, --file <path>       Input file path (required, '-' for stdin)\n"
         "  -d, --dump              Dump struct contents\n"
-        "  -k, --key <value>       Search by primary key value\n"
+        "  -k, --key <value>       Search by primary key value (repeatable)\n"
+        "      --keys-from <path>  Read search keys, one per line ('-' for stdin)\n"
+        "  -j, --threads <n>       Parser threads for stdin input\n"
+        "      --stats             Print parse statistics to stderr\n"
+        "      --filter <expr>     Keep only records matching e.g. 'TEMP>30 && LOCATION=Lab'\n"
+        "      --serve <socket>    Serve lookups on a Unix domain socket until SIGINT/SIGTERM\n"
+        "      --follow            Keep parsing lines appended to the file until SIGINT/SIGTERM\n"
+        "      --snapshot <path>   Build the record array in a memory-mapped snapshot file\n"
         "  -h, --help              Show this help\n",
         config->program_name);
 }
+
+/**
+ * @brief すべてのキーを検索し、見つかったレコードをキーの指定順にダンプする
+ *
+ * 検索をすべて終えてから出力をまとめて行う。FTCS_KEY_FIELD で複数キーの場合は
+ * ftcs_find_many() でまとめて引く（レコード集合の走査は1回で済む）。
+ * 見つからないキーは stderr に報告して残りの処理を続ける。
+ *
+ * @param config フレームワーク設定
+ * @param rs     検索対象のレコード集合
+ * @param keys   検索キー（1件以上）
+ * @param qt     検索・ダンプの所要時間の加算先
+ * @return すべて見つかれば 0、見つからないキーや設定不備があれば 1
+ */
+static int run_queries(const ftcs_config_t *config, const ftcs_record_set_t *rs,
+                       const key_list_t *keys, query_timing_t *qt)
+{
+    int         by_index = (config->parser_config->primary_key_mode == FTCS_KEY_INDEX); // 添字で検索するか
+    const char *pk       = config->parser_config->primary_key; // プライマリキーのフィールド名
+    // フィールド名で検索するため primary_key の設定が必要
+    if (!by_index && !pk) {
+        fprintf(stderr, "%s: primary_key が設定されていない\n", config->program_name);
+        return 1;
+    }
+
+    const void **found = malloc(keys->count * sizeof(*found)); // 各キーの検索結果（NULL = 見つからない）
+    if (!found) {
+        perror("malloc");
+        return 1;
+    }
+
+    int      ret = 0;             // 戻り値
+    uint64_t t0  = ftcs_now_ns(); // 検索開始時刻
+    // 単一キーなら一括検索の作業領域を用意するより線形探索の方が安い
+    if (!by_index && keys->count > 1) {
+        ftcs_find_many(rs, config->mapping, pk, (const char *const *)keys->keys, keys->count, found);
+    }
+    for (size_t i = 0; i < keys->count; i++) {
+        const char *key = keys->keys[i]; // i 番目の検索キー
+        if (by_index) {
+            // エラーメッセージは ftcs_find_by_index 側で出力する
+            found[i] = ftcs_find_by_index(rs, key, config->struct_size);
+        } else {
+            if (keys->count == 1) {
+                found[i] = ftcs_find_by_key(rs, config->mapping, pk, key, config->struct_size);
+            }
+            // 指定キーのレコードが存在しない場合はエラーを報告する
+            if (!found[i]) {
+                fprintf(stderr, "%s: %s=%s のレコードが見つからない\n",
+                        config->program_name, pk, key);
+            }
+        }
+        if (!found[i]) {
+            ret = 1;
+        }
+    }
+    qt->find_ns    += (double)(ftcs_now_ns() - t0);
+    qt->find_count += keys->count;
+
+    uint64_t t1 = ftcs_now_ns(); // ダンプ開始時刻
+    for (size_t i = 0; i < keys->count; i++) {
+        if (found[i]) {
+            config->dump_fn(found[i]);
+            qt->dump_count++;
+        }
+    }
+    qt->dump_ns += (double)(ftcs_now_ns() - t1);
+
+    free(found);
+    return ret;
+}
+
+/**
+ * @brief キーを複製して末尾に追加する
+ *
+ * @param list 追加先
+ * @param key  追加するキー
+ * @return 成功時 0、確保失敗時 -1
+ */
+static int key_list_push(key_list_t *list, const char *key)
+{
+    if (list->count == list->cap) {
+        size_t new_cap = list->cap ? list->cap * 2 : KEYS_INITIAL_CAPACITY; // 拡張後の容量
+        char **new_keys = realloc(list->keys, new_cap * sizeof(*new_keys)); // 拡張後の配列
+        if (!new_keys) {
+            perror("realloc");
+            return -1;
+        }
+        list->keys = new_keys;
+        list->cap  = new_cap;
+    }
+    char *copy = strdup(key); // キーの複製
+    if (!copy) {
+        perror("strdup");
+        return -1;
+    }
+    list->keys[list->count++] = copy;
+    return 0;
+}
+
+/**
+ * @brief ファイル（"-" なら標準入力）の各行をキーとして末尾に追加する
+ *
+ * 行末の改行・CR は取り除き、空行は読み飛ばす。
+ *
+ * @param list 追加先
+ * @param path 読み込むファイルのパス
+ * @return 成功時 0、失敗時 -1
+ */
+static int key_list_read(key_list_t *list, const char *path)
+{
+    FILE *fp = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r"); // キーの読み込み元
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    int     ret  = 0;    // 戻り値
+    char   *line = NULL; // getline のバッファ
+    size_t  cap  = 0;    // line の確保済みバイト数
+    ssize_t len;         // 読み込んだ行の長さ
+    while ((len = getline(&line, &cap, fp)) != -1) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        if (key_list_push(list, line) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+    free(line);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return ret;
+}
+
+/**
+ * @brief キー配列と各キー文字列を解放する
+ *
+ * @param list 解放対象
+ */
+static void key_list_free(key_list_t *list)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->keys[i]);
+    }
+    free(list->keys);
+    memset(list, 0, sizeof(*list));
+}
+
+/**
+ * @brief パース統計とフェーズ別時間、検索・ダンプの1件あたり時間を stderr に表示する
+ * @param config フレームワーク設定（プログラム名の取得に使用）
+ * @param st     パース統計
+ * @param qt     検索・ダンプの所要時間（回数 0 の項目は表示しない）
+ */
+static void print_stats(const ftcs_config_t *config, const ftcs_parse_stats_t *st,
+                        const query_timing_t *qt)
+{
+    double total_s = (double)st->total_ns / NS_PER_SEC; // 全体の所要秒数（スループット算出用）
+    fprintf(stderr, "%s: parse stats\n", config->program_name);
+    fprintf(stderr, "  bytes        %zu\n", st->bytes);
+    fprintf(stderr, "  lines        %zu (comments %zu, empty %zu)\n",
+            st->lines, st->comments, st->empty_lines);
+    fprintf(stderr, "  records      %zu\n", st->records);
+    if (st->filtered > 0) {
+        fprintf(stderr, "  filtered     %zu\n", st->filtered);
+    }
+    fprintf(stderr, "  unknown keys %zu\n", st->unknown_keys);
+    // キー順の予測が当たった割合（規則正しいファイルならほぼ 100%）
+    if (st->key_hits + st->key_misses > 0) {
+        fprintf(stderr, "  key order    %.1f%% predicted (%zu hits, %zu lookups)\n",
+                100.0 * (double)st->key_hits / (double)(st->key_hits + st->key_misses),
+                st->key_hits, st->key_misses);
+    }
+    fprintf(stderr, "  reallocs     %zu\n", st->reallocs);
+    fprintf(stderr, "  peak bytes   %zu\n", st->peak_bytes);
+    fprintf(stderr, "  total        %.3f ms", (double)st->total_ns / NS_PER_MS);
+    // 所要時間がゼロに丸められた場合はスループットを表示しない
+    if (total_s > 0) {
+        fprintf(stderr, " (%.1f MB/s, %.0f records/s)",
+                (double)st->bytes / total_s / 1e6, (double)st->records / total_s);
+    }
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  io           %.3f ms\n", (double)st->io_ns / NS_PER_MS);
+    fprintf(stderr, "  tokenize     %.3f ms (estimated from %zu sampled lines)\n",
+            (double)st->tokenize_ns / NS_PER_MS, st->sampled_lines);
+    fprintf(stderr, "  lookup       %.3f ms (estimated)\n", (double)st->lookup_ns / NS_PER_MS);
+    fprintf(stderr, "  convert      %.3f ms (estimated)\n", (double)st->convert_ns / NS_PER_MS);
+    fprintf(stderr, "  alloc        %.3f ms\n", (double)st->alloc_ns / NS_PER_MS);
+    if (qt->find_count > 0) {
+        fprintf(stderr, "  find         %.0f ns/query (%zu queries)\n",
+                qt->find_ns / (double)qt->find_count, qt->find_count);
+    }
+    if (qt->dump_count > 0) {
+        fprintf(stderr, "  dump         %.0f ns/record\n", qt->dump_ns / (double)qt->dump_count);
+    }
+}
+
+/**
+ * @brief 検索サーバーを起動し、SIGINT / SIGTERM を受けるまで要求に応答する
+ *
+ * @param config      フレームワーク設定
+ * @param pcfg        実際に使ったパーサー設定（キーの検索方式を参照する）
+ * @param rs          公開するレコード集合
+ * @param socket_path ソケットファイルのパス
+ * @return 正常に停止すれば 0、起動失敗やイベントループのエラーで 1
+ */
+static int serve(const ftcs_config_t *config, const ftcs_parser_config_t *pcfg,
+                 const ftcs_record_set_t *rs, const char *socket_path)
+{
+    ftcs_server_t *srv = ftcs_server_create(socket_path, rs, config->mapping, pcfg); // 検索サーバー
+    if (!srv) {
+        fprintf(stderr, "%s: 検索サーバーを起動できない\n", config->program_name);
+        return 1;
+    }
+
+    struct sigaction sa = { 0 }; // 停止シグナルのハンドラ設定
+    struct sigaction old_int;    // 元の SIGINT ハンドラ
+    struct sigaction old_term;   // 元の SIGTERM ハンドラ
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    serving_server = srv;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+
+    fprintf(stderr, "%s: %zu 件のレコードを %s で公開中\n",
+            config->program_name, rs->count, socket_path);
+    int ret = (ftcs_server_run(srv) == 0) ? 0 : 1; // 戻り値
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    serving_server = NULL;
+    ftcs_server_destroy(srv);
+    return ret;
+}
+
+/**
+ * @brief 停止シグナルを受けたら検索サーバーのイベントループに停止を要求する
+ * @param sig 受信したシグナル番号（未使用）
+ */
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    // ftcs_server_stop は eventfd への write だけなのでシグナルハンドラから呼べる
+    ftcs_server_stop(serving_server);
+}
+
+/**
+ * @brief ファイルへの追記を一定間隔で取り込み続け、SIGINT / SIGTERM で終了する
+ *
+ * ftcs_parse_resume() で前回の続きから解析し、増えたレコードを共有メモリに写して
+ * （-d 指定時は）ダンプする。ローテーション・切り詰めは ftcs_parse_resume() が検出して
+ * 新しいファイルの先頭から読み直す。
+ *
+ * @param config   フレームワーク設定
+ * @param pcfg     実際に使うパーサー設定
+ * @param filepath 入力ファイルのパス
+ * @param do_dump  非ゼロなら追加されたレコードをダンプする
+ * @param do_stats 非ゼロなら終了時に全呼び出し分のパース統計を表示する
+ * @return シグナルで停止すれば 0、ファイルが開けない・解析エラーなら 1
+ */
+static int follow(const ftcs_config_t *config, const ftcs_parser_config_t *pcfg,
+                  const char *filepath, int do_dump, int do_stats)
+{
+    if (do_dump && !config->dump_fn) {
+        fprintf(stderr, "%s: dump 関数が登録されていない\n", config->program_name);
+        return 1;
+    }
+    ftcs_parser_config_t cfg   = *pcfg;  // 呼び出しごとの統計を受け取る設定
+    ftcs_parse_stats_t   call  = { 0 };  // 1回の呼び出し分のパース統計
+    ftcs_parse_stats_t   total = { 0 };  // 全呼び出し分のパース統計
+    if (do_stats) {
+        cfg.stats = &call;
+    }
+
+    struct sigaction sa = { 0 }; // 停止シグナルのハンドラ設定
+    struct sigaction old_int;    // 元の SIGINT ハンドラ
+    struct sigaction old_term;   // 元の SIGTERM ハンドラ
+    sa.sa_handler = on_follow_signal;
+    sigemptyset(&sa.sa_mask);
+    follow_stopped = 0;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+
+    int                ret      = 0;    // 戻り値
+    ftcs_checkpoint_t  cp       = { 0 }; // 解析位置の記録
+    ftcs_record_set_t *rs       = NULL; // 取り込んだレコード集合
+    size_t             restarts = 0;    // 報告済みの読み直し回数
+    query_timing_t     qt       = { 0 }; // ダンプの所要時間
+    ftcs_shm_t         seg      = { 0 }; // shm_name 指定時に最初の公開で作るセグメント
+    while (!follow_stopped) {
+        size_t first = rs ? rs->count : 0; // 今回増える前のレコード数
+        if (ftcs_parse_resume(&cp, filepath, &cfg, config->mapping, config->struct_size, &rs) < 0) {
+            fprintf(stderr, "%s: '%s' のパースに失敗した\n", config->program_name, filepath);
+            ret = 1;
+            break;
+        }
+        if (do_stats) {
+            ftcs_stats_add(&total, &call);
+            total.total_ns += call.total_ns;
+            memset(&call, 0, sizeof(call));
+        }
+        if (cp.restarts != restarts) {
+            fprintf(stderr, "%s: '%s' が切り詰め・置き換えられたため先頭から読み直す\n",
+                    config->program_name, filepath);
+            restarts = cp.restarts;
+        }
+        if (rs->count > first) {
+            if (publish_shm(config, &seg, rs) != 0) {
+                ret = 1;
+                break;
+            }
+            if (do_dump) {
+                dump_range(config, rs, first, &qt);
+                fflush(stdout);
+            }
+        }
+        struct timespec interval = { 0, FOLLOW_INTERVAL_MS * 1000000L }; // 次の確認までの待ち時間
+        nanosleep(&interval, NULL);
+    }
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    if (do_stats) {
+        fflush(stdout);
+        print_stats(config, &total, &qt);
+    }
+    ftcs_record_set_free(rs);
+    ftcs_shm_close(&seg);
+    return ret;
+}
+
+/**
+ * @brief 停止シグナルを受けたら --follow のループに停止を要求する
+ * @param sig 受信したシグナル番号（未使用）
+ */
+static void on_follow_signal(int sig)
+{
+    (void)sig;
+    follow_stopped = 1;
+}
+
+/**
+ * @brief レコード配列を共有メモリに写し、更新を通知する
+ *
+ * shm_name 指定時は最初の呼び出しでそのときのレコード数に合わせたセグメントを作る。--follow で
+ * 容量を超えたら SHM_GROW_FACTOR 倍の容量で作り直し（ftcs_shm_grow）、読み出し側には
+ * ftcs_shm_replaced() で開き直しを促す。shm_addr 指定時は呼び出し元の領域へ写し、超えた分は切り詰める。
+ * ftcs_shm_allocator() でレコード配列を shm 上に直接確保した場合はコピー不要だが、
+ * 件数が変わったことは shm_notify を通じて読み出し側へ知らせる。
+ *
+ * @param config フレームワーク設定（shm_name も shm_addr も NULL なら写さない）
+ * @param seg    shm_name のセグメント（未作成ならゼロ初期化したもの）
+ * @param rs     写すレコード集合
+ * @return 成功時 0、セグメントを作れない・広げられなければ -1
+ */
+static int publish_shm(const ftcs_config_t *config, ftcs_shm_t *seg, const ftcs_record_set_t *rs)
+{
+    if (config->shm_name && !seg->base
+        && ftcs_shm_create(seg, config->shm_name, rs->struct_size, rs->count, config->shm_flags) != 0) {
+        fprintf(stderr, "%s: 共有メモリ '%s' を作れない\n", config->program_name, config->shm_name);
+        return -1;
+    }
+    if (seg->base && rs->count > seg->capacity
+        && ftcs_shm_grow(seg, rs->count * SHM_GROW_FACTOR) != 0) {
+        fprintf(stderr, "%s: 共有メモリ '%s' を %zu 件に広げられない\n",
+                config->program_name, config->shm_name, rs->count * SHM_GROW_FACTOR);
+        return -1;
+    }
+    int                own    = seg->base != NULL;                                   // 作ったセグメントへ写すか
+    void              *addr   = own ? seg->records : config->shm_addr;               // 写し先
+    size_t             size   = own ? seg->capacity * rs->struct_size : config->shm_size; // 写し先のバイト数
+    ftcs_shm_notify_t *notify = own ? seg->notify : config->shm_notify;              // 更新通知
+    size_t             count  = rs->count;                                           // 読み出し側から見える件数
+    ftcs_shm_publish_begin(notify);
+    if (addr != NULL && size > 0 && rs->records != addr) {
+        size_t bytes = rs->count * rs->struct_size; // 書き込みバイト数
+        if (bytes > size) {
+            bytes = size; // shm 領域を超えないよう切り詰める
+            count = bytes / rs->struct_size;
+        }
+        memcpy(addr, rs->records, bytes);
+    }
+    ftcs_shm_publish_end(notify, count);
+    return 0;
+}
+
+/**
+ * @brief first 番目以降のレコードを順にダンプする
+ *
+ * @param config フレームワーク設定（dump_fn を使う）
+ * @param rs     ダンプするレコード集合
+ * @param first  最初にダンプするレコードの位置
+ * @param qt     ダンプの所要時間の加算先
+ */
+static void dump_range(const ftcs_config_t *config, const ftcs_record_set_t *rs,
+                       size_t first, query_timing_t *qt)
+{
+    uint64_t t1 = ftcs_now_ns(); // ダンプ開始時刻
+    for (size_t i = first; i < rs->count; i++) {
+        const void *rec = (const char *)rs->records + i * config->struct_size; // i 番目のレコード
+        config->dump_fn(rec);
+    }
+    qt->dump_ns    += (double)(ftcs_now_ns() - t1);
+    qt->dump_count += rs->count - first;
+}
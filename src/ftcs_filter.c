@@ -0,0 +1,382 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftcs_internal.h"
+
+// フィルタ式の項数の上限。判定済みの項を 64 ビットのマスクで管理するため。
+#define FILTER_MAX_TERMS 64
+
+// 項どうしを結ぶ論理積の演算子
+#define FILTER_AND "&&"
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 比較演算子
+ */
+typedef enum {
+    OP_EQ, /**< = または == */
+    OP_NE, /**< != */
+    OP_LT, /**< < */
+    OP_LE, /**< <= */
+    OP_GT, /**< > */
+    OP_GE, /**< >= */
+} filter_op_t;
+
+/**
+ * @brief フィルタ式の項1個分（FIELD OP VALUE）
+ *
+ * 比較値はフィールドと同じ型に変換しておき、レコードごとの文字列変換を避ける。
+ */
+typedef struct {
+    const ftcs_field_mapping_t *m;  /**< 比較対象フィールドのマッピングエントリ */
+    filter_op_t                 op; /**< 比較演算子 */
+    union {
+        long   l; /**< FTCS_TYPE_INT / LONG / SHORT */
+        float  f; /**< FTCS_TYPE_FLOAT */
+        double d; /**< FTCS_TYPE_DOUBLE */
+        char   c; /**< FTCS_TYPE_CHAR */
+        char  *s; /**< FTCS_TYPE_STRING（strdup で確保） */
+    } v; /**< フィールド型に変換済みの比較値 */
+} filter_term_t;
+
+struct ftcs_filter {
+    const ftcs_field_mapping_t *mapping;     /**< コンパイル対象のマッピングテーブル */
+    filter_term_t               terms[FILTER_MAX_TERMS]; /**< 論理積で結ぶ項 */
+    size_t                      nterms;      /**< 項数 */
+    uint64_t                    all;         /**< すべての項のビットマスク */
+    uint64_t                   *field_terms; /**< マッピングエントリごとに、そのフィールドを見る項のマスク */
+};
+
+// --- 関数宣言（目次） ---
+
+static int  compile_term(ftcs_filter_t *f, char *text);               // 項1個を解析して追加する
+static int  parse_value(filter_term_t *t, const char *val);           // 比較値をフィールド型に変換する
+static int  term_holds(const filter_term_t *t, const void *rec);      // レコードが項を満たすか
+static int  op_holds(filter_op_t op, int cmp);                        // 比較結果が演算子を満たすか
+static int  op_holds_double(filter_op_t op, double a, double b);      // 浮動小数点の比較が演算子を満たすか
+static char *trim_space(char *s);                                     // 前後の空白を除去する
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+ftcs_filter_t *ftcs_filter_compile(const char *expr, const ftcs_field_mapping_t *mapping)
+{
+    ftcs_filter_t *f = calloc(1, sizeof(*f)); // コンパイル結果
+    if (!f) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    size_t nfields = 0; // マッピングエントリ数
+    while (mapping[nfields].field_name) {
+        nfields++;
+    }
+    f->mapping     = mapping;
+    f->field_terms = calloc(nfields + 1, sizeof(*f->field_terms));
+    char *buf      = strdup(expr); // 項に切り分けるための作業用コピー
+    if (!f->field_terms || !buf) {
+        perror("ftcs: calloc");
+        free(buf);
+        ftcs_filter_free(f);
+        return NULL;
+    }
+
+    // "&&" で区切った各項を順にコンパイルする
+    char *p = buf; // 未処理部分の先頭
+    for (;;) {
+        char *and = strstr(p, FILTER_AND); // 次の区切り位置
+        if (and) {
+            *and = '\0';
+        }
+        if (compile_term(f, p) != 0) {
+            free(buf);
+            ftcs_filter_free(f);
+            return NULL;
+        }
+        if (!and) {
+            break;
+        }
+        p = and + strlen(FILTER_AND);
+    }
+    free(buf);
+    return f;
+}
+
+int ftcs_filter_field(const ftcs_filter_t *f, const ftcs_field_mapping_t *m,
+                      const void *rec, uint64_t *decided)
+{
+    uint64_t mask = f->field_terms[m - f->mapping]; // このフィールドを見る項
+    // フィルタに現れないフィールドは判定不要（大半のフィールドはここで抜ける）
+    if (!mask) {
+        return 0;
+    }
+    for (size_t i = 0; i < f->nterms; i++) {
+        if ((mask >> i) & 1) {
+            if (!term_holds(&f->terms[i], rec)) {
+                return 1;
+            }
+        }
+    }
+    *decided |= mask;
+    return 0;
+}
+
+int ftcs_filter_rest(const ftcs_filter_t *f, const void *rec, uint64_t decided)
+{
+    uint64_t rest = f->all & ~decided; // 行に現れなかったフィールドの項
+    // 欠けたフィールドはゼロ初期化された値のまま判定する
+    for (size_t i = 0; rest != 0 && i < f->nterms; i++) {
+        if (((rest >> i) & 1) && !term_holds(&f->terms[i], rec)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int ftcs_filter_uses(const ftcs_filter_t *f, const ftcs_field_mapping_t *m)
+{
+    return f->field_terms[m - f->mapping] != 0;
+}
+
+void ftcs_filter_free(ftcs_filter_t *f)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!f) {
+        return;
+    }
+    for (size_t i = 0; i < f->nterms; i++) {
+        if (f->terms[i].m->type == FTCS_TYPE_STRING) {
+            free(f->terms[i].v.s);
+        }
+    }
+    free(f->field_terms);
+    free(f);
+}
+
+/**
+ * @brief "FIELD OP VALUE" 形式の項1個を解析し、フィルタに追加する
+ *
+ * @param f    追加先のフィルタ
+ * @param text 項の文字列（インプレースで書き換える）
+ * @return 成功時 0、構文エラー・未知のフィールド・型の合わない値なら -1
+ */
+static int compile_term(ftcs_filter_t *f, char *text)
+{
+    if (f->nterms == FILTER_MAX_TERMS) {
+        fprintf(stderr, "ftcs: フィルタ式の項が多すぎる（最大 %d）\n", FILTER_MAX_TERMS);
+        return -1;
+    }
+    char *term = trim_space(text);      // 前後の空白を除いた項
+    char *opp  = strpbrk(term, "=!<>"); // 演算子の先頭
+    if (!opp || opp == term) {
+        fprintf(stderr, "ftcs: フィルタ式の項 '%s' は FIELD OP VALUE の形でなければならない\n",
+                term);
+        return -1;
+    }
+
+    filter_term_t *t = &f->terms[f->nterms]; // 追加する項
+    size_t oplen = (opp[1] == '=') ? 2 : 1;  // 演算子の長さ
+    switch (opp[0]) {
+    case '=':
+        t->op = OP_EQ;
+        break;
+    case '!':
+        // "!" 単独は演算子ではない
+        if (oplen != 2) {
+            fprintf(stderr, "ftcs: フィルタ式の項 '%s' の演算子が不正\n", term);
+            return -1;
+        }
+        t->op = OP_NE;
+        break;
+    case '<':
+        t->op = (oplen == 2) ? OP_LE : OP_LT;
+        break;
+    default:
+        t->op = (oplen == 2) ? OP_GE : OP_GT;
+        break;
+    }
+
+    char *val = trim_space(opp + oplen); // 比較値
+    *opp = '\0';
+    char *name = trim_space(term); // フィールド名
+    if (val[0] == '\0') {
+        fprintf(stderr, "ftcs: フィルタ式の項 '%s' に比較値がない\n", name);
+        return -1;
+    }
+    const ftcs_field_mapping_t *m = f->mapping; // 比較対象のマッピングエントリ
+    while (m->field_name && strcmp(m->field_name, name) != 0) {
+        m++;
+    }
+    if (!m->field_name) {
+        fprintf(stderr, "ftcs: フィルタ式のフィールド '%s' がマッピングに存在しない\n", name);
+        return -1;
+    }
+    t->m = m;
+    if (parse_value(t, val) != 0) {
+        return -1;
+    }
+    f->field_terms[m - f->mapping] |= (uint64_t)1 << f->nterms;
+    f->all                         |= (uint64_t)1 << f->nterms;
+    f->nterms++;
+    return 0;
+}
+
+/**
+ * @brief 比較値の文字列を set_field と同じ規則でフィールド型に変換する
+ *
+ * @param t   比較値を設定する項（t->m は設定済み）
+ * @param val 比較値の文字列
+ * @return 成功時 0、フィールド型として不正な値なら -1
+ */
+static int parse_value(filter_term_t *t, const char *val)
+{
+    char *endptr = NULL; // 変換終端ポインタ（変換成否の確認に使用）
+    switch (t->m->type) {
+    case FTCS_TYPE_INT:
+    case FTCS_TYPE_LONG:
+    case FTCS_TYPE_SHORT:
+        t->v.l = strtol(val, &endptr, 10);
+        break;
+    case FTCS_TYPE_FLOAT:
+        // レコード側と同じく float に丸めてから比較する（30.1 等の境界値をずらさないため）
+        t->v.f = strtof(val, &endptr);
+        break;
+    case FTCS_TYPE_DOUBLE:
+        t->v.d = strtod(val, &endptr);
+        break;
+    case FTCS_TYPE_CHAR:
+        t->v.c = val[0];
+        return 0;
+    case FTCS_TYPE_ARRAY:
+        fprintf(stderr, "ftcs: 配列フィールド '%s' はフィルタ式で比較できない\n", t->m->field_name);
+        return -1;
+    case FTCS_TYPE_STRING:
+        t->v.s = strdup(val);
+        if (!t->v.s) {
+            perror("ftcs: strdup");
+            return -1;
+        }
+        return 0;
+    }
+    if (!endptr || *endptr != '\0') {
+        fprintf(stderr, "ftcs: フィルタ式の値 '%s' はフィールド '%s' の型に変換できない\n",
+                val, t->m->field_name);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief レコードのフィールド値が項を満たすかを返す
+ *
+ * @param t   判定する項
+ * @param rec 値を変換済みのレコード
+ * @return 満たせば非ゼロ
+ */
+static int term_holds(const filter_term_t *t, const void *rec)
+{
+    const char *field = (const char *)rec + t->m->offset; // フィールドの位置
+    switch (t->m->type) {
+    case FTCS_TYPE_INT: {
+        long a = *(const int *)field; // フィールド値
+        return op_holds(t->op, (a > t->v.l) - (a < t->v.l));
+    }
+    case FTCS_TYPE_LONG: {
+        long a = *(const long *)field; // フィールド値
+        return op_holds(t->op, (a > t->v.l) - (a < t->v.l));
+    }
+    case FTCS_TYPE_SHORT: {
+        long a = *(const short *)field; // フィールド値
+        return op_holds(t->op, (a > t->v.l) - (a < t->v.l));
+    }
+    case FTCS_TYPE_FLOAT:
+        return op_holds_double(t->op, *(const float *)field, t->v.f);
+    case FTCS_TYPE_DOUBLE:
+        return op_holds_double(t->op, *(const double *)field, t->v.d);
+    case FTCS_TYPE_CHAR: {
+        char a = *(const char *)field; // フィールド値
+        return op_holds(t->op, (a > t->v.c) - (a < t->v.c));
+    }
+    case FTCS_TYPE_STRING:
+        return op_holds(t->op, strcmp(field, t->v.s));
+    case FTCS_TYPE_ARRAY:
+        break; // 配列の項はコンパイル時に拒否している
+    }
+    return 0;
+}
+
+/**
+ * @brief 三方比較の結果が演算子を満たすかを返す
+ *
+ * @param op  比較演算子
+ * @param cmp 負・0・正（左辺が小さい・等しい・大きい）
+ * @return 満たせば非ゼロ
+ */
+static int op_holds(filter_op_t op, int cmp)
+{
+    switch (op) {
+    case OP_EQ:
+        return cmp == 0;
+    case OP_NE:
+        return cmp != 0;
+    case OP_LT:
+        return cmp < 0;
+    case OP_LE:
+        return cmp <= 0;
+    case OP_GT:
+        return cmp > 0;
+    case OP_GE:
+        return cmp >= 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief 浮動小数点の比較が演算子を満たすかを返す
+ *
+ * 三方比較にすると NaN が「等しい」扱いになるため、演算子ごとに直接比較する。
+ *
+ * @param op 比較演算子
+ * @param a  左辺（フィールド値）
+ * @param b  右辺（比較値）
+ * @return 満たせば非ゼロ
+ */
+static int op_holds_double(filter_op_t op, double a, double b)
+{
+    switch (op) {
+    case OP_EQ:
+        return a == b;
+    case OP_NE:
+        return a != b;
+    case OP_LT:
+        return a < b;
+    case OP_LE:
+        return a <= b;
+    case OP_GT:
+        return a > b;
+    case OP_GE:
+        return a >= b;
+    }
+    return 0;
+}
+
+/**
+ * @brief 文字列の前後の空白・タブをインプレースで除去する
+ *
+ * @param s 対象の文字列
+ * @return 除去後の先頭ポインタ
+ */
+static char *trim_space(char *s)
+{
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    size_t len = strlen(s); // 末尾位置を決めるための長さ
+    while (len > 0 && (s[len - 1] == ' ' || s[len - 1] == '\t')) {
+        s[--len] = '\0';
+    }
+    return s;
+}
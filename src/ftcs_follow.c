@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ftcs_internal.h"
+
+// 追記分を読み込む1回の pread のバイト数。追記は通常数行なので1回で読み切れ、
+// 大きな追記（初回の全体読み込みなど）でもシステムコール回数が十分少なくなる。
+#define RESUME_BLOCK_SIZE (64 * 1024)
+
+// --- 関数宣言（目次） ---
+
+static int  file_replaced(int fd, const struct stat *st, const ftcs_checkpoint_t *cp); // 前回から置き換わったか調べる
+static long parse_appended(ftcs_parse_ctx_t *ctx, int fd, ftcs_checkpoint_t *next);   // offset 以降を解析する
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+long ftcs_parse_resume(ftcs_checkpoint_t *cp,
+                       const char *filepath,
+                       const ftcs_parser_config_t *config,
+                       const ftcs_field_mapping_t *mapping,
+                       size_t struct_size,
+                       ftcs_record_set_t **rs)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!cp || !filepath || !config || !mapping || !config->kv_separator || !rs) {
+        fprintf(stderr, "ftcs: ftcs_parse_resume に NULL 引数が渡された\n");
+        return -1;
+    }
+    if (*rs && (*rs)->struct_size != struct_size) {
+        fprintf(stderr, "ftcs: レコード集合の struct_size (%zu) が %zu と異なる\n",
+                (*rs)->struct_size, struct_size);
+        return -1;
+    }
+
+    int fd = open(filepath, O_RDONLY); // 入力ファイル
+    if (fd < 0) {
+        fprintf(stderr, "ftcs: '%s' を開けない: %s\n", filepath, strerror(errno));
+        return -1;
+    }
+    struct stat st; // 入力ファイルの現在の状態
+    if (fstat(fd, &st) != 0) {
+        perror("ftcs: fstat");
+        close(fd);
+        return -1;
+    }
+
+    // 失敗時に cp を変えないよう、更新後の記録は写しに作る
+    ftcs_checkpoint_t next = *cp; // 今回の解析後の記録
+    if (file_replaced(fd, &st, cp)) {
+        next.offset  = 0;
+        next.pending = 0;
+        next.restarts++;
+    }
+    next.dev = (uint64_t)st.st_dev;
+    next.ino = (uint64_t)st.st_ino;
+    // 改行待ちの行の後ろに何も追記されていなければ読む必要はない
+    if (*rs && (uint64_t)st.st_size == next.offset + next.pending) {
+        close(fd);
+        *cp = next;
+        return 0;
+    }
+
+    uint64_t t0 = config->stats ? ftcs_now_ns() : 0; // 計測開始時刻
+    // 既存の集合に追加する場合、初期化で作る空の集合は捨てるので利用者のアロケーターを使わない
+    // （ftcs_mapfile_allocator() のように1つの配列しか置けないアロケーターもある）
+    ftcs_parser_config_t cfg = *config; // 実際に使うパーサー設定
+    if (*rs) {
+        cfg.allocator = NULL;
+    }
+    ftcs_parse_ctx_t ctx; // パース状態（追加先のレコード集合を含む）
+    if (ftcs_ctx_init(&ctx, &cfg, mapping, struct_size) != 0) {
+        close(fd);
+        return -1;
+    }
+    // 既存のレコード集合に追加する場合は、初期化で作った空の集合と差し替える
+    if (*rs) {
+        ftcs_record_set_free(ctx.rs);
+        ctx.rs = *rs;
+        // 前回までのレコードはリングへ書き込み済み
+        ctx.ring_from = ctx.rs->count;
+    }
+    size_t old_count = ctx.rs->count; // 呼び出し前のレコード数（失敗時に戻す）
+    long   added     = parse_appended(&ctx, fd, &next); // 今回格納したレコード数
+    close(fd);
+    ftcs_ctx_report_stats(&ctx, t0);
+
+    ftcs_record_set_t *out = ftcs_ctx_take(&ctx); // 追加先のレコード集合
+    ftcs_ctx_destroy(&ctx);
+    if (added < 0) {
+        if (*rs) {
+            out->count = old_count;
+        } else {
+            ftcs_record_set_free(out);
+        }
+        return -1;
+    }
+    if (added > 0) {
+        out->sorted = 0;
+    }
+    next.records += (size_t)added;
+    *cp = next;
+    *rs = out;
+    return added;
+}
+
+/**
+ * @brief 前回解析したファイルが置き換え・切り詰めされていないか調べる
+ *
+ * inode（とデバイス）が変わっていればローテーション、サイズが解析済みの位置に
+ * 届かなければ切り詰めとみなす。サイズが戻っていても、解析済みの最後の行を終える
+ * 改行が offset の直前になければ、切り詰めたあとに別の内容が書かれている。
+ *
+ * @param fd 入力ファイル
+ * @param st 入力ファイルの現在の状態
+ * @param cp 前回の解析位置の記録
+ * @return 先頭から読み直すべきなら非ゼロ
+ */
+static int file_replaced(int fd, const struct stat *st, const ftcs_checkpoint_t *cp)
+{
+    // 未解析（ゼロ初期化）の記録は先頭から読むだけなので読み直しには数えない
+    if (cp->ino == 0) {
+        return 0;
+    }
+    if (cp->dev != (uint64_t)st->st_dev || cp->ino != (uint64_t)st->st_ino) {
+        return 1;
+    }
+    if ((uint64_t)st->st_size < cp->offset + cp->pending) {
+        return 1;
+    }
+    if (cp->offset > 0) {
+        char last; // 解析済みの最後のバイト
+        if (pread(fd, &last, 1, (off_t)(cp->offset - 1)) != 1 || last != '\n') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief next->offset から EOF までを読み、改行で終わる行をレコード集合に追加する
+ *
+ * 末尾の改行のない行はレコードにせず、next->offset をその行の先頭に置いたまま
+ * next->pending にバイト数を記録する（次回は offset から読み直す）。
+ *
+ * @param ctx  追加先のレコード集合を持つパースコンテキスト
+ * @param fd   入力ファイル
+ * @param next 解析位置の記録（offset / pending を更新する）
+ * @return 格納したレコード数、読み込み・解析エラー・確保失敗時 -1
+ */
+static long parse_appended(ftcs_parse_ctx_t *ctx, int fd, ftcs_checkpoint_t *next)
+{
+    char *block = malloc(RESUME_BLOCK_SIZE); // 読み込みバッファ
+    if (!block) {
+        perror("ftcs: malloc");
+        return -1;
+    }
+    uint64_t pos = next->offset; // 次に読むバイト位置
+    ssize_t  n;                  // 読み込んだバイト数
+    for (;;) {
+        uint64_t t0 = ctx->stats ? ftcs_now_ns() : 0; // 読み込み開始時刻
+        n = pread(fd, block, RESUME_BLOCK_SIZE, (off_t)pos);
+        if (ctx->stats) {
+            ctx->st.io_ns += ftcs_now_ns() - t0;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        pos           += (uint64_t)n;
+        ctx->st.bytes += (size_t)n;
+        if (ftcs_ctx_feed(ctx, block, (size_t)n) != 0) {
+            free(block);
+            return -1;
+        }
+    }
+    free(block);
+    if (n < 0) {
+        perror("ftcs: pread");
+        return -1;
+    }
+    // 持ち越しに残った行は改行が追記されるまで解析しない
+    next->pending = ctx->carry_len;
+    next->offset  = pos - ctx->carry_len;
+    ctx->carry_len = 0;
+    return (long)ctx->st.records;
+}
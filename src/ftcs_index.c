@@ -0,0 +1,476 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftcs_internal.h"
+
+// ハッシュ表の最大負荷率の逆数。スロット数を件数の2倍以上にすると、
+// 線形探査の平均探査長がヒット時 1.5・ミス時 2.5 程度に収まる。
+#define INDEX_LOAD_INVERSE 2
+
+// ハッシュ表の最小スロット数（2 のべき乗）
+#define INDEX_MIN_SLOTS 16
+
+// 索引の探査でハッシュ値を先に求めてスロットを先読みしておくキーの数。
+// 探査1回の主記憶の遅延（約 100 ns）の間に残りのキーのハッシュ計算が進む。
+#define PROBE_BATCH 16
+
+// --- 内部型定義 ---
+
+/**
+ * @brief ハッシュ表のスロット1個分
+ *
+ * ハッシュ値を並べて持つことで、ほとんどの不一致をレコードを読まずに弾く。
+ */
+typedef struct {
+    uint64_t hash; /**< キーのハッシュ値 */
+    size_t   pos;  /**< レコードの 0-based 位置 + 1（0 は空きスロット） */
+} index_slot_t;
+
+struct ftcs_key_index {
+    const ftcs_record_set_t *rs;    /**< 索引対象のレコード集合 */
+    ftcs_field_mapping_t     key;   /**< キーフィールドのマッピングエントリ（写し） */
+    size_t                   mask;  /**< スロット数 - 1 */
+    index_slot_t            *slots; /**< 線形探査のハッシュ表 */
+};
+
+// --- 関数宣言（目次） ---
+
+static const void *index_probe(const ftcs_key_index_t *idx, const void *key,
+                               uint64_t h);                          // 索引を1キー分探査する
+static void     scan_join(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                          const void *const keys[], size_t n,
+                          const void *out[]);                        // キーのハッシュ表とレコードを突き合わせる
+static size_t   table_slots(size_t n);                               // n 件を載せるスロット数を決める
+static uint64_t mix64(uint64_t x);                                   // 64 ビット値を攪拌する
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+ftcs_key_index_t *ftcs_key_index_build(const ftcs_record_set_t *rs,
+                                       const ftcs_field_mapping_t *mapping,
+                                       const char *primary_key_name)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs || !mapping || !primary_key_name) {
+        fprintf(stderr, "ftcs: ftcs_key_index_build に NULL 引数が渡された\n");
+        return NULL;
+    }
+    const ftcs_field_mapping_t *m = mapping; // プライマリキーのマッピングエントリ
+    while (m->field_name && strcmp(m->field_name, primary_key_name) != 0) {
+        m++;
+    }
+    if (!m->field_name) {
+        fprintf(stderr, "ftcs: プライマリキー '%s' がマッピングに存在しない\n",
+                primary_key_name);
+        return NULL;
+    }
+    if (m->type == FTCS_TYPE_ARRAY) {
+        fprintf(stderr, "ftcs: 配列フィールド '%s' はキーに使えない\n", primary_key_name);
+        return NULL;
+    }
+
+    size_t nslots = table_slots(rs->count); // スロット数（2 のべき乗）
+    ftcs_key_index_t *idx = calloc(1, sizeof(*idx)); // 構築する索引
+    if (!idx) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    idx->slots = calloc(nslots, sizeof(*idx->slots));
+    if (!idx->slots) {
+        perror("ftcs: calloc");
+        free(idx);
+        return NULL;
+    }
+    idx->rs   = rs;
+    idx->key  = *m;
+    idx->mask = nslots - 1;
+
+    // 先頭から登録し、重複キーは最初のレコードだけを残す（ftcs_find_by_key と同じ結果にする）
+    for (size_t i = 0; i < rs->count; i++) {
+        const char *field = (const char *)rs->records + i * rs->struct_size + m->offset; // キーフィールドの位置
+        uint64_t    h     = ftcs_field_hash(m, field); // キーのハッシュ値
+        size_t      s     = h & idx->mask;         // 探査位置
+        while (idx->slots[s].pos != 0) {
+            const index_slot_t *slot = &idx->slots[s]; // 使用中のスロット
+            if (slot->hash == h
+                && ftcs_field_equal(m, field, (const char *)rs->records
+                                         + (slot->pos - 1) * rs->struct_size + m->offset)) {
+                break;
+            }
+            s = (s + 1) & idx->mask;
+        }
+        if (idx->slots[s].pos == 0) {
+            idx->slots[s].hash = h;
+            idx->slots[s].pos  = i + 1;
+        }
+    }
+    return idx;
+}
+
+const void *ftcs_key_index_find(const ftcs_key_index_t *idx, const char *key_value)
+{
+    if (!idx || !key_value) {
+        return NULL;
+    }
+    ftcs_key_value_t buf;                                       // 変換後のキー値
+    const void *key = ftcs_key_convert(&idx->key, key_value, &buf); // フィールドと同じ表現のキー
+    return index_probe(idx, key, ftcs_field_hash(&idx->key, key));
+}
+
+size_t ftcs_key_index_find_many(const ftcs_key_index_t *idx, const char *const keys[], size_t n,
+                                const void *out[])
+{
+    if (!idx || !keys || !out) {
+        return 0;
+    }
+    const ftcs_field_mapping_t *m = &idx->key; // キーフィールドのマッピングエントリ
+    size_t found = 0;                          // 見つかったキーの数
+    for (size_t b = 0; b < n; b += PROBE_BATCH) {
+        size_t           nb = (n - b < PROBE_BATCH) ? n - b : PROBE_BATCH; // この回のキーの数
+        ftcs_key_value_t buf[PROBE_BATCH]; // 変換後のキー値
+        const void      *key[PROBE_BATCH]; // フィールドと同じ表現のキー
+        uint64_t         h[PROBE_BATCH];   // キーのハッシュ値
+        // まとめてハッシュ値を求め、最初に読むスロットを先読みしておく
+        for (size_t j = 0; j < nb; j++) {
+            if (!keys[b + j]) {
+                key[j] = NULL;
+                continue;
+            }
+            key[j] = ftcs_key_convert(m, keys[b + j], &buf[j]);
+            h[j]   = ftcs_field_hash(m, key[j]);
+            __builtin_prefetch(&idx->slots[h[j] & idx->mask]);
+        }
+        for (size_t j = 0; j < nb; j++) {
+            out[b + j] = key[j] ? index_probe(idx, key[j], h[j]) : NULL;
+            found += out[b + j] != NULL;
+        }
+    }
+    return found;
+}
+
+void ftcs_key_index_free(ftcs_key_index_t *idx)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!idx) {
+        return;
+    }
+    free(idx->slots);
+    free(idx);
+}
+
+size_t ftcs_key_index_bytes(const ftcs_key_index_t *idx)
+{
+    if (!idx) {
+        return 0;
+    }
+    return sizeof(*idx) + (idx->mask + 1) * sizeof(*idx->slots);
+}
+
+size_t ftcs_find_many(const ftcs_record_set_t *rs,
+                      const ftcs_field_mapping_t *mapping,
+                      const char *field_name,
+                      const char *const keys[], size_t n,
+                      const void *out[])
+{
+    if (!out) {
+        fprintf(stderr, "ftcs: ftcs_find_many に NULL 引数が渡された\n");
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        out[i] = NULL;
+    }
+    // NULL チェック：必須引数が欠けている場合は全て見つからないものとする
+    if (!rs || !mapping || !field_name || !keys) {
+        fprintf(stderr, "ftcs: ftcs_find_many に NULL 引数が渡された\n");
+        return 0;
+    }
+    const ftcs_field_mapping_t *m = mapping; // キーフィールドのマッピングエントリ
+    while (m->field_name && strcmp(m->field_name, field_name) != 0) {
+        m++;
+    }
+    if (!m->field_name) {
+        fprintf(stderr, "ftcs: キーフィールド '%s' がマッピングに存在しない\n", field_name);
+        return 0;
+    }
+    if (m->type == FTCS_TYPE_ARRAY) {
+        fprintf(stderr, "ftcs: 配列フィールド '%s' はキーに使えない\n", field_name);
+        return 0;
+    }
+
+    // NULL でないキーを詰めて、1回ずつだけフィールドの表現に変換する
+    ftcs_key_value_t *buf   = malloc(n * sizeof(*buf));   // 変換後のキー値
+    const void      **conv  = malloc(n * sizeof(*conv));  // フィールドと同じ表現のキー
+    const void      **hit   = malloc(n * sizeof(*hit));   // conv[k] の一致レコード
+    size_t           *where = malloc(n * sizeof(*where)); // conv[k] に対応する keys の位置
+    if (n && (!buf || !conv || !hit || !where)) {
+        perror("ftcs: malloc");
+        free(buf);
+        free(conv);
+        free(hit);
+        free(where);
+        return 0;
+    }
+    size_t nkeys = 0; // NULL でないキーの数
+    for (size_t i = 0; i < n; i++) {
+        if (keys[i]) {
+            conv[nkeys]  = ftcs_key_convert(m, keys[i], &buf[nkeys]);
+            where[nkeys] = i;
+            nkeys++;
+        }
+    }
+
+    // 同じキーフィールドで並べ替え済みなら二分探索し、そうでなければ1回の走査で突き合わせる
+    if (rs->sorted && rs->sorted_key.offset == m->offset && rs->sorted_key.type == m->type) {
+        ftcs_sorted_find_many(rs, conv, nkeys, hit);
+    } else {
+        scan_join(rs, m, conv, nkeys, hit);
+    }
+    size_t found = 0; // 見つかったキーの数
+    for (size_t k = 0; k < nkeys; k++) {
+        out[where[k]] = hit[k];
+        found += hit[k] != NULL;
+    }
+    free(buf);
+    free(conv);
+    free(hit);
+    free(where);
+    return found;
+}
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+uint64_t ftcs_field_hash(const ftcs_field_mapping_t *m, const void *field)
+{
+    switch (m->type) {
+    case FTCS_TYPE_INT:
+        return mix64((uint64_t)*(const int *)field);
+    case FTCS_TYPE_LONG:
+        return mix64((uint64_t)*(const long *)field);
+    case FTCS_TYPE_SHORT:
+        return mix64((uint64_t)*(const short *)field);
+    case FTCS_TYPE_CHAR:
+        return mix64((uint64_t)(unsigned char)*(const char *)field);
+    case FTCS_TYPE_FLOAT: {
+        float v = *(const float *)field; // ハッシュ対象の値
+        // 0.0 と -0.0 は == で等しいため同じハッシュ値にそろえる
+        double d = (v == 0.0f) ? 0.0 : (double)v; // ビット列を取り出す値
+        uint64_t bits;                            // d のビット表現
+        memcpy(&bits, &d, sizeof(bits));
+        return mix64(bits);
+    }
+    case FTCS_TYPE_DOUBLE: {
+        double d = *(const double *)field;  // ハッシュ対象の値
+        // 0.0 と -0.0 は == で等しいため同じハッシュ値にそろえる
+        if (d == 0.0) {
+            d = 0.0;
+        }
+        uint64_t bits; // d のビット表現
+        memcpy(&bits, &d, sizeof(bits));
+        return mix64(bits);
+    }
+    case FTCS_TYPE_STRING: {
+        // FNV-1a（短いキーが多いので1バイトずつで十分速い）
+        uint64_t h = 0xcbf29ce484222325ULL; // FNV オフセット基底
+        for (const unsigned char *p = field; *p; p++) {
+            h = (h ^ *p) * 0x100000001b3ULL;
+        }
+        return mix64(h);
+    }
+    case FTCS_TYPE_ARRAY:
+        break; // 配列はキーにできない（索引の構築時に拒否している）
+    }
+    return 0;
+}
+
+int ftcs_field_equal(const ftcs_field_mapping_t *m, const void *a, const void *b)
+{
+    switch (m->type) {
+    case FTCS_TYPE_INT:
+        return *(const int *)a == *(const int *)b;
+    case FTCS_TYPE_LONG:
+        return *(const long *)a == *(const long *)b;
+    case FTCS_TYPE_SHORT:
+        return *(const short *)a == *(const short *)b;
+    case FTCS_TYPE_FLOAT:
+        return *(const float *)a == *(const float *)b;
+    case FTCS_TYPE_DOUBLE:
+        return *(const double *)a == *(const double *)b;
+    case FTCS_TYPE_CHAR:
+        return *(const char *)a == *(const char *)b;
+    case FTCS_TYPE_STRING:
+        return strcmp(a, b) == 0;
+    case FTCS_TYPE_ARRAY:
+        break;
+    }
+    return 0;
+}
+
+const void *ftcs_key_convert(const ftcs_field_mapping_t *m, const char *key_value,
+                             ftcs_key_value_t *buf)
+{
+    switch (m->type) {
+    case FTCS_TYPE_INT:
+        buf->i = (int)strtol(key_value, NULL, 10);
+        break;
+    case FTCS_TYPE_LONG:
+        buf->l = strtol(key_value, NULL, 10);
+        break;
+    case FTCS_TYPE_SHORT:
+        buf->s = (short)strtol(key_value, NULL, 10);
+        break;
+    case FTCS_TYPE_FLOAT:
+        buf->f = strtof(key_value, NULL);
+        break;
+    case FTCS_TYPE_DOUBLE:
+        buf->d = strtod(key_value, NULL);
+        break;
+    case FTCS_TYPE_CHAR:
+        buf->c = key_value[0];
+        break;
+    case FTCS_TYPE_STRING:
+        return key_value;
+    case FTCS_TYPE_ARRAY:
+        break;
+    }
+    return buf;
+}
+
+/**
+ * @brief ハッシュ索引を1キー分、空きスロットに当たるまで線形探査する
+ *
+ * @param idx ハッシュ索引
+ * @param key フィールドと同じ表現のキー
+ * @param h   キーのハッシュ値
+ * @return 一致レコード、見つからなければ NULL
+ */
+static const void *index_probe(const ftcs_key_index_t *idx, const void *key, uint64_t h)
+{
+    const ftcs_field_mapping_t *m = &idx->key; // キーフィールドのマッピングエントリ
+    for (size_t s = h & idx->mask; idx->slots[s].pos != 0; s = (s + 1) & idx->mask) {
+        if (idx->slots[s].hash != h) {
+            continue;
+        }
+        const char *rec = (const char *)idx->rs->records
+                          + (idx->slots[s].pos - 1) * idx->rs->struct_size; // 候補レコード
+        if (ftcs_field_equal(m, rec + m->offset, key)) {
+            return rec;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 検索キーのハッシュ表を作り、レコード集合を先頭から1回走査して突き合わせる
+ *
+ * 表に載せるのは検索キーの側なので、キーの数が少なければ表は L1 に収まり、
+ * 1レコードあたりの処理はハッシュ計算と1回の探査で済む。
+ * 同じキーは1スロットにまとめて next でつなぎ、最初に一致したレコードを全員に返す
+ * （先頭から走査するので ftcs_find_by_key の線形探索と同じレコードになる）。
+ * 全ての異なるキーが見つかった時点で走査を打ち切る。
+ * 表の確保に失敗した場合はキーごとの線形探索に切り替える。
+ * キー列を SIMD でまとめて比べる方式は、1比較を速くしてもキー数×レコード数の比較が残るため採らない。
+ *
+ * @param rs   検索対象のレコード集合
+ * @param m    キーフィールドのマッピングエントリ
+ * @param keys フィールドと同じ表現のキーの配列
+ * @param n    キーの数
+ * @param out  keys[k] の一致レコード（見つからなければ NULL）を書き込む n 要素の配列
+ */
+static void scan_join(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                      const void *const keys[], size_t n, const void *out[])
+{
+    size_t        nslots = table_slots(n);                   // スロット数（2 のべき乗）
+    size_t        mask   = nslots - 1;                       // スロット数 - 1
+    index_slot_t *slots  = calloc(nslots, sizeof(*slots));   // 検索キーのハッシュ表（pos はキー位置 + 1）
+    size_t       *next   = malloc((n ? n : 1) * sizeof(*next)); // 同じキーの次のキー位置 + 1（0 は終端）
+    const char   *base   = (const char *)rs->records;        // レコード配列の先頭
+    size_t        stride = rs->struct_size;                  // レコード間隔
+    for (size_t k = 0; k < n; k++) {
+        out[k] = NULL;
+    }
+    if (!slots || !next) {
+        perror("ftcs: malloc");
+        free(slots);
+        free(next);
+        for (size_t k = 0; k < n; k++) {
+            for (size_t i = 0; i < rs->count && !out[k]; i++) {
+                if (ftcs_field_equal(m, base + i * stride + m->offset, keys[k])) {
+                    out[k] = base + i * stride;
+                }
+            }
+        }
+        return;
+    }
+
+    size_t remaining = 0; // まだ見つかっていない異なるキーの数
+    for (size_t k = 0; k < n; k++) {
+        uint64_t h = ftcs_field_hash(m, keys[k]); // キーのハッシュ値
+        size_t   s = h & mask;                    // 探査位置
+        while (slots[s].pos != 0
+               && !(slots[s].hash == h && ftcs_field_equal(m, keys[slots[s].pos - 1], keys[k]))) {
+            s = (s + 1) & mask;
+        }
+        if (slots[s].pos == 0) {
+            slots[s].hash = h;
+            remaining++;
+        }
+        next[k]      = slots[s].pos;
+        slots[s].pos = k + 1;
+    }
+
+    for (size_t i = 0; i < rs->count && remaining > 0; i++) {
+        const char *rec   = base + i * stride;  // i 番目のレコード先頭
+        const void *field = rec + m->offset;    // キーフィールドの位置
+        uint64_t    h     = ftcs_field_hash(m, field); // フィールドのハッシュ値
+        for (size_t s = h & mask; slots[s].pos != 0; s = (s + 1) & mask) {
+            size_t k = slots[s].pos - 1; // このスロットの代表のキー位置
+            if (slots[s].hash != h || !ftcs_field_equal(m, field, keys[k])) {
+                continue;
+            }
+            // 最初に一致したレコードだけを採り、以後の一致は無視する
+            if (!out[k]) {
+                for (size_t p = slots[s].pos; p != 0; p = next[p - 1]) {
+                    out[p - 1] = rec;
+                }
+                remaining--;
+            }
+            break;
+        }
+    }
+    free(slots);
+    free(next);
+}
+
+/**
+ * @brief n 件を最大負荷率以下で載せられる 2 のべき乗のスロット数を求める
+ *
+ * @param n 載せる件数
+ * @return スロット数
+ */
+static size_t table_slots(size_t n)
+{
+    size_t nslots = INDEX_MIN_SLOTS; // スロット数（2 のべき乗）
+    while (nslots < n * INDEX_LOAD_INVERSE) {
+        nslots *= 2;
+    }
+    return nslots;
+}
+
+/**
+ * @brief 64 ビット値を攪拌して下位ビットにも偏りが出ないようにする（splitmix64 の最終段）
+ *
+ * @param x 攪拌する値
+ * @return 攪拌後の値
+ */
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
@@ -0,0 +1,414 @@
+#ifndef FTCS_INTERNAL_H
+#define FTCS_INTERNAL_H
+
+// ライブラリ内部の翻訳単位間でのみ共有する宣言。公開 API は ftcs.h に置くこと。
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "ftcs.h"
+
+// --- フィルタ ---
+
+/**
+ * @brief コンパイル済みのフィルタ式（不透明型）
+ */
+typedef struct ftcs_filter ftcs_filter_t;
+
+/**
+ * @brief "FIELD OP VALUE && ..." 形式のフィルタ式をマッピングに対してコンパイルする
+ *
+ * 演算子は = (==), !=, <, <=, >, >=。比較値はフィールドの型に変換しておく。
+ * @return 成功時フィルタ、構文エラー・未知のフィールド・型の合わない値なら NULL
+ */
+ftcs_filter_t *ftcs_filter_compile(const char *expr, const ftcs_field_mapping_t *mapping);
+
+/**
+ * @brief 変換直後のフィールド m に関する項を判定する
+ *
+ * @param decided 判定済みの項のマスク（満たした項のビットが立つ）
+ * @return 満たせば 0、レコードを棄却すべきなら 1
+ */
+int  ftcs_filter_field(const ftcs_filter_t *f, const ftcs_field_mapping_t *m,
+                       const void *rec, uint64_t *decided);
+
+/**
+ * @brief 行に現れなかったフィールドの項をゼロ初期化値のまま判定する
+ * @return 満たせば 0、レコードを棄却すべきなら 1
+ */
+int  ftcs_filter_rest(const ftcs_filter_t *f, const void *rec, uint64_t decided);
+
+/**
+ * @brief フィルタ式がフィールド m を参照するかを返す
+ */
+int  ftcs_filter_uses(const ftcs_filter_t *f, const ftcs_field_mapping_t *m);
+
+/**
+ * @brief フィルタを解放する（NULL なら何もしない）
+ */
+void ftcs_filter_free(ftcs_filter_t *f);
+
+// --- パースコンテキスト ---
+
+// キー順を覚えておくトークン位置の数。実用的なスキーマのフィールド数はこれに収まり、
+// それより後ろのトークンは毎回マッピングを検索する。
+#define FTCS_KEY_ORDER_SLOTS 32
+
+// マッピングにないキーを予測として覚える最大バイト数。判別キーなど毎行現れる未知のキーは短く、
+// これより長いキーは覚えずに毎回マッピングを検索する。
+#define FTCS_KEY_ORDER_NAME_MAX 32
+
+/**
+ * @brief 直前の行で、あるトークン位置に現れたキー
+ */
+typedef struct {
+    const ftcs_field_mapping_t *m;     /**< 対応したエントリ（NULL ならマッピングにないキー） */
+    size_t                      len;   /**< キーの長さ（予測の照合で strlen を省く） */
+    int                         known; /**< 照合に使えるか（未学習・長すぎる未知のキーなら 0） */
+    char                        name[FTCS_KEY_ORDER_NAME_MAX]; /**< マッピングにないキーの写し（NUL 終端なし） */
+} ftcs_key_slot_t;
+
+/**
+ * @brief 1回のパース処理の状態
+ *
+ * 行の取得方法（fgets / ブロック読み込み）に依存しない処理をまとめ、
+ * どの入力バックエンドからでも同じレコード集合が得られるようにする。
+ */
+typedef struct ftcs_parse_ctx {
+    const ftcs_parser_config_t *config;      /**< パーサー設定 */
+    const ftcs_field_mapping_t *mapping;     /**< フィールドマッピングテーブル */
+    size_t                      struct_size; /**< 1レコードのバイトサイズ */
+    char                        comment;     /**< コメント行の先頭文字 */
+    int                         use_index_field; /**< 配置位置指定モードなら非ゼロ */
+    ftcs_record_set_t          *rs;          /**< 構築中のレコード集合 */
+    char                       *carry;       /**< ブロック境界をまたいだ行の持ち越しバッファ */
+    size_t                      carry_len;   /**< carry に溜まっているバイト数 */
+    size_t                      carry_cap;   /**< carry の確保済みバイト数 */
+    int                         defer_placement; /**< 非ゼロなら配置位置指定モードでも出現順に詰め、
+                                                      位置は positions に記録して後段に配置を委ねる */
+    size_t                     *positions;     /**< 各レコードの 0-based 配置位置（defer_placement 時） */
+    size_t                      positions_len; /**< positions の要素数（== rs->count） */
+    size_t                      positions_cap; /**< positions の確保済み要素数 */
+    size_t                      ring_from;     /**< 順次モードで config->ring へまだ書き込んでいない先頭レコード位置 */
+    ftcs_parse_stats_t         *stats;       /**< 統計の報告先（NULL なら時間計測をしない） */
+    ftcs_parse_stats_t          st;          /**< 収集中の統計（フェーズ時間は抽出行の生値） */
+    int                         sampling;    /**< 処理中の行がフェーズ計測の対象なら非ゼロ */
+    uint64_t                    clock_ns;    /**< 時刻取得1回分の見積もりコスト（フェーズ時間から差し引く） */
+    ftcs_filter_t              *filter;      /**< config->filter のコンパイル結果（NULL ならフィルタなし） */
+    unsigned char              *projected;   /**< マッピングエントリごとの変換要否（NULL なら全フィールド変換） */
+    void                       *scratch;     /**< 配置位置指定モードでフィルタ判定前のレコードを組み立てる領域 */
+    ftcs_sparse_set_t          *sparse;      /**< 非 NULL なら配置位置指定モードのレコードをここに格納する（所有しない） */
+    struct ftcs_parse_ctx      *routes;      /**< 非 NULL なら行を判別キーの値で振り分ける先（ctx 自身には格納しない） */
+    const ftcs_schema_t        *schemas;     /**< routes[i] に振り分ける値を持つスキーマ（所有しない） */
+    size_t                      nroutes;     /**< routes の要素数 */
+    const char                 *route_key;   /**< 判別キーの名前（振り分け先では未知のキーとして数えない） */
+    ftcs_key_slot_t             key_order[FTCS_KEY_ORDER_SLOTS]; /**< トークン位置ごとに直前の行のキー（予測に使う） */
+} ftcs_parse_ctx_t;
+
+/**
+ * @brief 単調増加クロックの現在時刻をナノ秒で返す
+ */
+static inline uint64_t ftcs_now_ns(void)
+{
+    struct timespec ts; // 現在時刻
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 待ち時間（ミリ秒）から ftcs_now_ns() 基準の期限を求める
+ * @param timeout_ms 待つ上限（負なら無期限、0 なら待たない）
+ * @return 期限（無期限なら UINT64_MAX）
+ */
+static inline uint64_t ftcs_deadline_ns(int timeout_ms)
+{
+    if (timeout_ms < 0) {
+        return UINT64_MAX;
+    }
+    return ftcs_now_ns() + (uint64_t)timeout_ms * 1000000u;
+}
+
+/**
+ * @brief パースコンテキストを初期化し、空のレコード集合を確保する
+ * @return 成功時 0、確保失敗時 -1
+ */
+int  ftcs_ctx_init(ftcs_parse_ctx_t *ctx, const ftcs_parser_config_t *config,
+                   const ftcs_field_mapping_t *mapping, size_t struct_size);
+
+/**
+ * @brief 1行（NUL 終端・改行除去前でも可）を処理してレコード集合に反映する
+ * @return 成功時 0、解析エラー時 -1
+ */
+int  ftcs_ctx_line(ftcs_parse_ctx_t *ctx, char *line);
+
+/**
+ * @brief 読み込んだブロックを行に分割して処理する
+ *
+ * buf はインプレースで書き換えられる。末尾の改行なし断片は次回呼び出しまで持ち越す。
+ * config->ring があれば、このブロックで格納したレコードを書き込んでから戻る。
+ * @return 成功時 0、解析エラー時 -1
+ */
+int  ftcs_ctx_feed(ftcs_parse_ctx_t *ctx, char *buf, size_t len);
+
+/**
+ * @brief 持ち越し中の最終行（改行なしで終わるファイル末尾）を処理し、
+ *        config->ring へ溜めたレコードを書き込む
+ * @return 成功時 0、解析エラー時 -1
+ */
+int  ftcs_ctx_finish(ftcs_parse_ctx_t *ctx);
+
+/**
+ * @brief 構築済みレコード集合の所有権を呼び出し元へ移す
+ * @return レコード集合（以後 ctx からは参照されない）
+ */
+ftcs_record_set_t *ftcs_ctx_take(ftcs_parse_ctx_t *ctx);
+
+/**
+ * @brief 構築中のレコード集合を破棄し、空のレコード集合で次のバッチを始める
+ * @return 成功時 0、確保失敗時 -1
+ */
+int  ftcs_ctx_reset(ftcs_parse_ctx_t *ctx);
+
+/**
+ * @brief 収集した統計を換算して config->stats に書き込む（stats が NULL なら何もしない）
+ * @param start_ns パース開始時刻（ftcs_now_ns() の値）
+ */
+void ftcs_ctx_report_stats(ftcs_parse_ctx_t *ctx, uint64_t start_ns);
+
+/**
+ * @brief 統計 src を dst に加算する（並列パースの集計用）
+ */
+void ftcs_stats_add(ftcs_parse_stats_t *dst, const ftcs_parse_stats_t *src);
+
+/**
+ * @brief コンテキストが保持する資源を解放する（take していないレコード集合も含む）
+ */
+void ftcs_ctx_destroy(ftcs_parse_ctx_t *ctx);
+
+/**
+ * @brief config->projection をマッピングエントリごとの変換要否の配列にする
+ *
+ * filter が参照するフィールドは判定のため常に変換対象に含める。
+ * @param out 変換要否の配列（projection が NULL なら NULL。free で解放する）
+ * @return 成功時 0、未知のフィールド名・確保失敗時 -1
+ */
+int  ftcs_projection_compile(const ftcs_parser_config_t *config,
+                             const ftcs_field_mapping_t *mapping,
+                             const ftcs_filter_t *filter, unsigned char **out);
+
+/**
+ * @brief NUL 終端した文字列値をフィールドの型に変換して構造体に書き込む
+ * @return 成功時 0、型変換失敗時 -1
+ */
+int  ftcs_field_set(void *out, const ftcs_field_mapping_t *m, const char *val);
+
+/**
+ * @brief フィールド値のハッシュ値を求める（ftcs_field_equal で等しい値は同じハッシュ値になる）
+ */
+uint64_t ftcs_field_hash(const ftcs_field_mapping_t *m, const void *field);
+
+/**
+ * @brief 2つのフィールド値が ftcs_find_by_key の比較規則で等しいかを返す
+ */
+int  ftcs_field_equal(const ftcs_field_mapping_t *m, const void *a, const void *b);
+
+/**
+ * @brief 検索キー文字列をフィールド型の値に変換した一時領域
+ */
+typedef union {
+    int    i; /**< FTCS_TYPE_INT */
+    long   l; /**< FTCS_TYPE_LONG */
+    short  s; /**< FTCS_TYPE_SHORT */
+    float  f; /**< FTCS_TYPE_FLOAT */
+    double d; /**< FTCS_TYPE_DOUBLE */
+    char   c; /**< FTCS_TYPE_CHAR */
+} ftcs_key_value_t;
+
+/**
+ * @brief 検索キー文字列を ftcs_find_by_key と同じ規則でフィールド型の値に変換する
+ * @return フィールドと同じ表現の値へのポインタ（文字列型は key_value 自身、数値型は buf）
+ */
+const void *ftcs_key_convert(const ftcs_field_mapping_t *m, const char *key_value,
+                             ftcs_key_value_t *buf);
+
+/**
+ * @brief 並べ替えの単位（正規化したキーと元のレコード位置）
+ */
+typedef struct {
+    uint64_t key; /**< 符号なし整数として比較すると元の値と同じ順になるキー */
+    size_t   pos; /**< 並べ替え前のレコード位置 */
+} ftcs_sort_item_t;
+
+/**
+ * @brief キーフィールドの値を、符号なしで比較すると元の値と同じ順になる 64 ビット整数にする
+ *
+ * 符号付き整数は符号ビットを反転し、浮動小数点数は正なら符号ビットを立て負なら全ビットを反転する
+ * （-0.0 は 0.0 にそろえる）。文字列は先頭 8 バイトをビッグエンディアンで詰める。
+ */
+uint64_t ftcs_key_bits(const ftcs_field_mapping_t *m, const void *field);
+
+/**
+ * @brief 全レコードのキーを取り出して安定に並べ替える（ftcs_record_set_sort と同じ順）
+ * @return キー順に並べた rs->count 要素の配列（free で解放する）、確保失敗時 NULL
+ */
+ftcs_sort_item_t *ftcs_key_sort(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m);
+
+/**
+ * @brief ftcs_record_set_sort() で並べ替え済みのレコード集合を sorted_key で二分探索する
+ * @return 並べ替え前の線形探索と同じ一致レコード、見つからなければ NULL
+ */
+const void *ftcs_sorted_find(const ftcs_record_set_t *rs, const char *key_value);
+
+/**
+ * @brief 並べ替え済みのレコード集合で、変換済みの複数のキーをまとめて二分探索する
+ * @param keys ftcs_key_convert() で sorted_key の表現に変換したキーの配列
+ * @param out  keys[i] の一致レコード（見つからなければ NULL）を書き込む n 要素の配列
+ */
+void ftcs_sorted_find_many(const ftcs_record_set_t *rs, const void *const keys[], size_t n,
+                           const void *out[]);
+
+// --- 並列実行 ---
+
+// 並列処理のスレッド数の上限（集計・振り分けはメモリ帯域で頭打ちになるため、コア数が多くてもこれ以上は増やさない）
+#define FTCS_MAX_THREADS 16
+
+/**
+ * @brief n 件を1スレッドあたり min_per_thread 件以上ずつ分けるときのスレッド数を決める
+ *
+ * min_per_thread は、スレッド生成のコスト（数十 µs）が1スレッド分の処理時間を上回らない件数を選ぶ。
+ * @return 1 以上 FTCS_MAX_THREADS 以下で、コア数を超えないスレッド数
+ */
+size_t ftcs_parallel_threads(size_t n, size_t min_per_thread);
+
+/**
+ * @brief task_size バイトおきに並んだ ntasks 個の要素それぞれに run を別スレッドで適用する
+ *
+ * 先頭の要素とスレッドを作れなかった要素は呼び出しスレッドで処理し、全要素の終了を待って戻る。
+ * @return 成功時 0、確保失敗時 -1（run は呼ばれない）
+ */
+int  ftcs_run_parallel(void *tasks, size_t ntasks, size_t task_size, void (*run)(void *task));
+
+// --- レコード集合の操作 ---
+
+/**
+ * @brief ctx->rs の末尾に連続した n 件のレコードを追加する（順次モード用）
+ *
+ * config->ring があればリングにも書き込む。
+ * @return 成功時 0、realloc・リングへの書き込み失敗時 -1
+ */
+int  ftcs_ctx_append(ftcs_parse_ctx_t *ctx, const void *recs, size_t n);
+
+/**
+ * @brief ctx->rs の 0-based 位置 pos にレコード1件を配置する（配置位置指定モード用）
+ *
+ * config->ring があればリングにも書き込む。
+ * @return 成功時 0、realloc・リングへの書き込み失敗時 -1
+ */
+int  ftcs_ctx_place(ftcs_parse_ctx_t *ctx, size_t pos, const void *rec);
+
+// --- futex による待ち合わせ（共有メモリリング・更新通知） ---
+
+/**
+ * @brief 32 ビット語 word を加算し、ftcs_futex_wait_until() で眠っている相手がいれば起こす
+ * @param waiters word を待っている数（ftcs_futex_wait_until() が増減する）
+ */
+void ftcs_futex_bump(uint32_t *word, const uint32_t *waiters);
+
+/**
+ * @brief word が stale から変わるまで待つ
+ *
+ * 短くスピンしてから futex で眠る。プロセスをまたいで待ち合わせられる（共有メモリ上の語でよい）。
+ * @param deadline 期限（ftcs_deadline_ns() の値）
+ * @param waiters  眠っている間だけ加算する待ち手の数（起こす側が ftcs_futex_bump() に渡す）
+ * @return 変わったら 0、期限切れなら -1（errno = ETIMEDOUT）
+ */
+int  ftcs_futex_wait_until(uint32_t *word, uint32_t stale, uint64_t deadline, uint32_t *waiters);
+
+// --- 共有メモリリング ---
+
+/**
+ * @brief 生産者ハンドルなら1レコードのバイトサイズを、消費者ハンドルなら 0 を返す
+ */
+size_t ftcs_ring_producer_size(const ftcs_shm_ring_t *ring);
+
+// --- 疎なレコード集合 ---
+
+/**
+ * @brief 空の疎なレコード集合を作る
+ * @param allocator レコードページの確保に使うアロケーター（NULL なら calloc / free）
+ * @return 成功時は疎なレコード集合、確保失敗時 NULL
+ */
+ftcs_sparse_set_t *ftcs_sparse_create(size_t struct_size, const ftcs_allocator_t *allocator);
+
+/**
+ * @brief 0-based 位置 pos のスロットを返す（ページが未確保なら確保し、存在として記録する）
+ * @return スロットへのポインタ（新規ならゼロ初期化済み）、確保失敗時 NULL
+ */
+void *ftcs_sparse_slot(ftcs_sparse_set_t *ss, size_t pos);
+
+// --- メモリ確保 ---
+
+/**
+ * @brief アロケーター（NULL または関数未設定なら calloc）でゼロ初期化済みの領域を確保する
+ * @return 確保した領域、失敗時 NULL
+ */
+void *ftcs_mem_alloc(const ftcs_allocator_t *a, size_t size);
+
+/**
+ * @brief アロケーター（NULL または関数未設定なら realloc）で領域を伸縮する
+ * @return 伸縮後の領域、失敗時 NULL（ptr は有効なまま）
+ */
+void *ftcs_mem_realloc(const ftcs_allocator_t *a, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * @brief アロケーター（NULL または関数未設定なら free）で領域を解放する（ptr が NULL なら何もしない）
+ */
+void  ftcs_mem_free(const ftcs_allocator_t *a, void *ptr, size_t size);
+
+// --- ブロック読み込み ---
+
+/**
+ * @brief 大きなブロック単位でファイルを先読みするリーダー（不透明型）
+ */
+typedef struct ftcs_reader ftcs_reader_t;
+
+/**
+ * @brief ファイルを開き、指定バックエンドで先読みを開始する
+ *
+ * FTCS_IO_URING が使えない環境（カーネル未対応・seccomp 等）では
+ * 自動的に FTCS_IO_PREAD に切り替える。
+ * @return 成功時リーダー、失敗時 NULL
+ */
+ftcs_reader_t *ftcs_reader_open(const char *filepath, ftcs_io_backend_t backend);
+
+/**
+ * @brief ファイル先頭から順に次のブロックを取得する
+ *
+ * *block はリーダー内部のバッファを指し、次の呼び出しまで有効（書き換え可）。
+ * @return 取得バイト数、EOF で 0、エラー時 -1
+ */
+ssize_t ftcs_reader_next(ftcs_reader_t *r, char **block);
+
+/**
+ * @brief リーダーを閉じ、未完了の読み込みを破棄する
+ */
+void ftcs_reader_close(ftcs_reader_t *r);
+
+// --- 検索サーバーのプロトコル ---
+
+/**
+ * @brief 検索要求のヘッダ（直後に key_len バイトのキーが続く。NUL 終端は含めない）
+ */
+typedef struct {
+    uint32_t key_len; /**< キーのバイト数 */
+} ftcs_lookup_req_t;
+
+/**
+ * @brief 検索応答のヘッダ（直後に len バイトのレコードが続く）
+ */
+typedef struct {
+    uint32_t status; /**< ftcs_lookup_status_t の値 */
+    uint32_t len;    /**< レコードのバイト数（FOUND 以外は 0） */
+} ftcs_lookup_resp_t;
+
+#endif /* FTCS_INTERNAL_H */
@@ -0,0 +1,410 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ftcs_internal.h"
+
+// レコード配列・位置配列の初期確保件数
+#define LAZY_INITIAL_CAPACITY 16
+
+// 変換時に値をコピーする一時バッファのサイズ。これより長い数値表現はヒープに写す。
+#define LAZY_VALUE_BUF_SIZE 128
+
+// lazy_span_t.len の特殊値: 行に値がない（ゼロのまま）
+#define SPAN_ABSENT UINT32_MAX
+
+// lazy_span_t.len の特殊値: 変換済み（レコード内の値をそのまま返す）
+#define SPAN_DONE (UINT32_MAX - 1)
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 1フィールド分の値の位置（行頭からの相対位置）
+ */
+typedef struct {
+    uint32_t off; /**< 行頭から値の先頭までのバイト数 */
+    uint32_t len; /**< 値のバイト数、または SPAN_ABSENT / SPAN_DONE */
+} lazy_span_t;
+
+struct ftcs_lazy_set {
+    const ftcs_field_mapping_t *mapping;     /**< フィールドマッピングテーブル */
+    size_t                      nfields;     /**< マッピングエントリ数 */
+    size_t                      struct_size; /**< 1レコードのバイトサイズ */
+    const char                 *data;        /**< mmap したファイル内容（空ファイルなら NULL） */
+    size_t                      size;        /**< ファイルのバイト数 */
+    size_t                      count;       /**< レコード数 */
+    size_t                      cap;         /**< 各配列の確保済み件数 */
+    char                       *records;     /**< レコード配列（変換済みのフィールドだけ値が入る） */
+    size_t                     *line_off;    /**< 各レコード行の先頭のファイル内オフセット */
+    lazy_span_t                *spans;       /**< レコード × フィールドの値の位置 */
+};
+
+// --- 関数宣言（目次） ---
+
+static int  scan_lines(ftcs_lazy_set_t *ls, const ftcs_parser_config_t *config,
+                       const unsigned char *projected, ftcs_parse_stats_t *st); // 全行の値の位置を記録する
+static int  scan_line(ftcs_lazy_set_t *ls, const char *line, const char *end,
+                      const char *kv_sep, const unsigned char *projected,
+                      ftcs_parse_stats_t *st);                                  // 1行の値の位置を記録する
+static int  lazy_grow(ftcs_lazy_set_t *ls);                                    // 各配列を2倍に拡張する
+static int  convert(ftcs_lazy_set_t *ls, size_t i, size_t f);                  // 1フィールドを変換する
+static int  is_blank(char c);                                                  // 空白・タブか
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+ftcs_lazy_set_t *ftcs_parse_lazy(const char *filepath,
+                                 const ftcs_parser_config_t *config,
+                                 const ftcs_field_mapping_t *mapping,
+                                 size_t struct_size)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!filepath || !config || !mapping || !config->kv_separator) {
+        fprintf(stderr, "ftcs: ftcs_parse_lazy に NULL 引数が渡された\n");
+        return NULL;
+    }
+    // 値の変換前に配置位置やフィルタの判定はできない
+    if ((config->primary_key_mode == FTCS_KEY_INDEX && config->index_field_name)
+        || config->filter) {
+        fprintf(stderr, "ftcs: 遅延変換では index_field_name と filter は使えない\n");
+        return NULL;
+    }
+
+    uint64_t t0 = config->stats ? ftcs_now_ns() : 0; // 計測開始時刻
+    unsigned char *projected; // マッピングエントリごとの変換要否
+    if (ftcs_projection_compile(config, mapping, NULL, &projected) != 0) {
+        return NULL;
+    }
+    ftcs_lazy_set_t *ls = calloc(1, sizeof(*ls)); // 構築する遅延レコード集合
+    if (!ls) {
+        perror("ftcs: calloc");
+        free(projected);
+        return NULL;
+    }
+    ls->mapping     = mapping;
+    ls->struct_size = struct_size;
+    while (mapping[ls->nfields].field_name) {
+        ls->nfields++;
+    }
+
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC); // 入力ファイル
+    if (fd < 0) {
+        fprintf(stderr, "ftcs: '%s' を開けない: %s\n", filepath, strerror(errno));
+        free(projected);
+        ftcs_lazy_free(ls);
+        return NULL;
+    }
+    struct stat sb; // ファイルサイズの取得用
+    if (fstat(fd, &sb) != 0) {
+        perror("ftcs: fstat");
+        close(fd);
+        free(projected);
+        ftcs_lazy_free(ls);
+        return NULL;
+    }
+    ls->size = (size_t)sb.st_size;
+    // 長さ 0 の mmap はできないため、空ファイルはレコード 0 件として扱う
+    if (ls->size > 0) {
+        void *p = mmap(NULL, ls->size, PROT_READ, MAP_PRIVATE, fd, 0); // ファイル内容
+        if (p == MAP_FAILED) {
+            perror("ftcs: mmap");
+            close(fd);
+            free(projected);
+            ftcs_lazy_free(ls);
+            return NULL;
+        }
+        // 先頭から1回だけ走査するので先読みを促す
+        madvise(p, ls->size, MADV_SEQUENTIAL);
+        ls->data = p;
+    }
+    close(fd);
+
+    ftcs_parse_stats_t st = { 0 }; // 収集中の統計
+    int rc = scan_lines(ls, config, projected, &st); // 走査結果
+    free(projected);
+    if (rc != 0) {
+        ftcs_lazy_free(ls);
+        return NULL;
+    }
+    // 走査が終わった後はフィールド参照によるランダムアクセスになる
+    if (ls->data) {
+        madvise((void *)ls->data, ls->size, MADV_RANDOM);
+    }
+    if (config->stats) {
+        st.bytes      = ls->size;
+        st.records    = ls->count;
+        st.peak_bytes = ls->cap * (struct_size + sizeof(*ls->line_off)
+                                   + ls->nfields * sizeof(*ls->spans));
+        st.total_ns   = ftcs_now_ns() - t0;
+        *config->stats = st;
+    }
+    return ls;
+}
+
+size_t ftcs_lazy_count(const ftcs_lazy_set_t *ls)
+{
+    return ls ? ls->count : 0;
+}
+
+int ftcs_lazy_field_index(const ftcs_lazy_set_t *ls, const char *field_name)
+{
+    if (!ls || !field_name) {
+        return -1;
+    }
+    for (size_t f = 0; f < ls->nfields; f++) {
+        if (strcmp(ls->mapping[f].field_name, field_name) == 0) {
+            return (int)f;
+        }
+    }
+    return -1;
+}
+
+const void *ftcs_lazy_field(ftcs_lazy_set_t *ls, size_t i, int field)
+{
+    if (!ls || i >= ls->count || field < 0 || (size_t)field >= ls->nfields) {
+        return NULL;
+    }
+    if (convert(ls, i, (size_t)field) != 0) {
+        return NULL;
+    }
+    return ls->records + i * ls->struct_size + ls->mapping[field].offset;
+}
+
+const void *ftcs_lazy_record(ftcs_lazy_set_t *ls, size_t i)
+{
+    if (!ls || i >= ls->count) {
+        return NULL;
+    }
+    for (size_t f = 0; f < ls->nfields; f++) {
+        if (convert(ls, i, f) != 0) {
+            return NULL;
+        }
+    }
+    return ls->records + i * ls->struct_size;
+}
+
+void ftcs_lazy_free(ftcs_lazy_set_t *ls)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!ls) {
+        return;
+    }
+    if (ls->data) {
+        munmap((void *)ls->data, ls->size);
+    }
+    free(ls->records);
+    free(ls->line_off);
+    free(ls->spans);
+    free(ls);
+}
+
+/**
+ * @brief mmap したファイルを行に分けて走査し、各レコード行の値の位置を記録する
+ *
+ * @param ls        記録先の遅延レコード集合
+ * @param config    パーサー設定（コメント文字・区切り文字列を参照する）
+ * @param projected マッピングエントリごとの記録要否（NULL なら全フィールド）
+ * @param st        件数の加算先
+ * @return 成功時 0、解析エラー・確保失敗時 -1
+ */
+static int scan_lines(ftcs_lazy_set_t *ls, const ftcs_parser_config_t *config,
+                      const unsigned char *projected, ftcs_parse_stats_t *st)
+{
+    char        comment = config->comment_char ? config->comment_char : '#'; // コメント行の先頭文字
+    const char *p       = ls->data;            // 未処理部分の先頭
+    const char *end     = ls->data + ls->size; // ファイル終端
+
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p)); // 行末（改行なしの最終行はファイル終端）
+        const char *le = nl ? nl : end;                       // 行の終端
+        st->lines++;
+
+        // trim と同じく先頭の空白と末尾の空白・CR を除いて判定する
+        const char *b = p;  // 行の実質的な先頭
+        const char *e = le; // 行の実質的な終端
+        while (b < e && is_blank(*b)) {
+            b++;
+        }
+        while (e > b && (is_blank(e[-1]) || e[-1] == '\r')) {
+            e--;
+        }
+        if (b == e) {
+            st->empty_lines++;
+        } else if (*b == comment) {
+            st->comments++;
+        } else if (scan_line(ls, b, e, config->kv_separator, projected, st) != 0) {
+            return -1;
+        }
+        p = le + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 1行の KEY=VALUE トークンを走査し、マッピング上のフィールドの値の位置を記録する
+ *
+ * parse_line_kv と同じく、空白・タブで区切ったトークンを区切り文字列の最初の出現で分け、
+ * 同じキーが複数回現れた場合は後のものを採る。
+ *
+ * @param ls        記録先の遅延レコード集合
+ * @param line      行の先頭（空白除去済み）
+ * @param end       行の終端
+ * @param kv_sep    キーと値の区切り文字列
+ * @param projected マッピングエントリごとの記録要否（NULL なら全フィールド）
+ * @param st        未知キー数の加算先
+ * @return 成功時 0、区切り文字のないトークン・確保失敗時 -1
+ */
+static int scan_line(ftcs_lazy_set_t *ls, const char *line, const char *end,
+                     const char *kv_sep, const unsigned char *projected,
+                     ftcs_parse_stats_t *st)
+{
+    if (ls->count == ls->cap && lazy_grow(ls) != 0) {
+        return -1;
+    }
+    size_t       sep_len = strlen(kv_sep);                          // 区切り文字列の長さ
+    lazy_span_t *spans   = ls->spans + ls->count * ls->nfields;     // このレコードの値の位置
+    for (size_t f = 0; f < ls->nfields; f++) {
+        spans[f].off = 0;
+        spans[f].len = SPAN_ABSENT;
+    }
+    memset(ls->records + ls->count * ls->struct_size, 0, ls->struct_size);
+
+    const char *p = line; // 未処理部分の先頭
+    while (p < end) {
+        const char *tok = p; // トークンの先頭
+        while (p < end && !is_blank(*p)) {
+            p++;
+        }
+        const char *tok_end = p; // トークンの終端
+        while (p < end && is_blank(*p)) {
+            p++;
+        }
+
+        const char *sep = memmem(tok, (size_t)(tok_end - tok), kv_sep, sep_len); // 区切り位置
+        if (!sep) {
+            fprintf(stderr, "ftcs: 不正なトークン（区切り文字 '%s' がない）: %.*s\n",
+                    kv_sep, (int)(tok_end - tok), tok);
+            return -1;
+        }
+        size_t key_len = (size_t)(sep - tok); // キーのバイト数
+        size_t f       = 0;                   // キーに対応するフィールド番号
+        while (f < ls->nfields
+               && (strncmp(ls->mapping[f].field_name, tok, key_len) != 0
+                   || ls->mapping[f].field_name[key_len] != '\0')) {
+            f++;
+        }
+        if (f == ls->nfields) {
+            st->unknown_keys++;
+            continue;
+        }
+        // projection 外のフィールドは位置も記録せずゼロのまま残す
+        if (projected && !projected[f]) {
+            continue;
+        }
+        spans[f].off = (uint32_t)(sep + sep_len - line);
+        spans[f].len = (uint32_t)(tok_end - (sep + sep_len));
+    }
+    ls->line_off[ls->count] = (size_t)(line - ls->data);
+    ls->count++;
+    return 0;
+}
+
+/**
+ * @brief レコード配列・行位置・値の位置の各配列を2倍に拡張する
+ *
+ * @param ls 拡張対象の遅延レコード集合
+ * @return 成功時 0、realloc 失敗時 -1
+ */
+static int lazy_grow(ftcs_lazy_set_t *ls)
+{
+    size_t new_cap = ls->cap ? ls->cap * 2 : LAZY_INITIAL_CAPACITY; // 拡張後の件数
+    char *records = realloc(ls->records, new_cap * ls->struct_size); // 拡張後のレコード配列
+    if (!records) {
+        perror("ftcs: realloc");
+        return -1;
+    }
+    ls->records = records;
+    size_t *line_off = realloc(ls->line_off, new_cap * sizeof(*line_off)); // 拡張後の行位置
+    if (!line_off) {
+        perror("ftcs: realloc");
+        return -1;
+    }
+    ls->line_off = line_off;
+    lazy_span_t *spans = realloc(ls->spans, new_cap * ls->nfields * sizeof(*spans)); // 拡張後の値の位置
+    // フィールド数 0 のマッピングでは realloc が NULL を返しうるが、その場合は使わない
+    if (!spans && ls->nfields > 0) {
+        perror("ftcs: realloc");
+        return -1;
+    }
+    ls->spans = spans;
+    ls->cap   = new_cap;
+    return 0;
+}
+
+/**
+ * @brief i 番目のレコードのフィールド f が未変換なら、記録した位置の値を変換する
+ *
+ * @param ls 遅延レコード集合
+ * @param i  0-based のレコード位置
+ * @param f  フィールド番号
+ * @return 成功時 0、型変換失敗・確保失敗時 -1
+ */
+static int convert(ftcs_lazy_set_t *ls, size_t i, size_t f)
+{
+    lazy_span_t *span = &ls->spans[i * ls->nfields + f]; // 値の位置
+    // 変換済みまたは値がないフィールドはレコード内の値（ゼロ含む）をそのまま使う
+    if (span->len == SPAN_DONE || span->len == SPAN_ABSENT) {
+        return 0;
+    }
+    const ftcs_field_mapping_t *m   = &ls->mapping[f];                         // 変換対象のエントリ
+    const char                 *val = ls->data + ls->line_off[i] + span->off; // 値の先頭（NUL 終端なし）
+    char                       *rec = ls->records + i * ls->struct_size;      // 書き込み先のレコード
+
+    // 文字列はバッファを介さず直接写す（set_field と同じく容量に切り詰める）
+    if (m->type == FTCS_TYPE_STRING) {
+        size_t n = span->len < m->size - 1 ? span->len : m->size - 1; // 写すバイト数
+        memcpy(rec + m->offset, val, n);
+        rec[m->offset + n] = '\0';
+        span->len = SPAN_DONE;
+        return 0;
+    }
+
+    // 数値変換は NUL 終端が必要なため一時バッファに写す
+    char  buf[LAZY_VALUE_BUF_SIZE]; // 短い値用の一時バッファ
+    char *tmp = buf;                // 実際に使う一時バッファ
+    if (span->len >= sizeof(buf)) {
+        tmp = malloc((size_t)span->len + 1);
+        if (!tmp) {
+            perror("ftcs: malloc");
+            return -1;
+        }
+    }
+    memcpy(tmp, val, span->len);
+    tmp[span->len] = '\0';
+    int rc = ftcs_field_set(rec, m, tmp); // 変換結果
+    if (tmp != buf) {
+        free(tmp);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+    span->len = SPAN_DONE;
+    return 0;
+}
+
+/**
+ * @brief 空白またはタブかを返す
+ * @param c 判定する文字
+ * @return 空白・タブなら非ゼロ
+ */
+static int is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ftcs_internal.h"
+
+// スナップショットのヘッダー領域のバイト数。レコード配列を 4KiB ページ境界から始め、
+// 書き戻し・マップからの切り離しがヘッダーとレコードの境界で端数にならないようにする。
+#define HEADER_SIZE 4096
+
+// スナップショットの識別子。ftcs_mapfile_commit() が最後に書くので、確定前のファイルには現れない。
+#define SNAPSHOT_MAGIC "FTCSSNP1"
+
+// --- 内部型定義 ---
+
+/**
+ * @brief ファイル先頭に置くスナップショットのヘッダー（残りのヘッダー領域はゼロ）
+ */
+typedef struct {
+    char     magic[8];    /**< SNAPSHOT_MAGIC（NUL 終端なし） */
+    uint64_t struct_size; /**< 1レコードのバイトサイズ */
+    uint64_t count;       /**< レコード数 */
+} snapshot_header_t;
+
+// --- 関数宣言（目次） ---
+
+static void *mapfile_alloc(void *ctx, size_t size);                                   // 出力ファイルを伸ばしてマップする
+static void *mapfile_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size); // ftruncate + mremap で伸縮する
+static void  mapfile_free(void *ctx, void *ptr, size_t size);                         // マップを外す
+static void  write_back(ftcs_mapfile_t *mf, size_t filled);                           // 埋まった範囲を書き戻す
+static void *snapshot_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size); // 匿名マップに写して伸縮する
+static void  snapshot_free(void *ctx, void *ptr, size_t size);                        // スナップショットのマップを外す
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+int ftcs_mapfile_create(ftcs_mapfile_t *mf, const char *path)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!mf || !path) {
+        fprintf(stderr, "ftcs: ftcs_mapfile_create に NULL 引数が渡された\n");
+        return -1;
+    }
+    memset(mf, 0, sizeof(*mf));
+    mf->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mf->fd < 0) {
+        fprintf(stderr, "ftcs: '%s' を作れない: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+ftcs_allocator_t ftcs_mapfile_allocator(ftcs_mapfile_t *mf)
+{
+    ftcs_allocator_t a = { mapfile_alloc, mapfile_realloc, mapfile_free, mf }; // 出力ファイルを ctx に持つアロケーター
+    return a;
+}
+
+int ftcs_mapfile_commit(ftcs_mapfile_t *mf, ftcs_record_set_t *rs)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!mf || !rs) {
+        fprintf(stderr, "ftcs: ftcs_mapfile_commit に NULL 引数が渡された\n");
+        return -1;
+    }
+    if (!mf->base || rs->allocator.ctx != mf || (char *)rs->records != mf->base + HEADER_SIZE) {
+        fprintf(stderr, "ftcs: レコード集合はこの出力ファイルのアロケーターで確保されていない\n");
+        return -1;
+    }
+
+    // 未使用のスロットを切り落とし、ファイルサイズをレコード数に合わせる
+    size_t bytes = rs->count * rs->struct_size; // 確定するレコード配列のバイト数
+    void  *records = mapfile_realloc(mf, rs->records, rs->capacity * rs->struct_size, bytes); // 切り詰め後のレコード配列
+    if (!records) {
+        return -1;
+    }
+    rs->records  = records;
+    rs->capacity = rs->count;
+
+    // レコードを書き終えてからヘッダーを書き、確定前のファイルを読まないようにする
+    if (msync(mf->base, mf->len, MS_SYNC) != 0) {
+        perror("ftcs: msync");
+        return -1;
+    }
+    snapshot_header_t hdr = { .struct_size = rs->struct_size, .count = rs->count }; // 書き込むヘッダー
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+    memcpy(mf->base, &hdr, sizeof(hdr));
+    if (msync(mf->base, HEADER_SIZE, MS_SYNC) != 0) {
+        perror("ftcs: msync");
+        return -1;
+    }
+    return 0;
+}
+
+void ftcs_mapfile_close(ftcs_mapfile_t *mf)
+{
+    // マップは fd を閉じても有効なので、base / len はレコード集合の解放まで残す
+    if (mf && mf->fd >= 0) {
+        close(mf->fd);
+        mf->fd = -1;
+    }
+}
+
+ftcs_record_set_t *ftcs_snapshot_open(const char *path, size_t struct_size)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!path || struct_size == 0) {
+        fprintf(stderr, "ftcs: ftcs_snapshot_open に不正な引数が渡された\n");
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY); // スナップショットのファイル
+    if (fd < 0) {
+        fprintf(stderr, "ftcs: '%s' を開けない: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    struct stat       st;  // ファイルの状態（サイズの検査に使う）
+    snapshot_header_t hdr; // 読み込んだヘッダー
+    if (fstat(fd, &st) != 0 || pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)
+        || memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) != 0) {
+        fprintf(stderr, "ftcs: '%s' は確定済みのスナップショットではない\n", path);
+        close(fd);
+        return NULL;
+    }
+    if (hdr.struct_size != struct_size || hdr.count > (SIZE_MAX - HEADER_SIZE) / struct_size
+        || (uint64_t)st.st_size != HEADER_SIZE + hdr.count * struct_size) {
+        fprintf(stderr, "ftcs: '%s' の struct_size (%llu) / レコード数 (%llu) がファイルと合わない\n",
+                path, (unsigned long long)hdr.struct_size, (unsigned long long)hdr.count);
+        close(fd);
+        return NULL;
+    }
+
+    size_t len  = (size_t)st.st_size; // マップするバイト数
+    char  *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0); // ファイルの私的マップ
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("ftcs: mmap");
+        return NULL;
+    }
+    ftcs_record_set_t *rs = calloc(1, sizeof(*rs)); // 返すレコード集合
+    if (!rs) {
+        perror("ftcs: calloc");
+        munmap(base, len);
+        return NULL;
+    }
+    rs->records     = base + HEADER_SIZE;
+    rs->count       = (size_t)hdr.count;
+    rs->capacity    = (size_t)hdr.count;
+    rs->struct_size = struct_size;
+    rs->allocator.realloc_fn = snapshot_realloc;
+    rs->allocator.free_fn    = snapshot_free;
+    return rs;
+}
+
+// --- 出力ファイルのアロケーター ---
+
+/**
+ * @brief 出力ファイルをヘッダー + size バイトに伸ばし、共有マップする
+ *
+ * @param ctx  ftcs_mapfile_t へのポインタ
+ * @param size 確保するバイト数
+ * @return ヘッダーの直後（レコード配列の先頭）、失敗時 NULL
+ */
+static void *mapfile_alloc(void *ctx, size_t size)
+{
+    ftcs_mapfile_t *mf = ctx; // 出力ファイル
+    if (mf->fd < 0 || mf->base) {
+        fprintf(stderr, "ftcs: 出力ファイルが閉じているか、すでにレコード配列を置いている\n");
+        return NULL;
+    }
+    size_t len = HEADER_SIZE + size; // ファイルサイズ兼マップのバイト数
+    if (ftruncate(mf->fd, (off_t)len) != 0) {
+        perror("ftcs: ftruncate");
+        return NULL;
+    }
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, mf->fd, 0); // 出力ファイルの共有マップ
+    if (p == MAP_FAILED) {
+        perror("ftcs: mmap");
+        return NULL;
+    }
+    mf->base    = p;
+    mf->len     = len;
+    mf->flushed = 0;
+    mf->dropped = 0;
+    return mf->base + HEADER_SIZE;
+}
+
+/**
+ * @brief ファイルサイズを変えて mremap でマップを伸縮する（データはコピーしない）
+ *
+ * 拡張の前に、それまでに埋まった old_size バイトの書き戻しを進める。
+ * マップがファイル末尾を越えないよう、伸ばすときはファイルを先に、縮めるときはマップを先に変える。
+ *
+ * @param ctx      ftcs_mapfile_t へのポインタ
+ * @param ptr      伸縮対象のレコード配列（mf が管理するマップの中）
+ * @param old_size 現在のバイト数
+ * @param new_size 新しいバイト数
+ * @return 伸縮後のレコード配列、失敗時 NULL（ptr は有効なまま）
+ */
+static void *mapfile_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    (void)ptr;
+    ftcs_mapfile_t *mf  = ctx;                    // 出力ファイル
+    size_t          len = HEADER_SIZE + new_size; // 伸縮後のファイルサイズ
+    write_back(mf, old_size);
+    if (len > mf->len && ftruncate(mf->fd, (off_t)len) != 0) {
+        perror("ftcs: ftruncate");
+        return NULL;
+    }
+    void *p = mremap(mf->base, mf->len, len, MREMAP_MAYMOVE); // 伸縮後のマップ
+    if (p == MAP_FAILED) {
+        perror("ftcs: mremap");
+        return NULL;
+    }
+    // 縮めた場合は切り落とした分をファイルからも除く（失敗してもマップの範囲は正しい）
+    if (len < mf->len && ftruncate(mf->fd, (off_t)len) != 0) {
+        perror("ftcs: ftruncate");
+    }
+    mf->base = p;
+    mf->len  = len;
+    if (mf->flushed > len) {
+        mf->flushed = len;
+    }
+    if (mf->dropped > len) {
+        mf->dropped = len;
+    }
+    return mf->base + HEADER_SIZE;
+}
+
+/**
+ * @brief 出力ファイルのマップを外す
+ *
+ * @param ctx  ftcs_mapfile_t へのポインタ
+ * @param ptr  レコード配列（未使用。マップ全体は mf が持つ）
+ * @param size レコード配列のバイト数（未使用）
+ */
+static void mapfile_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ptr;
+    (void)size;
+    ftcs_mapfile_t *mf = ctx; // 出力ファイル
+    munmap(mf->base, mf->len);
+    mf->base = NULL;
+    mf->len  = 0;
+}
+
+/**
+ * @brief レコード配列の埋まった範囲の書き戻しを開始し、前回開始した範囲をマップから外す
+ *
+ * 共有ファイルマップの汚れたページはプロセスのメモリとして残り続けるので、拡張のたびに
+ * 書き戻しを非同期で開始しておく。前回開始した範囲は完了を待って MADV_DONTNEED で外す
+ * （共有マップなので内容はページキャッシュとファイルに残り、再び触れれば読み直される）。
+ * どちらも失敗してもデータは失われないので、エラーは無視する。
+ *
+ * @param mf     出力ファイル
+ * @param filled レコード配列の先頭から埋まっているバイト数
+ */
+static void write_back(ftcs_mapfile_t *mf, size_t filled)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);        // ページサイズ
+    size_t end  = (HEADER_SIZE + filled) / page * page; // 書き戻す範囲の終端（ファイル先頭から、ページ単位）
+    if (end > mf->flushed) {
+        (void)sync_file_range(mf->fd, (off_t)mf->flushed, (off_t)(end - mf->flushed),
+                              SYNC_FILE_RANGE_WRITE);
+    }
+    if (mf->flushed > mf->dropped) {
+        (void)sync_file_range(mf->fd, (off_t)mf->dropped, (off_t)(mf->flushed - mf->dropped),
+                              SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE
+                              | SYNC_FILE_RANGE_WAIT_AFTER);
+        (void)madvise(mf->base + mf->dropped, mf->flushed - mf->dropped, MADV_DONTNEED);
+        mf->dropped = mf->flushed;
+    }
+    if (end > mf->flushed) {
+        mf->flushed = end;
+    }
+}
+
+// --- スナップショットのレコード集合 ---
+
+/**
+ * @brief スナップショットのレコード配列を匿名マップに写して伸縮する
+ *
+ * 私的ファイルマップはファイル末尾を越えて伸ばせないので、同じくヘッダー領域を前に置いた
+ * 匿名マップに写す（解放は snapshot_free のまま行える）。
+ *
+ * @param ctx      未使用
+ * @param ptr      伸縮対象のレコード配列
+ * @param old_size 現在のバイト数
+ * @param new_size 新しいバイト数
+ * @return 伸縮後のレコード配列、失敗時 NULL（ptr は有効なまま）
+ */
+static void *snapshot_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    (void)ctx;
+    char *p = mmap(NULL, HEADER_SIZE + new_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); // 写し先の匿名マップ
+    if (p == MAP_FAILED) {
+        perror("ftcs: mmap");
+        return NULL;
+    }
+    memcpy(p + HEADER_SIZE, ptr, old_size < new_size ? old_size : new_size);
+    munmap((char *)ptr - HEADER_SIZE, HEADER_SIZE + old_size);
+    return p + HEADER_SIZE;
+}
+
+/**
+ * @brief スナップショットのレコード配列をヘッダー領域ごとマップから外す
+ *
+ * @param ctx  未使用
+ * @param ptr  レコード配列
+ * @param size レコード配列のバイト数
+ */
+static void snapshot_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx;
+    munmap((char *)ptr - HEADER_SIZE, HEADER_SIZE + size);
+}
@@ -0,0 +1,83 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ftcs_internal.h"
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 1スレッド分の実行単位
+ */
+typedef struct {
+    pthread_t   tid;            /**< スレッド ID */
+    int         started;        /**< スレッドを作れたか */
+    void      (*run)(void *);   /**< 実行する関数 */
+    void       *task;           /**< run に渡す要素 */
+} parallel_slot_t;
+
+// --- 関数宣言（目次） ---
+
+static void *slot_main(void *arg); // スレッドの本体
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+size_t ftcs_parallel_threads(size_t n, size_t min_per_thread)
+{
+    size_t t = n / min_per_thread; // レコード数から見たスレッド数
+    if (t <= 1) {
+        return 1;
+    }
+    long cores = sysconf(_SC_NPROCESSORS_ONLN); // 使えるコア数
+    if (cores > 0 && t > (size_t)cores) {
+        t = (size_t)cores;
+    }
+    if (t > FTCS_MAX_THREADS) {
+        t = FTCS_MAX_THREADS;
+    }
+    return t;
+}
+
+int ftcs_run_parallel(void *tasks, size_t ntasks, size_t task_size, void (*run)(void *task))
+{
+    parallel_slot_t *slots = calloc(ntasks, sizeof(*slots)); // 各要素の実行単位
+    if (!slots) {
+        perror("ftcs: calloc");
+        return -1;
+    }
+    for (size_t i = 0; i < ntasks; i++) {
+        slots[i].run  = run;
+        slots[i].task = (char *)tasks + i * task_size;
+    }
+    // 先頭の要素は呼び出しスレッドが受け持つ
+    for (size_t i = 1; i < ntasks; i++) {
+        slots[i].started = pthread_create(&slots[i].tid, NULL, slot_main, &slots[i]) == 0;
+    }
+    for (size_t i = 0; i < ntasks; i++) {
+        if (!slots[i].started) {
+            run(slots[i].task);
+        }
+    }
+    for (size_t i = 1; i < ntasks; i++) {
+        if (slots[i].started) {
+            pthread_join(slots[i].tid, NULL);
+        }
+    }
+    free(slots);
+    return 0;
+}
+
+/**
+ * @brief スレッドの本体
+ * @param arg 実行単位（parallel_slot_t）
+ * @return 常に NULL
+ */
+static void *slot_main(void *arg)
+{
+    parallel_slot_t *s = arg; // 実行単位
+    s->run(s->task);
+    return NULL;
+}
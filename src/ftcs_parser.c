@@ -4,6 +4,7 @@
 #include <string.h>
 #include <errno.h>
 #include "ftcs.h"
+#include "ftcs_internal.h"
 
 // 設定ファイルの1行として想定する最大バイト数。
 // 実用的な KV ファイルではこのサイズを超えることはほぼない。
@@ -12,34 +13,269 @@
 // 初期確保スロット数。大半のユースケースで再アロケートが不要な値として経験的に選択。
 #define INITIAL_CAPACITY 16
 
+// ブロック境界をまたぐ行の持ち越しバッファ初期サイズ。通常の行長なら再確保は起きない。
+#define CARRY_INITIAL_SIZE LINE_BUF_SIZE
+
+// フェーズ別の時間計測を行う間隔（行数）。clock_gettime はトークンごとに3回呼ぶため、
+// 全行で計測するとパース時間そのものが倍近くになる。1/16 の抽出なら誤差は小さく負荷は数%に収まる。
+#define STATS_SAMPLE_INTERVAL 16
+
+// 時刻取得コストの見積もりに使う計測回数（最小値を採るので少数で十分）
+#define CLOCK_CALIBRATION_ROUNDS 64
+
+// parse_line_kv の戻り値: フィルタ式でレコードを棄却した（エラーではない）
+#define LINE_REJECTED 1
+
+// 順次モードで config->ring へまとめて書き込む件数。1件ずつ公開すると眠っている消費者を
+// レコードごとに起こすことになり、CPU が少ない環境では切り替えのコストがパースを上回る。
+// 64 件なら最初のレコードが届くまでの遅れは数十マイクロ秒に収まる。
+#define RING_PUSH_BATCH 64
+
 // --- 関数宣言（目次） ---
 
-static int   parse_line_kv(char *line, const char *kv_sep,
-                            const ftcs_field_mapping_t *mapping, void *out); // 1行を構造体に書き込む
+static ftcs_record_set_t *parse_stdio(const char *filepath, ftcs_parse_ctx_t *ctx); // fgets で1行ずつパースする
+static ftcs_record_set_t *parse_blocks(const char *filepath, ftcs_parse_ctx_t *ctx); // ブロックリーダーでパースする
+static int   carry_append(ftcs_parse_ctx_t *ctx, const char *p, size_t len);   // 持ち越しバッファに追記する
+static int   positions_push(ftcs_parse_ctx_t *ctx, size_t pos);               // 配置位置を記録する（配置委譲時）
+static int   ring_push(ftcs_parse_ctx_t *ctx, const void *recs, size_t n);   // 格納したレコードをリングへ書き込む
+static int   ring_flush(ftcs_parse_ctx_t *ctx, size_t min);                  // 順次モードで溜めたレコードをリングへ書き込む
+static int   parse_line_kv(ftcs_parse_ctx_t *ctx, char *line, void *out);    // 1行を構造体に書き込む（フィルタ判定つき）
+static uint64_t stats_lap(const ftcs_parse_ctx_t *ctx, uint64_t *acc, uint64_t prev); // フェーズ時間を累積する
+static uint64_t clock_overhead_ns(void);                     // 時刻取得1回分のコストを見積もる
+static const ftcs_field_mapping_t *predict_mapping(ftcs_parse_ctx_t *ctx, size_t pos, const char *key,
+                                                    size_t len);              // 直前の行のキー順で予測して引く
 static const ftcs_field_mapping_t *find_mapping(const ftcs_field_mapping_t *mapping,
                                                  const char *name);           // フィールド名でエントリを検索する
 static int   set_field(void *out, const ftcs_field_mapping_t *m, const char *val); // 文字列値を構造体フィールドに書き込む
+static int   set_array(char *dst, const ftcs_field_mapping_t *m, const char *val); // カンマ区切りの値を配列に書き込む
+static const char *next_elem(const char *p, const char *end);                 // 配列の次の要素へ進む
+static size_t elem_size(ftcs_field_type_t type);                              // 配列要素1個のバイトサイズ
 static char *trim(char *s);                                                   // 先頭・末尾の空白を除去する
-static int   record_set_grow(ftcs_record_set_t *rs);                          // 順次追加モード用の容量拡張
-static int   record_set_ensure(ftcs_record_set_t *rs, size_t required);       // インデックスモード用の容量確保
+static int   record_set_grow(ftcs_parse_ctx_t *ctx);                          // 順次追加モード用の容量拡張
+static int   record_set_ensure(ftcs_parse_ctx_t *ctx, size_t required);       // インデックスモード用の容量確保
+static int   record_set_resize(ftcs_parse_ctx_t *ctx, size_t new_cap);        // レコード配列を再確保する
 static int   extract_field_int(const char *line, const char *kv_sep,
                                const char *field_name, long *out_val);        // 指定フィールドの整数値を抽出する
+static int   route_line(const ftcs_parse_ctx_t *ctx, const char *line);      // 行を振り分けるスキーマを決める
 
 // --- 関数定義（概要→詳細の順） ---
 
+/**
+ * @brief fgets で1行ずつ読み込んでパースする（FTCS_IO_STDIO）
+ *
+ * @param filepath 入力ファイルのパス
+ * @param ctx      初期化済みのパースコンテキスト
+ * @return 成功時レコード集合、失敗時 NULL
+ */
+static ftcs_record_set_t *parse_stdio(const char *filepath, ftcs_parse_ctx_t *ctx)
+{
+    FILE *fp = fopen(filepath, "r"); // 入力ファイルのストリーム
+    // ファイルが開けない場合は strerror で詳細を表示する
+    if (!fp) {
+        fprintf(stderr, "ftcs: '%s' を開けない: %s\n", filepath, strerror(errno));
+        return NULL;
+    }
+
+    char line[LINE_BUF_SIZE]; // 1行読み込みバッファ
+    // fgets 1回は短いため、行の計測と同じ間隔で抽出して読み込み時間を見積もる
+    int      timed = ctx->stats != NULL;     // 今回の fgets を計測するか
+    uint64_t t0    = timed ? ftcs_now_ns() : 0; // 計測開始時刻
+    // ファイルを1行ずつ読み込んで構造体に変換する
+    while (fgets(line, sizeof(line), fp)) {
+        if (timed) {
+            ctx->st.io_ns += ftcs_now_ns() - t0;
+        }
+        ctx->st.bytes += strlen(line);
+        if (ftcs_ctx_line(ctx, line) != 0) {
+            fclose(fp);
+            return NULL;
+        }
+        timed = ctx->stats != NULL && ctx->st.lines % STATS_SAMPLE_INTERVAL == 0;
+        if (timed) {
+            t0 = ftcs_now_ns();
+        }
+    }
+
+    fclose(fp);
+    // 抽出計測した fgets 時間を全行分に換算する
+    if (ctx->st.lines > 0) {
+        ctx->st.io_ns = ctx->st.io_ns * ctx->st.lines
+                        / (ctx->st.lines / STATS_SAMPLE_INTERVAL + 1);
+    }
+    // 持ち越しは空なので、リングへ溜めた分を書き込むだけになる
+    if (ftcs_ctx_finish(ctx) != 0) {
+        return NULL;
+    }
+    return ftcs_ctx_take(ctx);
+}
+
+/**
+ * @brief ブロックリーダーで先読みしながらパースする（FTCS_IO_URING / FTCS_IO_PREAD）
+ *
+ * 読み込み要求を複数発行したままパースを進めるため、ストレージが遊ばない。
+ *
+ * @param filepath 入力ファイルのパス
+ * @param ctx      初期化済みのパースコンテキスト
+ * @return 成功時レコード集合、失敗時 NULL
+ */
+static ftcs_record_set_t *parse_blocks(const char *filepath, ftcs_parse_ctx_t *ctx)
+{
+    ftcs_reader_t *r = ftcs_reader_open(filepath, ctx->config->io_backend); // ブロックリーダー
+    if (!r) {
+        return NULL;
+    }
+
+    char   *block; // 読み込み済みブロック（リーダー内部バッファ）
+    ssize_t n;     // ブロックのバイト数
+    // EOF（0）またはエラー（-1）までブロックを順に処理する
+    for (;;) {
+        // ブロック取得はまれで重いため毎回計測する（先読みが間に合っていれば待ち時間はほぼゼロ）
+        uint64_t t0 = ctx->stats ? ftcs_now_ns() : 0; // 待ち開始時刻
+        n = ftcs_reader_next(r, &block);
+        if (ctx->stats) {
+            ctx->st.io_ns += ftcs_now_ns() - t0;
+        }
+        if (n <= 0) {
+            break;
+        }
+        ctx->st.bytes += (size_t)n;
+        if (ftcs_ctx_feed(ctx, block, (size_t)n) != 0) {
+            ftcs_reader_close(r);
+            return NULL;
+        }
+    }
+    ftcs_reader_close(r);
+
+    // 読み込みエラーまたは最終行の解析エラー
+    if (n < 0 || ftcs_ctx_finish(ctx) != 0) {
+        return NULL;
+    }
+    return ftcs_ctx_take(ctx);
+}
+
+/**
+ * @brief 持ち越しバッファにバイト列を追記する（NUL 終端用の1バイトを常に確保）
+ *
+ * @param ctx パースコンテキスト
+ * @param p   追記するバイト列
+ * @param len 追記するバイト数
+ * @return 成功時 0、realloc 失敗時 -1
+ */
+static int carry_append(ftcs_parse_ctx_t *ctx, const char *p, size_t len)
+{
+    // 容量不足の場合は2倍ずつ拡張する（非常に長い行にも対応するため上限は設けない）
+    if (ctx->carry_len + len + 1 > ctx->carry_cap) {
+        size_t new_cap = ctx->carry_cap ? ctx->carry_cap : CARRY_INITIAL_SIZE; // 拡張後の容量
+        while (new_cap < ctx->carry_len + len + 1) {
+            new_cap *= 2;
+        }
+        char *new_buf = realloc(ctx->carry, new_cap); // 拡張後のバッファ
+        if (!new_buf) {
+            perror("ftcs: realloc");
+            return -1;
+        }
+        ctx->carry     = new_buf;
+        ctx->carry_cap = new_cap;
+    }
+    memcpy(ctx->carry + ctx->carry_len, p, len);
+    ctx->carry_len += len;
+    return 0;
+}
+
+/**
+ * @brief 配置を後段に委ねるモードで、直前に格納したレコードの配置位置を記録する
+ *
+ * @param ctx パースコンテキスト
+ * @param pos 0-based の配置位置
+ * @return 成功時 0、realloc 失敗時 -1
+ */
+static int positions_push(ftcs_parse_ctx_t *ctx, size_t pos)
+{
+    // 容量不足の場合は2倍に拡張する
+    if (ctx->positions_len == ctx->positions_cap) {
+        size_t  new_cap = ctx->positions_cap ? ctx->positions_cap * 2 : INITIAL_CAPACITY; // 拡張後の容量
+        size_t *new_buf = realloc(ctx->positions, new_cap * sizeof(*new_buf));            // 拡張後の配列
+        if (!new_buf) {
+            perror("ftcs: realloc");
+            return -1;
+        }
+        ctx->positions     = new_buf;
+        ctx->positions_cap = new_cap;
+    }
+    ctx->positions[ctx->positions_len++] = pos;
+    return 0;
+}
+
+/**
+ * @brief 格納したレコードを config->ring へ書き込む（リングがなければ何もしない）
+ *
+ * 消費者が読み進めて空きができるまで待つ。
+ *
+ * @param ctx  パースコンテキスト
+ * @param recs 格納したレコードの連続配列
+ * @param n    レコード数
+ * @return 成功時 0、リングがクローズ済みなら -1
+ */
+static int ring_push(ftcs_parse_ctx_t *ctx, const void *recs, size_t n)
+{
+    if (!ctx->config->ring || n == 0) {
+        return 0;
+    }
+    if (ftcs_shm_ring_push(ctx->config->ring, recs, n, -1) != (long)n) {
+        fprintf(stderr, "ftcs: レコードをリングに書き込めない\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 順次モードで ring_from 以降に格納したレコードが min 件以上あればリングへ書き込む
+ *
+ * 順次モードのレコードは records に連続して並ぶため、溜めた分を1回の公開で渡せる。
+ * 振り分け先のスキーマのコンテキストも書き込む。
+ *
+ * @param ctx パースコンテキスト
+ * @param min 書き込む最小件数（1 なら溜めた分をすべて書き込む）
+ * @return 成功時 0、リングへの書き込み失敗時 -1
+ */
+static int ring_flush(ftcs_parse_ctx_t *ctx, size_t min)
+{
+    for (size_t i = 0; i < ctx->nroutes; i++) {
+        if (ring_flush(&ctx->routes[i], min) != 0) {
+            return -1;
+        }
+    }
+    // 配置位置指定モードは格納のたびに書き込んでいる
+    if (!ctx->config->ring || ctx->use_index_field || !ctx->rs
+        || ctx->rs->count - ctx->ring_from < min) {
+        return 0;
+    }
+    const ftcs_record_set_t *rs = ctx->rs; // 構築中のレコード集合
+    size_t from = ctx->ring_from;          // 未書き込みの先頭レコード位置
+    ctx->ring_from = rs->count;
+    return ring_push(ctx, (const char *)rs->records + from * rs->struct_size, rs->count - from);
+}
+
 /**
  * @brief 1行分のスペース区切り KEY=VALUE ペアを構造体に書き込む
  *
- * @param line   解析対象の行文字列（インプレース変更される）
- * @param kv_sep キーと値の区切り文字列
- * @param mapping フィールドマッピングテーブル
- * @param out    書き込み先の構造体ポインタ
- * @return 成功時 0、解析エラー時 -1
+ * 統計の抽出対象行では、トークン分割・キー検索・値変換の各フェーズの時間を計る。
+ * フィルタ式がある場合は、フィールドを変換するたびにそのフィールドの項を判定し、
+ * 満たさなければ残りのトークンを解析せずに棄却する。
+ *
+ * @param ctx  パースコンテキスト（区切り文字・マッピング・統計・フィルタを参照する）
+ * @param line 解析対象の行文字列（インプレース変更される）
+ * @param out  書き込み先の構造体ポインタ
+ * @return 成功時 0、フィルタで棄却した場合 LINE_REJECTED、解析エラー時 -1
  */
-static int parse_line_kv(char *line, const char *kv_sep,
-                         const ftcs_field_mapping_t *mapping, void *out)
+static int parse_line_kv(ftcs_parse_ctx_t *ctx, char *line, void *out)
 {
-    size_t sep_len = strlen(kv_sep); // 区切り文字列の長さ（strstr 後のポインタ計算に使用）
+    const char *kv_sep  = ctx->config->kv_separator; // キーと値の区切り文字列
+    size_t      sep_len = strlen(kv_sep); // 区切り文字列の長さ（strstr 後のポインタ計算に使用）
+    int         timed   = ctx->sampling;  // この行でフェーズ計測を行うか
+    uint64_t    t       = timed ? ftcs_now_ns() : 0; // 直前のフェーズが終わった時刻
+    uint64_t    decided = 0;              // フィルタ式のうち判定済みの項
+    size_t      pos     = 0;              // 行内のトークン位置（キー順の予測に使う）
     char  *saveptr;                  // strtok_r の状態保持用
     char  *token = strtok_r(line, " \t", &saveptr); // 最初のトークン
 
@@ -56,20 +292,120 @@ static int parse_line_kv(char *line, const char *kv_sep,
         *sep      = '\0';
         char *key = token;          // kv_sep 以前の部分がキー
         char *val = sep + sep_len;  // kv_sep 以降の部分が値
+        if (timed) {
+            t = stats_lap(ctx, &ctx->st.tokenize_ns, t);
+        }
 
-        const ftcs_field_mapping_t *m = find_mapping(mapping, key); // キーに対応するマッピングエントリ
+        const ftcs_field_mapping_t *m = predict_mapping(ctx, pos++, key, (size_t)(sep - token)); // キーに対応するマッピングエントリ
+        if (timed) {
+            t = stats_lap(ctx, &ctx->st.lookup_ns, t);
+        }
         // マッピングに存在するフィールドのみ書き込む（未定義キーは無視）
-        if (m) {
+        // projection 外のフィールドは変換せず、ゼロのまま残す
+        if (m && ctx->projected && !ctx->projected[m - ctx->mapping]) {
+            if (timed) {
+                t = stats_lap(ctx, &ctx->st.convert_ns, t);
+            }
+        } else if (m) {
             if (set_field(out, m, val) != 0) {
                 return -1;
             }
+            // 判定に必要なフィールドが揃った時点で棄却し、残りのフィールドは変換しない
+            int rejected = ctx->filter && ftcs_filter_field(ctx->filter, m, out, &decided); // 棄却するか
+            if (timed) {
+                t = stats_lap(ctx, &ctx->st.convert_ns, t);
+            }
+            if (rejected) {
+                return LINE_REJECTED;
+            }
+        } else if (!ctx->route_key || strcmp(key, ctx->route_key) != 0) {
+            ctx->st.unknown_keys++;
         }
 
         token = strtok_r(NULL, " \t", &saveptr);
     }
+    if (timed) {
+        stats_lap(ctx, &ctx->st.tokenize_ns, t);
+    }
+    if (ctx->filter && ftcs_filter_rest(ctx->filter, out, decided)) {
+        return LINE_REJECTED;
+    }
     return 0;
 }
 
+/**
+ * @brief 前回時刻からの経過時間を累積し、現在時刻を返す
+ *
+ * 短いフェーズでは時刻取得自体のコストが無視できないため、見積もった分を差し引く。
+ *
+ * @param ctx  パースコンテキスト（時刻取得コストの見積もりを参照する）
+ * @param acc  経過時間の累積先
+ * @param prev 前回時刻
+ * @return 現在時刻（次フェーズの起点）
+ */
+static uint64_t stats_lap(const ftcs_parse_ctx_t *ctx, uint64_t *acc, uint64_t prev)
+{
+    uint64_t now     = ftcs_now_ns(); // 現在時刻
+    uint64_t elapsed = now - prev;    // 前回時刻からの経過時間
+    *acc += elapsed > ctx->clock_ns ? elapsed - ctx->clock_ns : 0;
+    return now;
+}
+
+/**
+ * @brief 連続した時刻取得の間隔から、時刻取得1回分のコストを見積もる
+ *
+ * 割り込み等による外れ値を避けるため、複数回計った最小値を採る。
+ *
+ * @return 時刻取得1回分の見積もりコスト（ナノ秒）
+ */
+static uint64_t clock_overhead_ns(void)
+{
+    uint64_t best = UINT64_MAX; // これまでの最小間隔
+    for (int i = 0; i < CLOCK_CALIBRATION_ROUNDS; i++) {
+        uint64_t a = ftcs_now_ns(); // 1回目の時刻
+        uint64_t b = ftcs_now_ns(); // 2回目の時刻
+        if (b - a < best) {
+            best = b - a;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief 直前の行で同じ位置に現れたキーと照合し、一致すればそのエントリを返す
+ *
+ * 実際のファイルはどの行もキーが同じ順に並ぶため、ほとんどのキーは長さの比較と memcmp 1回で決まる。
+ * 外れたらマッピングを検索し、結果をこの位置の予測として覚え直す（最初の行で学習する）。
+ * マッピングにないキー（複数スキーマの判別キーなど）も写しを覚え、NULL の予測として当てる。
+ *
+ * @param ctx パースコンテキスト（予測と key_hits / key_misses を更新する）
+ * @param pos 行内のトークン位置（0 始まり）
+ * @param key キー文字列（NUL 終端）
+ * @param len キーの長さ
+ * @return 一致エントリへのポインタ、マッピングにないキーなら NULL
+ */
+static const ftcs_field_mapping_t *predict_mapping(ftcs_parse_ctx_t *ctx, size_t pos, const char *key,
+                                                    size_t len)
+{
+    ftcs_key_slot_t *slot = pos < FTCS_KEY_ORDER_SLOTS ? &ctx->key_order[pos] : NULL; // この位置の予測
+    if (slot && slot->known && slot->len == len
+        && memcmp(slot->m ? slot->m->field_name : slot->name, key, len) == 0) {
+        ctx->st.key_hits++;
+        return slot->m;
+    }
+    ctx->st.key_misses++;
+    const ftcs_field_mapping_t *m = find_mapping(ctx->mapping, key); // 検索したエントリ
+    if (slot) {
+        slot->m     = m;
+        slot->len   = len;
+        slot->known = m != NULL || len <= sizeof(slot->name);
+        if (!m && slot->known) {
+            memcpy(slot->name, key, len);
+        }
+    }
+    return m;
+}
+
 /**
  * @brief フィールド名でマッピングエントリを検索する（大文字・小文字を区別）
  *
@@ -157,6 +493,8 @@ static int set_field(void *out, const ftcs_field_mapping_t *m, const char *val)
             return -1;
         }
         break;
+    case FTCS_TYPE_ARRAY:
+        return set_array(base + m->offset, m, val);
     default:
         fprintf(stderr, "ftcs: フィールド '%s' の型が不明\n", m->field_name);
         return -1;
@@ -164,6 +502,127 @@ static int set_field(void *out, const ftcs_field_mapping_t *m, const char *val)
     return 0;
 }
 
+/**
+ * @brief カンマ区切りの値を配列フィールドの先頭要素から順に書き込む
+ *
+ * 要素型ごとの分岐はループの外で1回だけ行い、各要素は変換結果を直接メンバに書く。
+ * 値が要素数より少なければ残りの要素を 0 にする（同じレコードへの再代入でも古い値を残さない）。
+ *
+ * @param dst 配列フィールドの先頭アドレス
+ * @param m   配列フィールドのマッピングエントリ
+ * @param val カンマ区切りの値（空文字列なら全要素 0）
+ * @return 成功時 0、無効な要素・要素数の超過・未対応の要素型なら -1
+ */
+static int set_array(char *dst, const ftcs_field_mapping_t *m, const char *val)
+{
+    size_t esize = elem_size(m->elem_type); // 要素1個のバイトサイズ
+    if (esize == 0) {
+        fprintf(stderr, "ftcs: 配列フィールド '%s' の要素型に対応していない\n", m->field_name);
+        return -1;
+    }
+    size_t      count = m->size / esize; // 要素数
+    size_t      n     = 0;               // 書き込んだ要素数
+    const char *p     = val;             // 次の要素の先頭（無効な要素を見つけたら NULL）
+    char       *end;                     // strtol/strtof の変換終端ポインタ
+
+    switch (m->elem_type) {
+    case FTCS_TYPE_INT:
+        for (int *a = (int *)dst; p && *p && n < count; n++) {
+            a[n] = (int)strtol(p, &end, 10);
+            p    = next_elem(p, end);
+        }
+        break;
+    case FTCS_TYPE_LONG:
+        for (long *a = (long *)dst; p && *p && n < count; n++) {
+            a[n] = strtol(p, &end, 10);
+            p    = next_elem(p, end);
+        }
+        break;
+    case FTCS_TYPE_SHORT:
+        for (short *a = (short *)dst; p && *p && n < count; n++) {
+            a[n] = (short)strtol(p, &end, 10);
+            p    = next_elem(p, end);
+        }
+        break;
+    case FTCS_TYPE_FLOAT:
+        for (float *a = (float *)dst; p && *p && n < count; n++) {
+            a[n] = strtof(p, &end);
+            p    = next_elem(p, end);
+        }
+        break;
+    case FTCS_TYPE_DOUBLE:
+        for (double *a = (double *)dst; p && *p && n < count; n++) {
+            a[n] = strtod(p, &end);
+            p    = next_elem(p, end);
+        }
+        break;
+    case FTCS_TYPE_CHAR:
+        // 1要素は1文字（スカラーの char と同じく先頭文字を採る）
+        for (; p && *p && n < count; n++) {
+            dst[n] = *p;
+            p      = strchr(p, ',');
+            p      = p ? p + 1 : val + strlen(val);
+        }
+        break;
+    default:
+        break;
+    }
+    if (!p) {
+        fprintf(stderr, "ftcs: 配列の %zu 番目の要素が無効（フィールド: '%s'）\n",
+                n, m->field_name);
+        return -1;
+    }
+    if (*p) {
+        fprintf(stderr, "ftcs: 配列の要素数が %zu を超えている（フィールド: '%s'）\n",
+                count, m->field_name);
+        return -1;
+    }
+    memset(dst + n * esize, 0, (count - n) * esize);
+    return 0;
+}
+
+/**
+ * @brief 変換した配列要素の直後を確かめ、次の要素の先頭を返す
+ *
+ * @param p   変換した要素の先頭
+ * @param end 変換終端ポインタ
+ * @return 次の要素の先頭（最後の要素なら末尾の NUL）、要素が数値として無効なら NULL
+ */
+static const char *next_elem(const char *p, const char *end)
+{
+    // 数字がない（空の要素を含む）か、区切りでも終端でもない文字が続けば無効
+    if (end == p || (*end != ',' && *end != '\0')) {
+        return NULL;
+    }
+    return *end ? end + 1 : end;
+}
+
+/**
+ * @brief 配列要素の型のバイトサイズを返す
+ *
+ * @param type 要素型
+ * @return バイトサイズ、配列要素にできない型なら 0
+ */
+static size_t elem_size(ftcs_field_type_t type)
+{
+    switch (type) {
+    case FTCS_TYPE_INT:
+        return sizeof(int);
+    case FTCS_TYPE_LONG:
+        return sizeof(long);
+    case FTCS_TYPE_SHORT:
+        return sizeof(short);
+    case FTCS_TYPE_FLOAT:
+        return sizeof(float);
+    case FTCS_TYPE_DOUBLE:
+        return sizeof(double);
+    case FTCS_TYPE_CHAR:
+        return sizeof(char);
+    default:
+        return 0;
+    }
+}
+
 /**
  * @brief 文字列の先頭・末尾の空白をインプレースで除去し、先頭ポインタを返す
  *
@@ -190,26 +649,19 @@ static char *trim(char *s)
  *
  * 容量が足りない場合は2倍に拡張する。
  *
- * @param rs 拡張対象のレコード集合
+ * @param ctx 拡張対象のレコード集合を持つパースコンテキスト
  * @return 成功時 0、realloc 失敗時 -1
  */
-static int record_set_grow(ftcs_record_set_t *rs)
+static int record_set_grow(ftcs_parse_ctx_t *ctx)
 {
+    ftcs_record_set_t *rs = ctx->rs; // 拡張対象のレコード集合
     // まだ空きがある場合は拡張不要
     if (rs->count < rs->capacity) {
         return 0;
     }
-
-    size_t new_cap = rs->capacity * 2;                           // 2倍に拡張する
-    void  *new_buf = realloc(rs->records, new_cap * rs->struct_size); // 拡張後のバッファ
-    // realloc 失敗時は元のバッファをそのまま保持し呼び出し元にエラーを伝える
-    if (!new_buf) {
-        perror("ftcs: realloc");
-        return -1;
-    }
-    rs->records  = new_buf;
-    rs->capacity = new_cap;
-    return 0;
+    // ftcs_record_set_compact() で縮めた集合は容量が小さいことがあるので、初期容量を下限にする
+    return record_set_resize(ctx, rs->capacity < INITIAL_CAPACITY ? INITIAL_CAPACITY
+                                                                   : rs->capacity * 2); // 2倍に拡張する
 }
 
 /**
@@ -217,34 +669,66 @@ static int record_set_grow(ftcs_record_set_t *rs)
  *
  * 必要に応じて2倍ずつ拡張し、新規スロットはゼロ初期化する。
  *
- * @param rs       拡張対象のレコード集合
+ * @param ctx      拡張対象のレコード集合を持つパースコンテキスト
  * @param required 必要なスロット数
  * @return 成功時 0、realloc 失敗時 -1
  */
-static int record_set_ensure(ftcs_record_set_t *rs, size_t required)
+static int record_set_ensure(ftcs_parse_ctx_t *ctx, size_t required)
 {
+    ftcs_record_set_t *rs = ctx->rs; // 拡張対象のレコード集合
     // すでに十分な容量がある場合は何もしない
     if (required <= rs->capacity) {
         return 0;
     }
 
-    size_t new_cap = rs->capacity; // required を満たすまで2倍ずつ拡張する
+    size_t old_cap = rs->capacity; // 拡張前の容量（ゼロ初期化範囲の起点）
+    size_t new_cap = rs->capacity < INITIAL_CAPACITY ? INITIAL_CAPACITY : rs->capacity; // required を満たすまで2倍ずつ拡張する
     // required を超えるまでループする
     while (new_cap < required) {
         new_cap *= 2;
     }
 
-    void *new_buf = realloc(rs->records, new_cap * rs->struct_size); // 拡張後のバッファ
-    // realloc 失敗時は元のバッファをそのまま保持し呼び出し元にエラーを伝える
-    if (!new_buf) {
-        perror("ftcs: realloc");
+    if (record_set_resize(ctx, new_cap) != 0) {
         return -1;
     }
     // 新規スロットをゼロ初期化して、未書き込みスロットを安全な状態にする
-    memset((char *)new_buf + rs->capacity * rs->struct_size, 0,
-           (new_cap - rs->capacity) * rs->struct_size);
+    memset((char *)rs->records + old_cap * rs->struct_size, 0,
+           (new_cap - old_cap) * rs->struct_size);
+    return 0;
+}
+
+/**
+ * @brief レコード配列を new_cap スロットに再確保し、再確保回数・時間・最大使用量を記録する
+ *
+ * @param ctx     再確保対象のレコード集合を持つパースコンテキスト
+ * @param new_cap 再確保後のスロット数
+ * @return 成功時 0、realloc 失敗時 -1
+ */
+static int record_set_resize(ftcs_parse_ctx_t *ctx, size_t new_cap)
+{
+    ftcs_record_set_t *rs = ctx->rs; // 再確保対象のレコード集合
+    uint64_t t0 = ctx->stats ? ftcs_now_ns() : 0; // 計測開始時刻（再確保はまれなので毎回計る）
+
+    void *new_buf = ftcs_mem_realloc(&rs->allocator, rs->records,
+                                     rs->capacity * rs->struct_size,
+                                     new_cap * rs->struct_size); // 拡張後のバッファ
+    // 失敗時は元のバッファをそのまま保持し呼び出し元にエラーを伝える
+    // （利用者アロケーターは errno を設定しないことがあるため perror は使わない）
+    if (!new_buf) {
+        fprintf(stderr, "ftcs: レコード配列の再確保に失敗（%zu バイト）\n",
+                new_cap * rs->struct_size);
+        return -1;
+    }
     rs->records  = new_buf;
     rs->capacity = new_cap;
+
+    ctx->st.reallocs++;
+    if (new_cap * rs->struct_size > ctx->st.peak_bytes) {
+        ctx->st.peak_bytes = new_cap * rs->struct_size;
+    }
+    if (ctx->stats) {
+        ctx->st.alloc_ns += ftcs_now_ns() - t0;
+    }
     return 0;
 }
 
@@ -294,6 +778,48 @@ static int extract_field_int(const char *line, const char *kv_sep,
     return -1; // フィールドが見つからなかった
 }
 
+/**
+ * @brief 行の判別キーの値と一致する tag を持つスキーマを探す（元の行を変更しない）
+ *
+ * 全スキーマで共通の前処理なので、トークンをコピーせずに区切り位置だけを辿る。
+ *
+ * @param ctx  振り分け元のパースコンテキスト（判別キーとスキーマを参照する）
+ * @param line 前後の空白を除いた行文字列
+ * @return スキーマ番号、判別キーがないか値が一致しなければ -1
+ */
+static int route_line(const ftcs_parse_ctx_t *ctx, const char *line)
+{
+    const char *kv_sep  = ctx->config->kv_separator; // キーと値の区切り文字列
+    size_t      sep_len = strlen(kv_sep);            // 区切り文字列の長さ
+    size_t      key_len = strlen(ctx->route_key);    // 判別キーの長さ
+    const char *p       = line;                      // 走査位置
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        const char *tok = p; // トークンの先頭
+        while (*p && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        // 判別キーと区切り文字で始まるトークンなら、残りが判別キーの値
+        if ((size_t)(p - tok) >= key_len + sep_len
+            && memcmp(tok, ctx->route_key, key_len) == 0
+            && memcmp(tok + key_len, kv_sep, sep_len) == 0) {
+            const char *val     = tok + key_len + sep_len; // 判別キーの値
+            size_t      val_len = (size_t)(p - val);       // 値の長さ
+            for (size_t i = 0; i < ctx->nroutes; i++) {
+                const char *tag = ctx->schemas[i].tag; // i 番目のスキーマの値
+                if (strlen(tag) == val_len && memcmp(tag, val, val_len) == 0) {
+                    return (int)i;
+                }
+            }
+            return -1;
+        }
+    }
+    return -1;
+}
+
 // --- 公開 API ---
 
 ftcs_record_set_t *ftcs_parse_file(const char *filepath,
@@ -307,118 +833,139 @@ ftcs_record_set_t *ftcs_parse_file(const char *filepath,
         return NULL;
     }
 
-    FILE *fp = fopen(filepath, "r"); // 入力ファイルのストリーム
-    // ファイルが開けない場合は strerror で詳細を表示する
-    if (!fp) {
-        fprintf(stderr, "ftcs: '%s' を開けない: %s\n", filepath, strerror(errno));
+    uint64_t         t0 = config->stats ? ftcs_now_ns() : 0; // 計測開始時刻
+    ftcs_parse_ctx_t ctx; // パース状態（レコード集合を含む）
+    if (ftcs_ctx_init(&ctx, config, mapping, struct_size) != 0) {
         return NULL;
     }
 
-    // rs と rs->records は ftcs_record_set_free() で解放される
-    ftcs_record_set_t *rs = calloc(1, sizeof(*rs)); // レコード集合（ヒープ確保）
-    if (!rs) {
-        perror("ftcs: calloc");
-        fclose(fp);
+    // 読み込みバックエンドに応じて行の取得方法を切り替える
+    ftcs_record_set_t *rs = (config->io_backend == FTCS_IO_STDIO)
+                            ? parse_stdio(filepath, &ctx)
+                            : parse_blocks(filepath, &ctx); // パース結果
+    ftcs_ctx_report_stats(&ctx, t0);
+    ftcs_ctx_destroy(&ctx);
+    return rs;
+}
+
+ftcs_sparse_set_t *ftcs_parse_sparse(const char *filepath,
+                                     const ftcs_parser_config_t *config,
+                                     const ftcs_field_mapping_t *mapping,
+                                     size_t struct_size)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!filepath || !config || !mapping || !config->kv_separator) {
+        fprintf(stderr, "ftcs: ftcs_parse_sparse に NULL 引数が渡された\n");
         return NULL;
     }
-
-    rs->struct_size = struct_size;
-    rs->capacity    = INITIAL_CAPACITY;
-    rs->records     = calloc(rs->capacity, struct_size);
-    if (!rs->records) {
-        perror("ftcs: calloc");
-        free(rs);
-        fclose(fp);
+    if (config->primary_key_mode != FTCS_KEY_INDEX || !config->index_field_name) {
+        fprintf(stderr, "ftcs: ftcs_parse_sparse には FTCS_KEY_INDEX と index_field_name が必要\n");
         return NULL;
     }
 
-    char line[LINE_BUF_SIZE];                                              // 1行読み込みバッファ
-    char comment = config->comment_char ? config->comment_char : '#';     // コメント行の先頭文字
-
-    // index_field_name が指定されている場合は配置位置指定モード
-    int use_index_field = (config->primary_key_mode == FTCS_KEY_INDEX)
-                          && (config->index_field_name != NULL);
-
-    // ファイルを1行ずつ読み込んで構造体に変換する
-    while (fgets(line, sizeof(line), fp)) {
-        char *trimmed = trim(line); // 前後の空白・改行を除去したポインタ
-        // 空行またはコメント行は読み飛ばす
-        if (trimmed[0] == '\0' || trimmed[0] == comment) {
-            continue;
-        }
-
-        if (use_index_field) {
-            // --- 配置位置指定モード: 1-based インデックスで array[値-1] に格納 ---
-            long id_val; // インデックスフィールドから抽出した 1-based の配置位置
-            // インデックスフィールドの抽出に失敗した場合はエラー
-            if (extract_field_int(trimmed, config->kv_separator,
-                                  config->index_field_name, &id_val) != 0) {
-                fprintf(stderr,
-                        "ftcs: インデックスフィールド '%s' が欠落または不正: %s\n",
-                        config->index_field_name, trimmed);
-                ftcs_record_set_free(rs);
-                fclose(fp);
-                return NULL;
-            }
-            // インデックスは 1 以上でなければならない
-            if (id_val < 1) {
-                fprintf(stderr,
-                        "ftcs: インデックスフィールド '%s' は 1 以上でなければならない（値: %ld）\n",
-                        config->index_field_name, id_val);
-                ftcs_record_set_free(rs);
-                fclose(fp);
-                return NULL;
-            }
-
-            size_t pos = (size_t)(id_val - 1); // 1-based を 0-based に変換
-
-            // pos + 1 スロット分の容量を確保する
-            if (record_set_ensure(rs, pos + 1) != 0) {
-                ftcs_record_set_free(rs);
-                fclose(fp);
-                return NULL;
-            }
-
-            void *rec = (char *)rs->records + pos * struct_size; // 書き込み先スロット
-            memset(rec, 0, struct_size);
-
-            // KV 行を構造体フィールドに書き込む
-            if (parse_line_kv(trimmed, config->kv_separator, mapping, rec) != 0) {
-                ftcs_record_set_free(rs);
-                fclose(fp);
-                return NULL;
-            }
-
-            // count はロード済みスロット数の最大値を追跡する
-            if (pos + 1 > rs->count) {
-                rs->count = pos + 1;
-            }
+    uint64_t         t0 = config->stats ? ftcs_now_ns() : 0; // 計測開始時刻
+    ftcs_parse_ctx_t ctx; // パース状態（レコード集合は使わない）
+    if (ftcs_ctx_init(&ctx, config, mapping, struct_size) != 0) {
+        return NULL;
+    }
+    // 各行は作業領域で組み立て、受理した行だけをページに写す
+    if (!ctx.scratch) {
+        ctx.scratch = malloc(struct_size);
+    }
+    ctx.sparse = ftcs_sparse_create(struct_size, config->allocator);
+    if (!ctx.scratch || !ctx.sparse) {
+        perror("ftcs: malloc");
+        ftcs_sparse_free(ctx.sparse);
+        ftcs_ctx_destroy(&ctx);
+        return NULL;
+    }
 
-        } else {
-            // --- 順次モード: ファイルの出現順に末尾へ追加 ---
-            // 容量が足りない場合は拡張する
-            if (record_set_grow(rs) != 0) {
-                ftcs_record_set_free(rs);
-                fclose(fp);
-                return NULL;
-            }
+    ftcs_record_set_t *rs = (config->io_backend == FTCS_IO_STDIO)
+                            ? parse_stdio(filepath, &ctx)
+                            : parse_blocks(filepath, &ctx); // 空のまま残る密なレコード集合
+    ftcs_sparse_set_t *ss = ctx.sparse; // パース結果
+    if (!rs) {
+        ftcs_sparse_free(ss);
+        ss = NULL;
+    }
+    ftcs_record_set_free(rs);
+    ctx.st.peak_bytes = ftcs_sparse_bytes(ss);
+    ftcs_ctx_report_stats(&ctx, t0);
+    ftcs_ctx_destroy(&ctx);
+    return ss;
+}
 
-            void *rec = (char *)rs->records + rs->count * struct_size; // 末尾スロット
-            memset(rec, 0, struct_size);
+int ftcs_parse_multi(const char *filepath,
+                     const ftcs_parser_config_t *config,
+                     const char *discriminator,
+                     const ftcs_schema_t *schemas, size_t nschemas,
+                     ftcs_record_set_t *out[])
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!filepath || !config || !discriminator || !schemas || nschemas == 0 || !out
+        || !config->kv_separator) {
+        fprintf(stderr, "ftcs: ftcs_parse_multi に NULL 引数が渡された\n");
+        return -1;
+    }
+    for (size_t i = 0; i < nschemas; i++) {
+        out[i] = NULL;
+        if (!schemas[i].tag || !schemas[i].mapping) {
+            fprintf(stderr, "ftcs: ftcs_parse_multi のスキーマ %zu に tag / mapping がない\n", i);
+            return -1;
+        }
+    }
 
-            // KV 行を構造体フィールドに書き込む
-            if (parse_line_kv(trimmed, config->kv_separator, mapping, rec) != 0) {
-                ftcs_record_set_free(rs);
-                fclose(fp);
-                return NULL;
-            }
+    uint64_t t0 = config->stats ? ftcs_now_ns() : 0; // 計測開始時刻
+    // 振り分け元は行の読み込みと振り分けだけを行うので、フィルタ等は各スキーマ側で扱う
+    // （使わないレコード集合で利用者のアロケーターの領域を消費しないよう malloc 系にする）
+    ftcs_parser_config_t router_cfg = *config; // 振り分け元の設定
+    router_cfg.filter     = NULL;
+    router_cfg.projection = NULL;
+    router_cfg.allocator  = NULL;
+    router_cfg.ring       = NULL;
+    ftcs_parse_ctx_t ctx; // 振り分け元のパース状態（レコード集合は使わない）
+    if (ftcs_ctx_init(&ctx, &router_cfg, schemas[0].mapping, schemas[0].struct_size) != 0) {
+        return -1;
+    }
+    ftcs_parse_ctx_t *routes = calloc(nschemas, sizeof(*routes)); // スキーマごとのパース状態
+    if (!routes) {
+        perror("ftcs: calloc");
+        ftcs_ctx_destroy(&ctx);
+        return -1;
+    }
+    size_t ninit = 0; // 初期化済みの routes の数
+    while (ninit < nschemas
+           && ftcs_ctx_init(&routes[ninit], config, schemas[ninit].mapping,
+                            schemas[ninit].struct_size) == 0) {
+        routes[ninit].route_key = discriminator;
+        ninit++;
+    }
+    ftcs_record_set_t *rs = NULL; // 空のまま残る振り分け元のレコード集合
+    if (ninit == nschemas) {
+        ctx.routes    = routes;
+        ctx.schemas   = schemas;
+        ctx.nroutes   = nschemas;
+        ctx.route_key = discriminator;
+        rs = (config->io_backend == FTCS_IO_STDIO)
+             ? parse_stdio(filepath, &ctx)
+             : parse_blocks(filepath, &ctx);
+    }
 
-            rs->count++;
+    // 行数・読み込み量は振り分け元で数えたので、スキーマ側からは格納の統計だけを足す
+    ctx.st.peak_bytes = 0;
+    for (size_t i = 0; i < ninit; i++) {
+        if (rs) {
+            out[i] = ftcs_ctx_take(&routes[i]);
         }
+        routes[i].st.lines = 0;
+        ftcs_stats_add(&ctx.st, &routes[i].st);
+        ftcs_ctx_destroy(&routes[i]);
     }
-
-    fclose(fp);
-    return rs;
+    free(routes);
+    ftcs_ctx_report_stats(&ctx, t0);
+    ftcs_ctx_destroy(&ctx);
+    ftcs_record_set_free(rs);
+    return rs ? 0 : -1;
 }
 
 void ftcs_record_set_free(ftcs_record_set_t *rs)
@@ -427,7 +974,7 @@ void ftcs_record_set_free(ftcs_record_set_t *rs)
     if (!rs) {
         return;
     }
-    free(rs->records);
+    ftcs_mem_free(&rs->allocator, rs->records, rs->capacity * rs->struct_size);
     free(rs);
 }
 
@@ -475,6 +1022,15 @@ const void *ftcs_find_by_key(const ftcs_record_set_t *rs,
     if (!m) {
         return NULL;
     }
+    if (m->type == FTCS_TYPE_ARRAY) {
+        fprintf(stderr, "ftcs: 配列フィールド '%s' はキーに使えない\n", primary_key_name);
+        return NULL;
+    }
+
+    // 同じキーフィールドで並べ替え済みなら二分探索する
+    if (rs->sorted && rs->sorted_key.offset == m->offset && rs->sorted_key.type == m->type) {
+        return ftcs_sorted_find(rs, key_value);
+    }
 
     // 全レコードを線形探索してキー値が一致するレコードを返す
     for (size_t i = 0; i < rs->count; i++) {
@@ -518,7 +1074,427 @@ const void *ftcs_find_by_key(const ftcs_record_set_t *rs,
                 return rec;
             }
             break;
+        case FTCS_TYPE_ARRAY:
+            break;
         }
     }
     return NULL;
 }
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+int ftcs_ctx_init(ftcs_parse_ctx_t *ctx, const ftcs_parser_config_t *config,
+                  const ftcs_field_mapping_t *mapping, size_t struct_size)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->config      = config;
+    ctx->mapping     = mapping;
+    ctx->struct_size = struct_size;
+    ctx->comment     = config->comment_char ? config->comment_char : '#';
+    ctx->stats       = config->stats;
+    ctx->clock_ns    = ctx->stats ? clock_overhead_ns() : 0;
+
+    // index_field_name が指定されている場合は配置位置指定モード
+    ctx->use_index_field = (config->primary_key_mode == FTCS_KEY_INDEX)
+                           && (config->index_field_name != NULL);
+
+    // リングのスロットにはレコードをそのまま写すため、大きさの違う構造体は書き込めない
+    if (config->ring && ftcs_ring_producer_size(config->ring) != struct_size) {
+        fprintf(stderr, "ftcs: ring が生産者ハンドルでないか、レコードサイズが %zu と異なる\n",
+                struct_size);
+        return -1;
+    }
+
+    if (config->filter) {
+        ctx->filter = ftcs_filter_compile(config->filter, mapping);
+        if (!ctx->filter) {
+            return -1;
+        }
+        if (ctx->use_index_field) {
+            ctx->scratch = malloc(struct_size);
+            if (!ctx->scratch) {
+                perror("ftcs: malloc");
+                ftcs_ctx_destroy(ctx);
+                return -1;
+            }
+        }
+    }
+
+    if (ftcs_projection_compile(config, mapping, ctx->filter, &ctx->projected) != 0) {
+        ftcs_ctx_destroy(ctx);
+        return -1;
+    }
+
+    // rs と rs->records は ftcs_record_set_free() で解放される
+    if (ftcs_ctx_reset(ctx) != 0) {
+        ftcs_ctx_destroy(ctx);
+        return -1;
+    }
+    return 0;
+}
+
+int ftcs_ctx_line(ftcs_parse_ctx_t *ctx, char *line)
+{
+    const ftcs_parser_config_t *config = ctx->config; // パーサー設定
+    ftcs_record_set_t          *rs     = ctx->rs;     // 構築中のレコード集合
+    size_t struct_size = ctx->struct_size;            // 1レコードのバイトサイズ
+
+    ctx->st.lines++;
+    char *trimmed = trim(line); // 前後の空白・改行を除去したポインタ
+    // 空行またはコメント行は読み飛ばす
+    if (trimmed[0] == '\0') {
+        ctx->st.empty_lines++;
+        return 0;
+    }
+    if (trimmed[0] == ctx->comment) {
+        ctx->st.comments++;
+        return 0;
+    }
+    // 複数スキーマの振り分け: 判別キーの値に対応するスキーマのコンテキストで解析する
+    if (ctx->routes) {
+        int r = route_line(ctx, trimmed); // 振り分け先のスキーマ番号
+        if (r < 0) {
+            ctx->st.unrouted++;
+            return 0;
+        }
+        return ftcs_ctx_line(&ctx->routes[r], trimmed);
+    }
+
+    // 統計を取る場合は一定間隔の行だけフェーズ別に時間を計る
+    // 棄却した行も解析はしているため、抽出間隔はレコード行（格納 + 棄却）で数える
+    ctx->sampling = ctx->stats != NULL
+                    && (ctx->st.records + ctx->st.filtered) % STATS_SAMPLE_INTERVAL == 0;
+    if (ctx->sampling) {
+        ctx->st.sampled_lines++;
+    }
+
+    size_t pos = 0; // 配置位置指定モードでの 0-based 配置位置
+    if (ctx->use_index_field) {
+        uint64_t t0 = ctx->sampling ? ftcs_now_ns() : 0; // 抽出開始時刻
+        long id_val; // インデックスフィールドから抽出した 1-based の配置位置
+        // インデックスフィールドの抽出に失敗した場合はエラー
+        if (extract_field_int(trimmed, config->kv_separator,
+                              config->index_field_name, &id_val) != 0) {
+            fprintf(stderr,
+                    "ftcs: インデックスフィールド '%s' が欠落または不正: %s\n",
+                    config->index_field_name, trimmed);
+            return -1;
+        }
+        // インデックスは 1 以上でなければならない
+        if (id_val < 1) {
+            fprintf(stderr,
+                    "ftcs: インデックスフィールド '%s' は 1 以上でなければならない（値: %ld）\n",
+                    config->index_field_name, id_val);
+            return -1;
+        }
+        pos = (size_t)(id_val - 1); // 1-based を 0-based に変換
+        if (ctx->sampling) {
+            stats_lap(ctx, &ctx->st.tokenize_ns, t0);
+        }
+    }
+
+    if (ctx->use_index_field && !ctx->defer_placement) {
+        // --- 配置位置指定モード: 1-based インデックスで array[値-1] に格納 ---
+        // フィルタがある場合は作業領域で組み立て、棄却した ID のために配列を広げない
+        void *rec = ctx->scratch; // 書き込み先（作業領域またはスロット）
+        if (!rec) {
+            // pos + 1 スロット分の容量を確保する
+            if (record_set_ensure(ctx, pos + 1) != 0) {
+                return -1;
+            }
+            rec = (char *)rs->records + pos * struct_size;
+        }
+        memset(rec, 0, struct_size);
+
+        // KV 行を構造体フィールドに書き込む
+        int rc = parse_line_kv(ctx, trimmed, rec); // 解析結果
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc == LINE_REJECTED) {
+            ctx->st.filtered++;
+            return 0;
+        }
+        if (ctx->sparse) {
+            // 疎な集合ではページを確保してから写すため、棄却した行のページは作らない
+            void *slot = ftcs_sparse_slot(ctx->sparse, pos); // 格納先スロット
+            if (!slot) {
+                return -1;
+            }
+            memcpy(slot, rec, struct_size);
+            if (ring_push(ctx, slot, 1) != 0) {
+                return -1;
+            }
+            ctx->st.records++;
+            return 0;
+        }
+        if (rec == ctx->scratch) {
+            if (record_set_ensure(ctx, pos + 1) != 0) {
+                return -1;
+            }
+            memcpy((char *)rs->records + pos * struct_size, rec, struct_size);
+        }
+
+        // count はロード済みスロット数の最大値を追跡する
+        if (pos + 1 > rs->count) {
+            rs->count = pos + 1;
+        }
+        if (ring_push(ctx, (char *)rs->records + pos * struct_size, 1) != 0) {
+            return -1;
+        }
+
+    } else {
+        // --- 順次モード: ファイルの出現順に末尾へ追加 ---
+        // 配置を後段に委ねる場合も、ここでは出現順に詰めて格納し位置だけを記録する
+        // 容量が足りない場合は拡張する
+        if (record_set_grow(ctx) != 0) {
+            return -1;
+        }
+
+        void *rec = (char *)rs->records + rs->count * struct_size; // 末尾スロット
+        memset(rec, 0, struct_size);
+
+        // KV 行を構造体フィールドに書き込む（棄却した場合は count を進めず、次の行が上書きする）
+        int rc = parse_line_kv(ctx, trimmed, rec); // 解析結果
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc == LINE_REJECTED) {
+            ctx->st.filtered++;
+            return 0;
+        }
+
+        if (ctx->use_index_field && positions_push(ctx, pos) != 0) {
+            return -1;
+        }
+        rs->count++;
+        if (ring_flush(ctx, RING_PUSH_BATCH) != 0) {
+            return -1;
+        }
+    }
+    ctx->st.records++;
+    return 0;
+}
+
+int ftcs_ctx_feed(ftcs_parse_ctx_t *ctx, char *buf, size_t len)
+{
+    char *p   = buf;       // 未処理部分の先頭
+    char *end = buf + len; // ブロック終端
+
+    // ブロック内の改行ごとに1行ずつ処理する
+    while (p < end) {
+        char *nl = memchr(p, '\n', (size_t)(end - p)); // 次の改行位置
+        // 改行がなければ行の途中でブロックが終わっているため次回へ持ち越す
+        if (!nl) {
+            return carry_append(ctx, p, (size_t)(end - p));
+        }
+
+        if (ctx->carry_len > 0) {
+            // 前ブロックからの続きは持ち越しバッファ上で行を完成させる
+            if (carry_append(ctx, p, (size_t)(nl - p)) != 0) {
+                return -1;
+            }
+            ctx->carry[ctx->carry_len] = '\0';
+            ctx->carry_len = 0;
+            if (ftcs_ctx_line(ctx, ctx->carry) != 0) {
+                return -1;
+            }
+        } else {
+            // ブロック内で完結する行はコピーせずその場で処理する
+            *nl = '\0';
+            if (ftcs_ctx_line(ctx, p) != 0) {
+                return -1;
+            }
+        }
+        p = nl + 1;
+    }
+    // 入力の途切れで消費者を待たせないよう、ブロックごとに溜めた分を書き込む
+    return ring_flush(ctx, 1);
+}
+
+int ftcs_ctx_finish(ftcs_parse_ctx_t *ctx)
+{
+    // 改行で終わるファイルなら持ち越しは空
+    if (ctx->carry_len > 0) {
+        ctx->carry[ctx->carry_len] = '\0';
+        ctx->carry_len = 0;
+        if (ftcs_ctx_line(ctx, ctx->carry) != 0) {
+            return -1;
+        }
+    }
+    return ring_flush(ctx, 1);
+}
+
+ftcs_record_set_t *ftcs_ctx_take(ftcs_parse_ctx_t *ctx)
+{
+    ftcs_record_set_t *rs = ctx->rs; // 呼び出し元へ渡すレコード集合
+    ctx->rs = NULL;
+    return rs;
+}
+
+int ftcs_ctx_reset(ftcs_parse_ctx_t *ctx)
+{
+    ftcs_record_set_free(ctx->rs);
+    ctx->rs            = NULL;
+    ctx->positions_len = 0;
+    ctx->ring_from     = 0;
+
+    ftcs_record_set_t *rs = calloc(1, sizeof(*rs)); // 次のバッチ用のレコード集合
+    if (!rs) {
+        perror("ftcs: calloc");
+        return -1;
+    }
+    rs->struct_size = ctx->struct_size;
+    rs->capacity    = INITIAL_CAPACITY;
+    // アロケーターは record set に写しておき、解放・再確保でも同じものを使う
+    if (ctx->config->allocator) {
+        rs->allocator = *ctx->config->allocator;
+    }
+    rs->records = ftcs_mem_alloc(&rs->allocator, rs->capacity * ctx->struct_size);
+    if (!rs->records) {
+        fprintf(stderr, "ftcs: レコード配列の確保に失敗（%zu バイト）\n",
+                rs->capacity * ctx->struct_size);
+        free(rs);
+        return -1;
+    }
+    ctx->rs = rs;
+    if (rs->capacity * rs->struct_size > ctx->st.peak_bytes) {
+        ctx->st.peak_bytes = rs->capacity * rs->struct_size;
+    }
+    return 0;
+}
+
+void ftcs_ctx_report_stats(ftcs_parse_ctx_t *ctx, uint64_t start_ns)
+{
+    if (!ctx->stats) {
+        return;
+    }
+    ftcs_parse_stats_t st = ctx->st; // 報告用の統計（換算後）
+    // 抽出した行のフェーズ時間を全レコード行分に換算する
+    if (st.sampled_lines > 0) {
+        size_t rec_lines = st.records + st.filtered; // 解析したレコード行数（格納 + 棄却）
+        st.tokenize_ns = st.tokenize_ns * rec_lines / st.sampled_lines;
+        st.lookup_ns   = st.lookup_ns   * rec_lines / st.sampled_lines;
+        st.convert_ns  = st.convert_ns  * rec_lines / st.sampled_lines;
+    }
+    st.total_ns   = ftcs_now_ns() - start_ns;
+    *ctx->stats = st;
+}
+
+void ftcs_stats_add(ftcs_parse_stats_t *dst, const ftcs_parse_stats_t *src)
+{
+    dst->bytes         += src->bytes;
+    dst->lines         += src->lines;
+    dst->records       += src->records;
+    dst->comments      += src->comments;
+    dst->empty_lines   += src->empty_lines;
+    dst->unknown_keys  += src->unknown_keys;
+    dst->reallocs      += src->reallocs;
+    dst->io_ns         += src->io_ns;
+    dst->tokenize_ns   += src->tokenize_ns;
+    dst->lookup_ns     += src->lookup_ns;
+    dst->convert_ns    += src->convert_ns;
+    dst->alloc_ns      += src->alloc_ns;
+    dst->sampled_lines += src->sampled_lines;
+    dst->filtered      += src->filtered;
+    dst->unrouted      += src->unrouted;
+    dst->key_hits      += src->key_hits;
+    dst->key_misses    += src->key_misses;
+    // 最大使用量は並行して確保された分を合算する（上限の見積もりとして扱う）
+    dst->peak_bytes    += src->peak_bytes;
+}
+
+void ftcs_ctx_destroy(ftcs_parse_ctx_t *ctx)
+{
+    ftcs_record_set_free(ctx->rs);
+    free(ctx->carry);
+    free(ctx->positions);
+    ftcs_filter_free(ctx->filter);
+    free(ctx->scratch);
+    free(ctx->projected);
+    ctx->rs            = NULL;
+    ctx->filter        = NULL;
+    ctx->scratch       = NULL;
+    ctx->projected     = NULL;
+    ctx->carry         = NULL;
+    ctx->carry_len     = 0;
+    ctx->carry_cap     = 0;
+    ctx->positions     = NULL;
+    ctx->positions_len = 0;
+    ctx->positions_cap = 0;
+}
+
+int ftcs_projection_compile(const ftcs_parser_config_t *config,
+                            const ftcs_field_mapping_t *mapping,
+                            const ftcs_filter_t *filter, unsigned char **out)
+{
+    *out = NULL;
+    if (!config->projection) {
+        return 0;
+    }
+    size_t nfields = 0; // マッピングエントリ数
+    while (mapping[nfields].field_name) {
+        nfields++;
+    }
+    unsigned char *projected = calloc(nfields + 1, 1); // エントリごとの変換要否
+    if (!projected) {
+        perror("ftcs: calloc");
+        return -1;
+    }
+    for (const char *const *name = config->projection; *name; name++) {
+        const ftcs_field_mapping_t *m = find_mapping(mapping, *name); // 変換対象のエントリ
+        if (!m) {
+            fprintf(stderr, "ftcs: projection のフィールド '%s' がマッピングに存在しない\n", *name);
+            free(projected);
+            return -1;
+        }
+        projected[m - mapping] = 1;
+    }
+    // フィルタの判定には値が必要なため、参照されるフィールドは変換対象に含める
+    for (size_t i = 0; filter && i < nfields; i++) {
+        if (ftcs_filter_uses(filter, &mapping[i])) {
+            projected[i] = 1;
+        }
+    }
+    *out = projected;
+    return 0;
+}
+
+int ftcs_field_set(void *out, const ftcs_field_mapping_t *m, const char *val)
+{
+    return set_field(out, m, val);
+}
+
+int ftcs_ctx_append(ftcs_parse_ctx_t *ctx, const void *recs, size_t n)
+{
+    ftcs_record_set_t *rs = ctx->rs; // 追加先のレコード集合
+    // 一度に n 件ぶんの容量を確保してからまとめてコピーする
+    if (rs->count + n > rs->capacity) {
+        size_t new_cap = rs->capacity; // 必要数を満たすまで2倍ずつ拡張する
+        while (new_cap < rs->count + n) {
+            new_cap *= 2;
+        }
+        if (record_set_resize(ctx, new_cap) != 0) {
+            return -1;
+        }
+    }
+    memcpy((char *)rs->records + rs->count * rs->struct_size, recs, n * rs->struct_size);
+    rs->count += n;
+    ctx->ring_from = rs->count;
+    return ring_push(ctx, recs, n);
+}
+
+int ftcs_ctx_place(ftcs_parse_ctx_t *ctx, size_t pos, const void *rec)
+{
+    ftcs_record_set_t *rs = ctx->rs; // 配置先のレコード集合
+    // pos + 1 スロット分の容量を確保する（新規スロットはゼロ初期化される）
+    if (record_set_ensure(ctx, pos + 1) != 0) {
+        return -1;
+    }
+    memcpy((char *)rs->records + pos * rs->struct_size, rec, rs->struct_size);
+    // count はロード済みスロット数の最大値を追跡する
+    if (pos + 1 > rs->count) {
+        rs->count = pos + 1;
+    }
+    return ring_push(ctx, rec, 1);
+}
@@ -0,0 +1,255 @@
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftcs_internal.h"
+
+// キャッシュラインのバイト数
+#define CACHE_LINE 64
+
+// 1キャッシュラインに入るキーの数。Eytzinger 配置ではノード k の 3 段下の子孫 8 個が
+// keys[8k .. 8k+7] に並ぶので、keys をキャッシュライン境界に置けば1ラインの先読みで足りる。
+#define KEYS_PER_LINE (CACHE_LINE / sizeof(uint64_t))
+
+// --- 内部型定義 ---
+
+struct ftcs_range_index {
+    const ftcs_record_set_t *rs;   /**< 索引対象のレコード集合 */
+    ftcs_field_mapping_t     key;  /**< キーフィールドのマッピングエントリ（写し） */
+    size_t                   n;    /**< レコード数 */
+    uint64_t                *keys; /**< 正規化したキーの Eytzinger 配置（1-based、keys[0] は未使用） */
+    size_t                  *rank; /**< keys[k] のキー順での順位 */
+    size_t                  *pos;  /**< キー順で rank 番目のレコード位置 */
+};
+
+// --- 関数宣言（目次） ---
+
+static size_t eytzinger_fill(ftcs_range_index_t *idx, const ftcs_sort_item_t *sorted,
+                             size_t i, size_t k);                       // 昇順のキーを木に配置する
+static int    bound_keys(const ftcs_range_index_t *idx, double lo, double hi,
+                         size_t *first, size_t *last);                  // 範囲の順位を求める
+static size_t lower_rank(const ftcs_range_index_t *idx, uint64_t key);  // key 以上の最小の順位を求める
+static uint64_t integer_key(double v, int round_up);                    // 整数に丸めて正規化したキーにする
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+ftcs_range_index_t *ftcs_range_index_build(const ftcs_record_set_t *rs,
+                                           const ftcs_field_mapping_t *mapping,
+                                           const char *field_name)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs || !mapping || !field_name) {
+        fprintf(stderr, "ftcs: ftcs_range_index_build に NULL 引数が渡された\n");
+        return NULL;
+    }
+    const ftcs_field_mapping_t *m = mapping; // キーフィールドのマッピングエントリ
+    while (m->field_name && strcmp(m->field_name, field_name) != 0) {
+        m++;
+    }
+    if (!m->field_name || m->type == FTCS_TYPE_STRING || m->type == FTCS_TYPE_ARRAY) {
+        fprintf(stderr, "ftcs: '%s' は範囲索引を作れる数値フィールドではない\n", field_name);
+        return NULL;
+    }
+
+    ftcs_range_index_t *idx = calloc(1, sizeof(*idx)); // 構築する索引
+    if (!idx) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    idx->rs  = rs;
+    idx->key = *m;
+    idx->n   = rs->count;
+    size_t key_bytes = (rs->count + 1) * sizeof(*idx->keys); // keys のバイト数
+    // aligned_alloc はサイズがアラインメントの倍数である必要がある
+    key_bytes  = (key_bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    idx->keys  = aligned_alloc(CACHE_LINE, key_bytes);
+    idx->rank  = malloc((rs->count + 1) * sizeof(*idx->rank));
+    idx->pos   = malloc((rs->count + 1) * sizeof(*idx->pos));
+    if (!idx->keys || !idx->rank || !idx->pos) {
+        perror("ftcs: malloc");
+        ftcs_range_index_free(idx);
+        return NULL;
+    }
+    ftcs_sort_item_t *sorted = ftcs_key_sort(rs, m); // キー順のレコード位置
+    if (!sorted) {
+        ftcs_range_index_free(idx);
+        return NULL;
+    }
+    for (size_t i = 0; i < rs->count; i++) {
+        idx->pos[i] = sorted[i].pos;
+    }
+    eytzinger_fill(idx, sorted, 0, 1);
+    free(sorted);
+    return idx;
+}
+
+size_t ftcs_range_count(const ftcs_range_index_t *idx, double lo, double hi)
+{
+    size_t first; // 範囲の先頭の順位
+    size_t last;  // 範囲の終端の順位（含まない）
+    if (!idx || bound_keys(idx, lo, hi, &first, &last) != 0) {
+        return 0;
+    }
+    return last - first;
+}
+
+size_t ftcs_range_query(const ftcs_range_index_t *idx, double lo, double hi,
+                        ftcs_range_cb_t cb, void *arg)
+{
+    size_t first; // 範囲の先頭の順位
+    size_t last;  // 範囲の終端の順位（含まない）
+    if (!idx || !cb || bound_keys(idx, lo, hi, &first, &last) != 0) {
+        return 0;
+    }
+    const char *records = idx->rs->records;     // レコード配列の先頭
+    size_t      stride  = idx->rs->struct_size; // レコード間隔
+    for (size_t r = first; r < last; r++) {
+        if (cb(records + idx->pos[r] * stride, arg) != 0) {
+            return r - first + 1;
+        }
+    }
+    return last - first;
+}
+
+void ftcs_range_index_free(ftcs_range_index_t *idx)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!idx) {
+        return;
+    }
+    free(idx->keys);
+    free(idx->rank);
+    free(idx->pos);
+    free(idx);
+}
+
+size_t ftcs_range_index_bytes(const ftcs_range_index_t *idx)
+{
+    if (!idx) {
+        return 0;
+    }
+    size_t key_bytes = (idx->n + 1) * sizeof(*idx->keys); // keys のバイト数（構築時と同じく切り上げる）
+    key_bytes = (key_bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    return sizeof(*idx) + key_bytes + (idx->n + 1) * (sizeof(*idx->rank) + sizeof(*idx->pos));
+}
+
+/**
+ * @brief 昇順のキーを、木を中間順に辿りながら Eytzinger 配置に書き込む
+ *
+ * ノード k の左の子は 2k、右の子は 2k+1。中間順に辿ると昇順になるので、
+ * 訪れた順に sorted の先頭から割り当てる。再帰の深さは木の高さ（log2 n）。
+ *
+ * @param idx    構築中の索引
+ * @param sorted キー順のレコード位置
+ * @param i      次に割り当てる順位
+ * @param k      訪れるノード
+ * @return 部分木に割り当てた後の次の順位
+ */
+static size_t eytzinger_fill(ftcs_range_index_t *idx, const ftcs_sort_item_t *sorted,
+                             size_t i, size_t k)
+{
+    if (k > idx->n) {
+        return i;
+    }
+    i = eytzinger_fill(idx, sorted, i, 2 * k);
+    idx->keys[k] = sorted[i].key;
+    idx->rank[k] = i;
+    return eytzinger_fill(idx, sorted, i + 1, 2 * k + 1);
+}
+
+/**
+ * @brief [lo, hi] に入るレコードの順位の範囲を求める
+ *
+ * @param idx   順序索引
+ * @param lo    範囲の下端（含む）
+ * @param hi    範囲の上端（含む）
+ * @param first 範囲の先頭の順位の書き込み先
+ * @param last  範囲の終端の順位（含まない）の書き込み先
+ * @return 範囲が空でなければ 0、空なら -1
+ */
+static int bound_keys(const ftcs_range_index_t *idx, double lo, double hi,
+                      size_t *first, size_t *last)
+{
+    // NaN は自身と等しくない
+    if (lo != lo || hi != hi || lo > hi) {
+        return -1;
+    }
+    uint64_t klo; // 下端の正規化したキー
+    uint64_t khi; // 上端の正規化したキー
+    if (idx->key.type == FTCS_TYPE_FLOAT || idx->key.type == FTCS_TYPE_DOUBLE) {
+        // float のキーも double に広げて正規化しているので、境界は double のまま変換する
+        ftcs_field_mapping_t dm = { .type = FTCS_TYPE_DOUBLE }; // double として正規化する
+        klo = ftcs_key_bits(&dm, &lo);
+        khi = ftcs_key_bits(&dm, &hi);
+    } else {
+        // (double)LONG_MAX は 2^63 に丸まるので、それ以上の下端は long に入らない
+        if (lo >= (double)LONG_MAX || hi < (double)LONG_MIN) {
+            return -1;
+        }
+        klo = integer_key(lo, 1);
+        khi = integer_key(hi, 0);
+        // [1.2, 1.8] のように整数を含まない範囲
+        if (klo > khi) {
+            return -1;
+        }
+    }
+    *first = lower_rank(idx, klo);
+    *last  = (khi == UINT64_MAX) ? idx->n : lower_rank(idx, khi + 1);
+    return 0;
+}
+
+/**
+ * @brief key 以上のキーを持つ最小の順位を Eytzinger 配置の木で探す
+ *
+ * 各段の比較結果で子を選ぶだけの分岐しない降下で、KEYS_PER_LINE 倍先（3 段下）の
+ * 子孫のキャッシュラインを先読みする（配列外の先読みは無視されるので範囲検査しない）。
+ * 降下を終えた k から、最後に右へ進んだ連続分と左へ進んだ1回を取り除くと、
+ * key 以上だった最後のノードが残る。
+ *
+ * @param idx 順序索引
+ * @param key 正規化したキー
+ * @return 順位（全キーが key 未満なら n）
+ */
+static size_t lower_rank(const ftcs_range_index_t *idx, uint64_t key)
+{
+    size_t k = 1; // 訪れているノード
+    while (k <= idx->n) {
+        __builtin_prefetch(idx->keys + k * KEYS_PER_LINE);
+        k = 2 * k + (idx->keys[k] < key);
+    }
+    k >>= __builtin_ffsll((long long)~k);
+    return k ? idx->rank[k] : idx->n;
+}
+
+/**
+ * @brief 範囲の端を整数に丸め、整数型フィールドと同じ規則で正規化したキーにする
+ *
+ * 整数型のキーは long に広げてから正規化されるので、long の範囲に収めてから変換する。
+ * libm に依存しないよう、丸めは long への切り捨てを補正して行う。
+ *
+ * @param v        範囲の端
+ * @param round_up 非ゼロなら切り上げ（下端）、0 なら切り捨て（上端）
+ * @return 正規化したキー
+ */
+static uint64_t integer_key(double v, int round_up)
+{
+    long l; // long に丸めた値
+    if (v <= (double)LONG_MIN) {
+        l = LONG_MIN;
+    } else if (v >= (double)LONG_MAX) {
+        l = LONG_MAX;
+    } else {
+        l = (long)v; // 0 方向に切り捨てた値
+        if (round_up && (double)l < v) {
+            l++;
+        } else if (!round_up && (double)l > v) {
+            l--;
+        }
+    }
+    ftcs_field_mapping_t lm = { .type = FTCS_TYPE_LONG }; // long として正規化する
+    return ftcs_key_bits(&lm, &l);
+}
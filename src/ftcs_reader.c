@@ -0,0 +1,430 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "ftcs_internal.h"
+
+// 1回の読み込み要求のバイト数。NVMe で帯域を使い切れる大きさとして 1MiB を選択。
+// 小さすぎると要求発行のオーバーヘッドが支配的になり、大きすぎるとパース開始が遅れる。
+#define READ_BLOCK_SIZE (1024 * 1024)
+
+// 同時に発行しておく読み込み要求数。パース中の1ブロックを除く3ブロックが常に読み込み中になる。
+#define READ_DEPTH 4
+
+// --- 内部型定義 ---
+
+/**
+ * @brief io_uring のリング（SQ/CQ）を生システムコールで扱うための状態
+ *
+ * liburing に依存しないよう、カーネルが共有するリングを直接 mmap して操作する。
+ */
+typedef struct {
+    int                  fd;        /**< io_uring インスタンスの fd */
+    void                *sq_ptr;    /**< SQ リングの mmap 先頭 */
+    size_t               sq_len;    /**< SQ リングの mmap サイズ */
+    void                *cq_ptr;    /**< CQ リングの mmap 先頭（SINGLE_MMAP 時は sq_ptr と同じ） */
+    size_t               cq_len;    /**< CQ リングの mmap サイズ */
+    struct io_uring_sqe *sqes;      /**< SQE 配列 */
+    size_t               sqes_len;  /**< SQE 配列の mmap サイズ */
+    unsigned            *sq_tail;   /**< SQ 末尾（ユーザが進める） */
+    unsigned            *sq_mask;   /**< SQ 添字マスク */
+    unsigned            *sq_array;  /**< SQ 添字配列 */
+    unsigned            *cq_head;   /**< CQ 先頭（ユーザが進める） */
+    unsigned            *cq_tail;   /**< CQ 末尾（カーネルが進める） */
+    unsigned            *cq_mask;   /**< CQ 添字マスク */
+    struct io_uring_cqe *cqes;      /**< CQE 配列 */
+} uring_t;
+
+/**
+ * @brief 先読みスロット1個分の状態
+ */
+typedef struct {
+    char         *buf;     /**< 読み込み先バッファ（READ_BLOCK_SIZE バイト） */
+    off_t         offset;  /**< このスロットが担当するファイルオフセット */
+    size_t        want;    /**< 要求バイト数（ファイル末尾では READ_BLOCK_SIZE 未満） */
+    ssize_t       result;  /**< 完了結果（バイト数または -errno） */
+    int           pending; /**< 読み込み要求が発行済みで未完了なら非ゼロ */
+    struct iovec  iov;     /**< IORING_OP_READV 用の iovec（完了まで生存させる） */
+} read_slot_t;
+
+struct ftcs_reader {
+    int          fd;                /**< 入力ファイルの fd */
+    off_t        file_size;         /**< オープン時点のファイルサイズ */
+    off_t        next_submit;       /**< 次に読み込み要求を出すオフセット */
+    size_t       next_block;        /**< 次に呼び出し元へ返すブロック番号 */
+    int          use_uring;         /**< io_uring が使えるなら非ゼロ */
+    int          held;              /**< 呼び出し元に貸し出し中のスロット番号（なければ -1） */
+    uring_t      ring;              /**< io_uring の状態 */
+    read_slot_t  slots[READ_DEPTH]; /**< 先読みスロット（ブロック番号 % READ_DEPTH で割り当て） */
+};
+
+// --- 関数宣言（目次） ---
+
+static int     uring_init(uring_t *ring, unsigned entries);            // io_uring を生成しリングを mmap する
+static void    uring_destroy(uring_t *ring);                           // リングを unmap して fd を閉じる
+static int     submit_slot(ftcs_reader_t *r, int slot);                 // スロットに次の読み込み要求を割り当てる
+static int     wait_slot(ftcs_reader_t *r, int slot);                   // スロットの読み込み完了を待つ
+static int     reap_one(ftcs_reader_t *r);                              // CQE を1件刈り取る
+static ssize_t pread_full(int fd, char *buf, size_t len, off_t offset); // 短い読み込みを吸収して pread する
+
+// --- 関数定義（概要→詳細の順） ---
+
+/**
+ * @brief スロットに次のブロックの読み込みを割り当てる
+ *
+ * io_uring 使用時は要求を発行するだけで戻り、pread 使用時は
+ * 後続ブロックの先読みをカーネルに依頼したうえで同期的に読む。
+ *
+ * @param r    リーダー
+ * @param slot 割り当て先スロット番号
+ * @return 成功時 0（ファイル末尾で割り当て不要な場合も 0）、失敗時 -1
+ */
+static int submit_slot(ftcs_reader_t *r, int slot)
+{
+    read_slot_t *s = &r->slots[slot]; // 割り当て先スロット
+    // ファイル末尾まで要求済みならこれ以上読み込む必要はない
+    if (r->next_submit >= r->file_size) {
+        s->want    = 0;
+        s->result  = 0;
+        s->pending = 0;
+        return 0;
+    }
+
+    s->offset = r->next_submit;
+    s->want   = (size_t)(r->file_size - r->next_submit);
+    if (s->want > READ_BLOCK_SIZE) {
+        s->want = READ_BLOCK_SIZE;
+    }
+    r->next_submit += (off_t)s->want;
+
+    if (!r->use_uring) {
+        // 後続ブロックの読み込みをカーネルの先読みに任せ、パース中もデバイスを動かし続ける
+        posix_fadvise(r->fd, r->next_submit,
+                      (off_t)READ_BLOCK_SIZE * (READ_DEPTH - 1), POSIX_FADV_WILLNEED);
+        s->result  = pread_full(r->fd, s->buf, s->want, s->offset);
+        s->pending = 0;
+        return s->result < 0 ? -1 : 0;
+    }
+
+    uring_t  *ring = &r->ring;                                       // io_uring の状態
+    unsigned  tail = *ring->sq_tail;                                 // SQ 末尾（自スレッドのみが更新する）
+    unsigned  idx  = tail & *ring->sq_mask;                          // 使用する SQE 添字
+    struct io_uring_sqe *sqe = &ring->sqes[idx];                     // 書き込む SQE
+
+    s->iov.iov_base = s->buf;
+    s->iov.iov_len  = s->want;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READV; // READ より古いカーネル（5.1〜）でも使える
+    sqe->fd        = r->fd;
+    sqe->off       = (unsigned long long)s->offset;
+    sqe->addr      = (unsigned long long)(uintptr_t)&s->iov;
+    sqe->len       = 1;
+    sqe->user_data = (unsigned long long)slot;
+    ring->sq_array[idx] = idx;
+    // SQE の内容がカーネルから見える前に tail を進めてはならない
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    s->pending = 1;
+    // 要求を即座に発行する（完了は wait_slot で待つ）
+    if (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0) {
+        perror("ftcs: io_uring_enter");
+        s->pending = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief スロットの読み込み完了を待ち、短い読み込みがあれば残りを同期で補う
+ *
+ * @param r    リーダー
+ * @param slot 待機対象スロット番号
+ * @return 成功時 0、読み込みエラー時 -1
+ */
+static int wait_slot(ftcs_reader_t *r, int slot)
+{
+    read_slot_t *s = &r->slots[slot]; // 待機対象スロット
+    // 他スロットの完了が先に届くこともあるため、目的のスロットが終わるまで刈り取る
+    while (s->pending) {
+        if (reap_one(r) != 0) {
+            return -1;
+        }
+    }
+
+    if (s->result < 0) {
+        fprintf(stderr, "ftcs: 読み込みに失敗した: %s\n", strerror((int)-s->result));
+        return -1;
+    }
+    // 通常ファイルでは稀だが、短い読み込みは残りを pread で補ってブロックを完成させる
+    if ((size_t)s->result < s->want) {
+        ssize_t rest = pread_full(r->fd, s->buf + s->result,
+                                  s->want - (size_t)s->result,
+                                  s->offset + s->result); // 補った分のバイト数
+        if (rest < 0) {
+            return -1;
+        }
+        s->result += rest;
+    }
+    return 0;
+}
+
+/**
+ * @brief CQ から完了イベントを1件取り出し、対応スロットに結果を記録する
+ *
+ * @param r リーダー
+ * @return 成功時 0、io_uring_enter 失敗時 -1
+ */
+static int reap_one(ftcs_reader_t *r)
+{
+    uring_t *ring = &r->ring; // io_uring の状態
+    unsigned head = *ring->cq_head; // CQ 先頭（自スレッドのみが更新する）
+
+    // CQ が空の間はカーネルに完了を待たせる
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1,
+                    IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+            perror("ftcs: io_uring_enter");
+            return -1;
+        }
+    }
+
+    struct io_uring_cqe *cqe  = &ring->cqes[head & *ring->cq_mask]; // 取り出す CQE
+    int                  slot = (int)cqe->user_data;                // 完了したスロット番号
+    r->slots[slot].result  = cqe->res;
+    r->slots[slot].pending = 0;
+    // CQE を読み終えてから head を進め、カーネルによる上書きを防ぐ
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief 指定長に達するか EOF までを pread で読む
+ *
+ * @param fd     読み込み元 fd
+ * @param buf    読み込み先
+ * @param len    読み込むバイト数
+ * @param offset ファイルオフセット
+ * @return 読み込んだバイト数、エラー時 -1
+ */
+static ssize_t pread_full(int fd, char *buf, size_t len, off_t offset)
+{
+    size_t done = 0; // 読み込み済みバイト数
+    // シグナル割り込みや短い読み込みがあっても len に達するまで繰り返す
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, offset + (off_t)done); // 今回の読み込みバイト数
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("ftcs: pread");
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+/**
+ * @brief io_uring インスタンスを生成し、SQ/CQ リングと SQE 配列を mmap する
+ *
+ * @param ring    初期化対象
+ * @param entries SQ のエントリ数
+ * @return 成功時 0、io_uring が利用できない場合 -1（エラー表示はしない）
+ */
+static int uring_init(uring_t *ring, unsigned entries)
+{
+    struct io_uring_params p; // カーネルから返されるリング配置情報
+    memset(&p, 0, sizeof(p));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    // 古いカーネルやコンテナの seccomp で拒否されるのは想定内（pread にフォールバックする）
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    // SINGLE_MMAP 対応カーネルでは SQ と CQ が1つの領域にまとまっている
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) {
+            ring->sq_len = ring->cq_len;
+        }
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_len);
+            close(ring->fd);
+            return -1;
+        }
+    }
+
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ptr != ring->sq_ptr) {
+            munmap(ring->cq_ptr, ring->cq_len);
+        }
+        munmap(ring->sq_ptr, ring->sq_len);
+        close(ring->fd);
+        return -1;
+    }
+
+    char *sq = ring->sq_ptr; // SQ リング先頭（オフセット計算用）
+    char *cq = ring->cq_ptr; // CQ リング先頭（オフセット計算用）
+    ring->sq_tail  = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->cq_head  = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail  = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+/**
+ * @brief リングを unmap し io_uring の fd を閉じる
+ * @param ring 破棄対象
+ */
+static void uring_destroy(uring_t *ring)
+{
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+ftcs_reader_t *ftcs_reader_open(const char *filepath, ftcs_io_backend_t backend)
+{
+    ftcs_reader_t *r = calloc(1, sizeof(*r)); // リーダー本体
+    if (!r) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    r->held = -1;
+
+    r->fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    // ファイルが開けない場合は strerror で詳細を表示する
+    if (r->fd < 0) {
+        fprintf(stderr, "ftcs: '%s' を開けない: %s\n", filepath, strerror(errno));
+        free(r);
+        return NULL;
+    }
+
+    struct stat st; // ファイルサイズ取得用
+    if (fstat(r->fd, &st) != 0) {
+        perror("ftcs: fstat");
+        close(r->fd);
+        free(r);
+        return NULL;
+    }
+    r->file_size = st.st_size;
+    // 順次読みであることを伝え、カーネルの先読み窓を広げさせる
+    posix_fadvise(r->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    for (int i = 0; i < READ_DEPTH; i++) {
+        r->slots[i].buf = malloc(READ_BLOCK_SIZE);
+        if (!r->slots[i].buf) {
+            perror("ftcs: malloc");
+            ftcs_reader_close(r);
+            return NULL;
+        }
+    }
+
+    r->use_uring = (backend == FTCS_IO_URING) && (uring_init(&r->ring, READ_DEPTH) == 0);
+
+    // io_uring では全スロットの要求を先に出しておく。pread では最初の1ブロックのみ読む
+    int initial = r->use_uring ? READ_DEPTH : 1; // 初回に割り当てるスロット数
+    for (int i = 0; i < initial; i++) {
+        if (submit_slot(r, i) != 0) {
+            ftcs_reader_close(r);
+            return NULL;
+        }
+    }
+    return r;
+}
+
+ssize_t ftcs_reader_next(ftcs_reader_t *r, char **block)
+{
+    int slot = (int)(r->next_block % READ_DEPTH); // 今回返すブロックのスロット
+
+    // 前回貸し出したスロットは処理済みなので、次の先読みに再利用する
+    if (r->held >= 0) {
+        if (r->use_uring) {
+            if (submit_slot(r, r->held) != 0) {
+                return -1;
+            }
+        }
+        r->held = -1;
+    }
+    // pread では貸し出し直前に同期で読む（スロットは1つずつ順に使う）
+    if (!r->use_uring && r->next_block > 0) {
+        if (submit_slot(r, slot) != 0) {
+            return -1;
+        }
+    }
+
+    if (wait_slot(r, slot) != 0) {
+        return -1;
+    }
+    // want == 0 のスロットはファイル末尾を越えている
+    if (r->slots[slot].want == 0 || r->slots[slot].result == 0) {
+        return 0;
+    }
+
+    r->held = slot;
+    r->next_block++;
+    *block = r->slots[slot].buf;
+    return r->slots[slot].result;
+}
+
+void ftcs_reader_close(ftcs_reader_t *r)
+{
+    if (!r) {
+        return;
+    }
+    if (r->use_uring) {
+        // カーネルが書き込み中のバッファを解放しないよう、未完了の要求をすべて刈り取る
+        for (int i = 0; i < READ_DEPTH; i++) {
+            while (r->slots[i].pending) {
+                if (reap_one(r) != 0) {
+                    break;
+                }
+            }
+        }
+        uring_destroy(&r->ring);
+    }
+    for (int i = 0; i < READ_DEPTH; i++) {
+        free(r->slots[i].buf);
+    }
+    close(r->fd);
+    free(r);
+}
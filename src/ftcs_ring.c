@@ -0,0 +1,369 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ftcs_internal.h"
+
+// 共有メモリ上のリングの識別子（"FTCSRNG1"）。未初期化の領域や別形式の領域への接続を拒む。
+#define RING_MAGIC 0x46544353524e4731ULL
+
+// キャッシュライン長。生産者・各消費者の位置を別ラインに置き false sharing を防ぐ。
+#define CACHE_LINE_SIZE 64
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 生産者または消費者1つの位置（共有メモリ上、1キャッシュライン）
+ *
+ * pos は持ち主だけが書き込むため CAS は不要。word は futex の待ち合わせに使う 32 ビット語で、
+ * 持ち主が pos を進めるたびに加算する（眠る側は加算前の値を渡して取りこぼしを防ぐ）。
+ * word と waiters は ftcs_futex_bump() / ftcs_futex_wait_until() に渡すため、_Atomic にせず
+ * __atomic 組み込み関数で読み書きする。
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t pos; /**< 書き込み・読み出し済みのレコード通し番号 */
+    uint32_t word;       /**< futex 語（pos を進めるたびに加算） */
+    uint32_t waiters;    /**< この位置の更新を futex で待っている数 */
+} ring_cursor_t;
+
+/**
+ * @brief リングの管理領域（共有メモリ領域の先頭に置く）
+ *
+ * ポインタを含まないため、プロセスごとにマップ先のアドレスが違ってよい。
+ * レコードのスロットは管理領域の直後から capacity 件並ぶ。
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t magic; /**< RING_MAGIC（他の項目を書いてから設定する） */
+    uint64_t      struct_size; /**< 1レコードのバイトサイズ */
+    uint64_t      capacity;    /**< スロット数（2 のべき乗） */
+    uint32_t      consumers;   /**< 消費者の数 */
+    atomic_uint   closed;      /**< 生産者が書き込みを終えたら非ゼロ */
+    ring_cursor_t tail;        /**< 生産者の位置 */
+    ring_cursor_t heads[FTCS_SHM_RING_MAX_CONSUMERS]; /**< 各消費者の位置 */
+} ring_header_t;
+
+struct ftcs_shm_ring {
+    ring_header_t *hdr;         /**< 共有メモリ上の管理領域 */
+    char          *slots;       /**< 共有メモリ上のスロット配列 */
+    uint64_t       mask;        /**< capacity - 1 */
+    size_t         struct_size; /**< 1レコードのバイトサイズ */
+    int            consumer;    /**< 消費者番号（生産者なら -1） */
+    uint64_t       pos;         /**< 自分の位置（共有メモリの pos と同じ値の手元の写し） */
+    uint64_t       limit;       /**< 相手を読み直さずに進められる位置
+                                     （生産者: 最も遅い消費者 + capacity、消費者: 生産者の位置） */
+};
+
+// --- 関数宣言（目次） ---
+
+static uint64_t slowest_head(const ring_header_t *hdr, unsigned *who);           // 最も遅い消費者の位置を求める
+static void     copy_slots(ftcs_shm_ring_t *r, void *dst, const void *src, size_t n, int to_ring); // スロットとの間で写す
+static void     publish(ring_cursor_t *c, uint64_t pos);                          // 位置を進めて待つ側を起こす
+static int      wait_moved(const ring_header_t *hdr, ring_cursor_t *c, uint64_t stale,
+                           uint64_t deadline); // 位置が stale から進むまで待つ
+static int      cursor_moved(const ring_header_t *hdr, const ring_cursor_t *c, uint64_t stale); // 待ち終えてよいか
+static ftcs_shm_ring_t *ring_handle(void *addr, int consumer);                    // ハンドルを作る
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+size_t ftcs_shm_ring_bytes(size_t struct_size, size_t slots)
+{
+    if (struct_size == 0 || slots == 0) {
+        return 0;
+    }
+    size_t cap = 1; // 2 のべき乗に切り上げたスロット数
+    while (cap < slots) {
+        if (cap > SIZE_MAX / 2) {
+            return 0;
+        }
+        cap *= 2;
+    }
+    if (cap > (SIZE_MAX - sizeof(ring_header_t)) / struct_size) {
+        return 0;
+    }
+    return sizeof(ring_header_t) + cap * struct_size;
+}
+
+ftcs_shm_ring_t *ftcs_shm_ring_init(void *addr, size_t size, size_t struct_size,
+                                    unsigned consumers)
+{
+    // 引数チェック：管理領域は _Alignas を含むためキャッシュライン境界に置く
+    if (!addr || (uintptr_t)addr % CACHE_LINE_SIZE != 0 || struct_size == 0
+        || consumers == 0 || consumers > FTCS_SHM_RING_MAX_CONSUMERS) {
+        fprintf(stderr, "ftcs: ftcs_shm_ring_init に不正な引数が渡された\n");
+        return NULL;
+    }
+    if (size < ftcs_shm_ring_bytes(struct_size, 1)) {
+        fprintf(stderr, "ftcs: 共有メモリ領域（%zu バイト）にリングが収まらない\n", size);
+        return NULL;
+    }
+    uint64_t cap = 1; // 領域に収まる最大の 2 のべき乗のスロット数
+    while (cap <= (size - sizeof(ring_header_t)) / struct_size / 2) {
+        cap *= 2;
+    }
+
+    ring_header_t *hdr = addr; // 共有メモリ上の管理領域
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->struct_size = struct_size;
+    hdr->capacity    = cap;
+    hdr->consumers   = consumers;
+    // 他の項目が見えてから接続を受け付けるよう、識別子は最後に書く
+    atomic_store_explicit(&hdr->magic, RING_MAGIC, memory_order_release);
+    return ring_handle(addr, -1);
+}
+
+ftcs_shm_ring_t *ftcs_shm_ring_attach(void *addr, size_t size, size_t struct_size,
+                                      unsigned consumer)
+{
+    if (!addr || size < sizeof(ring_header_t)) {
+        fprintf(stderr, "ftcs: ftcs_shm_ring_attach に不正な引数が渡された\n");
+        return NULL;
+    }
+    const ring_header_t *hdr = addr; // 共有メモリ上の管理領域
+    if (atomic_load_explicit(&hdr->magic, memory_order_acquire) != RING_MAGIC) {
+        fprintf(stderr, "ftcs: 共有メモリ領域にリングが作られていない\n");
+        return NULL;
+    }
+    if (hdr->struct_size != struct_size
+        || hdr->capacity > (size - sizeof(ring_header_t)) / struct_size) {
+        fprintf(stderr, "ftcs: リングのレコードサイズ（%zu）または領域サイズが一致しない\n",
+                (size_t)hdr->struct_size);
+        return NULL;
+    }
+    if (consumer >= hdr->consumers) {
+        fprintf(stderr, "ftcs: 消費者番号 %u はリングの消費者数 %u を超える\n",
+                consumer, hdr->consumers);
+        return NULL;
+    }
+    return ring_handle(addr, (int)consumer);
+}
+
+long ftcs_shm_ring_push(ftcs_shm_ring_t *ring, const void *recs, size_t n, int timeout_ms)
+{
+    if (!ring || ring->consumer >= 0 || (!recs && n > 0)) {
+        fprintf(stderr, "ftcs: ftcs_shm_ring_push に不正な引数が渡された\n");
+        return -1;
+    }
+    ring_header_t *hdr = ring->hdr; // 共有メモリ上の管理領域
+    if (atomic_load_explicit(&hdr->closed, memory_order_relaxed)) {
+        fprintf(stderr, "ftcs: クローズ済みのリングに書き込もうとした\n");
+        return -1;
+    }
+    uint64_t deadline = ftcs_deadline_ns(timeout_ms); // 空きを待つ期限
+    size_t   done     = 0;                            // 書き込んだ件数
+    while (done < n) {
+        // 手元の上限に達したときだけ消費者の位置を読み直し、キャッシュラインの往復を減らす
+        if (ring->pos == ring->limit) {
+            unsigned who; // 最も遅い消費者
+            ring->limit = slowest_head(hdr, &who) + hdr->capacity;
+            if (ring->pos == ring->limit
+                && wait_moved(hdr, &hdr->heads[who], ring->pos - hdr->capacity, deadline) != 0) {
+                break;
+            }
+            continue;
+        }
+        size_t k = n - done; // 今回まとめて書く件数
+        if (k > ring->limit - ring->pos) {
+            k = (size_t)(ring->limit - ring->pos);
+        }
+        copy_slots(ring, NULL, (const char *)recs + done * ring->struct_size, k, 1);
+        ring->pos += k;
+        done      += k;
+        publish(&hdr->tail, ring->pos);
+    }
+    return (long)done;
+}
+
+long ftcs_shm_ring_pop(ftcs_shm_ring_t *ring, void *out, size_t max, int timeout_ms)
+{
+    if (!ring || ring->consumer < 0 || !out || max == 0) {
+        fprintf(stderr, "ftcs: ftcs_shm_ring_pop に不正な引数が渡された\n");
+        errno = EINVAL;
+        return -1;
+    }
+    ring_header_t *hdr      = ring->hdr;                    // 共有メモリ上の管理領域
+    uint64_t       deadline = ftcs_deadline_ns(timeout_ms); // 書き込みを待つ期限
+    // 手元に読めるレコードがなければ生産者の位置を読み直し、それでもなければ待つ
+    while (ring->pos == ring->limit) {
+        // クローズの前に書いた位置が必ず見えるよう、closed を先に読む
+        int closed  = (int)atomic_load_explicit(&hdr->closed, memory_order_acquire); // 書き込み終了済みか
+        ring->limit = atomic_load_explicit(&hdr->tail.pos, memory_order_acquire);
+        if (ring->pos != ring->limit) {
+            break;
+        }
+        if (closed) {
+            return 0;
+        }
+        if (wait_moved(hdr, &hdr->tail, ring->pos, deadline) != 0) {
+            return -1;
+        }
+    }
+    // 手元の写しが max 件に満たなければ、その後に書かれた分もまとめて取り出す
+    if (ring->limit - ring->pos < max) {
+        ring->limit = atomic_load_explicit(&hdr->tail.pos, memory_order_acquire);
+    }
+    size_t k = max; // 今回取り出す件数
+    if (k > ring->limit - ring->pos) {
+        k = (size_t)(ring->limit - ring->pos);
+    }
+    copy_slots(ring, out, NULL, k, 0);
+    ring->pos += k;
+    publish(&hdr->heads[ring->consumer], ring->pos);
+    return (long)k;
+}
+
+void ftcs_shm_ring_close(ftcs_shm_ring_t *ring)
+{
+    if (!ring || ring->consumer >= 0) {
+        return;
+    }
+    atomic_store(&ring->hdr->closed, 1);
+    // 位置は変わらないが、futex 語を進めて眠っている消費者を起こす
+    publish(&ring->hdr->tail, ring->pos);
+}
+
+void ftcs_shm_ring_detach(ftcs_shm_ring_t *ring)
+{
+    free(ring);
+}
+
+/**
+ * @brief 最も遅い消費者の位置を求める
+ *
+ * @param hdr 管理領域
+ * @param who 最も遅い消費者の番号を書き込む先
+ * @return その消費者の位置
+ */
+static uint64_t slowest_head(const ring_header_t *hdr, unsigned *who)
+{
+    uint64_t min = UINT64_MAX; // これまでで最小の位置
+    *who = 0;
+    for (unsigned i = 0; i < hdr->consumers; i++) {
+        // 消費者がスロットを読み終えてから位置を進めるため、acquire で読めば上書きしてよい
+        uint64_t head = atomic_load_explicit(&hdr->heads[i].pos, memory_order_acquire); // 消費者 i の位置
+        if (head < min) {
+            min  = head;
+            *who = i;
+        }
+    }
+    return min;
+}
+
+/**
+ * @brief 自分の位置から n 件を、環状のスロット配列との間で写す
+ *
+ * 配列の末尾をまたぐ場合は2回に分けて写す。
+ *
+ * @param r       ハンドル（r->pos から書き込む・読み出す）
+ * @param dst     読み出し先（to_ring なら未使用）
+ * @param src     書き込み元（to_ring でなければ未使用）
+ * @param n       件数（空き・未読の件数以下）
+ * @param to_ring 非ゼロならスロットへ書き込む
+ */
+static void copy_slots(ftcs_shm_ring_t *r, void *dst, const void *src, size_t n, int to_ring)
+{
+    size_t first = (size_t)(r->mask + 1 - (r->pos & r->mask)); // 配列の末尾までのスロット数
+    if (first > n) {
+        first = n;
+    }
+    char  *slot  = r->slots + (r->pos & r->mask) * r->struct_size; // 最初のスロット
+    size_t bytes = first * r->struct_size;                        // 末尾までに写すバイト数
+    size_t rest  = (n - first) * r->struct_size;                  // 先頭に折り返して写すバイト数
+    if (to_ring) {
+        memcpy(slot, src, bytes);
+        memcpy(r->slots, (const char *)src + bytes, rest);
+    } else {
+        memcpy(dst, slot, bytes);
+        memcpy((char *)dst + bytes, r->slots, rest);
+    }
+}
+
+/**
+ * @brief 自分の位置を公開し、futex で待っている相手がいれば起こす
+ *
+ * スロットへの書き込み（読み出し）は release で位置より先に見える。位置を書いてから futex 語を
+ * 進めるので、語の変化を見た相手には新しい位置も見える。
+ *
+ * @param c   自分の位置
+ * @param pos 新しい位置
+ */
+static void publish(ring_cursor_t *c, uint64_t pos)
+{
+    atomic_store_explicit(&c->pos, pos, memory_order_release);
+    ftcs_futex_bump(&c->word, &c->waiters);
+}
+
+/**
+ * @brief 相手の位置が stale から進むまで待つ
+ *
+ * 位置を確かめる前に futex 語を読んでおき、確かめた後の公開・クローズで語が変わるのを待つ。
+ *
+ * @param hdr      管理領域（生産者のクローズも待ち終わりの条件にする）
+ * @param c        待つ相手の位置
+ * @param stale    待ち始めた時点の相手の位置
+ * @param deadline 期限（ftcs_deadline_ns() の値）
+ * @return 進んだら 0、期限切れなら -1（errno = ETIMEDOUT）
+ */
+static int wait_moved(const ring_header_t *hdr, ring_cursor_t *c, uint64_t stale,
+                      uint64_t deadline)
+{
+    for (;;) {
+        uint32_t seen = __atomic_load_n(&c->word, __ATOMIC_SEQ_CST); // 位置を確かめる前の futex 語
+        if (cursor_moved(hdr, c, stale)) {
+            return 0;
+        }
+        if (ftcs_futex_wait_until(&c->word, seen, deadline, &c->waiters) != 0) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief 待ち終えてよいか（相手の位置が進んだか、生産者がクローズしたか）を返す
+ *
+ * @param hdr   管理領域
+ * @param c     待つ相手の位置
+ * @param stale 待ち始めた時点の相手の位置
+ * @return 待ち終えてよければ非ゼロ
+ */
+static int cursor_moved(const ring_header_t *hdr, const ring_cursor_t *c, uint64_t stale)
+{
+    return atomic_load_explicit(&c->pos, memory_order_acquire) != stale
+           || atomic_load_explicit(&hdr->closed, memory_order_acquire);
+}
+
+/**
+ * @brief 管理領域を指すハンドルを作る
+ *
+ * @param addr     共有メモリ領域の先頭（初期化済み）
+ * @param consumer 消費者番号（生産者なら -1）
+ * @return ハンドル、確保失敗時 NULL
+ */
+static ftcs_shm_ring_t *ring_handle(void *addr, int consumer)
+{
+    ftcs_shm_ring_t *r = calloc(1, sizeof(*r)); // 作成するハンドル
+    if (!r) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    r->hdr         = addr;
+    r->slots       = (char *)addr + sizeof(ring_header_t);
+    r->mask        = r->hdr->capacity - 1;
+    r->struct_size = (size_t)r->hdr->struct_size;
+    r->consumer    = consumer;
+    // 同じ番号で接続し直した場合は前回読み終えた位置から続ける
+    r->pos   = atomic_load(consumer < 0 ? &r->hdr->tail.pos : &r->hdr->heads[consumer].pos);
+    r->limit = r->pos;
+    return r;
+}
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+size_t ftcs_ring_producer_size(const ftcs_shm_ring_t *ring)
+{
+    return ring->consumer < 0 ? ring->struct_size : 0;
+}
@@ -0,0 +1,575 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "ftcs_internal.h"
+
+// epoll_wait 1回で受け取るイベント数の上限
+#define SERVER_MAX_EVENTS 64
+
+// listen のバックログ。多数のクライアントが一斉に接続しても取りこぼさない大きさにする。
+#define SERVER_BACKLOG 1024
+
+// 1回の read で受信バッファに確保しておく空き容量
+#define CONN_READ_CHUNK (64u * 1024)
+
+// 未送信の応答がこのバイト数を超えたら、送り切るまでその接続からの読み込みを止める。
+// 応答を読まずに要求だけを送り続けるクライアントでサーバーのメモリが膨らむのを防ぐ。
+#define CONN_OUT_HIGH_WATER (4u * 1024 * 1024)
+
+// --- 内部型定義 ---
+
+/**
+ * @brief クライアント接続1本分の状態
+ */
+typedef struct conn {
+    int          fd;       /**< 接続ソケット */
+    char        *in;       /**< 受信バッファ（未処理の要求バイト列） */
+    size_t       in_len;   /**< in に溜まっているバイト数 */
+    size_t       in_cap;   /**< in の確保済みバイト数 */
+    char        *out;      /**< 送信バッファ（未送信の応答バイト列） */
+    size_t       out_off;  /**< out の送信済みバイト数 */
+    size_t       out_len;  /**< out に溜まっているバイト数 */
+    size_t       out_cap;  /**< out の確保済みバイト数 */
+    uint32_t     events;   /**< epoll に登録中のイベント */
+    int          closing;  /**< 非ゼロなら応答を送り切った時点で閉じる */
+    struct conn *prev;     /**< 接続リストの前要素 */
+    struct conn *next;     /**< 接続リストの次要素 */
+} conn_t;
+
+struct ftcs_server {
+    int                      listen_fd;   /**< 待ち受けソケット */
+    int                      epoll_fd;    /**< イベント待ち用 epoll */
+    int                      stop_fd;     /**< 停止要求を受ける eventfd */
+    char                    *path;        /**< ソケットファイルのパス（破棄時に削除する） */
+    const ftcs_record_set_t *rs;          /**< 公開するレコード集合 */
+    int                      by_index;    /**< 添字で検索するなら非ゼロ */
+    ftcs_key_index_t        *idx;         /**< FTCS_KEY_FIELD 用のキー索引 */
+    conn_t                  *conns;       /**< 接続中のクライアント一覧 */
+};
+
+// --- 関数宣言（目次） ---
+
+static int          open_listen_socket(const char *path);                 // ソケットを bind して待ち受けを始める
+static void         accept_clients(ftcs_server_t *srv);                   // 待機中の接続をすべて受け付ける
+static void         handle_conn(ftcs_server_t *srv, conn_t *c, uint32_t ev); // 接続1本のイベントを処理する
+static int          read_requests(ftcs_server_t *srv, conn_t *c);         // 受信して完結した要求に応答する
+static int          process_requests(ftcs_server_t *srv, conn_t *c);      // 受信バッファ内の要求をすべて処理する
+static const void  *lookup(const ftcs_server_t *srv, const char *key);    // キーに対応するレコードを引く
+static int          push_response(conn_t *c, uint32_t status,
+                                  const void *rec, uint32_t len);         // 応答を送信バッファに積む
+static int          flush_out(conn_t *c);                                 // 送信バッファを送れるだけ送る
+static int          update_events(ftcs_server_t *srv, conn_t *c);         // 接続の監視イベントを状態に合わせる
+static void         close_conn(ftcs_server_t *srv, conn_t *c);            // 接続を閉じてリストから外す
+static int          reserve(char **buf, size_t *cap, size_t need);        // バッファの容量を確保する
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+ftcs_server_t *ftcs_server_create(const char *socket_path,
+                                  const ftcs_record_set_t *rs,
+                                  const ftcs_field_mapping_t *mapping,
+                                  const ftcs_parser_config_t *config)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!socket_path || !rs || !mapping || !config) {
+        fprintf(stderr, "ftcs: ftcs_server_create に NULL 引数が渡された\n");
+        return NULL;
+    }
+    int by_index = (config->primary_key_mode == FTCS_KEY_INDEX); // 添字で検索するか
+    // フィールド名で検索するため primary_key の設定が必要
+    if (!by_index && !config->primary_key) {
+        fprintf(stderr, "ftcs: primary_key が設定されていない\n");
+        return NULL;
+    }
+
+    ftcs_server_t *srv = calloc(1, sizeof(*srv)); // 作成するサーバー
+    if (!srv) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    srv->listen_fd = -1;
+    srv->epoll_fd  = -1;
+    srv->stop_fd   = -1;
+    srv->rs        = rs;
+    srv->by_index  = by_index;
+
+    // 索引構築は接続を受け付ける前に済ませ、最初の要求から O(1) で引けるようにする
+    if (!by_index) {
+        srv->idx = ftcs_key_index_build(rs, mapping, config->primary_key);
+        if (!srv->idx) {
+            ftcs_server_destroy(srv);
+            return NULL;
+        }
+    }
+    srv->path = strdup(socket_path);
+    if (!srv->path) {
+        perror("ftcs: strdup");
+        ftcs_server_destroy(srv);
+        return NULL;
+    }
+    srv->listen_fd = open_listen_socket(socket_path);
+    if (srv->listen_fd < 0) {
+        // 他プロセスのソケットを消さないよう、bind できなかったパスは破棄時に削除しない
+        free(srv->path);
+        srv->path = NULL;
+        ftcs_server_destroy(srv);
+        return NULL;
+    }
+    srv->stop_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    srv->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (srv->stop_fd < 0 || srv->epoll_fd < 0) {
+        perror("ftcs: eventfd/epoll_create1");
+        ftcs_server_destroy(srv);
+        return NULL;
+    }
+
+    // 待ち受けソケットと停止通知は data.ptr に自身の fd 変数のアドレスを入れて接続と区別する
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &srv->listen_fd }; // 待ち受けの登録内容
+    struct epoll_event sv = { .events = EPOLLIN, .data.ptr = &srv->stop_fd };   // 停止通知の登録内容
+    if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, srv->listen_fd, &ev) != 0
+        || epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, srv->stop_fd, &sv) != 0) {
+        perror("ftcs: epoll_ctl");
+        ftcs_server_destroy(srv);
+        return NULL;
+    }
+    return srv;
+}
+
+int ftcs_server_run(ftcs_server_t *srv)
+{
+    if (!srv) {
+        return -1;
+    }
+    struct epoll_event events[SERVER_MAX_EVENTS]; // 受け取ったイベント
+    for (;;) {
+        int n = epoll_wait(srv->epoll_fd, events, SERVER_MAX_EVENTS, -1); // イベント数
+        if (n < 0) {
+            // シグナルで中断された場合は停止要求の有無を次の epoll_wait で確認する
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("ftcs: epoll_wait");
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr; // イベントの発生元
+            if (tag == &srv->stop_fd) {
+                uint64_t v; // 読み捨てる eventfd のカウンタ
+                if (read(srv->stop_fd, &v, sizeof(v)) < 0) {
+                    // 読めなくても停止要求があったことに変わりはない
+                }
+                return 0;
+            }
+            if (tag == &srv->listen_fd) {
+                accept_clients(srv);
+            } else {
+                handle_conn(srv, tag, events[i].events);
+            }
+        }
+    }
+}
+
+void ftcs_server_stop(ftcs_server_t *srv)
+{
+    if (!srv) {
+        return;
+    }
+    uint64_t one = 1; // eventfd に加算する値
+    // シグナルハンドラから呼ばれても安全なよう write だけを行う
+    if (write(srv->stop_fd, &one, sizeof(one)) < 0) {
+        // カウンタが飽和していても停止要求は既に届いている
+    }
+}
+
+void ftcs_server_destroy(ftcs_server_t *srv)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!srv) {
+        return;
+    }
+    while (srv->conns) {
+        close_conn(srv, srv->conns);
+    }
+    if (srv->listen_fd >= 0) {
+        close(srv->listen_fd);
+    }
+    if (srv->epoll_fd >= 0) {
+        close(srv->epoll_fd);
+    }
+    if (srv->stop_fd >= 0) {
+        close(srv->stop_fd);
+    }
+    if (srv->path) {
+        unlink(srv->path);
+        free(srv->path);
+    }
+    ftcs_key_index_free(srv->idx);
+    free(srv);
+}
+
+/**
+ * @brief AF_UNIX ソケットを作成し、path に bind して待ち受けを始める
+ *
+ * 前回のプロセスが残した古いソケットファイルは削除してから bind する。
+ * ソケット以外のファイルは誤って消さないようエラーとする。
+ *
+ * @param path ソケットファイルのパス
+ * @return 非ブロッキングの待ち受けソケット、失敗時 -1
+ */
+static int open_listen_socket(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX }; // bind 先のアドレス
+    // sun_path は NUL 終端を含めて収まらなければならない
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "ftcs: ソケットパスが長すぎる（最大 %zu バイト）: '%s'\n",
+                sizeof(addr.sun_path) - 1, path);
+        return -1;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    struct stat st; // 既存ファイルの種別
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "ftcs: '%s' はソケットではないファイルとして既に存在する\n", path);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0); // 待ち受けソケット
+    if (fd < 0) {
+        perror("ftcs: socket");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "ftcs: '%s' に bind できない: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SERVER_BACKLOG) != 0) {
+        perror("ftcs: listen");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 待機中の接続をすべて受け付け、epoll に登録する
+ *
+ * @param srv サーバー
+ */
+static void accept_clients(ftcs_server_t *srv)
+{
+    for (;;) {
+        int fd = accept4(srv->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC); // 接続ソケット
+        if (fd < 0) {
+            // EAGAIN は待機中の接続を受け付け終えたことを示す
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("ftcs: accept4");
+            }
+            return;
+        }
+        conn_t *c = calloc(1, sizeof(*c)); // 新しい接続の状態
+        if (!c) {
+            perror("ftcs: calloc");
+            close(fd);
+            continue;
+        }
+        c->fd     = fd;
+        c->events = EPOLLIN;
+        struct epoll_event ev = { .events = c->events, .data.ptr = c }; // 登録内容
+        if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("ftcs: epoll_ctl");
+            close(fd);
+            free(c);
+            continue;
+        }
+        c->next = srv->conns;
+        if (srv->conns) {
+            srv->conns->prev = c;
+        }
+        srv->conns = c;
+    }
+}
+
+/**
+ * @brief 接続1本のイベントを処理する
+ *
+ * 受信した要求はまとめて処理し、応答も1回の送信でまとめて返す（パイプライン）。
+ * 送り切れない応答は EPOLLOUT を待って続きを送る。
+ *
+ * @param srv サーバー
+ * @param c   イベントが発生した接続
+ * @param ev  発生したイベント
+ */
+static void handle_conn(ftcs_server_t *srv, conn_t *c, uint32_t ev)
+{
+    if (ev & EPOLLERR) {
+        close_conn(srv, c);
+        return;
+    }
+    // EPOLLHUP でも受信済みのデータは読めるので、read が 0 を返すまで読み進める
+    if ((ev & (EPOLLIN | EPOLLHUP)) && !c->closing) {
+        if (read_requests(srv, c) != 0) {
+            close_conn(srv, c);
+            return;
+        }
+    }
+    if (flush_out(c) != 0) {
+        close_conn(srv, c);
+        return;
+    }
+    // 相手が送信を終えていて、応答もすべて送り終えたら閉じる
+    if (c->closing && c->out_len == 0) {
+        close_conn(srv, c);
+        return;
+    }
+    if (update_events(srv, c) != 0) {
+        close_conn(srv, c);
+    }
+}
+
+/**
+ * @brief ソケットから受信し、完結した要求に応答する
+ *
+ * 相手が送信を終えた（read が 0）場合は closing を立て、積んだ応答を送り切ってから閉じる。
+ *
+ * @param srv サーバー
+ * @param c   受信する接続
+ * @return 成功時 0、接続を直ちに閉じるべき場合 -1
+ */
+static int read_requests(ftcs_server_t *srv, conn_t *c)
+{
+    if (reserve(&c->in, &c->in_cap, c->in_len + CONN_READ_CHUNK) != 0) {
+        return -1;
+    }
+    ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len); // 受信バイト数
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    if (n == 0) {
+        c->closing = 1;
+        return 0;
+    }
+    c->in_len += (size_t)n;
+    return process_requests(srv, c);
+}
+
+/**
+ * @brief 受信バッファ内の完結した要求をすべて処理し、応答を送信バッファに積む
+ *
+ * 未完結の末尾は次の受信まで残す。キー長が上限を超える要求には BAD_REQUEST を返し、
+ * 以降の受信を打ち切る（フレーム境界を見失うため）。
+ *
+ * @param srv サーバー
+ * @param c   処理する接続
+ * @return 成功時 0、確保失敗時 -1
+ */
+static int process_requests(ftcs_server_t *srv, conn_t *c)
+{
+    char   key[FTCS_LOOKUP_MAX_KEY + 1]; // NUL 終端したキー
+    size_t pos = 0;                      // 処理済みバイト数
+    while (c->in_len - pos >= sizeof(ftcs_lookup_req_t)) {
+        ftcs_lookup_req_t req; // 要求ヘッダ
+        memcpy(&req, c->in + pos, sizeof(req));
+        if (req.key_len > FTCS_LOOKUP_MAX_KEY) {
+            c->closing = 1;
+            c->in_len  = 0;
+            return push_response(c, FTCS_LOOKUP_BAD_REQUEST, NULL, 0);
+        }
+        if (c->in_len - pos - sizeof(req) < req.key_len) {
+            break;
+        }
+        memcpy(key, c->in + pos + sizeof(req), req.key_len);
+        key[req.key_len] = '\0';
+        pos += sizeof(req) + req.key_len;
+
+        const void *rec = lookup(srv, key); // 検索結果
+        int rc = rec ? push_response(c, FTCS_LOOKUP_FOUND, rec, (uint32_t)srv->rs->struct_size)
+                     : push_response(c, FTCS_LOOKUP_NOT_FOUND, NULL, 0); // 応答の積み込み結果
+        if (rc != 0) {
+            return -1;
+        }
+    }
+    // 未完結の要求を先頭に詰める
+    memmove(c->in, c->in + pos, c->in_len - pos);
+    c->in_len -= pos;
+    return 0;
+}
+
+/**
+ * @brief キーに対応するレコードを引く
+ *
+ * 添字検索ではエラーメッセージを出さない（不正なキーは NOT_FOUND として応答する）。
+ *
+ * @param srv サーバー
+ * @param key NUL 終端したキー
+ * @return レコード、見つからなければ NULL
+ */
+static const void *lookup(const ftcs_server_t *srv, const char *key)
+{
+    if (!srv->by_index) {
+        return ftcs_key_index_find(srv->idx, key);
+    }
+    // 先頭の符号や空白を受け付ける strtoul の前に数字だけで構成されているかを確かめる
+    if (key[0] < '0' || key[0] > '9') {
+        return NULL;
+    }
+    char         *endptr; // 変換終端ポインタ
+    unsigned long idx = strtoul(key, &endptr, 10); // 0-based の添字
+    if (*endptr != '\0' || idx >= srv->rs->count) {
+        return NULL;
+    }
+    return (const char *)srv->rs->records + idx * srv->rs->struct_size;
+}
+
+/**
+ * @brief 応答ヘッダとレコードを送信バッファの末尾に積む
+ *
+ * @param c      応答を返す接続
+ * @param status ftcs_lookup_status_t の値
+ * @param rec    レコード（status が FOUND 以外なら NULL）
+ * @param len    レコードのバイト数
+ * @return 成功時 0、確保失敗時 -1
+ */
+static int push_response(conn_t *c, uint32_t status, const void *rec, uint32_t len)
+{
+    ftcs_lookup_resp_t resp = { status, len }; // 応答ヘッダ
+    // 送信済みの先頭部分を詰めてから追記する
+    if (c->out_off > 0) {
+        memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+        c->out_len -= c->out_off;
+        c->out_off  = 0;
+    }
+    if (reserve(&c->out, &c->out_cap, c->out_len + sizeof(resp) + len) != 0) {
+        return -1;
+    }
+    memcpy(c->out + c->out_len, &resp, sizeof(resp));
+    if (len > 0) {
+        memcpy(c->out + c->out_len + sizeof(resp), rec, len);
+    }
+    c->out_len += sizeof(resp) + len;
+    return 0;
+}
+
+/**
+ * @brief 送信バッファを送れるだけ送る
+ *
+ * @param c 送信する接続
+ * @return 成功時 0（送り残しがあっても 0）、接続エラー時 -1
+ */
+static int flush_out(conn_t *c)
+{
+    while (c->out_off < c->out_len) {
+        // 相手が先に切断していても SIGPIPE でプロセスを落とさない
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off,
+                         MSG_NOSIGNAL); // 送信バイト数
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        c->out_off += (size_t)n;
+    }
+    c->out_off = 0;
+    c->out_len = 0;
+    return 0;
+}
+
+/**
+ * @brief 送り残しの有無に合わせて接続の監視イベントを切り替える
+ *
+ * 送り残しがあれば EPOLLOUT を監視し、上限（CONN_OUT_HIGH_WATER）を超えていれば
+ * 送り切るまで EPOLLIN を外して新しい要求の受信を止める。
+ *
+ * @param srv サーバー
+ * @param c   対象の接続
+ * @return 成功時 0、epoll_ctl 失敗時 -1
+ */
+static int update_events(ftcs_server_t *srv, conn_t *c)
+{
+    size_t   pending = c->out_len - c->out_off; // 送り残しのバイト数
+    uint32_t events  = 0;                       // 監視すべきイベント
+    if (!c->closing && pending <= CONN_OUT_HIGH_WATER) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events == c->events) {
+        return 0;
+    }
+    struct epoll_event ev = { .events = events, .data.ptr = c }; // 変更後の登録内容
+    if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev) != 0) {
+        perror("ftcs: epoll_ctl");
+        return -1;
+    }
+    c->events = events;
+    return 0;
+}
+
+/**
+ * @brief 接続を閉じ、接続リストから外して解放する
+ *
+ * @param srv サーバー
+ * @param c   閉じる接続
+ */
+static void close_conn(ftcs_server_t *srv, conn_t *c)
+{
+    // close で epoll の登録も外れる
+    close(c->fd);
+    if (c->prev) {
+        c->prev->next = c->next;
+    } else {
+        srv->conns = c->next;
+    }
+    if (c->next) {
+        c->next->prev = c->prev;
+    }
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+/**
+ * @brief バッファの容量を need バイト以上に広げる（倍々で拡張する）
+ *
+ * @param buf  対象のバッファ（拡張時に差し替えられる）
+ * @param cap  現在の容量（拡張時に更新される）
+ * @param need 必要なバイト数
+ * @return 成功時 0、realloc 失敗時 -1
+ */
+static int reserve(char **buf, size_t *cap, size_t need)
+{
+    if (need <= *cap) {
+        return 0;
+    }
+    size_t new_cap = *cap ? *cap : CONN_READ_CHUNK; // 拡張後の容量
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    char *p = realloc(*buf, new_cap); // 拡張後のバッファ
+    if (!p) {
+        perror("ftcs: realloc");
+        return -1;
+    }
+    *buf = p;
+    *cap = new_cap;
+    return 0;
+}
@@ -0,0 +1,509 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include "ftcs_internal.h"
+
+// futex で眠る前に語の変化を待つスピン回数。相手の短い書き込み（レコード数件分の公開）なら
+// システムコールなしで追いつける長さにする。
+#define FUTEX_SPIN_LIMIT 256
+
+// hugetlbfs のマウント先。systemd を使う多くのディストリビューションがここにマウントする。
+#define HUGETLBFS_DIR "/dev/hugepages"
+
+// shmem の THP 設定。[ ] で囲まれた値が現在の設定。
+#define SHMEM_THP_PATH "/sys/kernel/mm/transparent_hugepage/shmem_enabled"
+
+// THP を使うときの切り上げ単位（x86-64 / arm64 の PMD ページ）。端数のページは 4KiB のまま割り当てられる。
+#define THP_PAGE_SIZE (2u * 1024 * 1024)
+
+// セグメントの識別子。ヘッダーの他のメンバを書いた後に書くので、作成途中のセグメントには現れない。
+#define SEGMENT_MAGIC "FTCSSHM1"
+
+// レコード配列の先頭の境界。ヘッダー（更新通知）と先頭レコードが同じキャッシュラインを共有しないようにする。
+#define RECORDS_ALIGN 64
+
+// --- 内部型定義 ---
+
+/**
+ * @brief セグメント先頭に置くヘッダー（RECORDS_ALIGN バイトに切り上げた後ろからレコード配列）
+ */
+typedef struct {
+    char              magic[8];    /**< SEGMENT_MAGIC（NUL 終端なし） */
+    uint64_t          struct_size; /**< 1レコードのバイトサイズ */
+    uint64_t          capacity;    /**< 格納できるレコード数 */
+    uint32_t          replaced;    /**< ftcs_shm_grow() で新しいセグメントに置き換えたら非ゼロ */
+    ftcs_shm_notify_t notify;      /**< レコード配列の更新通知 */
+} segment_header_t;
+
+// レコード配列のセグメント先頭からの位置
+#define RECORDS_OFFSET ((sizeof(segment_header_t) + RECORDS_ALIGN - 1) / RECORDS_ALIGN * RECORDS_ALIGN)
+
+// --- 関数宣言（目次） ---
+
+static int      notify_wait(const ftcs_shm_notify_t *n, uint32_t stale, uint64_t deadline); // 世代が変わるまで待つ
+static int      create_segment(ftcs_shm_t *shm, const char *name, size_t need, unsigned flags,
+                               int hugetlb);                                  // 1つの置き場所で作ってマップする
+static int      open_file(const char *name, int hugetlb, int oflag);          // 名前に対応するファイルを開く
+static void     unlink_file(const char *name, int hugetlb);                   // 名前を消す
+static int      map_segment(ftcs_shm_t *shm, int fd, size_t len, unsigned flags); // マップしてフラグを適用する
+static int      shmem_thp_enabled(void);                                      // shmem の THP が使えるか
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+// 公開ヘッダは C++ からも読むため _Atomic を使わず、メンバは __atomic 組み込み関数で読み書きする
+
+void ftcs_shm_publish_begin(ftcs_shm_notify_t *n)
+{
+    if (!n) {
+        return;
+    }
+    // 加算自体は後続の（非アトミックな）レコード書き込みを後ろに留めないため、release フェンスで
+    // 順序を付ける。ftcs_shm_read_retry の acquire フェンスと対になり、書き込み途中のレコードを
+    // 読んだ読み出し側は必ず奇数か別の世代を見て読み直す
+    __atomic_fetch_add(&n->generation, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void ftcs_shm_publish_end(ftcs_shm_notify_t *n, size_t count)
+{
+    if (!n) {
+        return;
+    }
+    __atomic_store_n(&n->count, (uint64_t)count, __ATOMIC_RELAXED);
+    __atomic_store_n(&n->publish_ns, ftcs_now_ns(), __ATOMIC_RELAXED);
+    // 世代を偶数に戻し、眠っている読み出し側を起こす
+    ftcs_futex_bump(&n->generation, &n->waiters);
+}
+
+int ftcs_shm_wait_update(const ftcs_shm_notify_t *n, uint32_t *seen, int timeout_ms)
+{
+    if (!n || !seen) {
+        fprintf(stderr, "ftcs: ftcs_shm_wait_update に NULL 引数が渡された\n");
+        return -1;
+    }
+    uint64_t deadline = ftcs_deadline_ns(timeout_ms); // 待つ期限
+    // 書き込み中（奇数）の世代は受け取らず、公開が終わるまで待つ
+    for (;;) {
+        uint32_t gen = __atomic_load_n(&n->generation, __ATOMIC_ACQUIRE); // 現在の世代
+        if (gen != *seen && gen % 2 == 0) {
+            *seen = gen;
+            return 1;
+        }
+        if (notify_wait(n, gen, deadline) != 0) {
+            return 0;
+        }
+    }
+}
+
+uint32_t ftcs_shm_read_begin(const ftcs_shm_notify_t *n)
+{
+    for (;;) {
+        uint32_t gen = __atomic_load_n(&n->generation, __ATOMIC_ACQUIRE); // 現在の世代
+        if (gen % 2 == 0) {
+            return gen;
+        }
+        notify_wait(n, gen, UINT64_MAX);
+    }
+}
+
+int ftcs_shm_read_retry(const ftcs_shm_notify_t *n, uint32_t gen)
+{
+    // レコードの読み出しが世代の読み直しより後ろへずれないようにする
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&n->generation, __ATOMIC_RELAXED) != gen;
+}
+
+size_t ftcs_shm_count(const ftcs_shm_notify_t *n)
+{
+    return (size_t)__atomic_load_n(&n->count, __ATOMIC_RELAXED);
+}
+
+int ftcs_shm_create(ftcs_shm_t *shm, const char *name, size_t struct_size, size_t capacity,
+                    unsigned flags)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!shm || !name || struct_size == 0) {
+        fprintf(stderr, "ftcs: ftcs_shm_create に不正な引数が渡された\n");
+        return -1;
+    }
+    memset(shm, 0, sizeof(*shm));
+    if (capacity > (SIZE_MAX / 2 - RECORDS_OFFSET) / struct_size) {
+        fprintf(stderr, "ftcs: 共有メモリの容量が大きすぎる: %zu 件\n", capacity);
+        return -1;
+    }
+    size_t need = RECORDS_OFFSET + capacity * struct_size; // 最低限必要なバイト数
+    int    ret  = -1;                                      // 作成結果
+    if (flags & FTCS_SHM_HUGETLB) {
+        ret = create_segment(shm, name, need, flags, 1);
+        if (ret != 0) {
+            fprintf(stderr, "ftcs: '%s' に大きなページを確保できないため 4KiB ページで作る\n", name);
+        }
+    }
+    if (ret != 0) {
+        ret = create_segment(shm, name, need, flags & ~(unsigned)FTCS_SHM_HUGETLB, 0);
+    }
+    if (ret != 0) {
+        return -1;
+    }
+    shm->name = strdup(name);
+    if (!shm->name) {
+        perror("ftcs: strdup");
+        ftcs_shm_close(shm);
+        return -1;
+    }
+
+    // 端数まで容量に含め、ヘッダーの他のメンバが見えてから識別子が見えるようにする
+    segment_header_t *hdr = shm->base; // セグメント先頭のヘッダー
+    shm->notify   = &hdr->notify;
+    shm->records  = (char *)shm->base + RECORDS_OFFSET;
+    shm->capacity = (shm->len - RECORDS_OFFSET) / struct_size;
+    hdr->struct_size = struct_size;
+    hdr->capacity    = shm->capacity;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(hdr->magic, SEGMENT_MAGIC, sizeof(hdr->magic));
+    return 0;
+}
+
+int ftcs_shm_open(ftcs_shm_t *shm, const char *name, size_t struct_size, unsigned flags)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!shm || !name || struct_size == 0) {
+        fprintf(stderr, "ftcs: ftcs_shm_open に不正な引数が渡された\n");
+        return -1;
+    }
+    memset(shm, 0, sizeof(*shm));
+    // POSIX 共有メモリになければ、大きなページで作られたものとして hugetlbfs を探す
+    int hugetlb = 0;                          // hugetlbfs 上で見つけたか
+    int fd      = open_file(name, 0, O_RDWR); // セグメントのファイル
+    if (fd < 0 && errno == ENOENT) {
+        hugetlb = 1;
+        fd      = open_file(name, 1, O_RDWR);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "ftcs: 共有メモリ '%s' を開けない: %s\n", name, strerror(errno));
+        return -1;
+    }
+    struct stat st; // セグメントの大きさの確認に使う
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < RECORDS_OFFSET) {
+        fprintf(stderr, "ftcs: 共有メモリ '%s' は ftcs のセグメントではない\n", name);
+        close(fd);
+        return -1;
+    }
+    int mapped = map_segment(shm, fd, (size_t)st.st_size,
+                             (flags & ~(unsigned)FTCS_SHM_HUGETLB) | (hugetlb ? FTCS_SHM_HUGETLB : 0)); // マップ結果
+    close(fd); // fd は mmap 後に不要
+    if (mapped != 0) {
+        return -1;
+    }
+
+    const segment_header_t *hdr = shm->base; // セグメント先頭のヘッダー
+    int valid = memcmp(hdr->magic, SEGMENT_MAGIC, sizeof(hdr->magic)) == 0; // 作成を終えたセグメントか
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (!valid || hdr->struct_size != struct_size
+        || hdr->capacity > (shm->len - RECORDS_OFFSET) / struct_size) {
+        fprintf(stderr, "ftcs: 共有メモリ '%s' は未初期化か、レコードサイズが違う\n", name);
+        ftcs_shm_close(shm);
+        return -1;
+    }
+    shm->notify   = (ftcs_shm_notify_t *)&hdr->notify;
+    shm->records  = (char *)shm->base + RECORDS_OFFSET;
+    shm->capacity = (size_t)hdr->capacity;
+    return 0;
+}
+
+int ftcs_shm_grow(ftcs_shm_t *shm, size_t capacity)
+{
+    // 名前を持つ（作成した）側だけが作り直せる
+    if (!shm || !shm->base || !shm->name) {
+        fprintf(stderr, "ftcs: ftcs_shm_grow は ftcs_shm_create で作ったセグメントにのみ使える\n");
+        return -1;
+    }
+    if (capacity <= shm->capacity) {
+        return 0;
+    }
+    segment_header_t *old = shm->base; // 置き換える古いセグメントのヘッダー
+    ftcs_shm_t        next;           // 新しいセグメント
+    // ftcs_shm_create は同じ名前を外してから作るため、古いマップはこのプロセスと読み出し側に残る
+    if (ftcs_shm_create(&next, shm->name, (size_t)old->struct_size, capacity, shm->flags) != 0) {
+        return -1;
+    }
+
+    // 直近の公開内容と世代を引き継ぐ。世代は古い側を進めた後の値にそろえ、
+    // 開き直した読み出し側が同じ公開を新しい世代として受け取らないようにする
+    size_t   count = ftcs_shm_count(shm->notify);                              // 直近に公開したレコード数
+    uint32_t gen   = __atomic_load_n(&old->notify.generation, __ATOMIC_ACQUIRE); // 古い側の世代（偶数）
+    memcpy(next.records, shm->records, count * (size_t)old->struct_size);
+    __atomic_store_n(&next.notify->count, (uint64_t)count, __ATOMIC_RELAXED);
+    __atomic_store_n(&next.notify->publish_ns,
+                     __atomic_load_n(&old->notify.publish_ns, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&next.notify->generation, gen + 2, __ATOMIC_RELEASE); // 先に開いた読み出し側にも内容が見える
+
+    // 置き換え済みを記してから古い側の世代を進め、待っている読み出し側を起こす
+    ftcs_shm_publish_begin(shm->notify);
+    __atomic_store_n(&old->replaced, 1, __ATOMIC_RELAXED);
+    ftcs_shm_publish_end(shm->notify, count);
+
+    // 名前は新しいセグメントのものなので、古い側は消さずにマップだけ外す
+    free(shm->name);
+    shm->name = NULL;
+    ftcs_shm_close(shm);
+    *shm = next;
+    return 0;
+}
+
+int ftcs_shm_replaced(const ftcs_shm_t *shm)
+{
+    if (!shm || !shm->base) {
+        return 0;
+    }
+    const segment_header_t *hdr = shm->base; // セグメント先頭のヘッダー
+    return __atomic_load_n(&hdr->replaced, __ATOMIC_ACQUIRE) != 0;
+}
+
+void ftcs_shm_close(ftcs_shm_t *shm)
+{
+    // NULL・閉じたものは何もしない（二重解放防止）
+    if (!shm || !shm->base) {
+        return;
+    }
+    if (shm->flags & FTCS_SHM_MLOCK) {
+        munlock(shm->base, shm->len);
+    }
+    munmap(shm->base, shm->len);
+    if (shm->name) {
+        unlink_file(shm->name, (shm->flags & FTCS_SHM_HUGETLB) != 0);
+        free(shm->name);
+    }
+    memset(shm, 0, sizeof(*shm));
+}
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+void ftcs_futex_bump(uint32_t *word, const uint32_t *waiters)
+{
+    // 語の加算と waiters の読み出しは seq_cst にする。ftcs_futex_wait_until() の
+    // 「waiters の加算 → 語の読み出し」と合わせ、眠る前に新しい語が見えるか、
+    // ここで待ち手に気づくかのどちらかが必ず成り立つ
+    __atomic_fetch_add(word, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST) > 0) {
+        syscall(SYS_futex, (void *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+int ftcs_futex_wait_until(uint32_t *word, uint32_t stale, uint64_t deadline, uint32_t *waiters)
+{
+    // 待たない指定（期限切れ）ならスピンせずに眠る前の確認へ進む
+    unsigned spin_limit = ftcs_now_ns() < deadline ? FUTEX_SPIN_LIMIT : 0; // スピン回数の上限
+    for (unsigned spins = 0; spins < spin_limit; spins++) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != stale) {
+            return 0;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause(); // スピン中に兄弟ハイパースレッドへ実行資源を譲る
+#endif
+    }
+    // 眠る直前に語を読み直し、その後の加算で起こされ損なわないようにする
+    for (;;) {
+        __atomic_fetch_add(waiters, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(word, __ATOMIC_SEQ_CST) != stale) {
+            __atomic_fetch_sub(waiters, 1, __ATOMIC_SEQ_CST);
+            return 0;
+        }
+        uint64_t now = ftcs_now_ns(); // 現在時刻
+        if (now >= deadline) {
+            __atomic_fetch_sub(waiters, 1, __ATOMIC_SEQ_CST);
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        struct timespec rel = { // 期限までの残り時間
+            .tv_sec  = (time_t)((deadline - now) / 1000000000u),
+            .tv_nsec = (long)((deadline - now) % 1000000000u),
+        };
+        // プロセスをまたいで起こし合うため FUTEX_PRIVATE_FLAG は付けない
+        syscall(SYS_futex, (void *)word, FUTEX_WAIT, stale,
+                deadline == UINT64_MAX ? NULL : &rel, NULL, 0);
+        __atomic_fetch_sub(waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * @brief 世代が stale から変わるまで待つ
+ *
+ * waiters は共有メモリ上の値を書き換えるので const を外す（読み出し側も書く唯一のメンバ）。
+ *
+ * @param n        更新通知
+ * @param stale    待ち始めた時点の世代
+ * @param deadline 期限（ftcs_deadline_ns() の値）
+ * @return 変わったら 0、期限切れなら -1
+ */
+static int notify_wait(const ftcs_shm_notify_t *n, uint32_t stale, uint64_t deadline)
+{
+    return ftcs_futex_wait_until((uint32_t *)&n->generation, stale, deadline,
+                                 (uint32_t *)&n->waiters);
+}
+
+/**
+ * @brief POSIX 共有メモリか hugetlbfs の一方にセグメントを作り、マップする
+ *
+ * 大きさは置き場所のページサイズ（THP を使うなら THP_PAGE_SIZE）の倍数に切り上げる。
+ * 失敗したら作りかけのファイルを消す。
+ *
+ * @param shm     設定先（成功時に base / len / flags を設定する）
+ * @param name    セグメントの名前
+ * @param need    最低限必要なバイト数
+ * @param flags   FTCS_SHM_* の論理和
+ * @param hugetlb 非ゼロなら hugetlbfs に作る
+ * @return 成功時 0、失敗時 -1
+ */
+static int create_segment(ftcs_shm_t *shm, const char *name, size_t need, unsigned flags,
+                          int hugetlb)
+{
+    // 同名の古いセグメントは名前だけ外し、マップ中の読み出し側には古い内容を残す
+    unlink_file(name, hugetlb);
+    int fd = open_file(name, hugetlb, O_RDWR | O_CREAT | O_EXCL); // 作成するファイル
+    if (fd < 0) {
+        if (!hugetlb) {
+            fprintf(stderr, "ftcs: 共有メモリ '%s' を作れない: %s\n", name, strerror(errno));
+        }
+        return -1;
+    }
+    size_t        page = (size_t)sysconf(_SC_PAGESIZE); // 切り上げ単位
+    struct statfs fs;                                   // hugetlbfs のページサイズの取得に使う
+    if (hugetlb && fstatfs(fd, &fs) == 0) {
+        page = (size_t)fs.f_bsize;
+    } else if (!hugetlb && (flags & FTCS_SHM_THP) && shmem_thp_enabled()) {
+        page = THP_PAGE_SIZE;
+    }
+    size_t len = (need + page - 1) / page * page; // ページの倍数に切り上げた大きさ
+    if (ftruncate(fd, (off_t)len) != 0) {
+        if (!hugetlb) {
+            perror("ftcs: ftruncate");
+        }
+        close(fd);
+        unlink_file(name, hugetlb);
+        return -1;
+    }
+    int mapped = map_segment(shm, fd, len, hugetlb ? flags | FTCS_SHM_HUGETLB : flags); // マップ結果
+    close(fd); // fd は mmap 後に不要
+    if (mapped != 0) {
+        unlink_file(name, hugetlb);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief セグメントの名前に対応するファイルを開く
+ * @param name    セグメントの名前（"/" で始まる）
+ * @param hugetlb 非ゼロなら HUGETLBFS_DIR 下のファイル、ゼロなら shm_open(3)
+ * @param oflag   open(2) のフラグ
+ * @return ファイルディスクリプタ、失敗時 -1（errno を設定する）
+ */
+static int open_file(const char *name, int hugetlb, int oflag)
+{
+    if (!hugetlb) {
+        return shm_open(name, oflag, 0600);
+    }
+    char path[PATH_MAX]; // hugetlbfs 上のパス
+    if (snprintf(path, sizeof(path), "%s/%s", HUGETLBFS_DIR, name + (name[0] == '/')) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return open(path, oflag, 0600);
+}
+
+/**
+ * @brief セグメントの名前を消す（存在しなければ何もしない）
+ * @param name    セグメントの名前
+ * @param hugetlb 非ゼロなら HUGETLBFS_DIR 下のファイル
+ */
+static void unlink_file(const char *name, int hugetlb)
+{
+    if (!hugetlb) {
+        shm_unlink(name);
+        return;
+    }
+    char path[PATH_MAX]; // hugetlbfs 上のパス
+    if (snprintf(path, sizeof(path), "%s/%s", HUGETLBFS_DIR, name + (name[0] == '/')) < (int)sizeof(path)) {
+        unlink(path);
+    }
+}
+
+/**
+ * @brief セグメントを共有マップし、ページの事前割り当て・THP・mlock を適用する
+ *
+ * THP と mlock は効かなくてもマップは続け、効いたものだけを shm->flags に残す。
+ *
+ * @param shm   設定先（base / len / flags）
+ * @param fd    セグメントのファイル
+ * @param len   マップするバイト数
+ * @param flags FTCS_SHM_* の論理和（FTCS_SHM_HUGETLB は置き場所の印としてそのまま残す）
+ * @return 成功時 0、mmap 失敗時 -1
+ */
+static int map_segment(ftcs_shm_t *shm, int fd, size_t len, unsigned flags)
+{
+    // THP は MADV_HUGEPAGE の後に割り当てたページから効くため、MAP_POPULATE（mmap と同時に
+    // 4KiB ページで割り当てる）は使わず、指定の後に読み出しで割り当てる
+    int thp      = (flags & FTCS_SHM_THP) && !(flags & FTCS_SHM_HUGETLB) && shmem_thp_enabled(); // THP を指定するか
+    int populate = (flags & FTCS_SHM_POPULATE) != 0; // 全ページを割り当てるか
+    int mflags   = MAP_SHARED | ((populate && !thp) ? MAP_POPULATE : 0); // mmap のフラグ
+    void *base = mmap(NULL, len, PROT_READ | PROT_WRITE, mflags, fd, 0); // マップ先
+    if (base == MAP_FAILED) {
+        if (!(flags & FTCS_SHM_HUGETLB)) {
+            perror("ftcs: mmap");
+        }
+        return -1;
+    }
+    if (thp && madvise(base, len, MADV_HUGEPAGE) != 0) {
+        thp = 0;
+    }
+    if (thp && populate) {
+        // 読み出し側のマップでも内容を書き換えないよう、各ページを読んで割り当てる
+        long page = sysconf(_SC_PAGESIZE); // 触れる間隔
+        for (size_t off = 0; off < len; off += (size_t)page) {
+            (void)*(volatile const char *)((const char *)base + off);
+        }
+    }
+    if (!thp) {
+        flags &= ~(unsigned)FTCS_SHM_THP;
+    }
+    if ((flags & FTCS_SHM_MLOCK) && mlock(base, len) != 0) {
+        fprintf(stderr, "ftcs: 共有メモリを mlock できない: %s\n", strerror(errno));
+        flags &= ~(unsigned)FTCS_SHM_MLOCK;
+    }
+    shm->base  = base;
+    shm->len   = len;
+    shm->flags = flags;
+    return 0;
+}
+
+/**
+ * @brief shmem（POSIX 共有メモリ）で MADV_HUGEPAGE が効く設定かを返す
+ * @return 効くなら非ゼロ（設定を読めなければ 0）
+ */
+static int shmem_thp_enabled(void)
+{
+    FILE *fp = fopen(SHMEM_THP_PATH, "r"); // shmem の THP 設定
+    if (!fp) {
+        return 0;
+    }
+    char buf[128] = { 0 }; // 設定の内容
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp); // 読んだバイト数
+    fclose(fp);
+    buf[n] = '\0';
+    return strstr(buf, "[always]") || strstr(buf, "[within_size]") || strstr(buf, "[advise]")
+           || strstr(buf, "[force]");
+}
@@ -0,0 +1,551 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftcs_internal.h"
+
+// LSD 基数ソート1パスで扱うビット数。8 ビット（256 バケット）ならスレッドごとの
+// ヒストグラムと振り分け先の書き込み位置が L1 に収まる。
+#define RADIX_BITS 8
+
+#define RADIX_BUCKETS ((size_t)1 << RADIX_BITS) // 1パスのバケット数
+#define RADIX_MASK    (RADIX_BUCKETS - 1)       // 1桁を取り出すマスク
+
+// 正規化したキーのバイト数（LSD 基数ソートのパス数の上限）
+#define KEY_BYTES sizeof(uint64_t)
+
+// 符号付き整数・浮動小数点数の符号ビット
+#define SIGN_BIT ((uint64_t)1 << 63)
+
+// 1スレッドに割り当てる最小レコード数（ftcs_parallel_threads に渡す）。
+// 振り分けは1件ごとにランダムな位置へ書き込むため、集計より小さい単位でも分割が引き合う。
+#define PARALLEL_MIN_RECORDS 65536
+
+// MSD 基数ソートでこの件数以下の範囲は挿入ソートに切り替える。
+// 256 バケットの計数より、数十件の比較と移動のほうが速い。
+#define INSERTION_THRESHOLD 32
+
+// 二分探索を1段ずつ交互に進めるキーの数。1キーの次のレコードの読み込みを待つ間に
+// 残りのキーの比較を進めるので、主記憶の遅延（約 100 ns）を比較 16 回分で覆える。
+#define PROBE_BATCH 16
+
+// --- 内部型定義 ---
+
+/**
+ * @brief スレッドに割り当てる処理の段階
+ */
+typedef enum {
+    PHASE_EXTRACT, /**< レコードからキーを取り出す */
+    PHASE_COUNT,   /**< 現在の桁のヒストグラムを数える */
+    PHASE_SCATTER, /**< 現在の桁で振り分ける */
+    PHASE_GATHER   /**< 並べ替えた順にレコードを集める */
+} sort_phase_t;
+
+/**
+ * @brief 1スレッド分の並べ替え範囲
+ */
+typedef struct {
+    const ftcs_record_set_t    *rs;       /**< 並べ替えるレコード集合 */
+    const ftcs_field_mapping_t *m;        /**< キーフィールド */
+    ftcs_sort_item_t           *src;      /**< 振り分け元（全体の配列） */
+    ftcs_sort_item_t           *dst;      /**< 振り分け先（全体の配列） */
+    char                       *out;      /**< PHASE_GATHER の書き込み先（全体の配列） */
+    size_t                      first;    /**< 受け持つ範囲の先頭位置 */
+    size_t                      n;        /**< 受け持つ件数 */
+    unsigned                    shift;    /**< 現在の桁のビット位置 */
+    sort_phase_t                phase;    /**< 実行する段階 */
+    size_t                      hist[RADIX_BUCKETS]; /**< 範囲内の桁ごとの件数（振り分け時は書き込み位置） */
+    uint64_t                    key_or;   /**< 範囲内のキーのビット和 */
+    uint64_t                    key_and;  /**< 範囲内のキーのビット積 */
+} sort_task_t;
+
+// --- 関数宣言（目次） ---
+
+static ftcs_sort_item_t *radix_sort(sort_task_t *tasks, size_t nthreads,
+                                    ftcs_sort_item_t *a, ftcs_sort_item_t *b); // 正規化したキーで並べ替える
+static sort_task_t *make_tasks(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                               size_t *nthreads);                           // スレッドごとの範囲を作る
+static int      run_phase(sort_task_t *tasks, size_t nthreads, sort_phase_t phase); // 全範囲で1段階を実行する
+static void     task_run(void *arg);                                        // 1範囲で1段階を実行する
+static uint64_t double_bits(double d);                                      // 浮動小数点数を順序を保つ整数にする
+static void     refine_strings(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                               ftcs_sort_item_t *items, ftcs_sort_item_t *tmp); // 先頭 8 バイトが同じ範囲を並べ替える
+static void     msd_sort(const char *base, size_t stride, ftcs_sort_item_t *items, ftcs_sort_item_t *tmp,
+                         size_t n, size_t depth);                           // depth バイト目以降で並べ替える
+static void     insertion_sort(const char *base, size_t stride, ftcs_sort_item_t *items,
+                               size_t n, size_t depth);                     // 少数の範囲を並べ替える
+static int      key_less(const ftcs_field_mapping_t *m, const char *field,
+                         const void *key, uint64_t target);                 // フィールドがキーより小さいか調べる
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+int ftcs_record_set_sort(ftcs_record_set_t *rs,
+                         const ftcs_field_mapping_t *mapping,
+                         const char *field_name)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs || !mapping || !field_name) {
+        fprintf(stderr, "ftcs: ftcs_record_set_sort に NULL 引数が渡された\n");
+        return -1;
+    }
+    const ftcs_field_mapping_t *m = mapping; // キーフィールドのマッピングエントリ
+    while (m->field_name && strcmp(m->field_name, field_name) != 0) {
+        m++;
+    }
+    if (!m->field_name) {
+        fprintf(stderr, "ftcs: キーフィールド '%s' がマッピングに存在しない\n", field_name);
+        return -1;
+    }
+    if (m->type == FTCS_TYPE_ARRAY) {
+        fprintf(stderr, "ftcs: 配列フィールド '%s' はキーに使えない\n", field_name);
+        return -1;
+    }
+
+    size_t            n        = rs->count ? rs->count : 1;    // 一時領域の要素数（0 件でも確保する）
+    ftcs_sort_item_t *sorted   = ftcs_key_sort(rs, m);         // キー順のレコード位置
+    char             *out      = malloc(n * rs->struct_size);  // 並べ替えたレコードの一時領域
+    size_t            nthreads = 0;                            // 並べ替えスレッド数
+    sort_task_t      *tasks    = make_tasks(rs, m, &nthreads); // 各スレッドの範囲
+    if (!sorted || !out || !tasks) {
+        if (!out) {
+            perror("ftcs: malloc");
+        }
+        free(sorted);
+        free(out);
+        free(tasks);
+        return -1;
+    }
+    for (size_t i = 0; i < nthreads; i++) {
+        tasks[i].src = sorted;
+        tasks[i].out = out;
+    }
+    int rc = run_phase(tasks, nthreads, PHASE_GATHER); // 戻り値
+    // 0 件の集合は records が NULL のことがある
+    if (rc == 0 && rs->count) {
+        memcpy(rs->records, out, rs->count * rs->struct_size);
+    }
+    if (rc == 0) {
+        rs->sorted     = 1;
+        rs->sorted_key = *m;
+    }
+    free(sorted);
+    free(out);
+    free(tasks);
+    return rc;
+}
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+ftcs_sort_item_t *ftcs_key_sort(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m)
+{
+    size_t            n        = rs->count;                        // レコード数
+    ftcs_sort_item_t *a        = malloc((n ? n : 1) * sizeof(*a)); // キーの書き込み先
+    ftcs_sort_item_t *b        = malloc((n ? n : 1) * sizeof(*b)); // 振り分け先
+    size_t            nthreads = 0;                                // 並べ替えスレッド数
+    sort_task_t      *tasks    = make_tasks(rs, m, &nthreads);     // 各スレッドの範囲
+    if (!a || !b || !tasks) {
+        if (!a || !b) {
+            perror("ftcs: malloc");
+        }
+        free(a);
+        free(b);
+        free(tasks);
+        return NULL;
+    }
+    ftcs_sort_item_t *sorted = radix_sort(tasks, nthreads, a, b); // 並べ替え済みの配列（a か b）
+    if (sorted && m->type == FTCS_TYPE_STRING && m->size > KEY_BYTES) {
+        refine_strings(rs, m, sorted, sorted == a ? b : a);
+    }
+    if (sorted != a) {
+        free(a);
+    }
+    if (sorted != b) {
+        free(b);
+    }
+    free(tasks);
+    return sorted;
+}
+
+const void *ftcs_sorted_find(const ftcs_record_set_t *rs, const char *key_value)
+{
+    ftcs_key_value_t buf;                                             // 変換後のキー値
+    const void *key = ftcs_key_convert(&rs->sorted_key, key_value, &buf); // フィールドと同じ表現のキー
+    const void *rec;                                                  // 一致レコード
+    ftcs_sorted_find_many(rs, &key, 1, &rec);
+    return rec;
+}
+
+void ftcs_sorted_find_many(const ftcs_record_set_t *rs, const void *const keys[], size_t n,
+                           const void *out[])
+{
+    const ftcs_field_mapping_t *m = &rs->sorted_key; // キーフィールドのマッピングエントリ
+    const char *base   = (const char *)rs->records + m->offset; // 先頭レコードのキーフィールド
+    size_t      stride = rs->struct_size;                       // レコード間隔
+    if (rs->count == 0) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = NULL;
+        }
+        return;
+    }
+
+    // PROBE_BATCH 個ずつ、キー未満のレコードの数（下限）を求める。
+    // 全キーで探索範囲の件数は同じ列をたどるので、各段で全キーを1回ずつ比較し、
+    // 比較が済んだキーの次の段で読むレコードを先読みしてから次のキーに移る。
+    // 比較結果は条件分岐ではなく加算する幅の選択に使うため、分岐予測も外さない。
+    for (size_t b = 0; b < n; b += PROBE_BATCH) {
+        size_t   nb = (n - b < PROBE_BATCH) ? n - b : PROBE_BATCH; // この回のキーの数
+        size_t   lo[PROBE_BATCH];     // 各キーの探索範囲の先頭
+        uint64_t target[PROBE_BATCH]; // 各キーの正規化したキー
+        for (size_t j = 0; j < nb; j++) {
+            lo[j]     = 0;
+            target[j] = ftcs_key_bits(m, keys[b + j]);
+        }
+        size_t len = rs->count; // 探索範囲の件数
+        while (len > 1) {
+            size_t half = len / 2;           // 範囲の前半の件数
+            size_t next = (len - half) / 2;  // 次の段の前半の件数
+            for (size_t j = 0; j < nb; j++) {
+                lo[j] += key_less(m, base + (lo[j] + half) * stride, keys[b + j], target[j]) ? half : 0;
+                __builtin_prefetch(base + (lo[j] + next) * stride);
+            }
+            len -= half;
+        }
+        for (size_t j = 0; j < nb; j++) {
+            size_t i = lo[j] + key_less(m, base + lo[j] * stride, keys[b + j], target[j]); // 下限
+            // 正規化で同じ値になっても == で等しくない場合（NaN）は一致としない
+            if (i < rs->count && ftcs_field_equal(m, base + i * stride, keys[b + j])) {
+                out[b + j] = base + i * stride - m->offset;
+            } else {
+                out[b + j] = NULL;
+            }
+        }
+    }
+}
+
+uint64_t ftcs_key_bits(const ftcs_field_mapping_t *m, const void *field)
+{
+    const char *f = field; // キーフィールドの位置
+    switch (m->type) {
+    case FTCS_TYPE_INT:
+        return (uint64_t)(int64_t)*(const int *)f ^ SIGN_BIT;
+    case FTCS_TYPE_LONG:
+        return (uint64_t)(int64_t)*(const long *)f ^ SIGN_BIT;
+    case FTCS_TYPE_SHORT:
+        return (uint64_t)(int64_t)*(const short *)f ^ SIGN_BIT;
+    case FTCS_TYPE_CHAR:
+        // char の符号の有無は処理系依存なので、== と同じ解釈のまま広げる
+        return (uint64_t)(int64_t)*f ^ SIGN_BIT;
+    case FTCS_TYPE_FLOAT:
+        return double_bits(*(const float *)f);
+    case FTCS_TYPE_DOUBLE:
+        return double_bits(*(const double *)f);
+    case FTCS_TYPE_STRING: {
+        uint64_t k   = 0;                                     // 詰めた先頭バイト列
+        size_t   lim = m->size < KEY_BYTES ? m->size : KEY_BYTES; // 読むバイト数の上限
+        size_t   i   = 0;                                     // 読んだバイト数
+        for (; i < lim && f[i]; i++) {
+            k = (k << 8) | (unsigned char)f[i];
+        }
+        // 8 バイト未満なら残りを 0 で埋めた位置まで左に寄せる（空文字列は 0）
+        return i ? k << (8 * (KEY_BYTES - i)) : 0;
+    }
+    case FTCS_TYPE_ARRAY:
+        break; // 配列はキーにできない（並べ替えの開始時に拒否している）
+    }
+    return 0;
+}
+
+/**
+ * @brief キーを取り出し、値が揃っていない桁だけ LSD 基数ソートする
+ *
+ * 各パスはスレッドごとの範囲のヒストグラムを数え、桁ごと・範囲順に書き込み位置を
+ * 割り当ててから振り分ける。範囲の順に書き込むため並べ替えは安定になる。
+ *
+ * @param tasks    各スレッドの範囲（first / n 設定済み）
+ * @param nthreads 範囲の数
+ * @param a        キーの書き込み先（レコード数分）
+ * @param b        振り分け先（レコード数分）
+ * @return 並べ替え済みの配列（a か b）、スレッド処理の確保失敗時 NULL
+ */
+static ftcs_sort_item_t *radix_sort(sort_task_t *tasks, size_t nthreads,
+                                    ftcs_sort_item_t *a, ftcs_sort_item_t *b)
+{
+    for (size_t i = 0; i < nthreads; i++) {
+        tasks[i].dst = a;
+    }
+    if (run_phase(tasks, nthreads, PHASE_EXTRACT) != 0) {
+        return NULL;
+    }
+    uint64_t key_or  = 0;           // 全キーのビット和
+    uint64_t key_and = ~(uint64_t)0; // 全キーのビット積
+    for (size_t i = 0; i < nthreads; i++) {
+        key_or  |= tasks[i].key_or;
+        key_and &= tasks[i].key_and;
+    }
+    uint64_t varying = key_or ^ key_and; // キーによって値が異なるビット
+
+    ftcs_sort_item_t *src = a; // 現在のパスの振り分け元
+    ftcs_sort_item_t *dst = b; // 現在のパスの振り分け先
+    for (unsigned shift = 0; shift < KEY_BYTES * 8; shift += RADIX_BITS) {
+        // 全キーで同じ値の桁は並び順を変えないので読み飛ばす
+        if (((varying >> shift) & RADIX_MASK) == 0) {
+            continue;
+        }
+        for (size_t i = 0; i < nthreads; i++) {
+            tasks[i].src   = src;
+            tasks[i].dst   = dst;
+            tasks[i].shift = shift;
+        }
+        if (run_phase(tasks, nthreads, PHASE_COUNT) != 0) {
+            return NULL;
+        }
+        // 桁の値の順、同じ値の中では範囲の順に書き込み位置を割り当てる
+        size_t next = 0; // 次に割り当てる書き込み位置
+        for (size_t d = 0; d < RADIX_BUCKETS; d++) {
+            for (size_t i = 0; i < nthreads; i++) {
+                size_t cnt      = tasks[i].hist[d]; // 範囲 i で桁が d のキー数
+                tasks[i].hist[d] = next;
+                next            += cnt;
+            }
+        }
+        if (run_phase(tasks, nthreads, PHASE_SCATTER) != 0) {
+            return NULL;
+        }
+        ftcs_sort_item_t *t = src; // 振り分け元と先を入れ替える
+        src = dst;
+        dst = t;
+    }
+    return src;
+}
+
+/**
+ * @brief レコード集合をスレッド数分の連続した範囲に分ける
+ *
+ * @param rs       並べ替えるレコード集合
+ * @param m        キーフィールド
+ * @param nthreads 範囲の数の書き込み先
+ * @return 範囲の配列（free で解放する）、確保失敗時 NULL
+ */
+static sort_task_t *make_tasks(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                               size_t *nthreads)
+{
+    size_t       nt    = ftcs_parallel_threads(rs->count, PARALLEL_MIN_RECORDS); // 並べ替えスレッド数
+    sort_task_t *tasks = calloc(nt, sizeof(*tasks)); // 各スレッドの範囲
+    if (!tasks) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    size_t per = rs->count / nt; // 1スレッドあたりの件数（端数は最後のスレッド）
+    for (size_t i = 0; i < nt; i++) {
+        tasks[i].rs    = rs;
+        tasks[i].m     = m;
+        tasks[i].first = i * per;
+        tasks[i].n     = (i + 1 == nt) ? rs->count - i * per : per;
+    }
+    *nthreads = nt;
+    return tasks;
+}
+
+/**
+ * @brief 全ての範囲で1つの段階を ftcs_run_parallel() で並行して実行する
+ *
+ * @param tasks    各スレッドの範囲
+ * @param nthreads 範囲の数
+ * @param phase    実行する段階
+ * @return 成功時 0、確保失敗時 -1
+ */
+static int run_phase(sort_task_t *tasks, size_t nthreads, sort_phase_t phase)
+{
+    for (size_t i = 0; i < nthreads; i++) {
+        tasks[i].phase = phase;
+    }
+    return ftcs_run_parallel(tasks, nthreads, sizeof(*tasks), task_run);
+}
+
+/**
+ * @brief 1つの範囲で phase の段階を実行する
+ * @param arg 並べ替え範囲（sort_task_t）
+ */
+static void task_run(void *arg)
+{
+    sort_task_t *t   = arg;             // 並べ替え範囲
+    size_t       end = t->first + t->n; // 範囲の終端位置
+    switch (t->phase) {
+    case PHASE_EXTRACT: {
+        const char *p = (const char *)t->rs->records + t->first * t->rs->struct_size
+                        + t->m->offset; // 処理中のキーフィールド
+        t->key_or  = 0;
+        t->key_and = ~(uint64_t)0;
+        for (size_t i = t->first; i < end; i++, p += t->rs->struct_size) {
+            uint64_t k = ftcs_key_bits(t->m, p); // 正規化したキー
+            t->dst[i].key = k;
+            t->dst[i].pos = i;
+            t->key_or    |= k;
+            t->key_and   &= k;
+        }
+        break;
+    }
+    case PHASE_COUNT:
+        memset(t->hist, 0, sizeof(t->hist));
+        for (size_t i = t->first; i < end; i++) {
+            t->hist[(t->src[i].key >> t->shift) & RADIX_MASK]++;
+        }
+        break;
+    case PHASE_SCATTER:
+        for (size_t i = t->first; i < end; i++) {
+            t->dst[t->hist[(t->src[i].key >> t->shift) & RADIX_MASK]++] = t->src[i];
+        }
+        break;
+    case PHASE_GATHER: {
+        size_t      stride  = t->rs->struct_size;           // レコード間隔
+        const char *records = (const char *)t->rs->records; // 並べ替え前のレコード配列
+        for (size_t i = t->first; i < end; i++) {
+            memcpy(t->out + i * stride, records + t->src[i].pos * stride, stride);
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * @brief 浮動小数点数を、符号なしで比較すると同じ順になる 64 ビット整数にする
+ *
+ * 正の数は符号ビットを立て、負の数は全ビットを反転する。
+ * -0.0 は 0.0 と == で等しいため、同じ値にそろえてから変換する。
+ *
+ * @param d 変換する値
+ * @return 正規化したキー
+ */
+static uint64_t double_bits(double d)
+{
+    if (d == 0.0) {
+        d = 0.0;
+    }
+    uint64_t bits; // d のビット表現
+    memcpy(&bits, &d, sizeof(bits));
+    return (bits & SIGN_BIT) ? ~bits : bits | SIGN_BIT;
+}
+
+/**
+ * @brief 先頭 8 バイトでの並べ替えのあと、先頭 8 バイトが同じ文字列の範囲を並べ替える
+ *
+ * 8 バイト目が NUL（文字列が 8 バイト未満）のキーはそこで比較が決着しているので触らない。
+ *
+ * @param rs    並べ替えるレコード集合
+ * @param m     キーフィールドのマッピングエントリ
+ * @param items 先頭 8 バイトで並べ替え済みの配列
+ * @param tmp   作業配列（items と同じ要素数）
+ */
+static void refine_strings(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                           ftcs_sort_item_t *items, ftcs_sort_item_t *tmp)
+{
+    const char *base = (const char *)rs->records + m->offset; // 先頭レコードのキーフィールド
+    size_t      i    = 0;                                      // 範囲の先頭
+    while (i < rs->count) {
+        size_t j = i + 1; // 範囲の終端
+        while (j < rs->count && items[j].key == items[i].key) {
+            j++;
+        }
+        if (j - i > 1 && (items[i].key & RADIX_MASK) != 0) {
+            msd_sort(base, rs->struct_size, items + i, tmp, j - i, KEY_BYTES);
+        }
+        i = j;
+    }
+}
+
+/**
+ * @brief depth バイト目までが等しい文字列を、depth バイト目以降の MSD 基数ソートで並べ替える
+ *
+ * depth バイト目の値で安定に振り分け、NUL 以外のバケットを1バイト先で再帰的に並べ替える。
+ * NUL のバケットは文字列がそこで終わり全て等しいので触らない。
+ *
+ * @param base   先頭レコードのキーフィールド
+ * @param stride レコード間隔
+ * @param items  並べ替える範囲
+ * @param tmp    作業配列（n 要素以上）
+ * @param n      範囲の件数
+ * @param depth  比較を始めるバイト位置
+ */
+static void msd_sort(const char *base, size_t stride, ftcs_sort_item_t *items, ftcs_sort_item_t *tmp,
+                     size_t n, size_t depth)
+{
+    if (n <= INSERTION_THRESHOLD) {
+        insertion_sort(base, stride, items, n, depth);
+        return;
+    }
+    size_t start[RADIX_BUCKETS + 1]; // バイト値ごとの範囲の先頭（計数後に累積する）
+    // 全件で同じバイトが続く間は、再帰せずに比較位置だけ進める
+    for (;;) {
+        memset(start, 0, sizeof(start));
+        for (size_t i = 0; i < n; i++) {
+            start[(unsigned char)base[items[i].pos * stride + depth] + 1]++;
+        }
+        unsigned char first = (unsigned char)base[items[0].pos * stride + depth]; // 先頭要素のバイト
+        if (start[first + 1] != n) {
+            break;
+        }
+        if (first == 0) {
+            return;
+        }
+        depth++;
+    }
+    for (size_t d = 1; d <= RADIX_BUCKETS; d++) {
+        start[d] += start[d - 1];
+    }
+    size_t next[RADIX_BUCKETS]; // バイト値ごとの次の書き込み位置
+    memcpy(next, start, sizeof(next));
+    for (size_t i = 0; i < n; i++) {
+        tmp[next[(unsigned char)base[items[i].pos * stride + depth]]++] = items[i];
+    }
+    memcpy(items, tmp, n * sizeof(*items));
+    for (size_t d = 1; d < RADIX_BUCKETS; d++) {
+        if (start[d + 1] - start[d] > 1) {
+            msd_sort(base, stride, items + start[d], tmp, start[d + 1] - start[d], depth + 1);
+        }
+    }
+}
+
+/**
+ * @brief depth バイト目までが等しい少数の文字列を安定な挿入ソートで並べ替える
+ *
+ * @param base   先頭レコードのキーフィールド
+ * @param stride レコード間隔
+ * @param items  並べ替える範囲
+ * @param n      範囲の件数
+ * @param depth  比較を始めるバイト位置
+ */
+static void insertion_sort(const char *base, size_t stride, ftcs_sort_item_t *items,
+                           size_t n, size_t depth)
+{
+    for (size_t i = 1; i < n; i++) {
+        ftcs_sort_item_t  cur = items[i];                        // 挿入する要素
+        const char       *key = base + cur.pos * stride + depth; // 挿入する要素の比較開始位置
+        size_t            j   = i;                               // 挿入位置
+        while (j > 0 && strcmp(base + items[j - 1].pos * stride + depth, key) > 0) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = cur;
+    }
+}
+
+/**
+ * @brief 二分探索の1段の比較をする
+ *
+ * @param m      キーフィールド
+ * @param field  比較するレコードのキーフィールド
+ * @param key    フィールドと同じ表現のキー
+ * @param target key を正規化したキー（文字列型では使わない）
+ * @return フィールドがキーより小さければ非ゼロ
+ */
+static int key_less(const ftcs_field_mapping_t *m, const char *field,
+                    const void *key, uint64_t target)
+{
+    if (m->type == FTCS_TYPE_STRING) {
+        return strcmp(field, key) < 0;
+    }
+    return ftcs_key_bits(m, field) < target;
+}
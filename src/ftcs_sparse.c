@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftcs_internal.h"
+
+// 1ページのレコード数の log2。64 件なら存在ビットが uint64_t 1語に収まる。
+#define PAGE_SHIFT 6
+
+// 1テーブルのページ数の log2。512 ページ（ポインタ 4KiB）で 32768 件分を引く。
+#define TABLE_SHIFT 9
+
+#define PAGE_RECORDS ((size_t)1 << PAGE_SHIFT)  // 1ページのレコード数
+#define TABLE_PAGES  ((size_t)1 << TABLE_SHIFT) // 1テーブルのページ数
+
+// 1段目（テーブルの配列）の初期確保要素数
+#define DIRECTORY_INITIAL_CAPACITY 16
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 2段目のページテーブル（ページへのポインタとページごとの存在ビット）
+ */
+typedef struct {
+    char     *pages[TABLE_PAGES];   /**< レコードページ（未確保なら NULL） */
+    uint64_t  present[TABLE_PAGES]; /**< ページ内の各スロットにレコードがあればビットが立つ */
+} sparse_table_t;
+
+struct ftcs_sparse_set {
+    size_t            struct_size; /**< 1レコードのバイトサイズ */
+    ftcs_allocator_t  allocator;   /**< レコードページのアロケーター（関数未設定なら calloc / free） */
+    sparse_table_t  **tables;      /**< 1段目: テーブルの配列（未確保なら NULL） */
+    size_t            ntables;     /**< tables の要素数 */
+    size_t            count;       /**< 存在するレコード数 */
+    size_t            bytes;       /**< ページ・テーブル・1段目の確保バイト数 */
+};
+
+// --- 関数宣言（目次） ---
+
+static int directory_ensure(ftcs_sparse_set_t *ss, size_t t); // 1段目を t 番目まで広げる
+static size_t page_bytes(const ftcs_sparse_set_t *ss);        // 1ページのバイト数
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+size_t ftcs_sparse_count(const ftcs_sparse_set_t *ss)
+{
+    return ss ? ss->count : 0;
+}
+
+size_t ftcs_sparse_bytes(const ftcs_sparse_set_t *ss)
+{
+    return ss ? ss->bytes : 0;
+}
+
+const void *ftcs_sparse_find(const ftcs_sparse_set_t *ss, size_t index)
+{
+    if (!ss) {
+        return NULL;
+    }
+    size_t t = index >> (PAGE_SHIFT + TABLE_SHIFT); // テーブル番号
+    if (t >= ss->ntables || !ss->tables[t]) {
+        return NULL;
+    }
+    const sparse_table_t *table = ss->tables[t];                      // 2段目のテーブル
+    size_t                p     = (index >> PAGE_SHIFT) & (TABLE_PAGES - 1); // テーブル内のページ番号
+    size_t                slot  = index & (PAGE_RECORDS - 1);               // ページ内のスロット番号
+    if (!(table->present[p] & ((uint64_t)1 << slot))) {
+        return NULL;
+    }
+    return table->pages[p] + slot * ss->struct_size;
+}
+
+const void *ftcs_sparse_next(const ftcs_sparse_set_t *ss, ftcs_sparse_iter_t *it)
+{
+    if (!ss || !it) {
+        return NULL;
+    }
+    size_t pos = it->next; // 調べている配置位置
+    // 未確保のテーブルと空のページは丸ごと読み飛ばす
+    while ((pos >> (PAGE_SHIFT + TABLE_SHIFT)) < ss->ntables) {
+        size_t                t     = pos >> (PAGE_SHIFT + TABLE_SHIFT); // テーブル番号
+        const sparse_table_t *table = ss->tables[t];                     // 2段目のテーブル
+        if (!table) {
+            pos = (t + 1) << (PAGE_SHIFT + TABLE_SHIFT);
+            continue;
+        }
+        size_t   p    = (pos >> PAGE_SHIFT) & (TABLE_PAGES - 1);                   // ページ番号
+        uint64_t bits = table->present[p] & (~(uint64_t)0 << (pos & (PAGE_RECORDS - 1))); // pos 以降の存在ビット
+        if (!bits) {
+            pos = ((pos >> PAGE_SHIFT) + 1) << PAGE_SHIFT;
+            continue;
+        }
+        size_t slot = (size_t)__builtin_ctzll(bits); // 次に存在するスロット
+        it->index = (pos & ~(PAGE_RECORDS - 1)) | slot;
+        it->next  = it->index + 1;
+        return table->pages[p] + slot * ss->struct_size;
+    }
+    it->next = pos;
+    return NULL;
+}
+
+void ftcs_sparse_free(ftcs_sparse_set_t *ss)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!ss) {
+        return;
+    }
+    for (size_t t = 0; t < ss->ntables; t++) {
+        sparse_table_t *table = ss->tables[t]; // 2段目のテーブル
+        if (!table) {
+            continue;
+        }
+        for (size_t p = 0; p < TABLE_PAGES; p++) {
+            ftcs_mem_free(&ss->allocator, table->pages[p], page_bytes(ss));
+        }
+        free(table);
+    }
+    free(ss->tables);
+    free(ss);
+}
+
+// --- ライブラリ内部 API（ftcs_internal.h） ---
+
+ftcs_sparse_set_t *ftcs_sparse_create(size_t struct_size, const ftcs_allocator_t *allocator)
+{
+    ftcs_sparse_set_t *ss = calloc(1, sizeof(*ss)); // 作成する疎なレコード集合
+    if (!ss) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    ss->struct_size = struct_size;
+    if (allocator) {
+        ss->allocator = *allocator;
+    }
+    return ss;
+}
+
+void *ftcs_sparse_slot(ftcs_sparse_set_t *ss, size_t pos)
+{
+    size_t t = pos >> (PAGE_SHIFT + TABLE_SHIFT); // テーブル番号
+    if (directory_ensure(ss, t) != 0) {
+        return NULL;
+    }
+    sparse_table_t *table = ss->tables[t]; // 2段目のテーブル
+    if (!table) {
+        table = calloc(1, sizeof(*table));
+        if (!table) {
+            perror("ftcs: calloc");
+            return NULL;
+        }
+        ss->tables[t] = table;
+        ss->bytes    += sizeof(*table);
+    }
+    size_t p = (pos >> PAGE_SHIFT) & (TABLE_PAGES - 1); // テーブル内のページ番号
+    if (!table->pages[p]) {
+        // ページは最初に書き込まれたときにゼロ初期化して確保する
+        table->pages[p] = ftcs_mem_alloc(&ss->allocator, page_bytes(ss));
+        if (!table->pages[p]) {
+            fprintf(stderr, "ftcs: レコードページの確保に失敗（%zu バイト）\n", page_bytes(ss));
+            return NULL;
+        }
+        ss->bytes += page_bytes(ss);
+    }
+    size_t   slot = pos & (PAGE_RECORDS - 1); // ページ内のスロット番号
+    uint64_t bit  = (uint64_t)1 << slot;      // スロットの存在ビット
+    if (!(table->present[p] & bit)) {
+        table->present[p] |= bit;
+        ss->count++;
+    }
+    return table->pages[p] + slot * ss->struct_size;
+}
+
+/**
+ * @brief 1段目のテーブル配列が t 番目の要素を持つよう広げる（新しい要素は NULL）
+ *
+ * @param ss 疎なレコード集合
+ * @param t  必要なテーブル番号
+ * @return 成功時 0、realloc 失敗時 -1
+ */
+static int directory_ensure(ftcs_sparse_set_t *ss, size_t t)
+{
+    if (t < ss->ntables) {
+        return 0;
+    }
+    // 2倍ずつ広げても要素数とバイト数が size_t に収まる範囲に限る
+    if (t >= SIZE_MAX / (2 * sizeof(*ss->tables))) {
+        fprintf(stderr, "ftcs: 配置位置が大きすぎる\n");
+        return -1;
+    }
+    size_t n = ss->ntables ? ss->ntables : DIRECTORY_INITIAL_CAPACITY; // 拡張後の要素数
+    while (n <= t) {
+        n *= 2;
+    }
+    sparse_table_t **tables = realloc(ss->tables, n * sizeof(*tables)); // 拡張後の1段目
+    if (!tables) {
+        fprintf(stderr, "ftcs: ページテーブルの拡張に失敗（配置位置 %zu）\n",
+                t << (PAGE_SHIFT + TABLE_SHIFT));
+        return -1;
+    }
+    memset(tables + ss->ntables, 0, (n - ss->ntables) * sizeof(*tables));
+    ss->bytes  += (n - ss->ntables) * sizeof(*tables);
+    ss->tables  = tables;
+    ss->ntables = n;
+    return 0;
+}
+
+/**
+ * @brief 1ページ（PAGE_RECORDS 件）のバイト数を返す
+ * @param ss 疎なレコード集合
+ * @return 1ページのバイト数
+ */
+static size_t page_bytes(const ftcs_sparse_set_t *ss)
+{
+    return PAGE_RECORDS * ss->struct_size;
+}
@@ -0,0 +1,185 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ftcs_internal.h"
+
+// 1回の pread で読むバイト数。時間予算はこの単位の処理ごとに確認するので、
+// 最適化なしのビルドでも 1 単位の処理が 1ms を大きく下回る大きさにする。
+#define STEP_CHUNK_SIZE (16 * 1024)
+
+// --- 内部型定義 ---
+
+struct ftcs_parser {
+    ftcs_parser_config_t config;  /**< パーサー設定（写し。ctx.config はこれを指す） */
+    ftcs_parse_ctx_t     ctx;     /**< パース状態（構築中のレコード集合を含む） */
+    int                  fd;      /**< 入力ファイル */
+    char                *chunk;   /**< 読み込みバッファ（STEP_CHUNK_SIZE バイト） */
+    uint64_t             offset;  /**< 次に読むバイト位置 */
+    uint64_t             total;   /**< 開いた時点のファイルサイズ */
+    uint64_t             busy_ns; /**< ftcs_parser_step() で費やした時間の累計 */
+    int                  state;   /**< 1: 続きあり、0: 読み終えた、-1: エラーで停止 */
+};
+
+// --- 関数宣言（目次） ---
+
+static int read_chunk(ftcs_parser_t *p, size_t want); // 1単位読んでパースする
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+ftcs_parser_t *ftcs_parser_open(const char *filepath,
+                                const ftcs_parser_config_t *config,
+                                const ftcs_field_mapping_t *mapping,
+                                size_t struct_size)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!filepath || !config || !mapping || !config->kv_separator) {
+        fprintf(stderr, "ftcs: ftcs_parser_open に NULL 引数が渡された\n");
+        return NULL;
+    }
+    ftcs_parser_t *p = calloc(1, sizeof(*p)); // 作成するパーサー
+    if (!p) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    p->config = *config;
+    p->state  = 1;
+    p->fd     = open(filepath, O_RDONLY);
+    if (p->fd < 0) {
+        fprintf(stderr, "ftcs: '%s' を開けない: %s\n", filepath, strerror(errno));
+        free(p);
+        return NULL;
+    }
+    struct stat st; // 入力ファイルの状態（進捗の分母に使う）
+    if (fstat(p->fd, &st) == 0) {
+        p->total = (uint64_t)st.st_size;
+    }
+    p->chunk = malloc(STEP_CHUNK_SIZE);
+    if (!p->chunk) {
+        perror("ftcs: malloc");
+        close(p->fd);
+        free(p);
+        return NULL;
+    }
+    if (ftcs_ctx_init(&p->ctx, &p->config, mapping, struct_size) != 0) {
+        close(p->fd);
+        free(p->chunk);
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+int ftcs_parser_step(ftcs_parser_t *p, size_t budget_bytes, uint64_t budget_ns)
+{
+    if (!p) {
+        fprintf(stderr, "ftcs: ftcs_parser_step に NULL 引数が渡された\n");
+        return -1;
+    }
+    // 読み終えた・停止したパーサーは何もしない
+    if (p->state != 1) {
+        return p->state;
+    }
+
+    uint64_t start = ftcs_now_ns(); // 今回の開始時刻
+    size_t   used  = 0;             // 今回読んだバイト数
+    int      ret;                   // read_chunk の結果
+    do {
+        size_t want = STEP_CHUNK_SIZE; // 今回の単位で読むバイト数
+        if (budget_bytes > 0 && budget_bytes - used < want) {
+            want = budget_bytes - used;
+        }
+        ret = read_chunk(p, want);
+        if (ret > 0) {
+            used += (size_t)ret;
+        }
+    } while (ret > 0
+             && (budget_bytes == 0 || used < budget_bytes)
+             && (budget_ns == 0 || ftcs_now_ns() - start < budget_ns));
+    p->busy_ns += ftcs_now_ns() - start;
+    if (ret <= 0) {
+        p->state = ret;
+    }
+    return p->state;
+}
+
+void ftcs_parser_progress(const ftcs_parser_t *p, ftcs_parser_progress_t *out)
+{
+    if (!p || !out) {
+        return;
+    }
+    out->bytes       = p->offset;
+    out->total_bytes = p->total;
+    out->records     = p->ctx.st.records;
+    out->busy_ns     = p->busy_ns;
+    out->done        = (p->state == 1) ? 0 : (p->state == 0) ? 1 : -1;
+}
+
+ftcs_record_set_t *ftcs_parser_finish(ftcs_parser_t *p)
+{
+    if (!p) {
+        return NULL;
+    }
+    // 残りは予算なしで最後まで進める
+    if (p->state == 1) {
+        ftcs_parser_step(p, 0, 0);
+    }
+    ftcs_record_set_t *rs = NULL; // 取り出すレコード集合
+    if (p->state == 0) {
+        // 呼び出しの合間の待ち時間を除き、ステップ実行の時間だけを total_ns にする
+        ftcs_ctx_report_stats(&p->ctx, ftcs_now_ns() - p->busy_ns);
+        rs = ftcs_ctx_take(&p->ctx);
+    }
+    ftcs_parser_free(p);
+    return rs;
+}
+
+void ftcs_parser_free(ftcs_parser_t *p)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!p) {
+        return;
+    }
+    ftcs_ctx_destroy(&p->ctx);
+    close(p->fd);
+    free(p->chunk);
+    free(p);
+}
+
+/**
+ * @brief 次の最大 want バイトを読んでパースする
+ *
+ * EOF に達したら持ち越し中の最終行を処理する。
+ *
+ * @param p    パーサー
+ * @param want 読むバイト数の上限（1 以上）
+ * @return 読んだバイト数、EOF なら 0、読み込み・解析エラー時 -1
+ */
+static int read_chunk(ftcs_parser_t *p, size_t want)
+{
+    ftcs_parse_ctx_t *ctx = &p->ctx;                        // パース状態
+    uint64_t          t0  = ctx->stats ? ftcs_now_ns() : 0; // 読み込み開始時刻
+    ssize_t           n;                                    // 読み込んだバイト数
+    do {
+        n = pread(p->fd, p->chunk, want, (off_t)p->offset);
+    } while (n < 0 && errno == EINTR);
+    if (ctx->stats) {
+        ctx->st.io_ns += ftcs_now_ns() - t0;
+    }
+    if (n < 0) {
+        perror("ftcs: pread");
+        return -1;
+    }
+    if (n == 0) {
+        return ftcs_ctx_finish(ctx) == 0 ? 0 : -1;
+    }
+    p->offset     += (uint64_t)n;
+    ctx->st.bytes += (size_t)n;
+    return ftcs_ctx_feed(ctx, p->chunk, (size_t)n) == 0 ? (int)n : -1;
+}
@@ -0,0 +1,591 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "ftcs.h"
+#include "ftcs_internal.h"
+
+// 読み込みスレッドが1回に切り出すブロックのバイト数。
+// パーサースレッド間の負荷分散の粒度になるため、ファイル用の先読みブロックより小さくしている。
+#define STREAM_BLOCK_SIZE (256 * 1024)
+
+// 段間キューの深さ（2 のべき乗）。各パーサーが数ブロック分先行できれば読み込みの揺らぎを吸収できる。
+#define STREAM_QUEUE_DEPTH 8
+
+// パーサースレッド数の上限。これ以上はキュー段数とメモリが増えるだけで伸びない。
+#define STREAM_MAX_THREADS 64
+
+// キャッシュライン長。生産者・消費者のカウンタを別ラインに置き false sharing を防ぐ。
+#define CACHE_LINE_SIZE 64
+
+// 読み込みスレッドが中断要求を確認する間隔（ミリ秒）。パイプが無音でも join が遅れないようにする。
+#define ABORT_POLL_MS 100
+
+// 待機時のバックオフ段階。短い待ちはスピン、長い待ちはスリープで CPU を手放す。
+#define BACKOFF_SPIN_LIMIT  64
+#define BACKOFF_YIELD_LIMIT 128
+#define BACKOFF_SLEEP_NS    50000
+
+// --- 内部型定義 ---
+
+/**
+ * @brief 単一生産者・単一消費者のロックフリー有界キュー
+ *
+ * head は消費者だけが、tail は生産者だけが書き込むため CAS は不要。
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head; /**< 次に取り出す位置（消費者が更新） */
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail; /**< 次に格納する位置（生産者が更新） */
+    _Alignas(CACHE_LINE_SIZE) void *slots[STREAM_QUEUE_DEPTH]; /**< 要素（ポインタ）の環状配列 */
+} spsc_queue_t;
+
+/**
+ * @brief 読み込みスレッドからパーサースレッドへ渡す行ブロック
+ */
+typedef struct {
+    size_t seq;  /**< ブロック通し番号（順序付けに使用） */
+    int    eof;  /**< 入力終端マーカーなら非ゼロ（data は NULL） */
+    int    error;/**< 読み込みエラーなら非ゼロ */
+    char  *data; /**< 行の途中で切れていないテキスト */
+    size_t len;  /**< data のバイト数 */
+} stream_block_t;
+
+/**
+ * @brief パーサースレッドから順序付け段へ渡すレコードのバッチ
+ */
+typedef struct {
+    size_t             seq;       /**< 元ブロックの通し番号 */
+    int                eof;       /**< 入力終端マーカーなら非ゼロ */
+    int                error;     /**< 読み込み・解析エラーなら非ゼロ */
+    ftcs_record_set_t *rs;        /**< 出現順に詰めたレコード */
+    size_t            *positions; /**< 配置位置指定モードでの各レコードの位置（それ以外は NULL） */
+} stream_batch_t;
+
+struct stream_pipeline;
+
+/**
+ * @brief パーサースレッド1本分の状態
+ */
+typedef struct {
+    struct stream_pipeline *pl;   /**< 所属するパイプライン */
+    pthread_t               tid;  /**< スレッド ID */
+    spsc_queue_t            in;   /**< 読み込みスレッド → このパーサー */
+    spsc_queue_t            out;  /**< このパーサー → 順序付け段 */
+    ftcs_parse_stats_t      st;   /**< このパーサーが収集した統計（終了後に集計する） */
+} stream_worker_t;
+
+/**
+ * @brief パイプライン全体の共有状態
+ */
+typedef struct stream_pipeline {
+    int                         fd;          /**< 入力 fd */
+    const ftcs_parser_config_t *config;      /**< パーサー設定 */
+    ftcs_parser_config_t        worker_config; /**< パーサースレッド用の設定（アロケーターを既定に戻し、リングを外す） */
+    const ftcs_field_mapping_t *mapping;     /**< フィールドマッピングテーブル */
+    size_t                      struct_size; /**< 1レコードのバイトサイズ */
+    size_t                      nworkers;    /**< パーサースレッド数 */
+    stream_worker_t            *workers;     /**< パーサースレッド配列 */
+    pthread_t                   reader_tid;  /**< 読み込みスレッド ID */
+    atomic_int                  abort;       /**< 非ゼロならすべての段が処理を打ち切る */
+    size_t                      bytes;       /**< 読み込みスレッドが読んだバイト数 */
+    uint64_t                    io_ns;       /**< 読み込みスレッドが read で待った時間 */
+} stream_pipeline_t;
+
+// --- 関数宣言（目次） ---
+
+static int   sequence_batches(stream_pipeline_t *pl, ftcs_parse_ctx_t *ctx); // バッチを通し番号順に結合する
+static void *reader_main(void *arg);                                          // 入力を行境界で切ってブロック化する
+static void *worker_main(void *arg);                                          // ブロックをレコードのバッチに変換する
+static ssize_t read_some(stream_pipeline_t *pl, char *buf, size_t len);       // 中断要求を見ながら read する
+static int   queue_push(stream_pipeline_t *pl, spsc_queue_t *q, void *item);  // キューに格納する（満杯なら待つ）
+static void *queue_pop(stream_pipeline_t *pl, spsc_queue_t *q);               // キューから取り出す（空なら待つ）
+static void *queue_try_pop(spsc_queue_t *q);                                  // 待たずに取り出す（後始末用）
+static void  backoff(unsigned *spins);                                        // 段階的に待機する
+static void  block_free(stream_block_t *b);                                   // ブロックを解放する
+static void  batch_free(stream_batch_t *b);                                   // バッチを解放する
+
+// --- 関数定義（概要→詳細の順） ---
+
+/**
+ * @brief パーサースレッドのバッチを通し番号順に取り出してレコード集合に反映する
+ *
+ * ブロック k はパーサー k % N に割り当てられるため、各パーサーの出力キューを
+ * 順番に見るだけで全体の順序が復元でき、MPSC キューや並べ替えバッファを要しない。
+ *
+ * @param pl  パイプライン
+ * @param ctx 結合先レコード集合を持つパースコンテキスト
+ * @return 成功時 0、いずれかの段でエラーが起きた場合 -1
+ */
+static int sequence_batches(stream_pipeline_t *pl, ftcs_parse_ctx_t *ctx)
+{
+    // EOF マーカーに到達するまで通し番号順にバッチを結合する
+    for (size_t seq = 0; ; seq++) {
+        stream_worker_t *w = &pl->workers[seq % pl->nworkers]; // このブロックを担当したパーサー
+        stream_batch_t  *b = queue_pop(pl, &w->out);           // 通し番号 seq のバッチ
+        if (!b) {
+            return -1;
+        }
+        if (b->error) {
+            batch_free(b);
+            return -1;
+        }
+        if (b->eof) {
+            batch_free(b);
+            return 0;
+        }
+
+        int rc = 0; // 結合結果
+        if (b->positions) {
+            // 配置位置指定モード: 各レコードを array[ID-1] に置く
+            for (size_t i = 0; i < b->rs->count && rc == 0; i++) {
+                rc = ftcs_ctx_place(ctx, b->positions[i],
+                                   (const char *)b->rs->records + i * pl->struct_size);
+            }
+        } else {
+            rc = ftcs_ctx_append(ctx, b->rs->records, b->rs->count);
+        }
+        batch_free(b);
+        if (rc != 0) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief 読み込みスレッド: fd から読み、最後の改行で区切ったブロックを各パーサーへ配る
+ *
+ * @param arg stream_pipeline_t へのポインタ
+ * @return 常に NULL
+ */
+static void *reader_main(void *arg)
+{
+    stream_pipeline_t *pl  = arg; // パイプライン
+    size_t             seq = 0;   // 次のブロック通し番号
+    char  *rest     = NULL;       // 前ブロック末尾の改行なし断片
+    size_t rest_len = 0;          // rest のバイト数
+    int    eof      = 0;          // 入力終端に達したら非ゼロ
+    int    error    = 0;          // 読み込みエラーなら非ゼロ
+
+    // 入力終端・エラー・中断要求のいずれかまでブロックを生成する
+    while (!eof && !error && !atomic_load(&pl->abort)) {
+        size_t cap = STREAM_BLOCK_SIZE; // ブロックの確保サイズ
+        while (cap < rest_len * 2) {
+            cap *= 2;
+        }
+        char *buf = malloc(cap); // 新しいブロックの本体
+        if (!buf) {
+            perror("ftcs: malloc");
+            error = 1;
+            break;
+        }
+        if (rest_len > 0) {
+            memcpy(buf, rest, rest_len);
+        }
+        size_t len = rest_len; // buf の有効バイト数
+        free(rest);
+        rest     = NULL;
+        rest_len = 0;
+
+        // ブロックが埋まるか入力が尽きるまで読む
+        while (len < cap) {
+            uint64_t t0 = pl->config->stats ? ftcs_now_ns() : 0;   // 待ち開始時刻
+            ssize_t  n  = read_some(pl, buf + len, cap - len);    // 今回の読み込みバイト数
+            if (pl->config->stats) {
+                pl->io_ns += ftcs_now_ns() - t0;
+            }
+            if (n < 0) {
+                error = 1;
+                break;
+            }
+            if (n == 0) {
+                eof = 1;
+                break;
+            }
+            len       += (size_t)n;
+            pl->bytes += (size_t)n;
+        }
+
+        size_t cut = len; // ブロックとして渡す長さ（最後の改行の直後まで）
+        if (!eof && !error) {
+            char *nl = memrchr(buf, '\n', len); // 最後の改行
+            // 改行が1つもない長大な行は、次回さらに大きなブロックで読み直す
+            cut = nl ? (size_t)(nl - buf) + 1 : 0;
+            rest_len = len - cut;
+            rest     = malloc(rest_len ? rest_len : 1);
+            if (!rest) {
+                perror("ftcs: malloc");
+                free(buf);
+                error = 1;
+                break;
+            }
+            memcpy(rest, buf + cut, rest_len);
+        }
+        if (cut == 0 || error) {
+            free(buf);
+            continue;
+        }
+
+        stream_block_t *b = calloc(1, sizeof(*b)); // パーサーへ渡すブロック
+        if (!b) {
+            perror("ftcs: calloc");
+            free(buf);
+            error = 1;
+            break;
+        }
+        b->seq  = seq;
+        b->data = buf;
+        b->len  = cut;
+        if (queue_push(pl, &pl->workers[seq % pl->nworkers].in, b) != 0) {
+            block_free(b);
+            break;
+        }
+        seq++;
+    }
+    free(rest);
+
+    // 終端マーカーは全パーサーに1つずつ送る。順序付け段は通し番号 seq の位置で受け取る
+    for (size_t i = 0; i < pl->nworkers; i++) {
+        stream_block_t *b = calloc(1, sizeof(*b)); // 終端・エラーマーカー
+        if (!b) {
+            atomic_store(&pl->abort, 1);
+            break;
+        }
+        b->seq   = seq + i;
+        b->eof   = 1;
+        b->error = error;
+        if (queue_push(pl, &pl->workers[(seq + i) % pl->nworkers].in, b) != 0) {
+            block_free(b);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief パーサースレッド: ブロックを行に分割してレコードのバッチに変換する
+ *
+ * @param arg stream_worker_t へのポインタ
+ * @return 常に NULL
+ */
+static void *worker_main(void *arg)
+{
+    stream_worker_t   *w  = arg;   // 自スレッドの状態
+    stream_pipeline_t *pl = w->pl; // パイプライン
+    ftcs_parse_ctx_t   ctx;        // 自スレッド専用のパース状態
+    int                ctx_ok = (ftcs_ctx_init(&ctx, &pl->worker_config, pl->mapping,
+                                               pl->struct_size) == 0); // ctx 初期化成否
+    // 配置位置指定モードでも最終配置は順序付け段が行うため、ここでは出現順に詰める
+    ctx.defer_placement = 1;
+
+    // 終端マーカーまたは中断要求までブロックを処理する
+    for (;;) {
+        stream_block_t *blk = queue_pop(pl, &w->in); // 処理対象ブロック
+        if (!blk) {
+            break;
+        }
+        stream_batch_t *b = calloc(1, sizeof(*b)); // 順序付け段へ渡すバッチ
+        if (!b) {
+            perror("ftcs: calloc");
+            block_free(blk);
+            atomic_store(&pl->abort, 1);
+            break;
+        }
+        b->seq   = blk->seq;
+        b->eof   = blk->eof;
+        b->error = blk->error || !ctx_ok;
+
+        if (!b->eof && !b->error) {
+            // ブロックは改行で終わっているため持ち越しは発生しない
+            if (ftcs_ctx_feed(&ctx, blk->data, blk->len) != 0 || ftcs_ctx_finish(&ctx) != 0) {
+                b->error = 1;
+            } else {
+                b->rs = ftcs_ctx_take(&ctx);
+                if (ctx.use_index_field) {
+                    // 位置配列の所有権もバッチへ移す
+                    b->positions      = ctx.positions;
+                    ctx.positions     = NULL;
+                    ctx.positions_cap = 0;
+                }
+                if (ftcs_ctx_reset(&ctx) != 0) {
+                    b->error = 1;
+                }
+            }
+        }
+        int last = blk->eof; // 終端マーカーを転送したら終了する
+        block_free(blk);
+        if (queue_push(pl, &w->out, b) != 0) {
+            batch_free(b);
+            break;
+        }
+        if (last) {
+            break;
+        }
+    }
+    if (ctx_ok) {
+        w->st = ctx.st;
+        ftcs_ctx_destroy(&ctx);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 中断要求を定期的に確認しながら fd から読む
+ *
+ * パイプやソケットでは read がいつまでも戻らない可能性があるため、
+ * poll で待ってから read することで他段のエラー時にも速やかに終了できる。
+ *
+ * @param pl  パイプライン
+ * @param buf 読み込み先
+ * @param len 最大バイト数
+ * @return 読み込んだバイト数、EOF で 0、エラーまたは中断で -1
+ */
+static ssize_t read_some(stream_pipeline_t *pl, char *buf, size_t len)
+{
+    struct pollfd pfd = { .fd = pl->fd, .events = POLLIN }; // 読み込み可能待ち
+    // データが届くか中断要求が出るまで待つ
+    for (;;) {
+        if (atomic_load(&pl->abort)) {
+            return -1;
+        }
+        int pr = poll(&pfd, 1, ABORT_POLL_MS); // poll の結果
+        if (pr < 0 && errno != EINTR) {
+            perror("ftcs: poll");
+            return -1;
+        }
+        if (pr > 0) {
+            break;
+        }
+    }
+    ssize_t n; // read の結果
+    do {
+        n = read(pl->fd, buf, len);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        perror("ftcs: read");
+    }
+    return n;
+}
+
+/**
+ * @brief キューに要素を格納する。満杯の間は待つ
+ *
+ * @param pl   パイプライン（中断要求の確認に使用）
+ * @param q    格納先キュー
+ * @param item 格納する要素
+ * @return 成功時 0、中断要求により格納できなかった場合 -1
+ */
+static int queue_push(stream_pipeline_t *pl, spsc_queue_t *q, void *item)
+{
+    size_t   tail  = atomic_load_explicit(&q->tail, memory_order_relaxed); // 自分だけが更新する
+    unsigned spins = 0;                                                   // バックオフ段階
+    // 消費者が空きを作るまで待つ
+    while (tail - atomic_load_explicit(&q->head, memory_order_acquire) == STREAM_QUEUE_DEPTH) {
+        if (atomic_load(&pl->abort)) {
+            return -1;
+        }
+        backoff(&spins);
+    }
+    q->slots[tail % STREAM_QUEUE_DEPTH] = item;
+    // 要素の書き込みが消費者に見えてから tail を進める
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * @brief キューから要素を取り出す。空の間は待つ
+ *
+ * @param pl パイプライン（中断要求の確認に使用）
+ * @param q  取り出し元キュー
+ * @return 要素、中断要求時は NULL
+ */
+static void *queue_pop(stream_pipeline_t *pl, spsc_queue_t *q)
+{
+    unsigned spins = 0; // バックオフ段階
+    void    *item;      // 取り出した要素
+    // 生産者が格納するまで待つ
+    while ((item = queue_try_pop(q)) == NULL) {
+        if (atomic_load(&pl->abort)) {
+            return NULL;
+        }
+        backoff(&spins);
+    }
+    return item;
+}
+
+/**
+ * @brief キューが空でなければ要素を1つ取り出す
+ *
+ * @param q 取り出し元キュー
+ * @return 要素、空なら NULL
+ */
+static void *queue_try_pop(spsc_queue_t *q)
+{
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed); // 自分だけが更新する
+    if (head == atomic_load_explicit(&q->tail, memory_order_acquire)) {
+        return NULL;
+    }
+    void *item = q->slots[head % STREAM_QUEUE_DEPTH]; // 取り出す要素
+    // 要素を読み終えてから head を進め、生産者による上書きを防ぐ
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return item;
+}
+
+/**
+ * @brief 待機回数に応じてスピン → yield → 短いスリープと段階的に待つ
+ *
+ * @param spins これまでの待機回数（呼び出しごとに加算される）
+ */
+static void backoff(unsigned *spins)
+{
+    if (*spins < BACKOFF_SPIN_LIMIT) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause(); // スピン中に兄弟ハイパースレッドへ実行資源を譲る
+#endif
+    } else if (*spins < BACKOFF_YIELD_LIMIT) {
+        sched_yield();
+    } else {
+        // 入力が途切れている間は CPU を占有しないようスリープする
+        struct timespec ts = { 0, BACKOFF_SLEEP_NS }; // スリープ時間
+        nanosleep(&ts, NULL);
+    }
+    (*spins)++;
+}
+
+/**
+ * @brief 行ブロックを解放する
+ * @param b 解放対象（NULL 可）
+ */
+static void block_free(stream_block_t *b)
+{
+    if (!b) {
+        return;
+    }
+    free(b->data);
+    free(b);
+}
+
+/**
+ * @brief バッチを解放する
+ * @param b 解放対象（NULL 可）
+ */
+static void batch_free(stream_batch_t *b)
+{
+    if (!b) {
+        return;
+    }
+    ftcs_record_set_free(b->rs);
+    free(b->positions);
+    free(b);
+}
+
+// --- 公開 API ---
+
+ftcs_record_set_t *ftcs_parse_fd(int fd,
+                                 const ftcs_parser_config_t *config,
+                                 const ftcs_field_mapping_t *mapping,
+                                 size_t struct_size)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (fd < 0 || !config || !mapping || !config->kv_separator) {
+        fprintf(stderr, "ftcs: ftcs_parse_fd に不正な引数が渡された\n");
+        return NULL;
+    }
+
+    stream_pipeline_t pl; // パイプライン共有状態
+    memset(&pl, 0, sizeof(pl));
+    pl.fd          = fd;
+    pl.config      = config;
+    // バッチは結合後すぐ捨てる一時領域なので、利用者アロケーター（アリーナや shm）を消費させない
+    pl.worker_config           = *config;
+    pl.worker_config.allocator = NULL;
+    // リングへは順序付け段が通し番号順に書き込むため、パーサースレッドからは書かない
+    pl.worker_config.ring      = NULL;
+    pl.mapping     = mapping;
+    pl.struct_size = struct_size;
+    pl.nworkers    = config->stream_threads ? config->stream_threads : 1;
+    if (pl.nworkers > STREAM_MAX_THREADS) {
+        pl.nworkers = STREAM_MAX_THREADS;
+    }
+    atomic_init(&pl.abort, 0);
+
+    uint64_t t0 = config->stats ? ftcs_now_ns() : 0; // 計測開始時刻
+    // 結合先は順序付け段（呼び出しスレッド）だけが触るため、通常のパースと同じ初期化でよい
+    ftcs_parse_ctx_t ctx; // 結合先レコード集合の確保に使用
+    if (ftcs_ctx_init(&ctx, config, mapping, struct_size) != 0) {
+        return NULL;
+    }
+
+    // キューは _Alignas を含むため aligned_alloc でキャッシュライン境界に置く
+    size_t wbytes = sizeof(stream_worker_t) * pl.nworkers; // ワーカー配列のバイト数
+    wbytes = (wbytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    pl.workers = aligned_alloc(CACHE_LINE_SIZE, wbytes);
+    if (!pl.workers) {
+        perror("ftcs: aligned_alloc");
+        ftcs_ctx_destroy(&ctx);
+        return NULL;
+    }
+    memset(pl.workers, 0, wbytes);
+
+    size_t started = 0; // 起動に成功したパーサースレッド数
+    for (; started < pl.nworkers; started++) {
+        stream_worker_t *w = &pl.workers[started]; // 起動するパーサー
+        w->pl = &pl;
+        atomic_init(&w->in.head, 0);
+        atomic_init(&w->in.tail, 0);
+        atomic_init(&w->out.head, 0);
+        atomic_init(&w->out.tail, 0);
+        if (pthread_create(&w->tid, NULL, worker_main, w) != 0) {
+            fprintf(stderr, "ftcs: パーサースレッドを起動できない\n");
+            atomic_store(&pl.abort, 1);
+            break;
+        }
+    }
+    int reader_ok = 0; // 読み込みスレッドの起動成否
+    if (!atomic_load(&pl.abort)) {
+        reader_ok = (pthread_create(&pl.reader_tid, NULL, reader_main, &pl) == 0);
+        if (!reader_ok) {
+            fprintf(stderr, "ftcs: 読み込みスレッドを起動できない\n");
+            atomic_store(&pl.abort, 1);
+        }
+    }
+
+    int rc = atomic_load(&pl.abort) ? -1 : sequence_batches(&pl, &ctx); // 結合結果
+    // 失敗時は他段を打ち切らせ、キューに残った要素をすべて回収する
+    if (rc != 0) {
+        atomic_store(&pl.abort, 1);
+    }
+    if (reader_ok) {
+        pthread_join(pl.reader_tid, NULL);
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(pl.workers[i].tid, NULL);
+    }
+    // 各段の統計を集計する（フェーズ時間は全スレッドの合計 CPU 時間になる）
+    for (size_t i = 0; i < started; i++) {
+        ftcs_stats_add(&ctx.st, &pl.workers[i].st);
+    }
+    ctx.st.bytes += pl.bytes;
+    ctx.st.io_ns += pl.io_ns;
+    for (size_t i = 0; i < started; i++) {
+        void *item; // キューに残った要素
+        while ((item = queue_try_pop(&pl.workers[i].in)) != NULL) {
+            block_free(item);
+        }
+        while ((item = queue_try_pop(&pl.workers[i].out)) != NULL) {
+            batch_free(item);
+        }
+    }
+    free(pl.workers);
+
+    ftcs_record_set_t *rs = (rc == 0) ? ftcs_ctx_take(&ctx) : NULL; // パース結果
+    ftcs_ctx_report_stats(&ctx, t0);
+    ftcs_ctx_destroy(&ctx);
+    return rs;
+}
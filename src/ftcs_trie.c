@@ -0,0 +1,536 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftcs_internal.h"
+
+// イメージ先頭の識別子（"FTRI"）。ftcs_trie_attach() で別物のバイト列を弾く。
+#define TRIE_MAGIC 0x49525446u
+
+// イメージ形式の版。ノードやヘッダの配置を変えたら上げる。
+#define TRIE_VERSION 1u
+
+// 構築中のノード配列・ラベル領域の初期確保要素数
+#define BUILDER_INITIAL_CAPACITY 64
+
+// --- 内部型定義 ---
+
+/**
+ * @brief イメージの先頭に置くヘッダ（各領域はイメージ先頭からのオフセットで指す）
+ */
+typedef struct {
+    uint32_t magic;      /**< TRIE_MAGIC */
+    uint32_t version;    /**< TRIE_VERSION */
+    uint32_t flags;      /**< ftcs_trie_build() の flags */
+    uint32_t reserved;   /**< 未使用（0） */
+    uint64_t bytes;      /**< イメージ全体のバイト数 */
+    uint64_t nrecords;   /**< 索引したレコード数（pos の要素数） */
+    uint64_t nnodes;     /**< ノード数 */
+    uint64_t nlabels;    /**< ラベル領域のバイト数 */
+    uint64_t nodes_off;  /**< ノード配列のオフセット */
+    uint64_t pos_off;    /**< レコード位置配列のオフセット */
+    uint64_t labels_off; /**< ラベル領域のオフセット */
+} trie_header_t;
+
+/**
+ * @brief トライのノード1個分
+ *
+ * ノードが表すキーの範囲は、キー順に並べたレコード位置配列 pos の [first, end)。
+ * そのうちキーがこのノードでちょうど終わるもの（より短いので先頭に来る）は [first, term_end)。
+ */
+typedef struct {
+    uint32_t label;     /**< 圧縮した区間の文字列のラベル領域内オフセット */
+    uint32_t label_len; /**< 圧縮した区間の長さ */
+    uint32_t child;     /**< 先頭の子ノードの番号（子は先頭バイトの順に連続する） */
+    uint32_t nchild;    /**< 子ノード数 */
+    uint32_t first;     /**< 部分木のキーを持つレコードの pos 内の先頭 */
+    uint32_t end;       /**< 部分木のキーを持つレコードの pos 内の終端 */
+    uint32_t term_end;  /**< このノードで終わるキーを持つレコードの pos 内の終端 */
+    uint8_t  byte;      /**< ラベルの先頭バイト（子の二分探索に使う。根は 0） */
+} trie_node_t;
+
+struct ftcs_trie {
+    const ftcs_record_set_t *rs;        /**< 索引対象のレコード集合 */
+    const trie_header_t     *img;       /**< イメージ */
+    ftcs_allocator_t         allocator; /**< イメージを確保したアロケーター */
+    int                      owned;     /**< 非ゼロならイメージは ftcs_trie_free() で解放する */
+};
+
+/**
+ * @brief 構築中のノード配列とラベル領域
+ */
+typedef struct {
+    const char **keys;      /**< キー順に並べたキー文字列（大文字・小文字を区別しないなら畳み込み済み） */
+    trie_node_t *nodes;     /**< ノード配列 */
+    size_t       nnodes;    /**< ノード数 */
+    size_t       node_cap;  /**< nodes の確保済み要素数 */
+    char        *labels;    /**< ラベル領域 */
+    size_t       nlabels;   /**< ラベル領域の使用バイト数 */
+    size_t       label_cap; /**< labels の確保済みバイト数 */
+} trie_builder_t;
+
+// --- 関数宣言（目次） ---
+
+static const char **sorted_keys(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                                unsigned flags, ftcs_sort_item_t **sorted,
+                                char **folded);                          // キーを辞書順に並べる
+static int  build_node(trie_builder_t *b, size_t idx, size_t a, size_t e,
+                       size_t depth);                                    // キーの範囲からノードを作る
+static long reserve_nodes(trie_builder_t *b, size_t n);                  // ノードを連続して n 個確保する
+static long append_label(trie_builder_t *b, const char *s, size_t len);  // ラベルを追加する
+static const trie_header_t *pack_image(const trie_builder_t *b, const ftcs_sort_item_t *sorted,
+                                       size_t nrecords, unsigned flags,
+                                       const ftcs_allocator_t *allocator); // 連続領域に詰める
+static int  walk(const ftcs_trie_t *t, const char *key, int prefix,
+                 uint32_t *first, uint32_t *end);                        // キーに対応するノードを辿る
+static unsigned char fold_char(char c, int fold);                        // 比較用に文字を畳み込む
+
+// --- 関数定義（概要→詳細の順） ---
+
+// --- 公開 API ---
+
+ftcs_trie_t *ftcs_trie_build(const ftcs_record_set_t *rs,
+                             const ftcs_field_mapping_t *mapping,
+                             const char *field_name,
+                             unsigned flags,
+                             const ftcs_allocator_t *allocator)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!rs || !mapping || !field_name) {
+        fprintf(stderr, "ftcs: ftcs_trie_build に NULL 引数が渡された\n");
+        return NULL;
+    }
+    const ftcs_field_mapping_t *m = mapping; // キーフィールドのマッピングエントリ
+    while (m->field_name && strcmp(m->field_name, field_name) != 0) {
+        m++;
+    }
+    if (!m->field_name || m->type != FTCS_TYPE_STRING) {
+        fprintf(stderr, "ftcs: '%s' はトライを作れる文字列フィールドではない\n", field_name);
+        return NULL;
+    }
+    // ノードとレコード位置は 32 ビットで持つ
+    if (rs->count >= UINT32_MAX) {
+        fprintf(stderr, "ftcs: トライに索引できるレコード数を超えている（%zu 件）\n", rs->count);
+        return NULL;
+    }
+
+    ftcs_trie_t *t = calloc(1, sizeof(*t)); // 構築するトライ
+    if (!t) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    ftcs_sort_item_t *sorted = NULL; // キー順のレコード位置
+    char             *folded = NULL; // 畳み込んだキーの一時領域
+    trie_builder_t    b      = { .keys = sorted_keys(rs, m, flags, &sorted, &folded) }; // 構築中のトライ
+    if (b.keys && reserve_nodes(&b, 1) == 0 && build_node(&b, 0, 0, rs->count, 0) == 0) {
+        t->img = pack_image(&b, sorted, rs->count, flags, allocator);
+    }
+    free(b.keys);
+    free(b.nodes);
+    free(b.labels);
+    free(sorted);
+    free(folded);
+    if (!t->img) {
+        free(t);
+        return NULL;
+    }
+    t->rs    = rs;
+    t->owned = 1;
+    if (allocator) {
+        t->allocator = *allocator;
+    }
+    return t;
+}
+
+ftcs_trie_t *ftcs_trie_attach(const void *image, size_t size, const ftcs_record_set_t *rs)
+{
+    // NULL チェック：必須引数が欠けている場合は即座にエラーとする
+    if (!image || !rs) {
+        fprintf(stderr, "ftcs: ftcs_trie_attach に NULL 引数が渡された\n");
+        return NULL;
+    }
+    const trie_header_t *h = image; // イメージのヘッダ
+    if (size < sizeof(*h) || h->magic != TRIE_MAGIC || h->version != TRIE_VERSION
+        || h->bytes > size || h->nnodes == 0
+        || h->nodes_off + h->nnodes * sizeof(trie_node_t) > h->bytes
+        || h->pos_off + h->nrecords * sizeof(uint32_t) > h->bytes
+        || h->labels_off + h->nlabels > h->bytes) {
+        fprintf(stderr, "ftcs: トライのイメージが不正\n");
+        return NULL;
+    }
+    if (h->nrecords != rs->count) {
+        fprintf(stderr, "ftcs: トライのイメージとレコード集合の件数が異なる（%llu 件と %zu 件）\n",
+                (unsigned long long)h->nrecords, rs->count);
+        return NULL;
+    }
+    ftcs_trie_t *t = calloc(1, sizeof(*t)); // 作成するトライ
+    if (!t) {
+        perror("ftcs: calloc");
+        return NULL;
+    }
+    t->rs  = rs;
+    t->img = h;
+    return t;
+}
+
+const void *ftcs_trie_find(const ftcs_trie_t *t, const char *key)
+{
+    uint32_t first; // 一致したレコードの pos 内の先頭
+    uint32_t end;   // 一致したレコードの pos 内の終端
+    if (!t || !key || walk(t, key, 0, &first, &end) != 0) {
+        return NULL;
+    }
+    const uint32_t *pos = (const uint32_t *)((const char *)t->img + t->img->pos_off); // レコード位置配列
+    return (const char *)t->rs->records + (size_t)pos[first] * t->rs->struct_size;
+}
+
+size_t ftcs_trie_prefix(const ftcs_trie_t *t, const char *prefix, ftcs_range_cb_t cb, void *arg)
+{
+    uint32_t first; // 前方一致したレコードの pos 内の先頭
+    uint32_t end;   // 前方一致したレコードの pos 内の終端
+    if (!t || !prefix || !cb || walk(t, prefix, 1, &first, &end) != 0) {
+        return 0;
+    }
+    const uint32_t *pos     = (const uint32_t *)((const char *)t->img + t->img->pos_off); // レコード位置配列
+    const char     *records = t->rs->records;     // レコード配列の先頭
+    size_t          stride  = t->rs->struct_size; // レコード間隔
+    for (uint32_t r = first; r < end; r++) {
+        if (cb(records + (size_t)pos[r] * stride, arg) != 0) {
+            return r - first + 1;
+        }
+    }
+    return end - first;
+}
+
+size_t ftcs_trie_prefix_count(const ftcs_trie_t *t, const char *prefix)
+{
+    uint32_t first; // 前方一致したレコードの pos 内の先頭
+    uint32_t end;   // 前方一致したレコードの pos 内の終端
+    if (!t || !prefix || walk(t, prefix, 1, &first, &end) != 0) {
+        return 0;
+    }
+    return end - first;
+}
+
+const void *ftcs_trie_image(const ftcs_trie_t *t)
+{
+    return t ? t->img : NULL;
+}
+
+size_t ftcs_trie_bytes(const ftcs_trie_t *t)
+{
+    return t ? t->img->bytes : 0;
+}
+
+void ftcs_trie_free(ftcs_trie_t *t)
+{
+    // NULL の場合は早期リターン（二重解放防止）
+    if (!t) {
+        return;
+    }
+    if (t->owned) {
+        ftcs_mem_free(&t->allocator, (void *)t->img, t->img->bytes);
+    }
+    free(t);
+}
+
+/**
+ * @brief キー文字列をレコード集合と同じ安定な辞書順に並べる
+ *
+ * 大文字・小文字を区別しない場合は、畳み込んだキーを一時領域に並べてから並べ替える。
+ *
+ * @param rs     索引対象のレコード集合
+ * @param m      キーフィールドのマッピングエントリ
+ * @param flags  ftcs_trie_build() の flags
+ * @param sorted キー順のレコード位置の書き込み先（free で解放する）
+ * @param folded 畳み込んだキーの一時領域の書き込み先（free で解放する。畳み込まないなら NULL）
+ * @return キー順のキー文字列の配列（free で解放する）、確保失敗時 NULL
+ */
+static const char **sorted_keys(const ftcs_record_set_t *rs, const ftcs_field_mapping_t *m,
+                                unsigned flags, ftcs_sort_item_t **sorted, char **folded)
+{
+    const char *base   = (const char *)rs->records + m->offset; // 先頭レコードのキー
+    size_t      stride = rs->struct_size;                        // キーの間隔
+    if (flags & FTCS_TRIE_CASE_INSENSITIVE) {
+        *folded = malloc((rs->count ? rs->count : 1) * m->size);
+        if (!*folded) {
+            perror("ftcs: malloc");
+            return NULL;
+        }
+        for (size_t i = 0; i < rs->count; i++) {
+            const char *src = base + i * stride;      // 元のキー
+            char       *dst = *folded + i * m->size;  // 畳み込んだキー
+            size_t      j   = 0;                      // コピーしたバイト数
+            for (; j + 1 < m->size && src[j]; j++) {
+                dst[j] = (char)fold_char(src[j], 1);
+            }
+            dst[j] = '\0';
+        }
+        // 畳み込んだキーだけを並べた集合として並べ替える（位置は元のレコードと同じ）
+        ftcs_record_set_t    keys_rs = { .records = *folded, .count = rs->count, .struct_size = m->size };
+        ftcs_field_mapping_t keys_m  = { .size = m->size, .type = FTCS_TYPE_STRING };
+        *sorted = ftcs_key_sort(&keys_rs, &keys_m);
+        base    = *folded;
+        stride  = m->size;
+    } else {
+        *sorted = ftcs_key_sort(rs, m);
+    }
+    const char **keys = malloc((rs->count ? rs->count : 1) * sizeof(*keys)); // キー順のキー文字列
+    if (!*sorted || !keys) {
+        if (!keys) {
+            perror("ftcs: malloc");
+        }
+        free(keys);
+        return NULL;
+    }
+    for (size_t i = 0; i < rs->count; i++) {
+        keys[i] = base + (*sorted)[i].pos * stride;
+    }
+    return keys;
+}
+
+/**
+ * @brief 先頭 depth バイトが共通なキーの範囲 [a, e) から、ノード idx と部分木を作る
+ *
+ * 範囲の最初と最後のキーの共通接頭辞（辞書順なので範囲全体の共通接頭辞）をラベルにし、
+ * ラベルの直後でちょうど終わるキーを除いた残りを次のバイトで子に分ける。
+ * 各段で 1 バイト以上進むので、再帰の深さはキー長を超えない。
+ *
+ * @param b     構築中のトライ
+ * @param idx   作るノードの番号（確保済み）
+ * @param a     範囲の先頭
+ * @param e     範囲の終端
+ * @param depth 共通なバイト数
+ * @return 成功時 0、確保失敗時 -1
+ */
+static int build_node(trie_builder_t *b, size_t idx, size_t a, size_t e, size_t depth)
+{
+    size_t len = 0; // 範囲の共通接頭辞の depth 以降の長さ
+    if (a < e) {
+        const char *lo = b->keys[a] + depth;     // 範囲の最初のキー
+        const char *hi = b->keys[e - 1] + depth; // 範囲の最後のキー
+        while (lo[len] && lo[len] == hi[len]) {
+            len++;
+        }
+    }
+    long label = append_label(b, a < e ? b->keys[a] + depth : "", len); // ラベルのオフセット
+    if (label < 0) {
+        return -1;
+    }
+    size_t d = depth + len; // 子を分けるバイト位置
+    size_t t = a;           // 最初の子の範囲の先頭
+    while (t < e && b->keys[t][d] == '\0') {
+        t++;
+    }
+    size_t nchild = 0; // 子ノード数
+    for (size_t i = t; i < e; i++) {
+        if (i == t || b->keys[i][d] != b->keys[i - 1][d]) {
+            nchild++;
+        }
+    }
+    long child = reserve_nodes(b, nchild); // 先頭の子ノードの番号
+    if (child < 0) {
+        return -1;
+    }
+    trie_node_t *node = &b->nodes[idx]; // 作るノード
+    node->label     = (uint32_t)label;
+    node->label_len = (uint32_t)len;
+    node->child     = (uint32_t)child;
+    node->nchild    = (uint32_t)nchild;
+    node->first     = (uint32_t)a;
+    node->end       = (uint32_t)e;
+    node->term_end  = (uint32_t)t;
+    node->byte      = len ? (uint8_t)b->keys[a][depth] : 0;
+
+    size_t c = (size_t)child; // 作る子ノードの番号
+    for (size_t g = t; g < e; c++) {
+        size_t h = g + 1; // 子の範囲の終端
+        while (h < e && b->keys[h][d] == b->keys[g][d]) {
+            h++;
+        }
+        if (build_node(b, c, g, h, d) != 0) {
+            return -1;
+        }
+        g = h;
+    }
+    return 0;
+}
+
+/**
+ * @brief ノード配列の末尾に n 個のノードを連続して確保する（ゼロ初期化）
+ *
+ * @param b 構築中のトライ
+ * @param n 確保するノード数
+ * @return 先頭のノード番号、確保失敗時 -1
+ */
+static long reserve_nodes(trie_builder_t *b, size_t n)
+{
+    if (b->nnodes + n > b->node_cap) {
+        size_t cap = b->node_cap ? b->node_cap : BUILDER_INITIAL_CAPACITY; // 拡張後の要素数
+        while (cap < b->nnodes + n) {
+            cap *= 2;
+        }
+        trie_node_t *nodes = realloc(b->nodes, cap * sizeof(*nodes)); // 拡張後のノード配列
+        if (!nodes) {
+            perror("ftcs: realloc");
+            return -1;
+        }
+        b->nodes    = nodes;
+        b->node_cap = cap;
+    }
+    memset(b->nodes + b->nnodes, 0, n * sizeof(*b->nodes));
+    b->nnodes += n;
+    return (long)(b->nnodes - n);
+}
+
+/**
+ * @brief ラベル領域の末尾に len バイトを追加する
+ *
+ * @param b   構築中のトライ
+ * @param s   追加する文字列
+ * @param len 追加するバイト数
+ * @return 追加したラベルのオフセット、確保失敗時 -1
+ */
+static long append_label(trie_builder_t *b, const char *s, size_t len)
+{
+    if (len == 0) {
+        return (long)b->nlabels;
+    }
+    if (b->nlabels + len > b->label_cap) {
+        size_t cap = b->label_cap ? b->label_cap : BUILDER_INITIAL_CAPACITY; // 拡張後のバイト数
+        while (cap < b->nlabels + len) {
+            cap *= 2;
+        }
+        // ラベルのオフセットは 32 ビットで持つ
+        char *labels = cap <= UINT32_MAX ? realloc(b->labels, cap) : NULL; // 拡張後のラベル領域
+        if (!labels) {
+            fprintf(stderr, "ftcs: トライのラベル領域の確保に失敗（%zu バイト）\n", cap);
+            return -1;
+        }
+        b->labels    = labels;
+        b->label_cap = cap;
+    }
+    memcpy(b->labels + b->nlabels, s, len);
+    b->nlabels += len;
+    return (long)(b->nlabels - len);
+}
+
+/**
+ * @brief ヘッダ・ノード配列・レコード位置配列・ラベル領域を1つの連続領域に詰める
+ *
+ * @param b         構築済みのトライ
+ * @param sorted    キー順のレコード位置
+ * @param nrecords  レコード数
+ * @param flags     ftcs_trie_build() の flags
+ * @param allocator イメージの確保に使うアロケーター（NULL なら calloc）
+ * @return イメージ、確保失敗時 NULL
+ */
+static const trie_header_t *pack_image(const trie_builder_t *b, const ftcs_sort_item_t *sorted,
+                                       size_t nrecords, unsigned flags,
+                                       const ftcs_allocator_t *allocator)
+{
+    size_t nodes_off  = sizeof(trie_header_t);                           // ノード配列のオフセット
+    size_t pos_off    = nodes_off + b->nnodes * sizeof(trie_node_t);     // レコード位置配列のオフセット
+    size_t labels_off = pos_off + nrecords * sizeof(uint32_t);           // ラベル領域のオフセット
+    size_t bytes      = labels_off + b->nlabels;                         // イメージ全体のバイト数
+    char  *img        = ftcs_mem_alloc(allocator, bytes);                // イメージ
+    if (!img) {
+        fprintf(stderr, "ftcs: トライのイメージの確保に失敗（%zu バイト）\n", bytes);
+        return NULL;
+    }
+    trie_header_t *h = (trie_header_t *)img; // イメージのヘッダ
+    h->magic      = TRIE_MAGIC;
+    h->version    = TRIE_VERSION;
+    h->flags      = flags;
+    h->bytes      = bytes;
+    h->nrecords   = nrecords;
+    h->nnodes     = b->nnodes;
+    h->nlabels    = b->nlabels;
+    h->nodes_off  = nodes_off;
+    h->pos_off    = pos_off;
+    h->labels_off = labels_off;
+    memcpy(img + nodes_off, b->nodes, b->nnodes * sizeof(trie_node_t));
+    uint32_t *pos = (uint32_t *)(img + pos_off); // レコード位置配列
+    for (size_t i = 0; i < nrecords; i++) {
+        pos[i] = (uint32_t)sorted[i].pos;
+    }
+    if (b->nlabels) {
+        memcpy(img + labels_off, b->labels, b->nlabels);
+    }
+    return h;
+}
+
+/**
+ * @brief キーに沿って根からノードを辿り、一致するレコードの pos 内の範囲を求める
+ *
+ * 各ノードでラベルを比べ、次のバイトで子を二分探索する。
+ * 前方一致ではキーがラベルの途中で終わってもそのノードの部分木全体が一致する。
+ *
+ * @param t      トライ
+ * @param key    検索するキー
+ * @param prefix 非ゼロなら前方一致、0 なら完全一致
+ * @param first  範囲の先頭の書き込み先
+ * @param end    範囲の終端の書き込み先
+ * @return 一致があれば 0、なければ -1
+ */
+static int walk(const ftcs_trie_t *t, const char *key, int prefix,
+                uint32_t *first, uint32_t *end)
+{
+    const trie_header_t *h      = t->img;                                              // イメージのヘッダ
+    const trie_node_t   *nodes  = (const trie_node_t *)((const char *)h + h->nodes_off); // ノード配列
+    const char          *labels = (const char *)h + h->labels_off;                     // ラベル領域
+    int                  fold   = (h->flags & FTCS_TRIE_CASE_INSENSITIVE) != 0;        // 畳み込むか
+    const trie_node_t   *n      = &nodes[0];                                           // 訪れているノード
+    size_t               d      = 0;                                                   // キーの比較位置
+
+    for (;;) {
+        for (uint32_t i = 0; i < n->label_len; i++, d++) {
+            unsigned char c = fold_char(key[d], fold); // キーの次のバイト
+            if (c == '\0') {
+                if (!prefix) {
+                    return -1;
+                }
+                *first = n->first;
+                *end   = n->end;
+                return 0;
+            }
+            if (c != (unsigned char)labels[n->label + i]) {
+                return -1;
+            }
+        }
+        if (key[d] == '\0') {
+            *first = n->first;
+            *end   = prefix ? n->end : n->term_end;
+            return (*end > *first) ? 0 : -1;
+        }
+        unsigned char c  = fold_char(key[d], fold); // 子を選ぶバイト
+        uint32_t      lo = n->child;                // 子の探索範囲の先頭
+        uint32_t      hi = n->child + n->nchild;    // 子の探索範囲の終端
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2; // 探索範囲の中央
+            if (nodes[mid].byte < c) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo == n->child + n->nchild || nodes[lo].byte != c) {
+            return -1;
+        }
+        n = &nodes[lo];
+    }
+}
+
+/**
+ * @brief 比較用にバイトを畳み込む（fold が非ゼロなら ASCII の大文字を小文字にする）
+ *
+ * @param c    元のバイト
+ * @param fold 畳み込むか
+ * @return 比較に使うバイト
+ */
+static unsigned char fold_char(char c, int fold)
+{
+    unsigned char u = (unsigned char)c; // 符号なしにしたバイト
+    return (fold && u >= 'A' && u <= 'Z') ? (unsigned char)(u - 'A' + 'a') : u;
+}
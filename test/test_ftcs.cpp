@@ -8,8 +8,19 @@
  */
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
 #include <cstring>
 #include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 extern "C" {
 #include "ftcs.h"
@@ -42,48 +53,57 @@ typedef struct {
 /* ── マッピングテーブル（C++ では _Generic が使えないため手動定義） ── */
 
 static const ftcs_field_mapping_t sample_mapping[] = {
-    { "ID",    offsetof(sample_t, id),    sizeof(int),      FTCS_TYPE_INT    },
-    { "NAME",  offsetof(sample_t, name),  sizeof(char[64]), FTCS_TYPE_STRING },
-    { "VALUE", offsetof(sample_t, value), sizeof(double),   FTCS_TYPE_DOUBLE },
-    { nullptr, 0, 0, FTCS_TYPE_INT }
+    { "ID",    offsetof(sample_t, id),    sizeof(int),      FTCS_TYPE_INT,    FTCS_TYPE_INT    },
+    { "NAME",  offsetof(sample_t, name),  sizeof(char[64]), FTCS_TYPE_STRING, FTCS_TYPE_STRING },
+    { "VALUE", offsetof(sample_t, value), sizeof(double),   FTCS_TYPE_DOUBLE, FTCS_TYPE_DOUBLE },
+    { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
 };
 
 static const ftcs_field_mapping_t sensor_mapping[] = {
-    { "LOCATION", offsetof(sensor_t, location),    sizeof(char[32]), FTCS_TYPE_STRING },
-    { "TEMP",     offsetof(sensor_t, temperature), sizeof(float),    FTCS_TYPE_FLOAT  },
-    { "HUMIDITY", offsetof(sensor_t, humidity),    sizeof(float),    FTCS_TYPE_FLOAT  },
-    { nullptr, 0, 0, FTCS_TYPE_INT }
+    { "LOCATION", offsetof(sensor_t, location),    sizeof(char[32]), FTCS_TYPE_STRING, FTCS_TYPE_STRING },
+    { "TEMP",     offsetof(sensor_t, temperature), sizeof(float),    FTCS_TYPE_FLOAT,  FTCS_TYPE_FLOAT  },
+    { "HUMIDITY", offsetof(sensor_t, humidity),    sizeof(float),    FTCS_TYPE_FLOAT,  FTCS_TYPE_FLOAT  },
+    { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
 };
 
 static const ftcs_field_mapping_t all_types_mapping[] = {
-    { "IVAL",   offsetof(all_types_t, ival),   sizeof(int),      FTCS_TYPE_INT    },
-    { "LVAL",   offsetof(all_types_t, lval),   sizeof(long),     FTCS_TYPE_LONG   },
-    { "SVAL",   offsetof(all_types_t, sval),   sizeof(short),    FTCS_TYPE_SHORT  },
-    { "FVAL",   offsetof(all_types_t, fval),   sizeof(float),    FTCS_TYPE_FLOAT  },
-    { "DVAL",   offsetof(all_types_t, dval),   sizeof(double),   FTCS_TYPE_DOUBLE },
-    { "CVAL",   offsetof(all_types_t, cval),   sizeof(char),     FTCS_TYPE_CHAR   },
-    { "STRVAL", offsetof(all_types_t, strval), sizeof(char[32]), FTCS_TYPE_STRING },
-    { nullptr, 0, 0, FTCS_TYPE_INT }
+    { "IVAL",   offsetof(all_types_t, ival),   sizeof(int),      FTCS_TYPE_INT,    FTCS_TYPE_INT    },
+    { "LVAL",   offsetof(all_types_t, lval),   sizeof(long),     FTCS_TYPE_LONG,   FTCS_TYPE_LONG   },
+    { "SVAL",   offsetof(all_types_t, sval),   sizeof(short),    FTCS_TYPE_SHORT,  FTCS_TYPE_SHORT  },
+    { "FVAL",   offsetof(all_types_t, fval),   sizeof(float),    FTCS_TYPE_FLOAT,  FTCS_TYPE_FLOAT  },
+    { "DVAL",   offsetof(all_types_t, dval),   sizeof(double),   FTCS_TYPE_DOUBLE, FTCS_TYPE_DOUBLE },
+    { "CVAL",   offsetof(all_types_t, cval),   sizeof(char),     FTCS_TYPE_CHAR,   FTCS_TYPE_CHAR   },
+    { "STRVAL", offsetof(all_types_t, strval), sizeof(char[32]), FTCS_TYPE_STRING, FTCS_TYPE_STRING },
+    { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
 };
 
 /* ── パーサー設定 ────────────────────────────────────────── */
 
-static const ftcs_parser_config_t sample_cfg = {
-    '#', "=", "ID", FTCS_KEY_FIELD, nullptr
-};
-static const ftcs_parser_config_t all_types_cfg = {
-    '#', "=", nullptr, FTCS_KEY_FIELD, nullptr
-};
-static const ftcs_parser_config_t sensor_index_field_cfg = {
-    '#', "=", nullptr, FTCS_KEY_INDEX, "ID"
-};
-static const ftcs_parser_config_t sensor_sequential_cfg = {
-    '#', "=", nullptr, FTCS_KEY_INDEX, nullptr
-};
+/* 設定構造体にはメンバが追加されていくため、集成体の位置指定初期化ではなく
+ * 値初期化した上で必要なメンバだけを設定する */
+static ftcs_parser_config_t parser_cfg(const char *primary_key,
+                                       ftcs_primary_key_mode_t mode,
+                                       const char *index_field_name);
+
+static const ftcs_parser_config_t sample_cfg =
+    parser_cfg("ID", FTCS_KEY_FIELD, nullptr);
+static const ftcs_parser_config_t all_types_cfg =
+    parser_cfg(nullptr, FTCS_KEY_FIELD, nullptr);
+static const ftcs_parser_config_t sensor_index_field_cfg =
+    parser_cfg(nullptr, FTCS_KEY_INDEX, "ID");
+static const ftcs_parser_config_t sensor_sequential_cfg =
+    parser_cfg(nullptr, FTCS_KEY_INDEX, nullptr);
 
 /* ── 関数宣言（目次） ────────────────────────────────────── */
 
 static std::string data(const char *name);
+static std::string write_temp(const std::string &content);
+static ftcs_record_set_t *parse_via_pipe(const std::string &content,
+                                         const ftcs_parser_config_t *cfg,
+                                         const ftcs_field_mapping_t *mapping,
+                                         size_t struct_size);
+static std::string sample_lines(int n);
+static std::string temp_socket_path();
 
 /* ══════════════════════════════════════════════════════════
  * グループ1: ftcs_parse_file — 引数バリデーション
@@ -492,14 +512,3140 @@ TEST(ShmCopy, TruncatedWhenBufferSmall)
     ftcs_record_set_free(rs);
 }
 
-/* ── ヘルパー ───────────────────────────────────────────── */
+/* ══════════════════════════════════════════════════════════
+ * グループ12: 読み込みバックエンド (FTCS_IO_URING / FTCS_IO_PREAD)
+ * ══════════════════════════════════════════════════════════ */
 
-/**
- * @brief test/data/ ディレクトリ内のファイルパスを解決する
- * @param name ファイル名
- * @return test/data/<name> の絶対パス文字列
- */
-static std::string data(const char *name)
+class IoBackend : public ::testing::TestWithParam<ftcs_io_backend_t> {
+protected:
+    ftcs_parser_config_t cfg = sample_cfg;
+    void SetUp() override { cfg.io_backend = GetParam(); }
+};
+
+TEST_P(IoBackend, MatchesStdio)
 {
-    return std::string(TEST_DATA_DIR) + "/" + name;
+    ftcs_record_set_t *rs = ftcs_parse_file(data("comments_empty.txt").c_str(),
+                                            &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(2u, rs->count);
+
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    EXPECT_EQ(1, r[0].id);
+    EXPECT_STREQ("Alpha", r[0].name);
+    EXPECT_EQ(2, r[1].id);
+    EXPECT_STREQ("Beta", r[1].name);
+
+    ftcs_record_set_free(rs);
+}
+
+TEST_P(IoBackend, LinesSpanningBlocks)
+{
+    /* 1MiB ブロックを複数またぎ、最終行に改行がないファイル */
+    std::string content;
+    const int n = 100000;
+    for (int i = 0; i < n; i++) {
+        content += "ID=" + std::to_string(i) + " NAME=Item" + std::to_string(i)
+                 + " VALUE=" + std::to_string(i) + ".5";
+        if (i != n - 1) { content += "\n"; }
+    }
+    std::string path = write_temp(content);
+
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ((size_t)n, rs->count);
+
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ(i, r[i].id);
+        ASSERT_EQ("Item" + std::to_string(i), r[i].name);
+    }
+
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST_P(IoBackend, NonexistentFile)
+{
+    EXPECT_EQ(nullptr, ftcs_parse_file("/no/such/file.txt", &cfg,
+                                       sample_mapping, sizeof(sample_t)));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, IoBackend,
+                         ::testing::Values(FTCS_IO_URING, FTCS_IO_PREAD));
+
+/* ══════════════════════════════════════════════════════════
+ * グループ13: ftcs_parse_fd — パイプ入力のストリームパイプライン
+ * ══════════════════════════════════════════════════════════ */
+
+class ParseFd : public ::testing::TestWithParam<unsigned> {};
+
+TEST_P(ParseFd, SequentialOrderPreserved)
+{
+    /* 複数ブロック・複数パーサーに分散しても入力順に並ぶこと */
+    std::string content = "# header\n";
+    const int n = 50000;
+    for (int i = 0; i < n; i++) {
+        content += "ID=" + std::to_string(i) + " NAME=N" + std::to_string(i)
+                 + " VALUE=1.5\n";
+    }
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stream_threads = GetParam();
+
+    ftcs_record_set_t *rs = parse_via_pipe(content, &cfg, sample_mapping,
+                                           sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ((size_t)n, rs->count);
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ(i, r[i].id);
+    }
+    ftcs_record_set_free(rs);
+}
+
+TEST_P(ParseFd, IndexFieldPlacement)
+{
+    /* 逆順の ID でも array[ID-1] に配置されること（末尾は改行なし） */
+    std::string content;
+    const int n = 30000;
+    for (int i = n; i >= 1; i--) {
+        content += "ID=" + std::to_string(i) + " LOCATION=L" + std::to_string(i)
+                 + " TEMP=1.0 HUMIDITY=2.0";
+        if (i != 1) { content += "\n"; }
+    }
+    ftcs_parser_config_t cfg = sensor_index_field_cfg;
+    cfg.stream_threads = GetParam();
+
+    ftcs_record_set_t *rs = parse_via_pipe(content, &cfg, sensor_mapping,
+                                           sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ((size_t)n, rs->count);
+    const sensor_t *r = static_cast<const sensor_t *>(rs->records);
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ("L" + std::to_string(i + 1), r[i].location);
+    }
+    ftcs_record_set_free(rs);
+}
+
+TEST_P(ParseFd, ParseErrorReturnsNull)
+{
+    /* 後半のブロックに不正な行があっても全段が終了して NULL が返ること */
+    std::string content;
+    for (int i = 0; i < 40000; i++) {
+        content += "ID=" + std::to_string(i) + " NAME=N VALUE=1.0\n";
+    }
+    content += "ID=oops NAME=Bad VALUE=0\n";
+    for (int i = 0; i < 40000; i++) {
+        content += "ID=1 NAME=N VALUE=1.0\n";
+    }
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stream_threads = GetParam();
+
+    EXPECT_EQ(nullptr, parse_via_pipe(content, &cfg, sample_mapping,
+                                      sizeof(sample_t)));
+}
+
+INSTANTIATE_TEST_SUITE_P(Threads, ParseFd, ::testing::Values(1u, 4u));
+
+TEST(ParseFdArgs, InvalidFd)
+{
+    EXPECT_EQ(nullptr, ftcs_parse_fd(-1, &sample_cfg, sample_mapping,
+                                     sizeof(sample_t)));
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ14: パース統計 (ftcs_parser_config_t.stats)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(ParseStats, CountsLines)
+{
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stats = &st;
+
+    ftcs_record_set_t *rs = ftcs_parse_file(data("comments_empty.txt").c_str(),
+                                            &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(92u, st.bytes);
+    EXPECT_EQ(7u,  st.lines);
+    EXPECT_EQ(2u,  st.comments);
+    EXPECT_EQ(3u,  st.empty_lines);
+    EXPECT_EQ(2u,  st.records);
+    EXPECT_EQ(0u,  st.unknown_keys);
+    EXPECT_GT(st.total_ns, 0u);
+    ftcs_record_set_free(rs);
+}
+
+TEST(ParseStats, UnknownKeysCounted)
+{
+    std::string path = write_temp("ID=1 NAME=A VALUE=1.0 EXTRA=x\n"
+                                  "ID=2 NAME=B VALUE=2.0 EXTRA=y OTHER=z\n");
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stats = &st;
+
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(3u, st.unknown_keys);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(ParseStats, ReallocsAndPhases)
+{
+    /* 初期容量を超える件数で realloc が発生し、抽出行のフェーズ時間が換算されること */
+    std::string content;
+    const int n = 1000;
+    for (int i = 0; i < n; i++) {
+        content += "ID=" + std::to_string(i) + " NAME=N VALUE=1.5\n";
+    }
+    std::string path = write_temp(content);
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stats = &st;
+
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(content.size(), st.bytes);
+    EXPECT_EQ((size_t)n, st.records);
+    EXPECT_GT(st.reallocs, 0u);
+    EXPECT_GE(st.peak_bytes, n * sizeof(sample_t));
+    EXPECT_GT(st.sampled_lines, 0u);
+    EXPECT_LT(st.sampled_lines, (size_t)n);
+    EXPECT_GT(st.tokenize_ns + st.lookup_ns + st.convert_ns, 0u);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(ParseStats, StreamAggregatesWorkers)
+{
+    /* 複数パーサースレッドの統計が合算されること */
+    std::string content = "# header\n\n";
+    const int n = 50000;
+    for (int i = 0; i < n; i++) {
+        content += "ID=" + std::to_string(i) + " NAME=N VALUE=1.5\n";
+    }
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stream_threads = 4;
+    cfg.stats = &st;
+
+    ftcs_record_set_t *rs = parse_via_pipe(content, &cfg, sample_mapping,
+                                           sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(content.size(), st.bytes);
+    EXPECT_EQ((size_t)n + 2, st.lines);
+    EXPECT_EQ(1u, st.comments);
+    EXPECT_EQ(1u, st.empty_lines);
+    EXPECT_EQ((size_t)n, st.records);
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ15: アロケーター (ftcs_parser_config_t.allocator)
+ * ══════════════════════════════════════════════════════════ */
+
+/* 呼び出し回数と確保中バイト数を数える利用者アロケーター */
+struct CountingAllocator {
+    size_t allocs = 0, reallocs = 0, frees = 0;
+    size_t live_bytes = 0;
+
+    static void *alloc(void *ctx, size_t size)
+    {
+        auto *self = static_cast<CountingAllocator *>(ctx);
+        self->allocs++;
+        self->live_bytes += size;
+        return malloc(size);
+    }
+    static void *resize(void *ctx, void *ptr, size_t old_size, size_t new_size)
+    {
+        auto *self = static_cast<CountingAllocator *>(ctx);
+        void *p = realloc(ptr, new_size);
+        if (p) {
+            self->reallocs++;
+            self->live_bytes += new_size - old_size;
+        }
+        return p;
+    }
+    static void release(void *ctx, void *ptr, size_t size)
+    {
+        auto *self = static_cast<CountingAllocator *>(ctx);
+        self->frees++;
+        self->live_bytes -= size;
+        free(ptr);
+    }
+    ftcs_allocator_t allocator() { return { alloc, resize, release, this }; }
+};
+
+TEST(Allocator, CustomCallbacksBalanced)
+{
+    std::string path = write_temp(sample_lines(1000));
+    CountingAllocator counter;
+    ftcs_allocator_t a = counter.allocator();
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.allocator = &a;
+
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(1000u, rs->count);
+    EXPECT_EQ(1u, counter.allocs);
+    EXPECT_GT(counter.reallocs, 0u);
+    EXPECT_EQ(rs->capacity * sizeof(sample_t), counter.live_bytes);
+
+    ftcs_record_set_free(rs);
+    EXPECT_EQ(1u, counter.frees);
+    EXPECT_EQ(0u, counter.live_bytes);
+    unlink(path.c_str());
+}
+
+TEST(Allocator, ArenaGrowsInPlace)
+{
+    std::string path = write_temp(sample_lines(1000));
+    ftcs_arena_t arena;
+    ASSERT_EQ(0, ftcs_arena_init(&arena, nullptr, 1024 * sizeof(sample_t)));
+    ftcs_allocator_t a = ftcs_arena_allocator(&arena);
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.allocator = &a;
+
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    /* 唯一の確保ブロックなので、拡張してもアリーナ先頭から動かない */
+    EXPECT_EQ(static_cast<void *>(arena.base), rs->records);
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    EXPECT_EQ(999, r[999].id);
+
+    ftcs_record_set_free(rs);
+    EXPECT_EQ(0u, arena.used);
+    ftcs_arena_destroy(&arena);
+    unlink(path.c_str());
+}
+
+TEST(Allocator, ArenaExhaustedReturnsNull)
+{
+    std::string path = write_temp(sample_lines(1000));
+    ftcs_arena_t arena;
+    ASSERT_EQ(0, ftcs_arena_init(&arena, nullptr, 100 * sizeof(sample_t)));
+    ftcs_allocator_t a = ftcs_arena_allocator(&arena);
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.allocator = &a;
+
+    EXPECT_EQ(nullptr, ftcs_parse_file(path.c_str(), &cfg, sample_mapping,
+                                       sizeof(sample_t)));
+    EXPECT_EQ(0u, arena.used);
+    ftcs_arena_destroy(&arena);
+    unlink(path.c_str());
+}
+
+TEST(Allocator, HugepageMatchesDefault)
+{
+    std::string path = write_temp(sample_lines(50000));
+    ftcs_allocator_t a = ftcs_hugepage_allocator();
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.allocator = &a;
+
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(50000u, rs->count);
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    for (int i = 0; i < 50000; i++) {
+        ASSERT_EQ(i, r[i].id);
+    }
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(Allocator, ShmRegionHoldsRecords)
+{
+    /* 順不同の ID でも shm 上の array[ID-1] に直接配置されること */
+    std::vector<sensor_t> shm(64);
+    ftcs_arena_t arena;
+    ftcs_allocator_t a = ftcs_shm_allocator(&arena, shm.data(),
+                                            shm.size() * sizeof(sensor_t));
+    ftcs_parser_config_t cfg = sensor_index_field_cfg;
+    cfg.allocator = &a;
+
+    ftcs_record_set_t *rs = ftcs_parse_file(data("index_field.txt").c_str(),
+                                            &cfg, sensor_mapping,
+                                            sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(static_cast<void *>(shm.data()), rs->records);
+    EXPECT_STREQ("RoomA", shm[0].location);
+    EXPECT_STREQ("ServerRoom", shm[2].location);
+    ftcs_record_set_free(rs);
+    /* 解放後も shm 上の内容は残る */
+    EXPECT_STREQ("RoomA", shm[0].location);
+}
+
+TEST(Allocator, ParseFdUsesAllocatorForResultOnly)
+{
+    ftcs_arena_t arena;
+    ASSERT_EQ(0, ftcs_arena_init(&arena, nullptr, 65536 * sizeof(sample_t)));
+    ftcs_allocator_t a = ftcs_arena_allocator(&arena);
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.allocator = &a;
+    cfg.stream_threads = 4;
+
+    ftcs_record_set_t *rs = parse_via_pipe(sample_lines(50000), &cfg,
+                                           sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(50000u, rs->count);
+    EXPECT_EQ(static_cast<void *>(arena.base), rs->records);
+    ftcs_record_set_free(rs);
+    ftcs_arena_destroy(&arena);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ16: ftcs_key_index — プライマリキーのハッシュ索引
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(KeyIndex, MatchesLinearSearch)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_key_index_t *idx = ftcs_key_index_build(rs, sample_mapping, "ID");
+    ASSERT_NE(nullptr, idx);
+
+    for (const char *key : { "42", "7", "100", "999", "-1" }) {
+        EXPECT_EQ(ftcs_find_by_key(rs, sample_mapping, "ID", key, sizeof(sample_t)),
+                  ftcs_key_index_find(idx, key)) << key;
+    }
+    ftcs_key_index_free(idx);
+    ftcs_record_set_free(rs);
+}
+
+TEST(KeyIndex, StringKeyLargeSet)
+{
+    std::string path = write_temp(sample_lines(20000));
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_key_index_t *idx = ftcs_key_index_build(rs, sample_mapping, "NAME");
+    ASSERT_NE(nullptr, idx);
+
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    for (int i = 0; i < 20000; i++) {
+        std::string key = "N" + std::to_string(i);
+        ASSERT_EQ(&r[i], ftcs_key_index_find(idx, key.c_str())) << key;
+    }
+    EXPECT_EQ(nullptr, ftcs_key_index_find(idx, "N20000"));
+    ftcs_key_index_free(idx);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(KeyIndex, DuplicateKeyReturnsFirst)
+{
+    std::string path = write_temp("ID=5 NAME=First VALUE=1.0\n"
+                                  "ID=5 NAME=Second VALUE=2.0\n");
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_key_index_t *idx = ftcs_key_index_build(rs, sample_mapping, "ID");
+    ASSERT_NE(nullptr, idx);
+
+    const sample_t *s = static_cast<const sample_t *>(ftcs_key_index_find(idx, "5"));
+    ASSERT_NE(nullptr, s);
+    EXPECT_STREQ("First", s->name);
+    ftcs_key_index_free(idx);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(KeyIndex, DoubleKeySignedZero)
+{
+    /* 0.0 と -0.0 は線形探索と同じく一致として扱う */
+    std::string path = write_temp("ID=1 NAME=Zero VALUE=-0.0\n");
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_key_index_t *idx = ftcs_key_index_build(rs, sample_mapping, "VALUE");
+    ASSERT_NE(nullptr, idx);
+    EXPECT_EQ(rs->records, ftcs_key_index_find(idx, "0"));
+    ftcs_key_index_free(idx);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(KeyIndex, InvalidArguments)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(nullptr, ftcs_key_index_build(nullptr, sample_mapping, "ID"));
+    EXPECT_EQ(nullptr, ftcs_key_index_build(rs, sample_mapping, "NOSUCH"));
+    EXPECT_EQ(nullptr, ftcs_key_index_find(nullptr, "42"));
+    ftcs_key_index_free(nullptr);
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ17: 検索サーバー (ftcs_server / ftcs_client)
+ * ══════════════════════════════════════════════════════════ */
+
+/* 別スレッドでイベントループを回し、スコープを抜けるときに停止・破棄する */
+struct RunningServer {
+    ftcs_server_t *srv;
+    std::thread    loop;
+
+    explicit RunningServer(ftcs_server_t *s) : srv(s), loop([s]() { ftcs_server_run(s); }) {}
+    ~RunningServer()
+    {
+        ftcs_server_stop(srv);
+        loop.join();
+        ftcs_server_destroy(srv);
+    }
+};
+
+TEST(Server, FieldKeyLookup)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    std::string sock = temp_socket_path();
+    ftcs_server_t *srv = ftcs_server_create(sock.c_str(), rs, sample_mapping, &sample_cfg);
+    ASSERT_NE(nullptr, srv);
+    {
+        RunningServer running(srv);
+        ftcs_client_t *c = ftcs_client_connect(sock.c_str());
+        ASSERT_NE(nullptr, c);
+
+        sample_t rec = {};
+        EXPECT_EQ(FTCS_LOOKUP_FOUND, ftcs_client_lookup(c, "7", &rec, sizeof(rec)));
+        EXPECT_EQ(7, rec.id);
+        EXPECT_STREQ("Widget", rec.name);
+        EXPECT_EQ(FTCS_LOOKUP_NOT_FOUND, ftcs_client_lookup(c, "999", &rec, sizeof(rec)));
+        /* out を省略しても応答の境界はずれない */
+        EXPECT_EQ(FTCS_LOOKUP_FOUND, ftcs_client_lookup(c, "42", nullptr, 0));
+        EXPECT_EQ(FTCS_LOOKUP_FOUND, ftcs_client_lookup(c, "100", &rec, sizeof(rec)));
+        EXPECT_STREQ("Gadget", rec.name);
+        ftcs_client_close(c);
+    }
+    /* 破棄時にソケットファイルは削除される */
+    EXPECT_NE(0, access(sock.c_str(), F_OK));
+    ftcs_record_set_free(rs);
+}
+
+TEST(Server, IndexKeyLookup)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("sequential.txt").c_str(),
+                                            &sensor_sequential_cfg,
+                                            sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    std::string sock = temp_socket_path();
+    ftcs_server_t *srv = ftcs_server_create(sock.c_str(), rs, sensor_mapping,
+                                            &sensor_sequential_cfg);
+    ASSERT_NE(nullptr, srv);
+    RunningServer running(srv);
+    ftcs_client_t *c = ftcs_client_connect(sock.c_str());
+    ASSERT_NE(nullptr, c);
+
+    sensor_t rec = {};
+    EXPECT_EQ(FTCS_LOOKUP_FOUND, ftcs_client_lookup(c, "2", &rec, sizeof(rec)));
+    EXPECT_STREQ("Gamma", rec.location);
+    for (const char *key : { "3", "-1", "+1", " 1", "1x", "", "abc" }) {
+        EXPECT_EQ(FTCS_LOOKUP_NOT_FOUND, ftcs_client_lookup(c, key, &rec, sizeof(rec))) << key;
+    }
+    ftcs_client_close(c);
+    ftcs_record_set_free(rs);
+}
+
+TEST(Server, PipelinedRequestsAnsweredInOrder)
+{
+    /* 応答を待たずに大量の要求を送り、送信バッファの上限による読み込み停止も通す */
+    const int n = 20000;
+    std::string path = write_temp(sample_lines(n));
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    std::string sock = temp_socket_path();
+    ftcs_server_t *srv = ftcs_server_create(sock.c_str(), rs, sample_mapping, &sample_cfg);
+    ASSERT_NE(nullptr, srv);
+    RunningServer running(srv);
+
+    std::vector<ftcs_client_t *> clients;
+    for (int k = 0; k < 4; k++) {
+        clients.push_back(ftcs_client_connect(sock.c_str()));
+        ASSERT_NE(nullptr, clients.back());
+    }
+    std::vector<std::thread> senders;
+    for (ftcs_client_t *c : clients) {
+        senders.emplace_back([c, n]() {
+            for (int i = 0; i < n + 1; i++) {
+                ftcs_client_send(c, std::to_string(i).c_str());
+            }
+        });
+    }
+    for (ftcs_client_t *c : clients) {
+        sample_t rec = {};
+        for (int i = 0; i < n; i++) {
+            ASSERT_EQ(FTCS_LOOKUP_FOUND, ftcs_client_recv(c, &rec, sizeof(rec)));
+            ASSERT_EQ(i, rec.id);
+        }
+        EXPECT_EQ(FTCS_LOOKUP_NOT_FOUND, ftcs_client_recv(c, &rec, sizeof(rec)));
+    }
+    for (std::thread &t : senders) {
+        t.join();
+    }
+    for (ftcs_client_t *c : clients) {
+        ftcs_client_close(c);
+    }
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(Server, OversizedKeyClosesConnection)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    std::string sock = temp_socket_path();
+    ftcs_server_t *srv = ftcs_server_create(sock.c_str(), rs, sample_mapping, &sample_cfg);
+    ASSERT_NE(nullptr, srv);
+    RunningServer running(srv);
+    ftcs_client_t *c = ftcs_client_connect(sock.c_str());
+    ASSERT_NE(nullptr, c);
+
+    std::string key(FTCS_LOOKUP_MAX_KEY + 1, '1');
+    EXPECT_EQ(FTCS_LOOKUP_BAD_REQUEST, ftcs_client_lookup(c, key.c_str(), nullptr, 0));
+    EXPECT_EQ(-1, ftcs_client_lookup(c, "42", nullptr, 0));
+    ftcs_client_close(c);
+
+    /* 他の接続には影響しない */
+    c = ftcs_client_connect(sock.c_str());
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(FTCS_LOOKUP_FOUND, ftcs_client_lookup(c, "42", nullptr, 0));
+    ftcs_client_close(c);
+    ftcs_record_set_free(rs);
+}
+
+TEST(Server, InvalidArguments)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    std::string sock = temp_socket_path();
+    EXPECT_EQ(nullptr, ftcs_server_create(nullptr, rs, sample_mapping, &sample_cfg));
+    EXPECT_EQ(nullptr, ftcs_server_create(sock.c_str(), nullptr, sample_mapping, &sample_cfg));
+    /* FTCS_KEY_FIELD で primary_key 未設定 */
+    EXPECT_EQ(nullptr, ftcs_server_create(sock.c_str(), rs, sample_mapping, &all_types_cfg));
+    /* sun_path に収まらないパス */
+    std::string long_path = "/tmp/" + std::string(200, 'x');
+    EXPECT_EQ(nullptr, ftcs_server_create(long_path.c_str(), rs, sample_mapping, &sample_cfg));
+    /* ソケット以外の既存ファイルは上書きしない */
+    std::string regular = write_temp("not a socket\n");
+    EXPECT_EQ(nullptr, ftcs_server_create(regular.c_str(), rs, sample_mapping, &sample_cfg));
+    EXPECT_EQ(0, access(regular.c_str(), F_OK));
+
+    EXPECT_EQ(nullptr, ftcs_client_connect(sock.c_str()));
+    EXPECT_EQ(-1, ftcs_client_lookup(nullptr, "42", nullptr, 0));
+    ftcs_server_destroy(nullptr);
+    ftcs_client_close(nullptr);
+    unlink(regular.c_str());
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ18: フィルタ式 (ftcs_parser_config_t.filter)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(Filter, NumericAndStringTerms)
+{
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.filter = "VALUE > 3 && NAME!=Widget";
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(1u, rs->count);
+    EXPECT_STREQ("TestItem", static_cast<const sample_t *>(rs->records)[0].name);
+    ftcs_record_set_free(rs);
+}
+
+TEST(Filter, FloatBoundaryAndStats)
+{
+    /* float フィールドの比較値は float に丸めて比べる */
+    std::string path = write_temp("LOCATION=A TEMP=30.1 HUMIDITY=1\n"
+                                  "LOCATION=B TEMP=30.2 HUMIDITY=1\n"
+                                  "LOCATION=C TEMP=29.9 HUMIDITY=1\n");
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sensor_sequential_cfg;
+    cfg.filter = "TEMP>=30.1";
+    cfg.stats  = &st;
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(2u, rs->count);
+    const sensor_t *r = static_cast<const sensor_t *>(rs->records);
+    EXPECT_STREQ("A", r[0].location);
+    EXPECT_STREQ("B", r[1].location);
+    EXPECT_EQ(2u, st.records);
+    EXPECT_EQ(1u, st.filtered);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(Filter, RejectedLineRestNotParsed)
+{
+    /* 棄却が決まった行の後続フィールドは変換しないため、不正な値があってもエラーにならない */
+    std::string path = write_temp("ID=1 NAME=Skip VALUE=oops\n"
+                                  "ID=9 NAME=Keep VALUE=1.0\n"
+                                  "ID=2 NAME=Zero\n");
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.filter = "ID>5";
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(1u, rs->count);
+    EXPECT_STREQ("Keep", static_cast<const sample_t *>(rs->records)[0].name);
+    ftcs_record_set_free(rs);
+
+    /* 行に現れないフィールドはゼロ値として判定する */
+    cfg.filter = "VALUE=0 && ID<5";
+    std::string ok = write_temp("ID=2 NAME=Zero\nID=3 NAME=One VALUE=1\n");
+    rs = ftcs_parse_file(ok.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(1u, rs->count);
+    EXPECT_STREQ("Zero", static_cast<const sample_t *>(rs->records)[0].name);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+    unlink(ok.c_str());
+}
+
+TEST(Filter, IndexPlacementSkipsRejected)
+{
+    /* 棄却した大きな ID のために配列を広げない */
+    std::string path = write_temp("ID=2 LOCATION=Lab TEMP=35 HUMIDITY=1\n"
+                                  "ID=100000 LOCATION=Far TEMP=10 HUMIDITY=1\n"
+                                  "ID=1 LOCATION=Hall TEMP=31 HUMIDITY=1\n");
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sensor_index_field_cfg;
+    cfg.filter = "TEMP>30";
+    cfg.stats  = &st;
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(2u, rs->count);
+    const sensor_t *r = static_cast<const sensor_t *>(rs->records);
+    EXPECT_STREQ("Hall", r[0].location);
+    EXPECT_STREQ("Lab", r[1].location);
+    EXPECT_LT(st.peak_bytes, 1000 * sizeof(sensor_t));
+    ftcs_record_set_free(rs);
+
+    /* ストリームパイプラインでも同じ結果になる */
+    std::string content;
+    for (int i = 1; i <= 30000; i++) {
+        content += "ID=" + std::to_string(i) + " LOCATION=R" + std::to_string(i)
+                 + " TEMP=" + std::to_string(i % 40) + " HUMIDITY=1\n";
+    }
+    cfg.stats          = nullptr;
+    cfg.stream_threads = 4;
+    rs = parse_via_pipe(content, &cfg, sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    r = static_cast<const sensor_t *>(rs->records);
+    for (size_t i = 0; i < rs->count; i++) {
+        int id = (int)i + 1;
+        if (id % 40 > 30) {
+            ASSERT_EQ("R" + std::to_string(id), r[i].location);
+        } else {
+            ASSERT_STREQ("", r[i].location);
+        }
+    }
+    EXPECT_EQ(29999u, rs->count); /* 最後に残る ID は 29999（29999 % 40 = 39） */
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(Filter, CompileErrors)
+{
+    ftcs_parser_config_t cfg = sample_cfg;
+    for (const char *expr : { "NOSUCH=1", "ID", "ID!1", "ID>abc", "ID>", ">5",
+                              "ID>1 &&", "VALUE<1.5x" }) {
+        cfg.filter = expr;
+        EXPECT_EQ(nullptr, ftcs_parse_file(data("basic.txt").c_str(), &cfg,
+                                           sample_mapping, sizeof(sample_t))) << expr;
+    }
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ19: projection と遅延変換 (projection / ftcs_parse_lazy)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(Projection, SkipsUnlistedFields)
+{
+    /* projection 外の VALUE は不正な値でも変換しないためエラーにならない */
+    std::string path = write_temp("ID=1 NAME=A VALUE=oops\nID=2 NAME=B VALUE=2.5\n");
+    const char *const fields[] = { "ID", "NAME", nullptr };
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.projection = fields;
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(2u, rs->count);
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    EXPECT_EQ(1, r[0].id);
+    EXPECT_STREQ("B", r[1].name);
+    EXPECT_EQ(0.0, r[1].value);
+
+    /* filter が参照するフィールドは projection になくても判定に使われる */
+    ftcs_record_set_free(rs);
+    const char *const names[] = { "NAME", nullptr };
+    cfg.projection = names;
+    cfg.filter     = "ID=2";
+    rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(1u, rs->count);
+    EXPECT_STREQ("B", static_cast<const sample_t *>(rs->records)[0].name);
+    ftcs_record_set_free(rs);
+
+    /* 未知のフィールド名はエラー */
+    const char *const bad[] = { "NOSUCH", nullptr };
+    cfg.projection = bad;
+    cfg.filter     = nullptr;
+    EXPECT_EQ(nullptr, ftcs_parse_file(path.c_str(), &cfg, sample_mapping, sizeof(sample_t)));
+    unlink(path.c_str());
+}
+
+TEST(Lazy, ConvertsOnAccess)
+{
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stats = &st;
+    ftcs_lazy_set_t *ls = ftcs_parse_lazy(data("basic.txt").c_str(), &cfg,
+                                          sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, ls);
+    ASSERT_EQ(3u, ftcs_lazy_count(ls));
+    EXPECT_EQ(3u, st.records);
+    EXPECT_EQ(1u, st.comments);
+
+    int name = ftcs_lazy_field_index(ls, "NAME"); // NAME のフィールド番号
+    ASSERT_GE(name, 0);
+    EXPECT_EQ(-1, ftcs_lazy_field_index(ls, "NOSUCH"));
+    EXPECT_STREQ("Widget", static_cast<const char *>(ftcs_lazy_field(ls, 1, name)));
+    EXPECT_EQ(nullptr, ftcs_lazy_field(ls, 3, name));
+
+    /* レコード単位の取得は全フィールドを変換し、eager パースと同じ内容になる */
+    const sample_t *r = static_cast<const sample_t *>(ftcs_lazy_record(ls, 2));
+    ASSERT_NE(nullptr, r);
+    EXPECT_EQ(100, r->id);
+    EXPECT_STREQ("Gadget", r->name);
+    EXPECT_DOUBLE_EQ(2.718, r->value);
+    ftcs_lazy_free(ls);
+}
+
+TEST(Lazy, ConversionErrorsAtAccess)
+{
+    /* 不正な値は参照したときに初めてエラーになる */
+    std::string path = write_temp("ID=1 NAME=A VALUE=oops\r\n\n  ID=2 NAME=Bbbbbbbbbb");
+    ftcs_lazy_set_t *ls = ftcs_parse_lazy(path.c_str(), &sample_cfg,
+                                          sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, ls);
+    ASSERT_EQ(2u, ftcs_lazy_count(ls));
+    int value = ftcs_lazy_field_index(ls, "VALUE"); // VALUE のフィールド番号
+    EXPECT_EQ(nullptr, ftcs_lazy_field(ls, 0, value));
+    /* 行に現れないフィールドはゼロ値、改行のない最終行も読む */
+    EXPECT_EQ(0.0, *static_cast<const double *>(ftcs_lazy_field(ls, 1, value)));
+    EXPECT_STREQ("Bbbbbbbbbb", static_cast<const char *>(
+                                   ftcs_lazy_field(ls, 1, ftcs_lazy_field_index(ls, "NAME"))));
+    ftcs_lazy_free(ls);
+
+    /* 配置位置指定と filter は変換前に判定できないため受け付けない */
+    EXPECT_EQ(nullptr, ftcs_parse_lazy(path.c_str(), &sensor_index_field_cfg,
+                                       sensor_mapping, sizeof(sensor_t)));
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.filter = "ID>1";
+    EXPECT_EQ(nullptr, ftcs_parse_lazy(path.c_str(), &cfg, sample_mapping, sizeof(sample_t)));
+    unlink(path.c_str());
+
+    /* 空ファイルはレコード 0 件 */
+    std::string empty = write_temp("");
+    ls = ftcs_parse_lazy(empty.c_str(), &sample_cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, ls);
+    EXPECT_EQ(0u, ftcs_lazy_count(ls));
+    ftcs_lazy_free(ls);
+    unlink(empty.c_str());
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ20: 疎な配置位置指定 (ftcs_parse_sparse)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(Sparse, LargeIdAllocatesOnlyTouchedPages)
+{
+    /* 密な配列なら 5000 万件分を確保する ID でも、使うページだけを確保する */
+    std::string path = write_temp("ID=3 LOCATION=Lab TEMP=25 HUMIDITY=40\n"
+                                  "ID=50000000 LOCATION=Far TEMP=10 HUMIDITY=1\n"
+                                  "ID=1 LOCATION=Hall TEMP=31 HUMIDITY=2\n");
+    ftcs_parse_stats_t st = {};
+    ftcs_parser_config_t cfg = sensor_index_field_cfg;
+    cfg.stats = &st;
+    ftcs_sparse_set_t *ss = ftcs_parse_sparse(path.c_str(), &cfg, sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, ss);
+    EXPECT_EQ(3u, ftcs_sparse_count(ss));
+    EXPECT_EQ(3u, st.records);
+    EXPECT_LT(ftcs_sparse_bytes(ss), (size_t)1 << 20);
+    EXPECT_EQ(ftcs_sparse_bytes(ss), st.peak_bytes);
+
+    const sensor_t *r = static_cast<const sensor_t *>(ftcs_sparse_find(ss, 49999999));
+    ASSERT_NE(nullptr, r);
+    EXPECT_STREQ("Far", r->location);
+    EXPECT_STREQ("Lab", static_cast<const sensor_t *>(ftcs_sparse_find(ss, 2))->location);
+    EXPECT_EQ(nullptr, ftcs_sparse_find(ss, 1));
+    EXPECT_EQ(nullptr, ftcs_sparse_find(ss, 50000000));
+    EXPECT_EQ(nullptr, ftcs_sparse_find(ss, SIZE_MAX));
+
+    /* 走査は存在するレコードだけを配置位置の昇順に返す */
+    ftcs_sparse_iter_t it = {};
+    std::vector<size_t> seen;
+    while ((r = static_cast<const sensor_t *>(ftcs_sparse_next(ss, &it))) != nullptr) {
+        seen.push_back(it.index);
+    }
+    EXPECT_EQ((std::vector<size_t>{ 0, 2, 49999999 }), seen);
+    ftcs_sparse_free(ss);
+    unlink(path.c_str());
+}
+
+TEST(Sparse, MatchesDenseParse)
+{
+    /* 8 おきの ID と重複 ID を、密な配置と同じ内容で格納する */
+    std::string content;
+    for (int i = 20000; i >= 1; i -= 8) {
+        content += "ID=" + std::to_string(i) + " LOCATION=R" + std::to_string(i)
+                 + " TEMP=" + std::to_string(i % 50) + " HUMIDITY=1\n";
+    }
+    content += "ID=8 LOCATION=Again TEMP=1 HUMIDITY=1\n";
+    std::string path = write_temp(content);
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sensor_index_field_cfg,
+                                            sensor_mapping, sizeof(sensor_t));
+    ftcs_sparse_set_t *ss = ftcs_parse_sparse(path.c_str(), &sensor_index_field_cfg,
+                                              sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_NE(nullptr, ss);
+    EXPECT_EQ(2500u, ftcs_sparse_count(ss));
+    const sensor_t *dense = static_cast<const sensor_t *>(rs->records);
+    for (size_t i = 0; i < rs->count; i++) {
+        const sensor_t *r = static_cast<const sensor_t *>(ftcs_sparse_find(ss, i));
+        if (dense[i].location[0] == '\0') {
+            ASSERT_EQ(nullptr, r) << i;
+        } else {
+            ASSERT_NE(nullptr, r) << i;
+            ASSERT_EQ(0, memcmp(&dense[i], r, sizeof(sensor_t))) << i;
+        }
+    }
+    EXPECT_STREQ("Again", static_cast<const sensor_t *>(ftcs_sparse_find(ss, 7))->location);
+    ftcs_record_set_free(rs);
+    ftcs_sparse_free(ss);
+
+    /* filter で棄却した行はページを確保しない */
+    ftcs_parser_config_t cfg = sensor_index_field_cfg;
+    cfg.filter     = "TEMP>45";
+    cfg.io_backend = FTCS_IO_PREAD;
+    ss = ftcs_parse_sparse(path.c_str(), &cfg, sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, ss);
+    ftcs_sparse_iter_t it = {};
+    size_t n = 0;
+    while (const void *p = ftcs_sparse_next(ss, &it)) {
+        EXPECT_GT(static_cast<const sensor_t *>(p)->temperature, 45.0f);
+        n++;
+    }
+    EXPECT_EQ(ftcs_sparse_count(ss), n);
+    EXPECT_GT(n, 0u);
+    ftcs_sparse_free(ss);
+    unlink(path.c_str());
+}
+
+TEST(Sparse, InvalidArguments)
+{
+    /* 配置位置指定モード以外・ID 欠落はエラー */
+    EXPECT_EQ(nullptr, ftcs_parse_sparse(data("basic.txt").c_str(), &sample_cfg,
+                                         sample_mapping, sizeof(sample_t)));
+    EXPECT_EQ(nullptr, ftcs_parse_sparse(data("sequential.txt").c_str(), &sensor_sequential_cfg,
+                                         sensor_mapping, sizeof(sensor_t)));
+    EXPECT_EQ(nullptr, ftcs_parse_sparse(data("sequential.txt").c_str(), &sensor_index_field_cfg,
+                                         sensor_mapping, sizeof(sensor_t)));
+    EXPECT_EQ(0u, ftcs_sparse_count(nullptr));
+    EXPECT_EQ(nullptr, ftcs_sparse_find(nullptr, 0));
+    ftcs_sparse_free(nullptr);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ21: 集計 (ftcs_aggregate / ftcs_aggregate_by)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(Aggregate, AllNumericTypesMatchNaiveLoop)
+{
+    /* gather の端数が出る件数で、全数値型を素朴なループの結果と比べる。
+     * 30 万件は複数スレッドに分割される規模 */
+    for (size_t n : { (size_t)0, (size_t)1, (size_t)1003, (size_t)300001 }) {
+        std::vector<all_types_t> recs(n);
+        for (size_t i = 0; i < n; i++) {
+            long v = (long)((i * 7919) % 2001) - 1000; // -1000〜1000 に散らした値
+            recs[i].ival = (int)v;
+            recs[i].lval = v * 100000;
+            recs[i].sval = (short)v;
+            recs[i].fval = (float)v / 4;
+            recs[i].dval = (double)v / 8;
+            recs[i].cval = (char)(v % 100);
+        }
+        ftcs_record_set_t rs = {};
+        rs.records     = recs.data();
+        rs.count       = n;
+        rs.capacity    = n;
+        rs.struct_size = sizeof(all_types_t);
+
+        for (const ftcs_field_mapping_t *m = all_types_mapping; m->field_name; m++) {
+            if (m->type == FTCS_TYPE_STRING) {
+                continue;
+            }
+            double sum = 0, mn = 0, mx = 0; // 素朴なループの結果
+            for (size_t i = 0; i < n; i++) {
+                const char *f = reinterpret_cast<const char *>(&recs[i]) + m->offset;
+                double v = m->type == FTCS_TYPE_INT    ? *reinterpret_cast<const int *>(f)
+                         : m->type == FTCS_TYPE_LONG   ? (double)*reinterpret_cast<const long *>(f)
+                         : m->type == FTCS_TYPE_SHORT  ? *reinterpret_cast<const short *>(f)
+                         : m->type == FTCS_TYPE_FLOAT  ? *reinterpret_cast<const float *>(f)
+                         : m->type == FTCS_TYPE_DOUBLE ? *reinterpret_cast<const double *>(f)
+                                                       : *f;
+                sum += v;
+                mn = (i == 0 || v < mn) ? v : mn;
+                mx = (i == 0 || v > mx) ? v : mx;
+            }
+            ftcs_agg_result_t r;
+            ASSERT_EQ(0, ftcs_aggregate(&rs, all_types_mapping, m->field_name, FTCS_AGG_ALL, &r));
+            EXPECT_EQ(n, r.count) << m->field_name;
+            EXPECT_DOUBLE_EQ(sum, r.sum) << m->field_name << " n=" << n;
+            EXPECT_EQ(mn, r.min) << m->field_name << " n=" << n;
+            EXPECT_EQ(mx, r.max) << m->field_name << " n=" << n;
+            EXPECT_DOUBLE_EQ(n ? sum / n : 0.0, r.mean) << m->field_name;
+        }
+    }
+}
+
+TEST(Aggregate, MinMaxIgnoreNaNOnBothPaths)
+{
+    /* gather で読むレーンの先頭・途中と、1件ずつ処理する端数の両方に NaN を置く。
+     * 件数 3 は gather を使わない経路、1003 / 300001 は gather＋端数（＋複数スレッド）の経路 */
+    for (size_t n : { (size_t)3, (size_t)1003, (size_t)300001 }) {
+        std::vector<all_types_t> recs(n);
+        double mn = 0, mx = 0; // NaN を除いた最小・最大
+        bool   seen = false;   // NaN でない値があったか
+        for (size_t i = 0; i < n; i++) {
+            bool is_nan = i == 0 || i % 97 == 5 || i == n - 1;
+            double v = is_nan ? NAN : (double)((long)((i * 7919) % 2001) - 1000) / 8;
+            recs[i].fval = (float)v;
+            recs[i].dval = v;
+            if (!is_nan) {
+                mn = (!seen || v < mn) ? v : mn;
+                mx = (!seen || v > mx) ? v : mx;
+                seen = true;
+            }
+        }
+        ftcs_record_set_t rs = {};
+        rs.records     = recs.data();
+        rs.count       = n;
+        rs.capacity    = n;
+        rs.struct_size = sizeof(all_types_t);
+        for (const char *field : { "FVAL", "DVAL" }) {
+            ftcs_agg_result_t r;
+            ASSERT_EQ(0, ftcs_aggregate(&rs, all_types_mapping, field, FTCS_AGG_ALL, &r));
+            EXPECT_EQ(n, r.count);
+            EXPECT_EQ(mn, r.min) << field << " n=" << n;
+            EXPECT_EQ(mx, r.max) << field << " n=" << n;
+            EXPECT_TRUE(std::isnan(r.sum)) << field; /* 合計・平均は NaN を伝える */
+            EXPECT_TRUE(std::isnan(r.mean)) << field;
+        }
+    }
+
+    /* 全件 NaN なら最小・最大も NaN */
+    std::vector<all_types_t> recs(16);
+    for (all_types_t &r : recs) {
+        r.dval = NAN;
+    }
+    ftcs_record_set_t rs = {};
+    rs.records     = recs.data();
+    rs.count       = recs.size();
+    rs.capacity    = recs.size();
+    rs.struct_size = sizeof(all_types_t);
+    ftcs_agg_result_t r;
+    ASSERT_EQ(0, ftcs_aggregate(&rs, all_types_mapping, "DVAL", FTCS_AGG_MIN | FTCS_AGG_MAX, &r));
+    EXPECT_TRUE(std::isnan(r.min));
+    EXPECT_TRUE(std::isnan(r.max));
+}
+
+TEST(Aggregate, LargeIntegerSumsMatchScalarPath)
+{
+    /* INT64_MAX/4 付近の LONG を 1003 件足すと 64 ビットの合計は桁あふれする。
+     * 値は 2^40 の倍数なので double の合計は足す順によらず正確になり、
+     * gather の経路（ftcs_aggregate）と1件ずつの経路（1グループの ftcs_aggregate_by）が一致する */
+    const size_t n = 1003;
+    std::vector<all_types_t> recs(n);
+    double lsum = 0, isum = 0; // 素朴なループの合計
+    for (size_t i = 0; i < n; i++) {
+        recs[i].lval = ((long)1 << 61) - (long)(i % 7) * ((long)1 << 40);
+        recs[i].ival = INT32_MAX - (int)(i % 5);
+        recs[i].cval = 0; /* 全件を 1 グループにする */
+        lsum += (double)recs[i].lval;
+        isum += recs[i].ival;
+    }
+    ftcs_record_set_t rs = {};
+    rs.records     = recs.data();
+    rs.count       = n;
+    rs.capacity    = n;
+    rs.struct_size = sizeof(all_types_t);
+    for (const char *field : { "LVAL", "IVAL" }) {
+        ftcs_agg_result_t r;
+        ASSERT_EQ(0, ftcs_aggregate(&rs, all_types_mapping, field, FTCS_AGG_ALL, &r));
+        ftcs_agg_group_t *groups  = nullptr;
+        size_t            ngroups = 0;
+        ASSERT_EQ(0, ftcs_aggregate_by(&rs, all_types_mapping, field, "CVAL", FTCS_AGG_ALL,
+                                       &groups, &ngroups));
+        ASSERT_EQ(1u, ngroups);
+        EXPECT_EQ(groups[0].result.sum, r.sum) << field;
+        EXPECT_EQ(groups[0].result.mean, r.mean) << field;
+        EXPECT_EQ(strcmp(field, "LVAL") == 0 ? lsum : isum, r.sum) << field;
+        EXPECT_GT(r.sum, 0.0) << field;
+        free(groups);
+    }
+}
+
+TEST(Aggregate, GroupByStringAndOps)
+{
+    std::string path = write_temp("LOCATION=Lab TEMP=20 HUMIDITY=40\n"
+                                  "LOCATION=Hall TEMP=30 HUMIDITY=50\n"
+                                  "LOCATION=Lab TEMP=24 HUMIDITY=44\n"
+                                  "LOCATION=Lab TEMP=22 HUMIDITY=42\n");
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sensor_sequential_cfg,
+                                            sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_agg_group_t *groups = nullptr;
+    size_t ngroups = 0;
+    ASSERT_EQ(0, ftcs_aggregate_by(rs, sensor_mapping, "TEMP", "LOCATION",
+                                   FTCS_AGG_ALL, &groups, &ngroups));
+    ASSERT_EQ(2u, ngroups);
+    /* グループは最初に現れた順 */
+    EXPECT_STREQ("Lab", static_cast<const sensor_t *>(groups[0].record)->location);
+    EXPECT_EQ(3u, groups[0].result.count);
+    EXPECT_DOUBLE_EQ(66.0, groups[0].result.sum);
+    EXPECT_DOUBLE_EQ(20.0, groups[0].result.min);
+    EXPECT_DOUBLE_EQ(24.0, groups[0].result.max);
+    EXPECT_DOUBLE_EQ(22.0, groups[0].result.mean);
+    EXPECT_STREQ("Hall", static_cast<const sensor_t *>(groups[1].record)->location);
+    EXPECT_DOUBLE_EQ(30.0, groups[1].result.mean);
+    free(groups);
+
+    /* 指定しなかった項目は 0 */
+    ftcs_agg_result_t r;
+    ASSERT_EQ(0, ftcs_aggregate(rs, sensor_mapping, "HUMIDITY", FTCS_AGG_MAX | FTCS_AGG_COUNT, &r));
+    EXPECT_EQ(4u, r.count);
+    EXPECT_DOUBLE_EQ(50.0, r.max);
+    EXPECT_EQ(0.0, r.sum);
+    EXPECT_EQ(0.0, r.mean);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+
+    /* 整数キーでのグループ分け（2 万件・100 グループ） */
+    ftcs_record_set_t *big = parse_via_pipe(sample_lines(20000), &all_types_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, big);
+    sample_t *recs = static_cast<sample_t *>(big->records);
+    for (size_t i = 0; i < big->count; i++) {
+        recs[i].id    = (int)(i % 100);
+        recs[i].value = (double)i;
+    }
+    ASSERT_EQ(0, ftcs_aggregate_by(big, sample_mapping, "VALUE", "ID", FTCS_AGG_ALL,
+                                   &groups, &ngroups));
+    ASSERT_EQ(100u, ngroups);
+    for (size_t g = 0; g < ngroups; g++) {
+        EXPECT_EQ((int)g, static_cast<const sample_t *>(groups[g].record)->id);
+        EXPECT_EQ(200u, groups[g].result.count);
+        EXPECT_DOUBLE_EQ((double)g, groups[g].result.min);
+        EXPECT_DOUBLE_EQ((double)(19900 + g), groups[g].result.max);
+    }
+    free(groups);
+    ftcs_record_set_free(big);
+}
+
+TEST(Aggregate, InvalidArguments)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_agg_result_t r;
+    ftcs_agg_group_t *groups;
+    size_t ngroups;
+    EXPECT_EQ(-1, ftcs_aggregate(nullptr, sample_mapping, "ID", FTCS_AGG_ALL, &r));
+    EXPECT_EQ(-1, ftcs_aggregate(rs, sample_mapping, "NAME", FTCS_AGG_ALL, &r));
+    EXPECT_EQ(-1, ftcs_aggregate(rs, sample_mapping, "NOSUCH", FTCS_AGG_ALL, &r));
+    EXPECT_EQ(-1, ftcs_aggregate_by(rs, sample_mapping, "ID", "VALUE", FTCS_AGG_ALL,
+                                    &groups, &ngroups));
+    EXPECT_EQ(-1, ftcs_aggregate_by(rs, sample_mapping, "ID", "NOSUCH", FTCS_AGG_ALL,
+                                    &groups, &ngroups));
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ22: 整列 (ftcs_record_set_sort)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(Sort, SortsByKeyAndSwitchesToBinarySearch)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(0, rs->sorted);
+    ASSERT_EQ(0, ftcs_record_set_sort(rs, sample_mapping, "ID"));
+    EXPECT_NE(0, rs->sorted);
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    EXPECT_EQ(7, r[0].id);
+    EXPECT_EQ(42, r[1].id);
+    EXPECT_EQ(100, r[2].id);
+
+    /* 並べ替えたキーでの検索は二分探索になる */
+    for (const char *key : { "7", "42", "100" }) {
+        const sample_t *hit = static_cast<const sample_t *>(
+            ftcs_find_by_key(rs, sample_mapping, "ID", key, sizeof(sample_t)));
+        ASSERT_NE(nullptr, hit) << key;
+        EXPECT_EQ(atoi(key), hit->id);
+    }
+    for (const char *key : { "0", "8", "43", "1000", "-5" }) {
+        EXPECT_EQ(nullptr, ftcs_find_by_key(rs, sample_mapping, "ID", key, sizeof(sample_t)))
+            << key;
+    }
+
+    /* 文字列キーで並べ替え直すと、ID での検索は線形探索に戻る */
+    ASSERT_EQ(0, ftcs_record_set_sort(rs, sample_mapping, "NAME"));
+    EXPECT_STREQ("Gadget", r[0].name);
+    EXPECT_STREQ("TestItem", r[1].name);
+    EXPECT_STREQ("Widget", r[2].name);
+    const sample_t *hit = static_cast<const sample_t *>(
+        ftcs_find_by_key(rs, sample_mapping, "NAME", "TestItem", sizeof(sample_t)));
+    ASSERT_NE(nullptr, hit);
+    EXPECT_EQ(42, hit->id);
+    EXPECT_EQ(nullptr, ftcs_find_by_key(rs, sample_mapping, "NAME", "Test", sizeof(sample_t)));
+    hit = static_cast<const sample_t *>(
+        ftcs_find_by_key(rs, sample_mapping, "ID", "7", sizeof(sample_t)));
+    ASSERT_NE(nullptr, hit);
+    EXPECT_STREQ("Widget", hit->name);
+    ftcs_record_set_free(rs);
+}
+
+TEST(Sort, AllTypesMatchStableSort)
+{
+    /* 負の値・重複・0.0 と -0.0・8 バイトを超える共通接頭辞を含む値で、
+     * 全フィールドの並びを std::stable_sort と比べる。30 万件は複数スレッドに分割される規模 */
+    for (size_t n : { (size_t)0, (size_t)1, (size_t)1003, (size_t)300001 }) {
+        std::vector<all_types_t> orig(n);
+        for (size_t i = 0; i < n; i++) {
+            long v = (long)((i * 7919) % 2001) - 1000; // -1000〜1000 に散らした値
+            orig[i].ival = (int)(v * 2000003);
+            orig[i].lval = v * 4000000000L;
+            orig[i].sval = (short)v;
+            orig[i].fval = (v == 0 && i % 2) ? -0.0f : (float)v / 4;
+            orig[i].dval = (v == 0 && i % 2) ? -0.0 : (double)v / 8;
+            orig[i].cval = (char)(v % 100);
+            if (v % 7 == 0) {
+                snprintf(orig[i].strval, sizeof(orig[i].strval), "%s", v % 2 ? "" : "LOC");
+            } else {
+                snprintf(orig[i].strval, sizeof(orig[i].strval), "LOCATION_%ld", v + 1000);
+            }
+        }
+        for (const ftcs_field_mapping_t *m = all_types_mapping; m->field_name; m++) {
+            auto less = [m](const all_types_t &x, const all_types_t &y) {
+                const char *a = reinterpret_cast<const char *>(&x) + m->offset;
+                const char *b = reinterpret_cast<const char *>(&y) + m->offset;
+                switch (m->type) {
+                case FTCS_TYPE_INT:    return *reinterpret_cast<const int *>(a) < *reinterpret_cast<const int *>(b);
+                case FTCS_TYPE_LONG:   return *reinterpret_cast<const long *>(a) < *reinterpret_cast<const long *>(b);
+                case FTCS_TYPE_SHORT:  return *reinterpret_cast<const short *>(a) < *reinterpret_cast<const short *>(b);
+                case FTCS_TYPE_FLOAT:  return *reinterpret_cast<const float *>(a) < *reinterpret_cast<const float *>(b);
+                case FTCS_TYPE_DOUBLE: return *reinterpret_cast<const double *>(a) < *reinterpret_cast<const double *>(b);
+                case FTCS_TYPE_CHAR:   return *a < *b;
+                case FTCS_TYPE_STRING: return strcmp(a, b) < 0;
+                case FTCS_TYPE_ARRAY:  break;
+                }
+                return false;
+            };
+            std::vector<all_types_t> expected = orig;
+            std::stable_sort(expected.begin(), expected.end(), less);
+            std::vector<all_types_t> recs = orig;
+            ftcs_record_set_t rs = {};
+            rs.records     = recs.data();
+            rs.count       = n;
+            rs.capacity    = n;
+            rs.struct_size = sizeof(all_types_t);
+            ASSERT_EQ(0, ftcs_record_set_sort(&rs, all_types_mapping, m->field_name));
+            for (size_t i = 0; i < n; i++) {
+                /* -0.0 の位置まで一致することをビット列で確かめる */
+                ASSERT_EQ(expected[i].ival, recs[i].ival) << m->field_name << " i=" << i;
+                ASSERT_EQ(expected[i].lval, recs[i].lval) << m->field_name << " i=" << i;
+                ASSERT_EQ(0, memcmp(&expected[i].fval, &recs[i].fval, sizeof(float)))
+                    << m->field_name << " i=" << i;
+                ASSERT_EQ(0, memcmp(&expected[i].dval, &recs[i].dval, sizeof(double)))
+                    << m->field_name << " i=" << i;
+                ASSERT_STREQ(expected[i].strval, recs[i].strval) << m->field_name << " i=" << i;
+            }
+        }
+    }
+}
+
+TEST(Sort, BinarySearchMatchesLinearSearch)
+{
+    /* 重複キーでは並べ替え前に線形探索で見つかる先頭のレコードを返す */
+    ftcs_record_set_t *rs = parse_via_pipe(sample_lines(5000), &all_types_cfg,
+                                           sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    sample_t *recs = static_cast<sample_t *>(rs->records);
+    for (size_t i = 0; i < rs->count; i++) {
+        recs[i].id    = (int)((i * 37) % 1000) - 500;
+        recs[i].value = (i % 10 == 0) ? -0.0 : (double)((i * 13) % 100) / 4;
+        snprintf(recs[i].name, sizeof(recs[i].name), "SENSOR_LOCATION_%zu", (i * 7) % 300);
+    }
+    const struct {
+        const char *field;
+        std::vector<std::string> keys;
+    } cases[] = {
+        { "ID",    { "-500", "-1", "0", "499", "500", "-501", "12x" } },
+        { "VALUE", { "0", "-0", "0.25", "24.75", "25", "nan" } },
+        { "NAME",  { "SENSOR_LOCATION_0", "SENSOR_LOCATION_299", "SENSOR_LOCATION_", "SENSOR", "" } },
+    };
+    for (const auto &c : cases) {
+        /* 線形探索は直前の並び順での先頭を返す（並べ替えは安定なので二分探索と一致する） */
+        std::vector<sample_t> linear;
+        std::vector<bool>     found;
+        for (const std::string &k : c.keys) {
+            const void *hit = ftcs_find_by_key(rs, sample_mapping, c.field, k.c_str(), sizeof(sample_t));
+            found.push_back(hit != nullptr);
+            linear.push_back(hit ? *static_cast<const sample_t *>(hit) : sample_t{});
+        }
+        ASSERT_EQ(0, ftcs_record_set_sort(rs, sample_mapping, c.field));
+        for (size_t k = 0; k < c.keys.size(); k++) {
+            const sample_t *hit = static_cast<const sample_t *>(
+                ftcs_find_by_key(rs, sample_mapping, c.field, c.keys[k].c_str(), sizeof(sample_t)));
+            ASSERT_EQ(found[k], hit != nullptr) << c.field << "=" << c.keys[k];
+            if (hit) {
+                EXPECT_EQ(linear[k].id, hit->id) << c.field << "=" << c.keys[k];
+                EXPECT_STREQ(linear[k].name, hit->name) << c.field << "=" << c.keys[k];
+                EXPECT_EQ(0, memcmp(&linear[k].value, &hit->value, sizeof(double)))
+                    << c.field << "=" << c.keys[k];
+            }
+        }
+    }
+    ftcs_record_set_free(rs);
+}
+
+TEST(Sort, InvalidArguments)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(-1, ftcs_record_set_sort(nullptr, sample_mapping, "ID"));
+    EXPECT_EQ(-1, ftcs_record_set_sort(rs, nullptr, "ID"));
+    EXPECT_EQ(-1, ftcs_record_set_sort(rs, sample_mapping, nullptr));
+    EXPECT_EQ(-1, ftcs_record_set_sort(rs, sample_mapping, "NOSUCH"));
+    EXPECT_EQ(0, rs->sorted);
+    EXPECT_EQ(42, static_cast<const sample_t *>(rs->records)[0].id);
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ23: 範囲索引 (ftcs_range_index_build / ftcs_range_query / ftcs_range_count)
+ * ══════════════════════════════════════════════════════════ */
+
+/** @brief ftcs_range_query のコールバック: 受け取ったレコードを std::vector に積む */
+static int collect_record(const void *record, void *arg)
+{
+    static_cast<std::vector<const void *> *>(arg)->push_back(record);
+    return 0;
+}
+
+TEST(RangeIndex, MatchesFullScan)
+{
+    /* 重複・負値を含む整数と double で、さまざまな範囲を全件走査の結果と比べる。
+     * 件数は Eytzinger 配置の木が完全二分木にならない数を含める */
+    for (size_t n : { (size_t)0, (size_t)1, (size_t)2, (size_t)7, (size_t)1000, (size_t)65537 }) {
+        std::vector<sample_t> recs(n);
+        for (size_t i = 0; i < n; i++) {
+            recs[i].id    = (int)((i * 7919) % 2001) - 1000;
+            recs[i].value = (double)((i * 104729) % 4001) / 8 - 250;
+        }
+        ftcs_record_set_t rs = {};
+        rs.records     = recs.data();
+        rs.count       = n;
+        rs.capacity    = n;
+        rs.struct_size = sizeof(sample_t);
+        ftcs_range_index_t *by_id    = ftcs_range_index_build(&rs, sample_mapping, "ID");
+        ftcs_range_index_t *by_value = ftcs_range_index_build(&rs, sample_mapping, "VALUE");
+        ASSERT_NE(nullptr, by_id);
+        ASSERT_NE(nullptr, by_value);
+
+        const double ranges[][2] = {
+            { -1000, 1000 }, { 0, 0 }, { -3.5, 12.2 }, { 1.2, 1.8 }, { 999, 5000 },
+            { -INFINITY, -999 }, { -INFINITY, INFINITY }, { 5, 4 }, { NAN, 1 },
+            { -0.0, 0.0 }, { -250, -249.875 }, { 1e300, INFINITY },
+        };
+        for (const auto &r : ranges) {
+            for (ftcs_range_index_t *idx : { by_id, by_value }) {
+                bool is_id = (idx == by_id);
+                std::vector<const void *> expected;
+                for (const sample_t &rec : recs) {
+                    double v = is_id ? rec.id : rec.value;
+                    if (v >= r[0] && v <= r[1]) {
+                        expected.push_back(&rec);
+                    }
+                }
+                /* 値の昇順、同じ値はレコード順 */
+                std::stable_sort(expected.begin(), expected.end(),
+                                 [is_id](const void *a, const void *b) {
+                                     const sample_t *x = static_cast<const sample_t *>(a);
+                                     const sample_t *y = static_cast<const sample_t *>(b);
+                                     return is_id ? x->id < y->id : x->value < y->value;
+                                 });
+                std::vector<const void *> got;
+                EXPECT_EQ(expected.size(), ftcs_range_count(idx, r[0], r[1]))
+                    << (is_id ? "ID " : "VALUE ") << r[0] << ".." << r[1] << " n=" << n;
+                EXPECT_EQ(expected.size(), ftcs_range_query(idx, r[0], r[1], collect_record, &got));
+                EXPECT_EQ(expected, got) << (is_id ? "ID " : "VALUE ") << r[0] << ".." << r[1];
+            }
+        }
+        ftcs_range_index_free(by_id);
+        ftcs_range_index_free(by_value);
+    }
+}
+
+TEST(RangeIndex, FloatFieldAndEarlyStop)
+{
+    std::string path = write_temp("LOCATION=A TEMP=19.5 HUMIDITY=40\n"
+                                  "LOCATION=B TEMP=20 HUMIDITY=50\n"
+                                  "LOCATION=C TEMP=25 HUMIDITY=44\n"
+                                  "LOCATION=D TEMP=22.25 HUMIDITY=42\n"
+                                  "LOCATION=E TEMP=25.01 HUMIDITY=42\n");
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sensor_sequential_cfg,
+                                            sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_range_index_t *idx = ftcs_range_index_build(rs, sensor_mapping, "TEMP");
+    ASSERT_NE(nullptr, idx);
+    EXPECT_EQ(3u, ftcs_range_count(idx, 20, 25));
+    std::vector<const void *> got;
+    EXPECT_EQ(3u, ftcs_range_query(idx, 20, 25, collect_record, &got));
+    ASSERT_EQ(3u, got.size());
+    EXPECT_STREQ("B", static_cast<const sensor_t *>(got[0])->location);
+    EXPECT_STREQ("D", static_cast<const sensor_t *>(got[1])->location);
+    EXPECT_STREQ("C", static_cast<const sensor_t *>(got[2])->location);
+
+    /* コールバックが非ゼロを返すとそこで打ち切る */
+    int calls = 0;
+    EXPECT_EQ(2u, ftcs_range_query(idx, -INFINITY, INFINITY,
+                                   [](const void *, void *arg) {
+                                       return ++*static_cast<int *>(arg) == 2 ? 1 : 0;
+                                   }, &calls));
+    EXPECT_EQ(2, calls);
+    ftcs_range_index_free(idx);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(RangeIndex, InvalidArguments)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(nullptr, ftcs_range_index_build(nullptr, sample_mapping, "ID"));
+    EXPECT_EQ(nullptr, ftcs_range_index_build(rs, sample_mapping, "NAME"));
+    EXPECT_EQ(nullptr, ftcs_range_index_build(rs, sample_mapping, "NOSUCH"));
+    EXPECT_EQ(0u, ftcs_range_count(nullptr, 0, 100));
+    ftcs_range_index_t *idx = ftcs_range_index_build(rs, sample_mapping, "ID");
+    ASSERT_NE(nullptr, idx);
+    EXPECT_EQ(0u, ftcs_range_query(idx, 0, 100, nullptr, nullptr));
+    ftcs_range_index_free(idx);
+    ftcs_range_index_free(nullptr);
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ24: 文字列索引 (ftcs_trie_build / ftcs_trie_find / ftcs_trie_prefix)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(Trie, FindAndPrefixMatchScan)
+{
+    /* 共通接頭辞の長い名前・重複・空文字列・互いに接頭辞になる名前を混ぜ、
+     * 完全一致と前方一致を線形走査の結果と比べる */
+    const size_t n = 20000;
+    std::vector<sample_t> recs(n);
+    for (size_t i = 0; i < n; i++) {
+        recs[i].id = (int)i;
+        unsigned r = (unsigned)((i * 2654435761u) % 5000);
+        if (r % 97 == 0) {
+            recs[i].name[0] = '\0';
+        } else if (r % 13 == 0) {
+            snprintf(recs[i].name, sizeof(recs[i].name), "Room%u", r % 10);
+        } else {
+            snprintf(recs[i].name, sizeof(recs[i].name), "%s%u",
+                     r % 2 ? "Room" : "ServerRoom-Building-", r);
+        }
+    }
+    ftcs_record_set_t rs = {};
+    rs.records     = recs.data();
+    rs.count       = n;
+    rs.capacity    = n;
+    rs.struct_size = sizeof(sample_t);
+    ftcs_trie_t *t = ftcs_trie_build(&rs, sample_mapping, "NAME", 0, nullptr);
+    ASSERT_NE(nullptr, t);
+    EXPECT_GT(ftcs_trie_bytes(t), 0u);
+
+    for (const char *key : { "Room1", "Room3", "Room10", "Room4999", "ServerRoom-Building-2",
+                             "", "Room", "room1", "Room99999", "ServerRoom-Building" }) {
+        EXPECT_EQ(ftcs_find_by_key(&rs, sample_mapping, "NAME", key, sizeof(sample_t)),
+                  ftcs_trie_find(t, key)) << key;
+    }
+    for (const char *prefix : { "", "Room", "Room1", "Room12", "Room4999", "ServerRoom-Building-1",
+                                "ServerRoom-X", "Z", "Room49990" }) {
+        std::vector<const void *> expected;
+        for (const sample_t &rec : recs) {
+            if (strncmp(rec.name, prefix, strlen(prefix)) == 0) {
+                expected.push_back(&rec);
+            }
+        }
+        /* キーの辞書順、同じキーはレコード順 */
+        std::stable_sort(expected.begin(), expected.end(), [](const void *a, const void *b) {
+            return strcmp(static_cast<const sample_t *>(a)->name,
+                          static_cast<const sample_t *>(b)->name) < 0;
+        });
+        std::vector<const void *> got;
+        EXPECT_EQ(expected.size(), ftcs_trie_prefix_count(t, prefix)) << prefix;
+        EXPECT_EQ(expected.size(), ftcs_trie_prefix(t, prefix, collect_record, &got)) << prefix;
+        EXPECT_EQ(expected, got) << prefix;
+    }
+    ftcs_trie_free(t);
+}
+
+TEST(Trie, CaseInsensitiveAndAttach)
+{
+    std::string path = write_temp("LOCATION=ServerRoom TEMP=20 HUMIDITY=40\n"
+                                  "LOCATION=serverroom TEMP=21 HUMIDITY=41\n"
+                                  "LOCATION=Lab TEMP=22 HUMIDITY=42\n"
+                                  "LOCATION=SERVERROOM-B TEMP=23 HUMIDITY=43\n");
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sensor_sequential_cfg,
+                                            sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    const sensor_t *r = static_cast<const sensor_t *>(rs->records);
+
+    ftcs_trie_t *exact = ftcs_trie_build(rs, sensor_mapping, "LOCATION", 0, nullptr);
+    ftcs_trie_t *ci    = ftcs_trie_build(rs, sensor_mapping, "LOCATION",
+                                         FTCS_TRIE_CASE_INSENSITIVE, nullptr);
+    ASSERT_NE(nullptr, exact);
+    ASSERT_NE(nullptr, ci);
+    EXPECT_EQ(&r[1], ftcs_trie_find(exact, "serverroom"));
+    EXPECT_EQ(nullptr, ftcs_trie_find(exact, "SERVERROOM"));
+    EXPECT_EQ(1u, ftcs_trie_prefix_count(exact, "Server"));
+    /* 大文字・小文字を区別しない場合、同じキーは先頭のレコード */
+    EXPECT_EQ(&r[0], ftcs_trie_find(ci, "SERVERROOM"));
+    EXPECT_EQ(&r[2], ftcs_trie_find(ci, "lab"));
+    EXPECT_EQ(3u, ftcs_trie_prefix_count(ci, "sErVeR"));
+
+    /* イメージを別の領域にコピーしても同じ結果になる */
+    std::vector<char> copy((const char *)ftcs_trie_image(ci),
+                           (const char *)ftcs_trie_image(ci) + ftcs_trie_bytes(ci));
+    ftcs_trie_t *attached = ftcs_trie_attach(copy.data(), copy.size(), rs);
+    ASSERT_NE(nullptr, attached);
+    EXPECT_EQ(&r[0], ftcs_trie_find(attached, "serverROOM"));
+    EXPECT_EQ(3u, ftcs_trie_prefix_count(attached, "server"));
+    std::vector<const void *> got;
+    EXPECT_EQ(3u, ftcs_trie_prefix(attached, "SERVERROOM", collect_record, &got));
+    EXPECT_EQ((std::vector<const void *>{ &r[0], &r[1], &r[3] }), got);
+    ftcs_trie_free(attached);
+
+    /* 壊れたイメージと件数の合わないレコード集合は拒否する */
+    copy[0] ^= 1;
+    EXPECT_EQ(nullptr, ftcs_trie_attach(copy.data(), copy.size(), rs));
+    copy[0] ^= 1;
+    EXPECT_EQ(nullptr, ftcs_trie_attach(copy.data(), copy.size() - 1, rs));
+    ftcs_record_set_t fewer = *rs;
+    fewer.count = 3;
+    EXPECT_EQ(nullptr, ftcs_trie_attach(copy.data(), copy.size(), &fewer));
+
+    ftcs_trie_free(exact);
+    ftcs_trie_free(ci);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(Trie, InvalidArguments)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(nullptr, ftcs_trie_build(nullptr, sample_mapping, "NAME", 0, nullptr));
+    EXPECT_EQ(nullptr, ftcs_trie_build(rs, sample_mapping, "ID", 0, nullptr));
+    EXPECT_EQ(nullptr, ftcs_trie_build(rs, sample_mapping, "NOSUCH", 0, nullptr));
+    EXPECT_EQ(nullptr, ftcs_trie_attach(nullptr, 0, rs));
+    EXPECT_EQ(nullptr, ftcs_trie_find(nullptr, "Widget"));
+    EXPECT_EQ(0u, ftcs_trie_prefix_count(nullptr, ""));
+    EXPECT_EQ(0u, ftcs_trie_bytes(nullptr));
+    ftcs_trie_t *t = ftcs_trie_build(rs, sample_mapping, "NAME", 0, nullptr);
+    ASSERT_NE(nullptr, t);
+    EXPECT_EQ(nullptr, ftcs_trie_find(t, nullptr));
+    EXPECT_EQ(0u, ftcs_trie_prefix(t, "", nullptr, nullptr));
+    ftcs_trie_free(t);
+    ftcs_trie_free(nullptr);
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ25: 一括検索 (ftcs_find_many / ftcs_key_index_find_many)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(FindMany, MatchesFindByKeyBeforeAndAfterSort)
+{
+    /* 重複キー・見つからないキー・同じキーの繰り返し・NaN・NULL を混ぜ、
+     * 線形探索・二分探索・ハッシュ索引のいずれでも ftcs_find_by_key と同じレコードを返す */
+    ftcs_record_set_t *rs = parse_via_pipe(sample_lines(3000), &all_types_cfg,
+                                           sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    sample_t *recs = static_cast<sample_t *>(rs->records);
+    for (size_t i = 0; i < rs->count; i++) {
+        recs[i].id    = (int)((i * 37) % 1000) - 500;
+        recs[i].value = (i % 10 == 0) ? -0.0 : (double)((i * 13) % 100) / 4;
+        snprintf(recs[i].name, sizeof(recs[i].name), "SENSOR_LOCATION_%zu", (i * 7) % 300);
+    }
+    const struct {
+        const char *field;
+        std::vector<std::string> keys;
+    } cases[] = {
+        { "ID",    { "-500", "7", "-1", "0", "499", "500", "7", "-501", "12x" } },
+        { "VALUE", { "0", "-0", "0.25", "24.75", "25", "nan", "0.25" } },
+        { "NAME",  { "SENSOR_LOCATION_0", "SENSOR_LOCATION_299", "SENSOR_LOCATION_",
+                     "SENSOR", "", "SENSOR_LOCATION_0" } },
+    };
+    for (const auto &c : cases) {
+        /* 16 件ずつの先読み単位をまたぐよう、キーを繰り返して NULL を挟む */
+        std::vector<const char *> keys;
+        for (int rep = 0; rep < 5; rep++) {
+            for (const std::string &k : c.keys) {
+                keys.push_back(k.c_str());
+            }
+            keys.push_back(nullptr);
+        }
+        for (int sorted = 0; sorted < 2; sorted++) {
+            std::vector<const void *> expected;
+            size_t expected_found = 0;
+            for (const char *k : keys) {
+                const void *hit = k ? ftcs_find_by_key(rs, sample_mapping, c.field, k, sizeof(sample_t))
+                                    : nullptr;
+                expected.push_back(hit);
+                expected_found += hit != nullptr;
+            }
+            std::vector<const void *> out(keys.size(), &out);
+            EXPECT_EQ(expected_found, ftcs_find_many(rs, sample_mapping, c.field, keys.data(),
+                                                     keys.size(), out.data()))
+                << c.field << " sorted=" << sorted;
+            for (size_t k = 0; k < keys.size(); k++) {
+                EXPECT_EQ(expected[k], out[k]) << c.field << "=" << (keys[k] ? keys[k] : "NULL")
+                                               << " sorted=" << sorted;
+            }
+
+            ftcs_key_index_t *idx = ftcs_key_index_build(rs, sample_mapping, c.field);
+            ASSERT_NE(nullptr, idx);
+            std::fill(out.begin(), out.end(), &out);
+            EXPECT_EQ(expected_found, ftcs_key_index_find_many(idx, keys.data(), keys.size(), out.data()));
+            for (size_t k = 0; k < keys.size(); k++) {
+                EXPECT_EQ(expected[k], out[k]) << c.field << "=" << (keys[k] ? keys[k] : "NULL");
+            }
+            ftcs_key_index_free(idx);
+            ASSERT_EQ(0, ftcs_record_set_sort(rs, sample_mapping, c.field));
+        }
+    }
+    ftcs_record_set_free(rs);
+}
+
+TEST(FindMany, AllKeysOfLargeSet)
+{
+    /* 全レコードのキーと、その間の存在しないキーを逆順に一括で引く */
+    const size_t n = 20000;
+    std::vector<all_types_t> recs(n);
+    for (size_t i = 0; i < n; i++) {
+        recs[i].lval = (long)(i * 2) - 10000;
+        snprintf(recs[i].strval, sizeof(recs[i].strval), "K%zu", i * 2);
+    }
+    ftcs_record_set_t rs = {};
+    rs.records     = recs.data();
+    rs.count       = n;
+    rs.capacity    = n;
+    rs.struct_size = sizeof(all_types_t);
+    std::vector<std::string> lkeys, skeys;
+    for (size_t i = 2 * n; i-- > 0;) {
+        lkeys.push_back(std::to_string((long)i - 10000));
+        skeys.push_back("K" + std::to_string(i));
+    }
+    for (int sorted = 0; sorted < 2; sorted++) {
+        for (const auto *keys : { &lkeys, &skeys }) {
+            const char *field = (keys == &lkeys) ? "LVAL" : "STRVAL";
+            if (sorted) {
+                ASSERT_EQ(0, ftcs_record_set_sort(&rs, all_types_mapping, field));
+            }
+            std::vector<const char *> ptrs;
+            for (const std::string &k : *keys) {
+                ptrs.push_back(k.c_str());
+            }
+            std::vector<const void *> out(ptrs.size());
+            EXPECT_EQ(n, ftcs_find_many(&rs, all_types_mapping, field, ptrs.data(), ptrs.size(),
+                                        out.data()))
+                << field << " sorted=" << sorted;
+            for (size_t k = 0; k < ptrs.size(); k++) {
+                size_t i = 2 * n - 1 - k; // keys[k] が表す値の位置
+                if (i % 2) {
+                    ASSERT_EQ(nullptr, out[k]) << field << "=" << ptrs[k];
+                } else {
+                    ASSERT_NE(nullptr, out[k]) << field << "=" << ptrs[k];
+                    const all_types_t *hit = static_cast<const all_types_t *>(out[k]);
+                    if (keys == &lkeys) {
+                        ASSERT_EQ((long)i - 10000, hit->lval);
+                    } else {
+                        ASSERT_STREQ(ptrs[k], hit->strval);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(FindMany, InvalidArguments)
+{
+    ftcs_record_set_t *rs = ftcs_parse_file(data("basic.txt").c_str(), &sample_cfg,
+                                            sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    const char *keys[] = { "42", "7" };
+    const void *out[2] = { rs, rs };
+    EXPECT_EQ(0u, ftcs_find_many(rs, sample_mapping, "NOSUCH", keys, 2, out));
+    EXPECT_EQ(nullptr, out[0]);
+    EXPECT_EQ(nullptr, out[1]);
+    out[0] = rs;
+    EXPECT_EQ(0u, ftcs_find_many(nullptr, sample_mapping, "ID", keys, 2, out));
+    EXPECT_EQ(nullptr, out[0]);
+    EXPECT_EQ(0u, ftcs_find_many(rs, sample_mapping, "ID", nullptr, 2, out));
+    EXPECT_EQ(0u, ftcs_find_many(rs, sample_mapping, "ID", keys, 2, nullptr));
+    EXPECT_EQ(0u, ftcs_find_many(rs, sample_mapping, "ID", keys, 0, out));
+    EXPECT_EQ(2u, ftcs_find_many(rs, sample_mapping, "ID", keys, 2, out));
+    EXPECT_EQ(0u, ftcs_key_index_find_many(nullptr, keys, 2, out));
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ26: 追記ファイルの差分パース (ftcs_parse_resume)
+ * ══════════════════════════════════════════════════════════ */
+
+/** @brief path の末尾に text を書き足す */
+static void append_file(const std::string &path, const std::string &text)
+{
+    FILE *fp = fopen(path.c_str(), "a");
+    ASSERT_NE(nullptr, fp);
+    fputs(text.c_str(), fp);
+    fclose(fp);
+}
+
+TEST(ParseResume, ParsesOnlyAppendedLines)
+{
+    std::string path = write_temp(sample_lines(100));
+    ASSERT_FALSE(path.empty());
+    ftcs_checkpoint_t  cp = {};
+    ftcs_record_set_t *rs = nullptr;
+    EXPECT_EQ(100, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                     sizeof(sample_t), &rs));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(100u, rs->count);
+    EXPECT_EQ(100u, cp.records);
+    EXPECT_EQ(0u, cp.pending);
+    EXPECT_EQ(0u, cp.restarts);
+
+    /* 追記がなければ何もしない */
+    EXPECT_EQ(0, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+
+    /* 改行の来ていない行は持ち越し、改行が来てから1レコードにする */
+    uint64_t offset = cp.offset;
+    append_file(path, "ID=100 NAME=Par");
+    EXPECT_EQ(0, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(offset, cp.offset);
+    EXPECT_EQ(15u, cp.pending);
+    append_file(path, "tial VALUE=2.5\n# comment\nID=101 NAME=Next VALUE=3.5\n");
+    EXPECT_EQ(2, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(0u, cp.pending);
+    EXPECT_EQ(102u, cp.records);
+    ASSERT_EQ(102u, rs->count);
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    EXPECT_EQ(100, r[100].id);
+    EXPECT_STREQ("Partial", r[100].name);
+    EXPECT_DOUBLE_EQ(2.5, r[100].value);
+    EXPECT_STREQ("Next", r[101].name);
+
+    /* ファイル全体を読み直した結果と一致する */
+    ftcs_record_set_t *full = ftcs_parse_file(path.c_str(), &sample_cfg, sample_mapping,
+                                              sizeof(sample_t));
+    ASSERT_NE(nullptr, full);
+    ASSERT_EQ(full->count, rs->count);
+    EXPECT_EQ(0, memcmp(full->records, rs->records, rs->count * sizeof(sample_t)));
+
+    /* 保存した記録と同じ件数の集合からは、別の集合でも続きを読める */
+    ftcs_checkpoint_t saved = cp;
+    append_file(path, "ID=102 NAME=Later VALUE=4.5\n");
+    EXPECT_EQ(1, ftcs_parse_resume(&saved, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &full));
+    EXPECT_EQ(103u, full->count);
+    EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(0, memcmp(full->records, rs->records, rs->count * sizeof(sample_t)));
+
+    /* 追記すると並べ替え済みの印は外れる */
+    ASSERT_EQ(0, ftcs_record_set_sort(rs, sample_mapping, "NAME"));
+    append_file(path, "ID=103 NAME=AAA VALUE=5.5\n");
+    EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(0, rs->sorted);
+    ftcs_record_set_free(full);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(ParseResume, RestartsAfterTruncationAndRotation)
+{
+    std::string path = write_temp("ID=1 NAME=First VALUE=1\nID=2 NAME=Second VALUE=2\n");
+    ASSERT_FALSE(path.empty());
+    ftcs_checkpoint_t  cp = {};
+    ftcs_record_set_t *rs = nullptr;
+    EXPECT_EQ(2, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    ASSERT_NE(nullptr, rs);
+
+    /* 切り詰めて短く書き直すと先頭から読み直し、取り込み済みのレコードは残す */
+    FILE *fp = fopen(path.c_str(), "w");
+    ASSERT_NE(nullptr, fp);
+    fputs("ID=3 NAME=Trunc VALUE=3\n", fp);
+    fclose(fp);
+    EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(1u, cp.restarts);
+    ASSERT_EQ(3u, rs->count);
+    const sample_t *r = static_cast<const sample_t *>(rs->records);
+    EXPECT_STREQ("Trunc", r[2].name);
+
+    /* 切り詰め後に元より長く書かれていても、offset の直前が改行でなければ読み直す */
+    fp = fopen(path.c_str(), "w");
+    ASSERT_NE(nullptr, fp);
+    fputs("ID=4 NAME=Rewritten_long_name VALUE=4\n", fp);
+    fclose(fp);
+    EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(2u, cp.restarts);
+    r = static_cast<const sample_t *>(rs->records);
+    EXPECT_STREQ("Rewritten_long_name", r[3].name);
+
+    /* 別のファイルに置き換える（ローテーション）と、新しいファイルを先頭から読む */
+    std::string rotated = write_temp("ID=5 NAME=Rotated VALUE=5\nID=6 NAME=Rot");
+    ASSERT_FALSE(rotated.empty());
+    ASSERT_EQ(0, rename(rotated.c_str(), path.c_str()));
+    EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(3u, cp.restarts);
+    EXPECT_EQ(13u, cp.pending);
+    append_file(path, "ated VALUE=6\n");
+    EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    EXPECT_EQ(3u, cp.restarts);
+    ASSERT_EQ(6u, rs->count);
+    r = static_cast<const sample_t *>(rs->records);
+    EXPECT_STREQ("Rotated", r[4].name);
+    EXPECT_STREQ("Rotated", r[5].name);
+    EXPECT_EQ(6u, cp.records);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(ParseResume, ErrorsLeaveCheckpointUnchanged)
+{
+    std::string path = write_temp("ID=1 NAME=Good VALUE=1\n");
+    ASSERT_FALSE(path.empty());
+    ftcs_checkpoint_t  cp = {};
+    ftcs_record_set_t *rs = nullptr;
+    EXPECT_EQ(-1, ftcs_parse_resume(nullptr, path.c_str(), &sample_cfg, sample_mapping,
+                                    sizeof(sample_t), &rs));
+    EXPECT_EQ(-1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                    sizeof(sample_t), nullptr));
+    EXPECT_EQ(-1, ftcs_parse_resume(&cp, "/nonexistent/ftcs.txt", &sample_cfg, sample_mapping,
+                                    sizeof(sample_t), &rs));
+    EXPECT_EQ(nullptr, rs);
+    EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                   sizeof(sample_t), &rs));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(-1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                    sizeof(sample_t) + 8, &rs));
+
+    /* 解析エラーの行までに追加したレコードは取り消し、記録も進めない */
+    ftcs_checkpoint_t before = cp;
+    append_file(path, "ID=2 NAME=Ok VALUE=2\nID=oops NAME=Bad VALUE=3\n");
+    EXPECT_EQ(-1, ftcs_parse_resume(&cp, path.c_str(), &sample_cfg, sample_mapping,
+                                    sizeof(sample_t), &rs));
+    EXPECT_EQ(0, memcmp(&before, &cp, sizeof(cp)));
+    EXPECT_EQ(1u, rs->count);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ27: 複数種類のレコードの振り分け (ftcs_parse_multi)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(MultiSchema, RoutesLinesToMatchingSchema)
+{
+    std::string mixed =
+        "# mixed\n"
+        "TYPE=sample ID=1 NAME=Alpha VALUE=1.5\n"
+        "TYPE=types IVAL=10 STRVAL=first DVAL=2.5\n"
+        "ID=2 TYPE=sample NAME=Beta VALUE=2.5\n"
+        "\n"
+        "TYPE=other ID=3\n"
+        "ID=4 NAME=NoType VALUE=4\n"
+        "TYPE=types IVAL=20 STRVAL=second\n";
+    std::string path = write_temp(mixed);
+    ASSERT_FALSE(path.empty());
+    const ftcs_schema_t schemas[] = {
+        { "sample", sample_mapping,    sizeof(sample_t)    },
+        { "types",  all_types_mapping, sizeof(all_types_t) },
+    };
+    const ftcs_io_backend_t backends[] = { FTCS_IO_STDIO, FTCS_IO_PREAD };
+    for (ftcs_io_backend_t backend : backends) {
+        ftcs_parser_config_t cfg = all_types_cfg;
+        cfg.io_backend = backend;
+        ftcs_record_set_t *out[2] = {};
+        ASSERT_EQ(0, ftcs_parse_multi(path.c_str(), &cfg, "TYPE", schemas, 2, out));
+        ASSERT_NE(nullptr, out[0]);
+        ASSERT_NE(nullptr, out[1]);
+        ASSERT_EQ(2u, out[0]->count);
+        ASSERT_EQ(2u, out[1]->count);
+        const sample_t *s = static_cast<const sample_t *>(out[0]->records);
+        EXPECT_EQ(1, s[0].id);
+        EXPECT_STREQ("Alpha", s[0].name);
+        EXPECT_STREQ("Beta", s[1].name);
+        EXPECT_DOUBLE_EQ(2.5, s[1].value);
+        const all_types_t *t = static_cast<const all_types_t *>(out[1]->records);
+        EXPECT_EQ(10, t[0].ival);
+        EXPECT_STREQ("first", t[0].strval);
+        EXPECT_DOUBLE_EQ(2.5, t[0].dval);
+        EXPECT_EQ(20, t[1].ival);
+        EXPECT_STREQ("second", t[1].strval);
+        ftcs_record_set_free(out[0]);
+        ftcs_record_set_free(out[1]);
+    }
+
+    /* 種類ごとに抜き出したファイルを個別に解析した結果と一致する */
+    std::string only_sample = write_temp("ID=1 NAME=Alpha VALUE=1.5\nID=2 NAME=Beta VALUE=2.5\n");
+    ASSERT_FALSE(only_sample.empty());
+    ftcs_record_set_t *single = ftcs_parse_file(only_sample.c_str(), &all_types_cfg,
+                                                sample_mapping, sizeof(sample_t));
+    ftcs_record_set_t *out[2] = {};
+    ASSERT_EQ(0, ftcs_parse_multi(path.c_str(), &all_types_cfg, "TYPE", schemas, 2, out));
+    ASSERT_NE(nullptr, single);
+    ASSERT_EQ(single->count, out[0]->count);
+    EXPECT_EQ(0, memcmp(single->records, out[0]->records, single->count * sizeof(sample_t)));
+    ftcs_record_set_free(single);
+    ftcs_record_set_free(out[0]);
+    ftcs_record_set_free(out[1]);
+    unlink(only_sample.c_str());
+    unlink(path.c_str());
+}
+
+TEST(MultiSchema, StatsCountUnroutedLinesOnce)
+{
+    std::string path = write_temp(
+        "TYPE=sample ID=1 NAME=A VALUE=1\n"
+        "TYPE=sample ID=2 NAME=B VALUE=2 EXTRA=1\n"
+        "TYPE=unknown ID=3\n"
+        "TYPE=types IVAL=1\n"
+        "# comment\n"
+        "NOTYPE=sample ID=5\n");
+    ASSERT_FALSE(path.empty());
+    const ftcs_schema_t schemas[] = {
+        { "sample", sample_mapping,    sizeof(sample_t)    },
+        { "types",  all_types_mapping, sizeof(all_types_t) },
+    };
+    ftcs_parse_stats_t   st  = {};
+    ftcs_parser_config_t cfg = all_types_cfg;
+    cfg.stats = &st;
+    ftcs_record_set_t *out[2] = {};
+    ASSERT_EQ(0, ftcs_parse_multi(path.c_str(), &cfg, "TYPE", schemas, 2, out));
+    EXPECT_EQ(6u, st.lines);
+    EXPECT_EQ(1u, st.comments);
+    EXPECT_EQ(3u, st.records);
+    EXPECT_EQ(2u, st.unrouted);
+    /* 判別キーは未知のキーに数えず、EXTRA だけを数える */
+    EXPECT_EQ(1u, st.unknown_keys);
+
+    /* フィルタは全スキーマに適用する */
+    ftcs_record_set_free(out[0]);
+    ftcs_record_set_free(out[1]);
+    std::string both = write_temp(
+        "TYPE=sample ID=1 NAME=A VALUE=1\n"
+        "TYPE=sample ID=2 NAME=B VALUE=2\n"
+        "TYPE=types ID=3 IVAL=1\n");
+    ASSERT_FALSE(both.empty());
+    const ftcs_field_mapping_t types_with_id[] = {
+        { "ID",   offsetof(all_types_t, ival), sizeof(int),  FTCS_TYPE_INT,  FTCS_TYPE_INT  },
+        { "LVAL", offsetof(all_types_t, lval), sizeof(long), FTCS_TYPE_LONG, FTCS_TYPE_LONG },
+        { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
+    };
+    const ftcs_schema_t filtered[] = {
+        { "sample", sample_mapping, sizeof(sample_t)    },
+        { "types",  types_with_id,  sizeof(all_types_t) },
+    };
+    cfg.filter = "ID >= 2";
+    ASSERT_EQ(0, ftcs_parse_multi(both.c_str(), &cfg, "TYPE", filtered, 2, out));
+    EXPECT_EQ(1u, out[0]->count);
+    EXPECT_EQ(1u, out[1]->count);
+    EXPECT_EQ(1u, st.filtered);
+    ftcs_record_set_free(out[0]);
+    ftcs_record_set_free(out[1]);
+    unlink(both.c_str());
+    unlink(path.c_str());
+}
+
+TEST(MultiSchema, InvalidArgumentsAndParseErrors)
+{
+    std::string path = write_temp("TYPE=sample ID=1 NAME=A VALUE=1\nTYPE=sample ID=bad\n");
+    ASSERT_FALSE(path.empty());
+    const ftcs_schema_t schemas[] = {
+        { "sample", sample_mapping, sizeof(sample_t) },
+    };
+    ftcs_record_set_t *out[1] = {};
+    EXPECT_EQ(-1, ftcs_parse_multi(nullptr, &all_types_cfg, "TYPE", schemas, 1, out));
+    EXPECT_EQ(-1, ftcs_parse_multi(path.c_str(), &all_types_cfg, nullptr, schemas, 1, out));
+    EXPECT_EQ(-1, ftcs_parse_multi(path.c_str(), &all_types_cfg, "TYPE", schemas, 0, out));
+    const ftcs_schema_t no_tag[] = { { nullptr, sample_mapping, sizeof(sample_t) } };
+    EXPECT_EQ(-1, ftcs_parse_multi(path.c_str(), &all_types_cfg, "TYPE", no_tag, 1, out));
+    EXPECT_EQ(-1, ftcs_parse_multi("/nonexistent/ftcs.txt", &all_types_cfg, "TYPE",
+                                   schemas, 1, out));
+    EXPECT_EQ(nullptr, out[0]);
+    /* 振り分け先での変換エラーは全体のエラーにし、途中のレコード集合も返さない */
+    EXPECT_EQ(-1, ftcs_parse_multi(path.c_str(), &all_types_cfg, "TYPE", schemas, 1, out));
+    EXPECT_EQ(nullptr, out[0]);
+    unlink(path.c_str());
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ28: ファイルに置くレコード集合 (ftcs_mapfile_* / ftcs_snapshot_open)
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(MapFile, ParsesIntoFileAndReopensAsSnapshot)
+{
+    std::string input = write_temp(sample_lines(5000));
+    std::string snap  = write_temp("");
+    ASSERT_FALSE(input.empty());
+    ASSERT_FALSE(snap.empty());
+    ftcs_record_set_t *heap = ftcs_parse_file(input.c_str(), &sample_cfg, sample_mapping,
+                                              sizeof(sample_t));
+    ASSERT_NE(nullptr, heap);
+
+    /* 拡張を何度も経てもヒープに置いた場合と同じ内容になる */
+    ftcs_mapfile_t mf;
+    ASSERT_EQ(0, ftcs_mapfile_create(&mf, snap.c_str()));
+    ftcs_allocator_t     alloc = ftcs_mapfile_allocator(&mf);
+    ftcs_parse_stats_t   st    = {};
+    ftcs_parser_config_t cfg   = sample_cfg;
+    cfg.allocator = &alloc;
+    cfg.stats     = &st;
+    ftcs_record_set_t *rs = ftcs_parse_file(input.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_GT(st.reallocs, 3u);
+    ASSERT_EQ(heap->count, rs->count);
+    EXPECT_EQ(0, memcmp(heap->records, rs->records, rs->count * sizeof(sample_t)));
+
+    /* 確定するとファイルはヘッダーとレコード数分になり、集合はそのまま使える */
+    ASSERT_EQ(0, ftcs_mapfile_commit(&mf, rs));
+    EXPECT_EQ(rs->count, rs->capacity);
+    struct stat sb;
+    ASSERT_EQ(0, stat(snap.c_str(), &sb));
+    EXPECT_EQ((off_t)(4096 + rs->count * sizeof(sample_t)), sb.st_size);
+    EXPECT_NE(nullptr, ftcs_find_by_key(rs, sample_mapping, "ID", "4999", sizeof(sample_t)));
+    ftcs_record_set_free(rs);
+    ftcs_mapfile_close(&mf);
+
+    /* スナップショットは変換なしでそのままレコード集合になる */
+    ftcs_record_set_t *snapshot = ftcs_snapshot_open(snap.c_str(), sizeof(sample_t));
+    ASSERT_NE(nullptr, snapshot);
+    ASSERT_EQ(heap->count, snapshot->count);
+    EXPECT_EQ(0, memcmp(heap->records, snapshot->records, heap->count * sizeof(sample_t)));
+    const sample_t *r = static_cast<const sample_t *>(
+        ftcs_find_by_key(snapshot, sample_mapping, "ID", "1234", sizeof(sample_t)));
+    ASSERT_NE(nullptr, r);
+    EXPECT_STREQ("N1234", r->name);
+
+    /* 読み込んだ集合への変更・追加はファイルに反映されない */
+    ASSERT_EQ(0, ftcs_record_set_sort(snapshot, sample_mapping, "NAME"));
+    append_file(input, "ID=5000 NAME=Added VALUE=1\n");
+    ftcs_checkpoint_t cp = {};
+    EXPECT_EQ(5001, ftcs_parse_resume(&cp, input.c_str(), &sample_cfg, sample_mapping,
+                                      sizeof(sample_t), &snapshot));
+    EXPECT_EQ(10001u, snapshot->count);
+    ftcs_record_set_free(snapshot);
+    snapshot = ftcs_snapshot_open(snap.c_str(), sizeof(sample_t));
+    ASSERT_NE(nullptr, snapshot);
+    EXPECT_EQ(0, memcmp(heap->records, snapshot->records, heap->count * sizeof(sample_t)));
+    ftcs_record_set_free(snapshot);
+    ftcs_record_set_free(heap);
+    unlink(snap.c_str());
+    unlink(input.c_str());
+}
+
+TEST(MapFile, CommitAgainAfterResume)
+{
+    std::string input = write_temp(sample_lines(10));
+    std::string snap  = write_temp("");
+    ASSERT_FALSE(input.empty());
+    ASSERT_FALSE(snap.empty());
+    ftcs_mapfile_t mf;
+    ASSERT_EQ(0, ftcs_mapfile_create(&mf, snap.c_str()));
+    ftcs_allocator_t     alloc = ftcs_mapfile_allocator(&mf);
+    ftcs_parser_config_t cfg   = sample_cfg;
+    cfg.allocator = &alloc;
+    ftcs_checkpoint_t  cp = {};
+    ftcs_record_set_t *rs = nullptr;
+    ASSERT_EQ(10, ftcs_parse_resume(&cp, input.c_str(), &cfg, sample_mapping,
+                                    sizeof(sample_t), &rs));
+    ASSERT_EQ(0, ftcs_mapfile_commit(&mf, rs));
+
+    /* 確定後も出力ファイル上で伸ばせ、もう一度確定すると追加分も読める */
+    append_file(input, sample_lines(100).substr(sample_lines(10).size()));
+    EXPECT_EQ(90, ftcs_parse_resume(&cp, input.c_str(), &cfg, sample_mapping,
+                                    sizeof(sample_t), &rs));
+    ftcs_record_set_t *stale = ftcs_snapshot_open(snap.c_str(), sizeof(sample_t));
+    EXPECT_EQ(nullptr, stale);
+    ASSERT_EQ(0, ftcs_mapfile_commit(&mf, rs));
+    ftcs_mapfile_close(&mf);
+    ftcs_record_set_t *snapshot = ftcs_snapshot_open(snap.c_str(), sizeof(sample_t));
+    ASSERT_NE(nullptr, snapshot);
+    ASSERT_EQ(100u, snapshot->count);
+    EXPECT_EQ(0, memcmp(rs->records, snapshot->records, rs->count * sizeof(sample_t)));
+    ftcs_record_set_free(snapshot);
+    ftcs_record_set_free(rs);
+    unlink(snap.c_str());
+    unlink(input.c_str());
+}
+
+TEST(MapFile, InvalidArgumentsAndUncommittedFiles)
+{
+    std::string input = write_temp(sample_lines(10));
+    std::string snap  = write_temp("");
+    ASSERT_FALSE(input.empty());
+    ASSERT_FALSE(snap.empty());
+    ftcs_mapfile_t mf;
+    EXPECT_EQ(-1, ftcs_mapfile_create(nullptr, snap.c_str()));
+    EXPECT_EQ(-1, ftcs_mapfile_create(&mf, "/nonexistent/dir/ftcs.snap"));
+    EXPECT_EQ(nullptr, ftcs_snapshot_open(nullptr, sizeof(sample_t)));
+    EXPECT_EQ(nullptr, ftcs_snapshot_open("/nonexistent/ftcs.snap", sizeof(sample_t)));
+
+    ASSERT_EQ(0, ftcs_mapfile_create(&mf, snap.c_str()));
+    ftcs_allocator_t     alloc = ftcs_mapfile_allocator(&mf);
+    ftcs_parser_config_t cfg   = sample_cfg;
+    cfg.allocator = &alloc;
+    ftcs_record_set_t *rs = ftcs_parse_file(input.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    /* 1つの出力ファイルに置けるレコード配列は1つだけ */
+    EXPECT_EQ(nullptr, ftcs_parse_file(input.c_str(), &cfg, sample_mapping, sizeof(sample_t)));
+    /* 確定前のファイルはスナップショットとして開けない */
+    EXPECT_EQ(nullptr, ftcs_snapshot_open(snap.c_str(), sizeof(sample_t)));
+
+    /* 別のアロケーターで確保した集合は確定できない */
+    ftcs_record_set_t *heap = ftcs_parse_file(input.c_str(), &sample_cfg, sample_mapping,
+                                              sizeof(sample_t));
+    ASSERT_NE(nullptr, heap);
+    EXPECT_EQ(-1, ftcs_mapfile_commit(&mf, heap));
+    EXPECT_EQ(-1, ftcs_mapfile_commit(&mf, nullptr));
+    ASSERT_EQ(0, ftcs_mapfile_commit(&mf, rs));
+    /* 構造体サイズが違えば開けない */
+    EXPECT_EQ(nullptr, ftcs_snapshot_open(snap.c_str(), sizeof(sample_t) + 8));
+    /* 閉じたあとの解放も安全 */
+    ftcs_mapfile_close(&mf);
+    ftcs_mapfile_close(&mf);
+    ftcs_record_set_free(rs);
+    ftcs_record_set_free(heap);
+    unlink(snap.c_str());
+    unlink(input.c_str());
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ29: 分割実行パーサー (ftcs_parser_*)
+ * ══════════════════════════════════════════════════════════ */
+
+/** @brief budget_bytes ずつ最後まで進めて取り出す */
+static ftcs_record_set_t *parse_in_steps(const std::string &path, const ftcs_parser_config_t *cfg,
+                                         const ftcs_field_mapping_t *mapping, size_t struct_size,
+                                         size_t budget_bytes)
+{
+    ftcs_parser_t *p = ftcs_parser_open(path.c_str(), cfg, mapping, struct_size);
+    if (!p) {
+        return nullptr;
+    }
+    while (ftcs_parser_step(p, budget_bytes, 0) == 1) {
+    }
+    return ftcs_parser_finish(p);
+}
+
+TEST(ParserStep, MatchesOneShotParse)
+{
+    struct parse_case {
+        std::string                 path;
+        const ftcs_parser_config_t *cfg;
+        const ftcs_field_mapping_t *mapping;
+        size_t                      struct_size;
+    };
+    ftcs_parser_config_t filtered = sample_cfg;
+    filtered.filter = "ID >= 100 && ID < 200";
+    /* 末尾に改行のない行・コメント・空行を含む */
+    std::string tail = write_temp(sample_lines(1000) + "# end\n\nID=1000 NAME=Last VALUE=9");
+    ASSERT_FALSE(tail.empty());
+    const parse_case cases[] = {
+        { data("basic.txt"),          &sample_cfg,             sample_mapping,    sizeof(sample_t)    },
+        { data("comments_empty.txt"), &sample_cfg,             sample_mapping,    sizeof(sample_t)    },
+        { data("all_types.txt"),      &all_types_cfg,          all_types_mapping, sizeof(all_types_t) },
+        { data("index_field.txt"),    &sensor_index_field_cfg, sensor_mapping,    sizeof(sensor_t)    },
+        { tail,                       &sample_cfg,             sample_mapping,    sizeof(sample_t)    },
+        { tail,                       &filtered,               sample_mapping,    sizeof(sample_t)    },
+    };
+    for (const parse_case &c : cases) {
+        ftcs_record_set_t *whole = ftcs_parse_file(c.path.c_str(), c.cfg, c.mapping, c.struct_size);
+        ASSERT_NE(nullptr, whole) << c.path;
+        /* 行の途中で区切られる小さな予算から、1回で読み切る予算まで */
+        for (size_t budget : { (size_t)1, (size_t)7, (size_t)4096, (size_t)0 }) {
+            ftcs_record_set_t *rs = parse_in_steps(c.path, c.cfg, c.mapping, c.struct_size, budget);
+            ASSERT_NE(nullptr, rs) << c.path << " budget " << budget;
+            ASSERT_EQ(whole->count, rs->count) << c.path << " budget " << budget;
+            EXPECT_EQ(0, memcmp(whole->records, rs->records, rs->count * c.struct_size))
+                << c.path << " budget " << budget;
+            ftcs_record_set_free(rs);
+        }
+        ftcs_record_set_free(whole);
+    }
+    unlink(tail.c_str());
+}
+
+TEST(ParserStep, BudgetsBoundWorkAndReportProgress)
+{
+    std::string path = write_temp(sample_lines(20000));
+    ASSERT_FALSE(path.empty());
+    ftcs_parse_stats_t   st  = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stats = &st;
+    ftcs_parser_t *p = ftcs_parser_open(path.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, p);
+    ftcs_parser_progress_t pr;
+    ftcs_parser_progress(p, &pr);
+    EXPECT_EQ(0u, pr.bytes);
+    EXPECT_EQ((uint64_t)sample_lines(20000).size(), pr.total_bytes);
+    EXPECT_EQ(0, pr.done);
+
+    /* バイト数の予算はちょうどその分だけ読む */
+    EXPECT_EQ(1, ftcs_parser_step(p, 100, 0));
+    ftcs_parser_progress(p, &pr);
+    EXPECT_EQ(100u, pr.bytes);
+    EXPECT_GT(pr.records, 0u);
+    /* 時間の予算を使い切っても少なくとも1単位は進む */
+    EXPECT_EQ(1, ftcs_parser_step(p, 0, 1));
+    ftcs_parser_progress(p, &pr);
+    EXPECT_EQ(100u + 16 * 1024, pr.bytes);
+    EXPECT_GT(pr.busy_ns, 0u);
+    /* 十分な時間があれば読み切る（呼び出しの合間の待ち時間は統計の所要時間に含めない） */
+    usleep(100 * 1000);
+    while (ftcs_parser_step(p, 0, 1000000000) == 1) {
+    }
+    ftcs_parser_progress(p, &pr);
+    EXPECT_EQ(1, pr.done);
+    EXPECT_EQ(pr.total_bytes, pr.bytes);
+    EXPECT_EQ(20000u, pr.records);
+    EXPECT_EQ(0, ftcs_parser_step(p, 100, 0));
+
+    ftcs_record_set_t *rs = ftcs_parser_finish(p);
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(20000u, rs->count);
+    EXPECT_EQ(20000u, st.records);
+    EXPECT_EQ(20000u, st.lines);
+    EXPECT_EQ(pr.total_bytes, (uint64_t)st.bytes);
+    EXPECT_LT(st.total_ns, 100u * 1000 * 1000);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(ParserStep, ErrorsStopAndAbortFrees)
+{
+    EXPECT_EQ(nullptr, ftcs_parser_open(nullptr, &sample_cfg, sample_mapping, sizeof(sample_t)));
+    EXPECT_EQ(nullptr, ftcs_parser_open("/nonexistent/ftcs.txt", &sample_cfg, sample_mapping,
+                                        sizeof(sample_t)));
+    EXPECT_EQ(-1, ftcs_parser_step(nullptr, 0, 0));
+    EXPECT_EQ(nullptr, ftcs_parser_finish(nullptr));
+    ftcs_parser_free(nullptr);
+
+    /* 解析エラーで止まったパーサーはその後も -1 を返し、結果を取り出せない */
+    std::string bad = write_temp(sample_lines(100) + "ID=oops NAME=Bad VALUE=1\n" + sample_lines(10));
+    ASSERT_FALSE(bad.empty());
+    ftcs_parser_t *p = ftcs_parser_open(bad.c_str(), &sample_cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(-1, ftcs_parser_step(p, 0, 0));
+    EXPECT_EQ(-1, ftcs_parser_step(p, 0, 0));
+    ftcs_parser_progress_t pr;
+    ftcs_parser_progress(p, &pr);
+    EXPECT_EQ(-1, pr.done);
+    EXPECT_EQ(nullptr, ftcs_parser_finish(p));
+
+    /* 途中で中断しても構築途中のレコード集合ごと解放できる */
+    std::string good = write_temp(sample_lines(1000));
+    ASSERT_FALSE(good.empty());
+    p = ftcs_parser_open(good.c_str(), &sample_cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(1, ftcs_parser_step(p, 500, 0));
+    ftcs_parser_free(p);
+    unlink(bad.c_str());
+    unlink(good.c_str());
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ30: 配列フィールド (FTCS_TYPE_ARRAY)
+ * ══════════════════════════════════════════════════════════ */
+
+typedef struct {
+    int    id;
+    float  samples[4];
+    int    counts[3];
+    long   totals[2];
+    short  levels[2];
+    double weights[2];
+    char   flags[3];
+} array_rec_t;
+
+static const ftcs_field_mapping_t array_mapping[] = {
+    { "ID",      offsetof(array_rec_t, id),      sizeof(int),       FTCS_TYPE_INT,   FTCS_TYPE_INT    },
+    { "SAMPLES", offsetof(array_rec_t, samples), sizeof(float[4]),  FTCS_TYPE_ARRAY, FTCS_TYPE_FLOAT  },
+    { "COUNTS",  offsetof(array_rec_t, counts),  sizeof(int[3]),    FTCS_TYPE_ARRAY, FTCS_TYPE_INT    },
+    { "TOTALS",  offsetof(array_rec_t, totals),  sizeof(long[2]),   FTCS_TYPE_ARRAY, FTCS_TYPE_LONG   },
+    { "LEVELS",  offsetof(array_rec_t, levels),  sizeof(short[2]),  FTCS_TYPE_ARRAY, FTCS_TYPE_SHORT  },
+    { "WEIGHTS", offsetof(array_rec_t, weights), sizeof(double[2]), FTCS_TYPE_ARRAY, FTCS_TYPE_DOUBLE },
+    { "FLAGS",   offsetof(array_rec_t, flags),   sizeof(char[3]),   FTCS_TYPE_ARRAY, FTCS_TYPE_CHAR   },
+    { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
+};
+
+TEST(ArrayField, ConvertsEveryElementTypeAndZeroFillsShortLists)
+{
+    std::string path = write_temp(
+        "ID=1 SAMPLES=0.5,1.25,-2,3e2 COUNTS=1,-2,3 TOTALS=5000000000,-7 LEVELS=7,8"
+        " WEIGHTS=0.125,2.5 FLAGS=a,b,c\n"
+        /* 要素数より少なければ残りは 0、空の値なら全要素 0 */
+        "ID=2 SAMPLES=9 COUNTS= FLAGS=x\n"
+        /* 同じキーが2回現れたら後の値で配列全体を置き換える */
+        "ID=3 COUNTS=4,5,6 COUNTS=7\n");
+    ASSERT_FALSE(path.empty());
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sample_cfg, array_mapping,
+                                            sizeof(array_rec_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(3u, rs->count);
+    const array_rec_t *r = (const array_rec_t *)rs->records;
+    EXPECT_FLOAT_EQ(0.5f, r[0].samples[0]);
+    EXPECT_FLOAT_EQ(1.25f, r[0].samples[1]);
+    EXPECT_FLOAT_EQ(-2.0f, r[0].samples[2]);
+    EXPECT_FLOAT_EQ(300.0f, r[0].samples[3]);
+    EXPECT_EQ(1, r[0].counts[0]);
+    EXPECT_EQ(-2, r[0].counts[1]);
+    EXPECT_EQ(3, r[0].counts[2]);
+    EXPECT_EQ(5000000000L, r[0].totals[0]);
+    EXPECT_EQ(-7L, r[0].totals[1]);
+    EXPECT_EQ(7, r[0].levels[0]);
+    EXPECT_EQ(8, r[0].levels[1]);
+    EXPECT_DOUBLE_EQ(0.125, r[0].weights[0]);
+    EXPECT_DOUBLE_EQ(2.5, r[0].weights[1]);
+    EXPECT_EQ(0, memcmp("abc", r[0].flags, 3));
+
+    EXPECT_FLOAT_EQ(9.0f, r[1].samples[0]);
+    EXPECT_FLOAT_EQ(0.0f, r[1].samples[3]);
+    EXPECT_EQ(0, r[1].counts[0]);
+    EXPECT_EQ(0, memcmp("x\0\0", r[1].flags, 3));
+    EXPECT_EQ(7, r[2].counts[0]);
+    EXPECT_EQ(0, r[2].counts[1]);
+    EXPECT_EQ(0, r[2].counts[2]);
+
+    /* 遅延変換でも同じ値になる */
+    ftcs_lazy_set_t *ls = ftcs_parse_lazy(path.c_str(), &sample_cfg, array_mapping,
+                                          sizeof(array_rec_t));
+    ASSERT_NE(nullptr, ls);
+    for (size_t i = 0; i < rs->count; i++) {
+        const void *rec = ftcs_lazy_record(ls, i);
+        ASSERT_NE(nullptr, rec);
+        EXPECT_EQ(0, memcmp(&r[i], rec, sizeof(array_rec_t))) << i;
+    }
+    ftcs_lazy_free(ls);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(ArrayField, RejectsInvalidElementsAndTooManyValues)
+{
+    const char *bad_lines[] = {
+        "ID=1 COUNTS=1,2,3,4\n",   /* 要素数の超過 */
+        "ID=1 COUNTS=1,x,3\n",     /* 数値でない要素 */
+        "ID=1 COUNTS=1,,3\n",      /* 空の要素 */
+        "ID=1 SAMPLES=1.5;2.5\n",  /* 区切りでない文字 */
+        "ID=1 FLAGS=a,b,c,d\n",
+    };
+    for (const char *line : bad_lines) {
+        ftcs_record_set_t *rs = parse_via_pipe(line, &sample_cfg, array_mapping,
+                                               sizeof(array_rec_t));
+        EXPECT_EQ(nullptr, rs) << line;
+        ftcs_record_set_free(rs);
+    }
+    /* 要素型に対応していない配列（文字列の配列）は変換時にエラー */
+    static const ftcs_field_mapping_t names_mapping[] = {
+        { "NAMES", 0, sizeof(char[4][8]), FTCS_TYPE_ARRAY, FTCS_TYPE_STRING },
+        { nullptr, 0, 0, FTCS_TYPE_INT, FTCS_TYPE_INT }
+    };
+    EXPECT_EQ(nullptr, parse_via_pipe("NAMES=a,b\n", &all_types_cfg, names_mapping, 32));
+}
+
+TEST(ArrayField, CannotBeUsedAsKeyFilterOrAggregate)
+{
+    std::string path = write_temp("ID=1 COUNTS=1,2,3\nID=2 COUNTS=4,5,6\n");
+    ASSERT_FALSE(path.empty());
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sample_cfg, array_mapping,
+                                            sizeof(array_rec_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(nullptr, ftcs_find_by_key(rs, array_mapping, "COUNTS", "1", sizeof(array_rec_t)));
+    EXPECT_EQ(nullptr, ftcs_key_index_build(rs, array_mapping, "COUNTS"));
+    EXPECT_EQ(nullptr, ftcs_range_index_build(rs, array_mapping, "COUNTS"));
+    EXPECT_EQ(-1, ftcs_record_set_sort(rs, array_mapping, "COUNTS"));
+    ftcs_agg_result_t res;
+    EXPECT_EQ(-1, ftcs_aggregate(rs, array_mapping, "COUNTS", FTCS_AGG_SUM, &res));
+
+    ftcs_parser_config_t filtered = sample_cfg;
+    filtered.filter = "COUNTS = 1";
+    EXPECT_EQ(nullptr, ftcs_parse_file(path.c_str(), &filtered, array_mapping,
+                                       sizeof(array_rec_t)));
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ31: レコード集合のメモリ使用量と切り詰め
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(RecordSetMemory, ReportsUsedReservedEmptyAndIndexBytes)
+{
+    std::string path = write_temp(sample_lines(1000));
+    ASSERT_FALSE(path.empty());
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &sample_cfg, sample_mapping,
+                                            sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_memory_info_t info;
+    ASSERT_EQ(0, ftcs_record_set_memory_info(rs, &info));
+    /* 倍々の拡張で 1000 件に 1024 スロットを確保している */
+    EXPECT_EQ(1000 * sizeof(sample_t), info.used_bytes);
+    EXPECT_EQ(rs->capacity * sizeof(sample_t), info.reserved_bytes);
+    EXPECT_EQ(1024u, rs->capacity);
+    EXPECT_EQ(0u, info.empty_bytes);
+    EXPECT_EQ(0u, info.trailing_empty);
+    /* パースで書き込んだページは物理メモリに載っている */
+    EXPECT_GE(info.resident_bytes, info.used_bytes / 2);
+
+    ftcs_key_index_t   *kidx = ftcs_key_index_build(rs, sample_mapping, "ID");
+    ftcs_range_index_t *ridx = ftcs_range_index_build(rs, sample_mapping, "VALUE");
+    ASSERT_NE(nullptr, kidx);
+    ASSERT_NE(nullptr, ridx);
+    EXPECT_GE(ftcs_key_index_bytes(kidx), 1000 * sizeof(size_t));
+    EXPECT_GE(ftcs_range_index_bytes(ridx), 1000 * (sizeof(uint64_t) + 2 * sizeof(size_t)));
+    EXPECT_EQ(0u, ftcs_key_index_bytes(nullptr));
+    EXPECT_EQ(0u, ftcs_range_index_bytes(nullptr));
+    ftcs_key_index_free(kidx);
+    ftcs_range_index_free(ridx);
+    ftcs_record_set_free(rs);
+
+    /* 配置位置指定モードの飛び番は空きスロットとして数える */
+    rs = parse_via_pipe("ID=2 LOCATION=A TEMP=1\nID=5 LOCATION=B TEMP=2\n",
+                        &sensor_index_field_cfg, sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(0, ftcs_record_set_memory_info(rs, &info));
+    EXPECT_EQ(5 * sizeof(sensor_t), info.used_bytes);
+    EXPECT_EQ(3 * sizeof(sensor_t), info.empty_bytes);
+    EXPECT_EQ(0u, info.trailing_empty);
+    ftcs_record_set_free(rs);
+
+    EXPECT_EQ(-1, ftcs_record_set_memory_info(nullptr, &info));
+    unlink(path.c_str());
+}
+
+TEST(RecordSetMemory, CompactShrinksToFitAndKeepsAppending)
+{
+    std::string path = write_temp(sample_lines(300000));
+    ASSERT_FALSE(path.empty());
+    ftcs_allocator_t     huge = ftcs_hugepage_allocator();
+    ftcs_parser_config_t huge_cfg = sample_cfg;
+    huge_cfg.allocator = &huge;
+    for (const ftcs_parser_config_t *cfg : { &sample_cfg, (const ftcs_parser_config_t *)&huge_cfg }) {
+        ftcs_checkpoint_t  cp = {};
+        ftcs_record_set_t *rs = nullptr;
+        ASSERT_EQ(300000, ftcs_parse_resume(&cp, path.c_str(), cfg, sample_mapping,
+                                            sizeof(sample_t), &rs));
+        ASSERT_EQ(524288u, rs->capacity);
+        const char *old_end = (const char *)rs->records + rs->capacity * sizeof(sample_t);
+
+        ASSERT_EQ(0, ftcs_record_set_compact(rs, 0));
+        EXPECT_EQ(300000u, rs->count);
+        EXPECT_EQ(300000u, rs->capacity);
+        const sample_t *r = static_cast<const sample_t *>(rs->records);
+        for (int i = 0; i < 300000; i++) {
+            ASSERT_EQ(i, r[i].id);
+        }
+        if (cfg == &huge_cfg) {
+            /* huge page アロケーターは切り詰めた末尾のページをマップから外す */
+            long          page = sysconf(_SC_PAGESIZE);
+            unsigned char vec;
+            uintptr_t     last = ((uintptr_t)old_end - 1) / page * page;
+            EXPECT_EQ(-1, mincore((void *)last, page, &vec));
+            EXPECT_EQ(ENOMEM, errno);
+        }
+
+        /* 縮めたあとも追記で容量が伸びる */
+        append_file(path, "ID=300000 NAME=Tail VALUE=1.5\n");
+        EXPECT_EQ(1, ftcs_parse_resume(&cp, path.c_str(), cfg, sample_mapping,
+                                       sizeof(sample_t), &rs));
+        EXPECT_EQ(300001u, rs->count);
+        EXPECT_EQ(300000, static_cast<const sample_t *>(rs->records)[300000].id);
+        ftcs_record_set_free(rs);
+        truncate(path.c_str(), (off_t)sample_lines(300000).size());
+    }
+
+    /* 0 件の集合でも records は有効なまま */
+    ftcs_record_set_t *rs = parse_via_pipe("# empty\n", &sample_cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(0, ftcs_record_set_compact(rs, 0));
+    EXPECT_EQ(0u, rs->count);
+    EXPECT_EQ(1u, rs->capacity);
+    EXPECT_NE(nullptr, rs->records);
+    ftcs_record_set_free(rs);
+    EXPECT_EQ(-1, ftcs_record_set_compact(nullptr, 0));
+    unlink(path.c_str());
+}
+
+TEST(RecordSetMemory, TrimEmptyDropsOnlyTrailingSlots)
+{
+    /* sensor_mapping に ID はないので、ID だけの行は全バイト 0 のスロットになる */
+    ftcs_record_set_t *rs = parse_via_pipe(
+        "ID=1 LOCATION=A TEMP=1\nID=3 LOCATION=C TEMP=3\nID=6\nID=40\n",
+        &sensor_index_field_cfg, sensor_mapping, sizeof(sensor_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(40u, rs->count);
+    ftcs_memory_info_t info;
+    ASSERT_EQ(0, ftcs_record_set_memory_info(rs, &info));
+    EXPECT_EQ(37u, info.trailing_empty);
+    EXPECT_EQ(38 * sizeof(sensor_t), info.empty_bytes);
+
+    /* フラグなしでは count は変えない */
+    ASSERT_EQ(0, ftcs_record_set_compact(rs, 0));
+    EXPECT_EQ(40u, rs->count);
+    EXPECT_EQ(40u, rs->capacity);
+    ASSERT_EQ(0, ftcs_record_set_compact(rs, FTCS_COMPACT_TRIM_EMPTY));
+    EXPECT_EQ(3u, rs->count);
+    EXPECT_EQ(3u, rs->capacity);
+    /* 手前の飛び番はそのままで、位置による検索は変わらない */
+    const sensor_t *s = static_cast<const sensor_t *>(ftcs_find_by_index(rs, "2", sizeof(sensor_t)));
+    ASSERT_NE(nullptr, s);
+    EXPECT_STREQ("C", s->location);
+    EXPECT_EQ(nullptr, ftcs_find_by_index(rs, "5", sizeof(sensor_t)));
+    ftcs_record_set_free(rs);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ32: 共有メモリリング
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(ShmRing, PushPopKeepsOrderAcrossWrapAndClose)
+{
+    size_t bytes = ftcs_shm_ring_bytes(sizeof(sample_t), 3);
+    ASSERT_EQ(ftcs_shm_ring_bytes(sizeof(sample_t), 4), bytes); /* 2 のべき乗に切り上げる */
+    void *shm = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, shm);
+    EXPECT_EQ(nullptr, ftcs_shm_ring_attach(shm, bytes, sizeof(sample_t), 0)); /* 未初期化 */
+    ftcs_shm_ring_t *prod = ftcs_shm_ring_init(shm, bytes, sizeof(sample_t), 1);
+    ASSERT_NE(nullptr, prod);
+    EXPECT_EQ(nullptr, ftcs_shm_ring_attach(shm, bytes, sizeof(sensor_t), 0));
+    EXPECT_EQ(nullptr, ftcs_shm_ring_attach(shm, bytes, sizeof(sample_t), 1));
+    ftcs_shm_ring_t *cons = ftcs_shm_ring_attach(shm, bytes, sizeof(sample_t), 0);
+    ASSERT_NE(nullptr, cons);
+
+    sample_t in[6] = {};
+    sample_t out[8];
+    for (int i = 0; i < 6; i++) {
+        in[i].id = i;
+    }
+    errno = 0;
+    EXPECT_EQ(-1, ftcs_shm_ring_pop(cons, out, 8, 0));
+    EXPECT_EQ(ETIMEDOUT, errno);
+    /* 満杯になった時点で待たずに戻る */
+    EXPECT_EQ(4, ftcs_shm_ring_push(prod, in, 6, 0));
+    ASSERT_EQ(3, ftcs_shm_ring_pop(cons, out, 3, 0));
+    EXPECT_EQ(0, out[0].id);
+    EXPECT_EQ(2, out[2].id);
+    /* 配列の末尾をまたいで書き込み、まとめて読み出す */
+    EXPECT_EQ(2, ftcs_shm_ring_push(prod, in + 4, 2, 0));
+    ASSERT_EQ(3, ftcs_shm_ring_pop(cons, out, 8, -1));
+    EXPECT_EQ(3, out[0].id);
+    EXPECT_EQ(4, out[1].id);
+    EXPECT_EQ(5, out[2].id);
+
+    /* 役割の違うハンドルは使えない */
+    EXPECT_EQ(-1, ftcs_shm_ring_push(cons, in, 1, 0));
+    EXPECT_EQ(-1, ftcs_shm_ring_pop(prod, out, 1, 0));
+    ftcs_shm_ring_close(prod);
+    EXPECT_EQ(0, ftcs_shm_ring_pop(cons, out, 8, -1));
+    EXPECT_EQ(-1, ftcs_shm_ring_push(prod, in, 1, 0));
+    ftcs_shm_ring_detach(cons);
+    ftcs_shm_ring_detach(prod);
+    munmap(shm, bytes);
+}
+
+TEST(ShmRing, ParserStreamsRecordsToConsumers)
+{
+    const int n = 5000;
+    std::string path = write_temp(sample_lines(n));
+    ASSERT_FALSE(path.empty());
+    /* 16 件のリングで 5000 件を渡すため、パース中から消費者が読み進めないと終わらない */
+    size_t bytes = ftcs_shm_ring_bytes(sizeof(sample_t), 16);
+    void *shm = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, shm);
+
+    /* 別プロセスの消費者へ ftcs_parse_file から渡す */
+    ftcs_shm_ring_t *prod = ftcs_shm_ring_init(shm, bytes, sizeof(sample_t), 1);
+    ASSERT_NE(nullptr, prod);
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        ftcs_shm_ring_t *cons = ftcs_shm_ring_attach(shm, bytes, sizeof(sample_t), 0);
+        sample_t out[5];
+        int      next = 0;
+        long     got;
+        while (cons && (got = ftcs_shm_ring_pop(cons, out, 5, 10000)) > 0) {
+            for (long i = 0; i < got; i++) {
+                if (out[i].id != next++) {
+                    _exit(2);
+                }
+            }
+        }
+        _exit(next == n ? 0 : 1);
+    }
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.ring = prod;
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ((size_t)n, rs->count);
+    ftcs_record_set_free(rs);
+    ftcs_shm_ring_close(prod);
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+    ftcs_shm_ring_detach(prod);
+
+    /* ftcs_parse_fd はパーサースレッドが複数でも出現順に書き込む */
+    prod = ftcs_shm_ring_init(shm, bytes, sizeof(sample_t), 1);
+    ASSERT_NE(nullptr, prod);
+    int next = 0;
+    std::thread consumer([&]() {
+        ftcs_shm_ring_t *cons = ftcs_shm_ring_attach(shm, bytes, sizeof(sample_t), 0);
+        sample_t out[7];
+        long     got;
+        while (cons && (got = ftcs_shm_ring_pop(cons, out, 7, 10000)) > 0) {
+            for (long i = 0; i < got && out[i].id == next; i++) {
+                next++;
+            }
+        }
+        ftcs_shm_ring_detach(cons);
+    });
+    cfg.ring           = prod;
+    cfg.stream_threads = 3;
+    rs = parse_via_pipe(sample_lines(n), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ftcs_record_set_free(rs);
+    ftcs_shm_ring_close(prod);
+    consumer.join();
+    EXPECT_EQ(n, next);
+
+    /* 消費者ハンドルやレコードサイズの違うリングは渡せない */
+    EXPECT_EQ(nullptr, ftcs_parse_file(path.c_str(), &cfg, sensor_mapping, sizeof(sensor_t)));
+    ftcs_shm_ring_detach(prod);
+    munmap(shm, bytes);
+    unlink(path.c_str());
+}
+
+TEST(ShmRing, BroadcastDeliversEveryRecordToEachConsumer)
+{
+    const int      n         = 20000;
+    const unsigned consumers = 3;
+    size_t bytes = ftcs_shm_ring_bytes(sizeof(int), 8);
+    void *shm = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, shm);
+    EXPECT_EQ(nullptr, ftcs_shm_ring_init(shm, bytes, sizeof(int), 0));
+    EXPECT_EQ(nullptr, ftcs_shm_ring_init(shm, bytes, sizeof(int), FTCS_SHM_RING_MAX_CONSUMERS + 1));
+    ftcs_shm_ring_t *prod = ftcs_shm_ring_init(shm, bytes, sizeof(int), consumers);
+    ASSERT_NE(nullptr, prod);
+
+    /* 消費者ごとに読む速さを変え、最も遅い消費者に生産者が合わせることを確かめる */
+    std::vector<long long> sums(consumers, 0);
+    std::vector<int>       counts(consumers, 0);
+    std::vector<std::thread> threads;
+    for (unsigned c = 0; c < consumers; c++) {
+        threads.emplace_back([&, c]() {
+            ftcs_shm_ring_t *cons = ftcs_shm_ring_attach(shm, bytes, sizeof(int), c);
+            int  out[4];
+            long got;
+            while (cons && (got = ftcs_shm_ring_pop(cons, out, c + 1, 10000)) > 0) {
+                for (long i = 0; i < got; i++) {
+                    if (out[i] != counts[c]) {
+                        return;
+                    }
+                    sums[c] += out[i];
+                    counts[c]++;
+                }
+            }
+            ftcs_shm_ring_detach(cons);
+        });
+    }
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ(1, ftcs_shm_ring_push(prod, &i, 1, 10000));
+    }
+    ftcs_shm_ring_close(prod);
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (unsigned c = 0; c < consumers; c++) {
+        EXPECT_EQ(n, counts[c]);
+        EXPECT_EQ((long long)n * (n - 1) / 2, sums[c]);
+    }
+    ftcs_shm_ring_detach(prod);
+    munmap(shm, bytes);
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ33: 共有メモリの更新通知
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(ShmNotify, WaitUpdateWakesOnPublishAndTimesOut)
+{
+    ftcs_shm_notify_t n    = {};
+    uint32_t          seen = 0;
+    EXPECT_EQ(0, ftcs_shm_wait_update(&n, &seen, 0));
+    EXPECT_EQ(0, ftcs_shm_wait_update(&n, &seen, 20));
+    EXPECT_EQ(-1, ftcs_shm_wait_update(nullptr, &seen, 0));
+    EXPECT_EQ(-1, ftcs_shm_wait_update(&n, nullptr, 0));
+    ftcs_shm_publish_begin(nullptr); /* NULL は何もしない */
+    ftcs_shm_publish_end(nullptr, 1);
+
+    /* 眠っている読み出し側が公開で起こされる */
+    int got = -2;
+    std::thread waiter([&]() { got = ftcs_shm_wait_update(&n, &seen, 10000); });
+    usleep(20000);
+    ftcs_shm_publish_begin(&n);
+    ftcs_shm_publish_end(&n, 42);
+    waiter.join();
+    EXPECT_EQ(1, got);
+    EXPECT_EQ(2u, seen);
+    EXPECT_EQ(42u, ftcs_shm_count(&n));
+    EXPECT_GT(n.publish_ns, 0u);
+    EXPECT_EQ(0u, n.waiters);
+
+    /* 書き込み中（奇数）の世代は新しい世代として受け取らない */
+    ftcs_shm_publish_begin(&n);
+    EXPECT_EQ(0, ftcs_shm_wait_update(&n, &seen, 10));
+    ftcs_shm_publish_end(&n, 43);
+    EXPECT_EQ(1, ftcs_shm_wait_update(&n, &seen, 0));
+    EXPECT_EQ(4u, seen);
+}
+
+TEST(ShmNotify, SeqlockReaderNeverSeesTornSnapshot)
+{
+    /* 書き込み側は全要素を同じ値で上書きし続け、読み出し側は異なる値が混ざらないことを確かめる */
+    const int         width  = 256;
+    const int         rounds = 2000;
+    ftcs_shm_notify_t n      = {};
+    std::vector<int>  snap(width, 0);
+    std::thread writer([&]() {
+        for (int r = 1; r <= rounds; r++) {
+            ftcs_shm_publish_begin(&n);
+            for (int i = 0; i < width; i++) {
+                __atomic_store_n(&snap[i], r, __ATOMIC_RELAXED);
+            }
+            ftcs_shm_publish_end(&n, (size_t)r);
+        }
+    });
+    int              torn = 0;
+    int              last = 0;
+    std::vector<int> copy(width);
+    while (last < rounds) {
+        uint32_t gen;
+        do {
+            gen = ftcs_shm_read_begin(&n);
+            for (int i = 0; i < width; i++) {
+                copy[i] = __atomic_load_n(&snap[i], __ATOMIC_RELAXED);
+            }
+        } while (ftcs_shm_read_retry(&n, gen));
+        torn += (int)std::count_if(copy.begin(), copy.end(), [&](int v) { return v != copy[0]; });
+        last = copy[0];
+    }
+    writer.join();
+    EXPECT_EQ(0, torn);
+    EXPECT_EQ((size_t)rounds, ftcs_shm_count(&n));
+}
+
+TEST(ShmNotify, WakesWaiterInAnotherProcess)
+{
+    auto *n = (ftcs_shm_notify_t *)mmap(nullptr, sizeof(ftcs_shm_notify_t), PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, (void *)n);
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        /* 3 回目の公開（世代 6）まで受け取り、その件数を確かめる */
+        uint32_t seen = 0;
+        while (seen != 6) {
+            if (ftcs_shm_wait_update(n, &seen, 10000) != 1) {
+                _exit(1);
+            }
+        }
+        _exit(ftcs_shm_count(n) == 3 ? 0 : 2);
+    }
+    for (size_t i = 1; i <= 3; i++) {
+        usleep(10000);
+        ftcs_shm_publish_begin(n);
+        ftcs_shm_publish_end(n, i);
+    }
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+    munmap(n, sizeof(*n));
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ34: 共有メモリのセグメント
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(ShmSegment, CreateSizesFromCountAndOpenSharesRecords)
+{
+    std::string name = "/ftcs_test_seg_" + std::to_string(getpid());
+    ftcs_shm_t  w;
+    ASSERT_EQ(0, ftcs_shm_create(&w, name.c_str(), sizeof(sample_t), 100,
+                                 FTCS_SHM_POPULATE | FTCS_SHM_MLOCK));
+    long page = sysconf(_SC_PAGESIZE);
+    EXPECT_EQ(0u, w.len % (size_t)page);
+    EXPECT_GE(w.capacity, 100u);
+    /* 端数のページまで容量に含める */
+    EXPECT_LT(w.len - w.capacity * sizeof(sample_t), (size_t)page + sizeof(sample_t));
+    EXPECT_EQ(0u, (uintptr_t)w.records % 64);
+    EXPECT_EQ(FTCS_SHM_POPULATE | FTCS_SHM_MLOCK, w.flags);
+    EXPECT_EQ(0u, ftcs_shm_count(w.notify));
+
+    /* 書き込み側が公開した内容と件数を読み出し側が読める */
+    ftcs_shm_t r;
+    ASSERT_EQ(0, ftcs_shm_open(&r, name.c_str(), sizeof(sample_t), 0));
+    EXPECT_EQ(w.capacity, r.capacity);
+    EXPECT_EQ(nullptr, r.name);
+    auto *recs = (sample_t *)w.records;
+    ftcs_shm_publish_begin(w.notify);
+    for (int i = 0; i < 100; i++) {
+        recs[i].id = i * 3;
+    }
+    ftcs_shm_publish_end(w.notify, 100);
+    uint32_t seen = 0;
+    EXPECT_EQ(1, ftcs_shm_wait_update(r.notify, &seen, 0));
+    EXPECT_EQ(100u, ftcs_shm_count(r.notify));
+    EXPECT_EQ(297, ((sample_t *)r.records)[99].id);
+
+    /* サイズ違い・存在しない名前は開けない */
+    ftcs_shm_t bad;
+    EXPECT_EQ(-1, ftcs_shm_open(&bad, name.c_str(), sizeof(sensor_t), 0));
+    EXPECT_EQ(-1, ftcs_shm_open(&bad, "/ftcs_test_no_such_segment", sizeof(sample_t), 0));
+    EXPECT_EQ(-1, ftcs_shm_create(&bad, nullptr, sizeof(sample_t), 1, 0));
+
+    /* 作成者が閉じると名前が消え、読み出し側のマップは残る */
+    ftcs_shm_close(&w);
+    ftcs_shm_close(&w); /* 二重に閉じても安全 */
+    EXPECT_EQ(nullptr, w.base);
+    EXPECT_EQ(-1, ftcs_shm_open(&bad, name.c_str(), sizeof(sample_t), 0));
+    EXPECT_EQ(297, ((sample_t *)r.records)[99].id);
+    ftcs_shm_close(&r);
+}
+
+TEST(ShmSegment, RecreateKeepsOldMappingAndHugePagesFallBack)
+{
+    std::string name = "/ftcs_test_seg_huge_" + std::to_string(getpid());
+    ftcs_shm_t  a;
+    ASSERT_EQ(0, ftcs_shm_create(&a, name.c_str(), sizeof(int), 10, 0));
+    ((int *)a.records)[0] = 7;
+
+    /* 同名で作り直しても、古いマップの内容は変わらない */
+    ftcs_shm_t b;
+    ASSERT_EQ(0, ftcs_shm_create(&b, name.c_str(), sizeof(int), 0, 0));
+    EXPECT_GT(b.capacity, 0u);
+    EXPECT_EQ(0, ((int *)b.records)[0]);
+    EXPECT_EQ(7, ((int *)a.records)[0]);
+    free(a.name); /* 古い方が閉じるときに新しい名前を消さないようにする */
+    a.name = nullptr;
+    ftcs_shm_close(&a);
+    ftcs_shm_close(&b);
+
+    /* 大きなページを確保できない環境でも 4KiB ページで作れ、効いた指定だけが残る */
+    ftcs_shm_t h;
+    ASSERT_EQ(0, ftcs_shm_create(&h, name.c_str(), sizeof(sample_t), 5000,
+                                 FTCS_SHM_HUGETLB | FTCS_SHM_THP | FTCS_SHM_POPULATE));
+    EXPECT_GE(h.capacity, 5000u);
+    EXPECT_TRUE(h.flags & FTCS_SHM_POPULATE);
+    if (h.flags & (FTCS_SHM_HUGETLB | FTCS_SHM_THP)) {
+        EXPECT_EQ(0u, h.len % (2u * 1024 * 1024));
+    }
+    ftcs_shm_t r;
+    ASSERT_EQ(0, ftcs_shm_open(&r, name.c_str(), sizeof(sample_t), FTCS_SHM_POPULATE));
+    EXPECT_EQ(h.capacity, r.capacity);
+    EXPECT_EQ(h.flags & FTCS_SHM_HUGETLB, r.flags & FTCS_SHM_HUGETLB);
+    ftcs_shm_close(&r);
+    ftcs_shm_close(&h);
+}
+
+TEST(ShmSegment, GrowPastCapacityReopensReaders)
+{
+    /* --follow の追記と同じく、最初の容量を超えて公開し続ける */
+    std::string name = "/ftcs_test_seg_grow_" + std::to_string(getpid());
+    ftcs_shm_t  w;
+    ASSERT_EQ(0, ftcs_shm_create(&w, name.c_str(), sizeof(int), 10, 0));
+    size_t first = w.capacity; // 最初の容量
+    ftcs_shm_publish_begin(w.notify);
+    for (size_t i = 0; i < first; i++) {
+        ((int *)w.records)[i] = (int)i;
+    }
+    ftcs_shm_publish_end(w.notify, first);
+
+    ftcs_shm_t r;
+    ASSERT_EQ(0, ftcs_shm_open(&r, name.c_str(), sizeof(int), 0));
+    uint32_t seen = 0;
+    ASSERT_EQ(1, ftcs_shm_wait_update(r.notify, &seen, 0));
+    EXPECT_EQ(0, ftcs_shm_replaced(&r));
+    EXPECT_EQ(-1, ftcs_shm_grow(&r, first * 2)); /* 読み出し側は作り直せない */
+
+    /* 眠っている読み出し側は作り直しで起こされ、置き換えを知る */
+    int woke = -1; // 待ち受けスレッドの ftcs_shm_wait_update の結果
+    std::thread waiter([&]() { woke = ftcs_shm_wait_update(r.notify, &seen, 5000); });
+    size_t total = first + 100; // 追記後の件数
+    ASSERT_EQ(0, ftcs_shm_grow(&w, total * 2));
+    waiter.join();
+    EXPECT_EQ(1, woke);
+    EXPECT_NE(0, ftcs_shm_replaced(&r));
+    EXPECT_GE(w.capacity, total * 2);
+    EXPECT_EQ(0, ftcs_shm_grow(&w, first)); /* 小さくはしない */
+
+    /* 追記分を新しいセグメントに公開する */
+    ftcs_shm_publish_begin(w.notify);
+    for (size_t i = first; i < total; i++) {
+        ((int *)w.records)[i] = (int)i;
+    }
+    ftcs_shm_publish_end(w.notify, total);
+
+    /* 開き直すと引き継いだ内容と追記分の両方が読める */
+    ftcs_shm_close(&r);
+    ASSERT_EQ(0, ftcs_shm_open(&r, name.c_str(), sizeof(int), 0));
+    EXPECT_EQ(w.capacity, r.capacity);
+    EXPECT_EQ(0, ftcs_shm_replaced(&r));
+    EXPECT_EQ(1, ftcs_shm_wait_update(r.notify, &seen, 0));
+    ASSERT_EQ(total, ftcs_shm_count(r.notify));
+    for (size_t i = 0; i < total; i++) {
+        ASSERT_EQ((int)i, ((const int *)r.records)[i]);
+    }
+    ftcs_shm_close(&r);
+
+    /* 作成者が閉じると新しい名前が消える */
+    ftcs_shm_close(&w);
+    EXPECT_EQ(-1, ftcs_shm_open(&r, name.c_str(), sizeof(int), 0));
+}
+
+/* ══════════════════════════════════════════════════════════
+ * グループ35: キー順の予測
+ * ══════════════════════════════════════════════════════════ */
+
+TEST(KeyOrder, RegularFileLearnsFromFirstLine)
+{
+    const int n = 1000;
+    std::string path = write_temp(sample_lines(n));
+    ASSERT_FALSE(path.empty());
+    ftcs_parse_stats_t   st  = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stats = &st;
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ((size_t)n, rs->count);
+    /* 最初の行の 3 キーだけを検索し、残りはすべて予測で決まる */
+    EXPECT_EQ(3u, st.key_misses);
+    EXPECT_EQ(3u * (n - 1), st.key_hits);
+    EXPECT_STREQ("N999", ((sample_t *)rs->records)[999].name);
+    ftcs_record_set_free(rs);
+
+    /* パーサースレッドが複数でも各スレッドの回数の合計になる */
+    cfg.stream_threads = 3;
+    rs = parse_via_pipe(sample_lines(n), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    EXPECT_EQ(3u * n, st.key_hits + st.key_misses);
+    EXPECT_GE(st.key_hits, 3u * (n - 3));
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+TEST(KeyOrder, MispredictionFallsBackAndRelearns)
+{
+    /* 2 行目で順序が変わり、3 行目で未知のキーが挟まる。4 行目は 3 行目と同じ並び */
+    std::string path = write_temp("ID=1 NAME=A VALUE=1.0\n"
+                                  "VALUE=2.0 ID=2 NAME=B\n"
+                                  "VALUE=3.0 EXTRA=x ID=3 NAME=C\n"
+                                  "VALUE=4.0 EXTRA=y ID=4 NAME=D\n"
+                                  "VALUE=5.0 NAM=E\n");
+    ASSERT_FALSE(path.empty());
+    ftcs_parse_stats_t   st  = {};
+    ftcs_parser_config_t cfg = sample_cfg;
+    cfg.stats = &st;
+    ftcs_record_set_t *rs = ftcs_parse_file(path.c_str(), &cfg, sample_mapping, sizeof(sample_t));
+    ASSERT_NE(nullptr, rs);
+    ASSERT_EQ(5u, rs->count);
+    const sample_t *r = (const sample_t *)rs->records;
+    EXPECT_EQ(2, r[1].id);
+    EXPECT_STREQ("B", r[1].name);
+    EXPECT_DOUBLE_EQ(3.0, r[2].value);
+    EXPECT_STREQ("C", r[2].name);
+    EXPECT_EQ(4, r[3].id);
+    EXPECT_STREQ("D", r[3].name);
+    /* 長さの違う前方一致のキーは予測に一致させない */
+    EXPECT_STREQ("", r[4].name);
+    EXPECT_EQ(3u, st.unknown_keys);
+    /* 外れ: 1行目 3 + 2行目 3 + 3行目 3（VALUE のみ当たる）+ 5行目 1（NAM）。
+     * 4行目は未知のキー EXTRA も 3 行目から予測でき、4 キーとも当たる */
+    EXPECT_EQ(10u, st.key_misses);
+    EXPECT_EQ(6u, st.key_hits);
+    ftcs_record_set_free(rs);
+    unlink(path.c_str());
+}
+
+/* ── ヘルパー ───────────────────────────────────────────── */
+
+/**
+ * @brief テスト用のパーサー設定を生成する（未指定メンバはゼロ = デフォルト）
+ * @param primary_key      プライマリキーのフィールド名
+ * @param mode             キー検索モード
+ * @param index_field_name 配置位置フィールド名（NULL で順次モード）
+ * @return パーサー設定
+ */
+static ftcs_parser_config_t parser_cfg(const char *primary_key,
+                                       ftcs_primary_key_mode_t mode,
+                                       const char *index_field_name)
+{
+    ftcs_parser_config_t cfg = {};
+    cfg.comment_char     = '#';
+    cfg.kv_separator     = "=";
+    cfg.primary_key      = primary_key;
+    cfg.primary_key_mode = mode;
+    cfg.index_field_name = index_field_name;
+    return cfg;
+}
+
+/**
+ * @brief test/data/ ディレクトリ内のファイルパスを解決する
+ * @param name ファイル名
+ * @return test/data/<name> の絶対パス文字列
+ */
+static std::string data(const char *name)
+{
+    return std::string(TEST_DATA_DIR) + "/" + name;
+}
+
+/**
+ * @brief 一時ファイルを作成して内容を書き込む
+ * @param content 書き込む内容
+ * @return 作成した一時ファイルのパス（呼び出し側で unlink すること）
+ */
+static std::string write_temp(const std::string &content)
+{
+    char path[] = "/tmp/ftcs_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return std::string();
+    }
+    size_t done = 0;
+    while (done < content.size()) {
+        ssize_t n = write(fd, content.data() + done, content.size() - done);
+        if (n <= 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+    close(fd);
+    return path;
+}
+
+/**
+ * @brief 別スレッドからパイプへ内容を書き込み、読み込み側を ftcs_parse_fd でパースする
+ * @param content     パイプへ流す内容
+ * @param cfg         パーサー設定
+ * @param mapping     フィールドマッピングテーブル
+ * @param struct_size 1レコードのバイトサイズ
+ * @return ftcs_parse_fd の戻り値
+ */
+static ftcs_record_set_t *parse_via_pipe(const std::string &content,
+                                         const ftcs_parser_config_t *cfg,
+                                         const ftcs_field_mapping_t *mapping,
+                                         size_t struct_size)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return nullptr;
+    }
+    std::thread writer([&content, wfd = fds[1]]() {
+        size_t done = 0;
+        while (done < content.size()) {
+            ssize_t n = write(wfd, content.data() + done, content.size() - done);
+            if (n <= 0) {
+                break;
+            }
+            done += (size_t)n;
+        }
+        close(wfd);
+    });
+    ftcs_record_set_t *rs = ftcs_parse_fd(fds[0], cfg, mapping, struct_size);
+    /* パース失敗時は読み手がいなくなるため、残りを読み捨てて書き手を終わらせる */
+    char sink[4096];
+    while (read(fds[0], sink, sizeof(sink)) > 0) {
+    }
+    writer.join();
+    close(fds[0]);
+    return rs;
+}
+
+/**
+ * @brief sample 形式のレコード行を n 行生成する（ID は 0 から連番）
+ * @param n 行数
+ * @return 生成した内容
+ */
+static std::string sample_lines(int n)
+{
+    std::string content;
+    for (int i = 0; i < n; i++) {
+        content += "ID=" + std::to_string(i) + " NAME=N" + std::to_string(i) + " VALUE=1.5\n";
+    }
+    return content;
+}
+
+/**
+ * @brief テスト用の一意なソケットファイルパスを返す（ファイルは作成しない）
+ * @return /tmp 配下のパス
+ */
+static std::string temp_socket_path()
+{
+    static int seq = 0;
+    return "/tmp/ftcs_test_" + std::to_string(getpid()) + "_" + std::to_string(seq++) + ".sock";
 }